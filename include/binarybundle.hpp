@@ -0,0 +1,108 @@
+#ifndef CODEBUNDLER_BINARYBUNDLE_HPP
+#define CODEBUNDLER_BINARYBUNDLE_HPP
+
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace codebundler {
+namespace binary {
+
+    constexpr std::uint32_t FORMAT_VERSION = 2;
+    constexpr std::uint64_t BLOB_ALIGNMENT = 4096; // Content blobs start on page boundaries
+
+    /**
+     * @brief A file to be stored in a bundle: path, raw content and permission bits.
+     */
+    struct FileEntry {
+        std::string path;
+        std::string content;
+        std::uint32_t mode = 0644;
+    };
+
+    /**
+     * @brief Everything a bundle holds, independent of its on-disk format.
+     */
+    struct BundleContents {
+        std::string separator;
+        std::string description;
+        std::vector<FileEntry> entries;
+    };
+
+    /**
+     * @brief One record of the entry table of a binary bundle.
+     */
+    struct Entry {
+        std::string path;
+        std::uint32_t mode = 0;
+        std::uint64_t offset = 0; // Blob position from the start of the bundle
+        std::uint64_t length = 0;
+        std::string checksum; // Checksum of the blob, as written on a text bundle's "Checksum:" line
+    };
+
+    /**
+     * @brief Writes a binary (format v2) bundle.
+     *
+     * Layout: a fixed 64-byte header, a string table holding the separator,
+     * description and all paths, a table of fixed 64-byte entry records
+     * (path reference, mode, checksum type, blob offset, blob length, raw
+     * SHA-256 or SHA-256 tree root), then the content blobs, each starting on
+     * a BLOB_ALIGNMENT boundary. All integers are little-endian. Content is stored byte for byte, so binary files and
+     * files without a trailing newline round-trip exactly.
+     *
+     * @param outputStream The stream to write to (no seeking needed).
+     * @param separator The separator to use when the bundle is converted back to text.
+     * @param description The bundle description.
+     * @param entries The files, in bundle order.
+     * @param checksumType "sha256" or "sha256-tree".
+     * @param jobs Number of hashing threads (0 - one per hardware thread).
+     * @throws FileIOException If writing fails.
+     */
+    void writeBundle(std::ostream& outputStream, const std::string& separator, const std::string& description, const std::vector<FileEntry>& entries,
+        const std::string& checksumType = "sha256", int jobs = 0);
+
+    /**
+     * @brief Checks whether data starts with the binary bundle magic number.
+     * @param data The first bytes of a bundle (at least 8 for a positive answer).
+     * @return True if the data looks like a binary bundle.
+     */
+    bool isBinaryBundle(std::string_view data);
+
+    /**
+     * @brief Read-only view of a binary bundle held in memory (typically a mapping).
+     * Only the header, string table and entry table are decoded; blobs are not touched
+     * until content() is used.
+     */
+    class Reader {
+    public:
+        /**
+         * @brief Decodes the tables of a binary bundle.
+         * @param data The whole bundle; must outlive the reader.
+         * @throws BundleFormatException If the bundle is malformed or of an unknown version.
+         */
+        explicit Reader(std::string_view data);
+
+        const std::string& separator() const { return m_separator; }
+        const std::string& description() const { return m_description; }
+        const std::vector<Entry>& entries() const { return m_entries; }
+
+        /**
+         * @brief Returns the content blob of an entry.
+         * @param entry An entry of this bundle.
+         * @return A view into the bundle data.
+         */
+        std::string_view content(const Entry& entry) const;
+
+    private:
+        std::string_view m_data;
+        std::string m_separator;
+        std::string m_description;
+        std::vector<Entry> m_entries;
+    };
+
+} // namespace binary
+} // namespace codebundler
+
+#endif // CODEBUNDLER_BINARYBUNDLE_HPP
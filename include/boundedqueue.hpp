@@ -0,0 +1,84 @@
+#ifndef CODEBUNDLER_BOUNDEDQUEUE_HPP
+#define CODEBUNDLER_BOUNDEDQUEUE_HPP
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <optional>
+
+namespace codebundler {
+
+/**
+ * @brief A fixed-capacity queue connecting two pipeline stages.
+ *
+ * push() blocks while the queue is full and pop() while it is empty, so a fast
+ * stage cannot run arbitrarily far ahead of a slow one. Closing the queue wakes
+ * both sides: later pushes fail, and pops drain what is left and then report
+ * the end. Either side may close, which is how a failing stage stops the other.
+ */
+template <typename T>
+class BoundedQueue {
+public:
+    explicit BoundedQueue(size_t capacity)
+        : m_capacity(capacity == 0 ? 1 : capacity)
+    {
+    }
+
+    /**
+     * @brief Appends an item, waiting for room.
+     * @param item The item to append.
+     * @return False if the queue was closed (the item is dropped).
+     */
+    bool push(T item)
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_notFull.wait(lock, [this] { return m_closed || m_items.size() < m_capacity; });
+        if (m_closed) {
+            return false;
+        }
+        m_items.push_back(std::move(item));
+        m_notEmpty.notify_one();
+        return true;
+    }
+
+    /**
+     * @brief Removes the oldest item, waiting for one to arrive.
+     * @return The item, or nothing once the queue is closed and empty.
+     */
+    std::optional<T> pop()
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_notEmpty.wait(lock, [this] { return m_closed || !m_items.empty(); });
+        if (m_items.empty()) {
+            return std::nullopt;
+        }
+        T item = std::move(m_items.front());
+        m_items.pop_front();
+        m_notFull.notify_one();
+        return item;
+    }
+
+    /**
+     * @brief Marks the end of input and wakes all waiting threads.
+     */
+    void close()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_closed = true;
+        m_notEmpty.notify_all();
+        m_notFull.notify_all();
+    }
+
+private:
+    size_t m_capacity;
+    bool m_closed = false;
+    std::deque<T> m_items;
+    std::mutex m_mutex;
+    std::condition_variable m_notEmpty;
+    std::condition_variable m_notFull;
+};
+
+} // namespace codebundler
+
+#endif // CODEBUNDLER_BOUNDEDQUEUE_HPP
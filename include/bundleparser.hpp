@@ -1,12 +1,14 @@
 #ifndef BUNDLEPARSER_HPP
 #define BUNDLEPARSER_HPP
 
+#include "dedupindex.hpp"
 #include "options.hpp"
 #include "FSMgine/FSMgine.hpp"
 
 #include <filesystem>
 #include <functional>
 #include <optional>
+#include <set>
 #include <string>
 #include <vector>
 
@@ -21,6 +23,10 @@ class BundleParser {
 public:
     // Public type alias for Hasher
     using Hasher = std::function<std::string(const std::string&)>;
+    // Receives each verified entry (and its calculated checksum, if any) instead of it being written below the output path
+    using EntryHandler = std::function<void(const std::string& filename, std::string content, const std::string& checksum)>;
+    // Told about each entry whose file was written (not called for trial runs or handed-off entries)
+    using SavedHandler = std::function<void(const std::string& filename, const std::string& checksum)>;
 
     // --- Constructor ---
     BundleParser(const codebundler::Options& options, Hasher hasher, std::filesystem::path outputPath = ".");
@@ -28,10 +34,60 @@ public:
     // --- Public Methods ---
     bool haveContent() const
     {
-        return !lines_.empty();
+        return !lines_.empty() || !block_.empty();
     }
     bool parse(const InputType& input);
 
+    /**
+     * @brief Tells the reader how many raw bytes the next input must be.
+     * After a "Length:" header the parser expects the entry content as one block
+     * of exactly that many bytes (fed to parse() as a single input) instead of lines.
+     * @return The expected block size, or nothing if lines are expected.
+     */
+    std::optional<size_t> pendingBlockLength() const;
+
+    /**
+     * @brief Feeds the rest of an entry's content as one block instead of line by line.
+     * Used when the reader already knows where the entry ends (e.g. from a separator scan);
+     * only a separator (or EOF) may follow.
+     * @param content The raw content bytes, newline-terminated.
+     * @return True if parsing is done.
+     */
+    bool parseBlock(const std::string& content);
+
+    /**
+     * @brief Hands verified entries to a callback instead of writing them to files.
+     * @param handler The callback (an empty function restores writing to files).
+     */
+    void setEntryHandler(EntryHandler handler) { entryHandler_ = std::move(handler); }
+
+    /**
+     * @brief Reports each entry once its file is in place, e.g. to journal it.
+     * @param handler The callback (an empty function stops reporting).
+     */
+    void setSavedHandler(SavedHandler handler) { savedHandler_ = std::move(handler); }
+
+    /**
+     * @brief Returns the text of the header's "Description:" line, once it was parsed.
+     */
+    const std::string& description() const { return description_; }
+
+    /**
+     * @brief Returns true once the header comment declared "Length:" entry headers.
+     * Without that declaration a "Length:" line after the checksum is content.
+     */
+    bool lengthHeaders() const { return lengthHeaders_; }
+
+    /**
+     * @brief Returns true once the header comment declared "Tokens:" entry headers.
+     */
+    bool tokenHeaders() const { return tokenHeaders_; }
+
+    /**
+     * @brief Returns the entries selected with --only that were found so far.
+     */
+    const std::set<std::string>& selectedFiles() const { return selectedFiles_; }
+
 private:
     // FSM for state management
     fsmgine::FSM<InputType> fsm_;
@@ -39,11 +95,21 @@ private:
     int lineCount_ = 0;
     codebundler::Options options_;
     Hasher hasher_;
+    codebundler::DedupIndex dedup_; // Must follow options_
+    EntryHandler entryHandler_;
+    SavedHandler savedHandler_;
     std::string separator_; // Determined at runtime
+    std::string description_;
     std::string filename_;
     std::string checksum_;
     std::filesystem::path outputPath_;
     std::vector<std::string> lines_;
+    std::set<std::string> selectedFiles_;
+    std::string block_; // Content read in one piece after a "Length:" header
+    std::optional<size_t> blockLength_;
+    bool blockInput_ = false; // The current input is a content block, not a line
+    bool lengthHeaders_ = false; // Declared by an ENTRY_HEADERS_PREFIX line in a comment
+    bool tokenHeaders_ = false; // Likewise
 
     // --- Private Helper Methods ---
     std::string trim(const std::string& str);
@@ -53,13 +119,20 @@ private:
     bool isSeparator(const InputType& input) const;
     bool isFilename(const InputType& input) const;
     bool isChecksum(const InputType& input) const;
+    bool isLength(const InputType& input) const;
+    bool isTokens(const InputType& input) const;
+    bool isBlock(const InputType& input) const;
     bool isEOF(const InputType& input) const;
 
     // --- Actions (converted from static to member functions) ---
     void rememberSeparator(const InputType& input);
+    void rememberDescription(const InputType& input);
+    void rememberCommentLine(const InputType& input);
     void rememberFilename(const InputType& input);
     void rememberChecksum(const InputType& input);
     void rememberContentLine(const InputType& input);
+    void rememberLength(const InputType& input);
+    void rememberContentBlock(const InputType& input);
     void saveFile(const InputType& input);
     void skip(const InputType& input);
     void errorMissingFilename(const InputType& input);
@@ -1,13 +1,21 @@
 #ifndef CODEBUNDLER_BUNDLER_HPP
 #define CODEBUNDLER_BUNDLER_HPP
 
+#include "binarybundle.hpp"
+#include "filecache.hpp"
 #include "options.hpp"
+#include <cstdint>
+#include <filesystem> // Requires C++17
 #include <iosfwd> // Forward declaration for std::ostream
 #include <string>
+#include <string_view>
+#include <unordered_map>
 #include <vector>
 
 namespace codebundler {
 
+class OutputSink;
+
 /**
  * @brief Creates a CodeBundle archive from files tracked by Git.
  */
@@ -15,12 +23,14 @@ class Bundler {
 public:
     /**
      * @brief Constructs a Bundler object.
-     * @param separator The boundary marker to use between files in the bundle.
+     * @param options Configuration options for bundling.
+     * @param cache Optional cache of file contents and checksums shared between runs (not owned).
      */
-    explicit Bundler(const Options& options);
+    explicit Bundler(const Options& options, FileCache* cache = nullptr);
 
     /**
-     * @brief Bundles files tracked by `git ls-files` into the provided output stream.
+     * @brief Bundles files tracked by `git ls-files` (or, with the walk option, all files not
+     * ignored by .gitignore/.ignore rules) into the provided output stream.
      * @param outputStream The stream to write the bundle content to.
      * @param description An optional description to include in the bundle header.
      * @throws GitCommandException If `git ls-files` fails.
@@ -29,6 +39,16 @@ public:
      */
     void bundleToStream(std::ostream& outputStream, const std::string& description = "");
 
+    /**
+     * @brief Bundles the files bundleToStream() would bundle into a file descriptor, e.g. stdout.
+     * Text bundles are written with one gathered write per large entry; other formats are buffered.
+     * @param fd The descriptor to write to (not closed).
+     * @param description An optional description to include in the bundle header.
+     * @throws GitCommandException If `git ls-files` fails.
+     * @throws FileIOException If any tracked file cannot be read or writing fails.
+     */
+    void bundleToFd(int fd, const std::string& description = "");
+
     /**
      * @brief Bundles files tracked by `git ls-files` into a specified file.
      * @param outputFilePath The path to the bundle file to create.
@@ -39,8 +59,51 @@ public:
      */
     void bundleToFile(const std::string& outputFilePath, const std::string& description = "");
 
-private:
-    Options m_options;
+    /**
+     * @brief Bundles the files bundleToStream() would bundle into several self-contained
+     * bundles of about shardSize bytes each, plus a manifest listing them.
+     * Files are assigned by their size on disk, largest first, to the smallest shard so far;
+     * each shard has its own header and whole entries in the usual order.
+     * @param pathPattern Shard file names with one %d or %0Nd placeholder for the shard number;
+     * the manifest is written to the name with "manifest" in its place.
+     * @param shardSize The target shard size in bytes (non-zero).
+     * @param description An optional description for the shard headers and the manifest.
+     * @return The path of the manifest.
+     * @throws FileIOException If a file cannot be read or a shard cannot be written.
+     */
+    std::string bundleToShards(const std::string& pathPattern, std::uint64_t shardSize, const std::string& description = "");
+
+    /**
+     * @brief Bundles the files of a git revision into the provided output stream.
+     * Contents come from the object database through one `git cat-file --batch` process,
+     * so the working tree and index are neither read nor changed.
+     * @param outputStream The stream to write the bundle content to.
+     * @param revision The commit or tree to bundle (e.g. "HEAD~3", a tag or a hash).
+     * @param description An optional description to include in the bundle header.
+     * @throws GitCommandException If the revision cannot be listed or an object cannot be read.
+     * @throws CodeBundlerException If a file contains the separator (text bundles).
+     */
+    void bundleRevisionToStream(std::ostream& outputStream, const std::string& revision, const std::string& description = "");
+
+    /**
+     * @brief Bundles an already gathered list of files into the provided output stream.
+     * @param outputStream The stream to write the bundle content to.
+     * @param filesToBundle Paths relative to the root directory, in bundle order.
+     * @param description An optional description to include in the bundle header.
+     * @throws FileIOException If any file cannot be read.
+     */
+    void bundleFilesToStream(std::ostream& outputStream, const std::vector<std::string>& filesToBundle, const std::string& description = "");
+
+    /**
+     * @brief Writes already loaded entries as a bundle in the configured format.
+     * Used to convert between formats; the separator given in the options is replaced by
+     * the one in contents, if any.
+     * @param outputStream The stream to write the bundle to.
+     * @param contents The separator, description and entries to write.
+     * @throws CodeBundlerException If an entry cannot be represented in a text bundle.
+     * @throws FileIOException If writing fails.
+     */
+    void bundleContentsToStream(std::ostream& outputStream, const binary::BundleContents& contents);
 
     /**
      * @brief Writes the bundle header to the output stream.
@@ -56,6 +119,124 @@ private:
      * @throws FileIOException If the file cannot be read.
      */
     void writeFileEntry(std::ostream& outputStream, const std::string& filePath);
+
+    /**
+     * @brief Writes a single file entry to a sink from one private read of the file.
+     * @param sink The sink to write to.
+     * @param filePath The path of the file to include.
+     * @throws FileIOException If the file cannot be read or writing fails.
+     */
+    void writeFileEntry(OutputSink& sink, const std::string& filePath);
+
+    /**
+     * @brief Writes a single entry from newline-terminated content and its checksum.
+     * @param outputStream The stream to write to.
+     * @param filePath The path stored in the entry.
+     * @param content The content, as produced by readFileContent.
+     * @param checksum The checksum of content, as written on the "Checksum:" line.
+     * @throws CodeBundlerException If the content contains the separator.
+     */
+    void writeEntry(std::ostream& outputStream, const std::string& filePath, const std::string& content, const std::string& checksum);
+
+    /**
+     * @brief Writes a single entry from newline-terminated content as one gathered write.
+     * @param sink The sink to write to.
+     * @param filePath The path stored in the entry.
+     * @param content The content, ending with a newline unless empty.
+     * @param checksum The checksum of content.
+     * @throws CodeBundlerException If the content contains the separator.
+     */
+    void writeEntry(OutputSink& sink, const std::string& filePath, std::string_view content, const std::string& checksum);
+
+private:
+    Options m_options;
+    FileCache* m_cache;
+    std::unordered_map<std::string, std::uint64_t> m_tokenCounts; // Written as "Tokens:" headers; set by a token budget
+
+    /**
+     * @brief Returns the location of a file to bundle.
+     * @param filePath A path relative to the root directory.
+     * @return The path to open.
+     */
+    std::filesystem::path filePathOf(const std::string& filePath) const;
+
+    /**
+     * @brief Returns the configured separator, or with --separator auto one no entry collides with.
+     * @param entries The entries that will be bundled.
+     * @return The separator to write.
+     */
+    std::string pickSeparator(const std::vector<binary::FileEntry>& entries) const;
+
+    /**
+     * @brief Returns the header lines of an entry (filename, checksum and, if set, tokens and length).
+     * @param filePath The path stored in the entry.
+     * @param checksum The checksum of the content.
+     * @param contentSize The size of the content as stored (newline-terminated).
+     * @return The lines.
+     */
+    std::string entryHeader(const std::string& filePath, const std::string& checksum, size_t contentSize) const;
+
+    /**
+     * @brief Lists the files to bundle: git's tracked files (of each listed repository) or the walk, then the file filters.
+     * @return Paths relative to the root directory, in bundle order.
+     */
+    std::vector<std::string> gatherFiles();
+
+    /**
+     * @brief Lists the tracked files of every repository in Options::repositories concurrently.
+     * @return Paths relative to the root directory, prefixed with their repository's directory;
+     * repositories in list order, each in git's order.
+     * @throws GitCommandException If a directory is not a repository.
+     */
+    std::vector<std::string> gatherRepositoryFiles();
+
+    /**
+     * @brief Keeps the highest-priority files that fit the token budget.
+     * Token counts are estimated in parallel and cached like checksums; files too large
+     * to fit by their size alone are not read.
+     * @param files Paths relative to the root directory, in bundle order.
+     * @return The chosen paths, in bundle order.
+     */
+    std::vector<std::string> selectForTokenBudget(const std::vector<std::string>& files);
+
+    bool hasFileFilters() const
+    {
+        return !m_options.includePatterns.empty() || !m_options.excludePatterns.empty() || m_options.maxFileSize > 0 || m_options.skipBinary
+            || m_options.stats;
+    }
+
+    /**
+     * @brief Bundles an already gathered list of files into a sink.
+     * Text bundles with a fixed separator are written entry by entry; other formats through the sink's buffer.
+     * @param sink The sink to write to.
+     * @param filesToBundle Paths relative to the root directory, in bundle order.
+     * @param description The optional description text.
+     */
+    void bundleFilesToSink(OutputSink& sink, const std::vector<std::string>& filesToBundle, const std::string& description);
+
+    /**
+     * @brief Renders all entries in parallel and writes them as a compressed container.
+     * @param outputStream The stream to write the container to.
+     * @param filesToBundle Paths relative to the root directory, in bundle order.
+     * @param description The optional description text.
+     */
+    void writeCompressedBundle(std::ostream& outputStream, const std::vector<std::string>& filesToBundle, const std::string& description);
+
+    /**
+     * @brief Reads all files byte for byte in parallel and writes them as a binary (v2) or NDJSON bundle.
+     * @param outputStream The stream to write the bundle to.
+     * @param filesToBundle Paths relative to the root directory, in bundle order.
+     * @param description The optional description text.
+     */
+    void writeRawBundle(std::ostream& outputStream, const std::vector<std::string>& filesToBundle, const std::string& description);
+
+    /**
+     * @brief Writes entries holding exact file bytes in the configured raw format ("v2" or "ndjson").
+     * @param outputStream The stream to write the bundle to.
+     * @param description The optional description text.
+     * @param entries The files, in bundle order.
+     */
+    void writeRawEntries(std::ostream& outputStream, const std::string& description, const std::vector<binary::FileEntry>& entries);
 };
 
 } // namespace codebundler
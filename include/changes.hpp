@@ -0,0 +1,134 @@
+#ifndef CODEBUNDLER_CHANGES_HPP
+#define CODEBUNDLER_CHANGES_HPP
+
+#include "binarybundle.hpp"
+#include <cstdint>
+#include <filesystem> // Requires C++17
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace codebundler {
+
+class HashCache;
+
+namespace changes {
+
+    /**
+     * @brief Path and checksum of one bundle entry, as read from its header or entry table.
+     */
+    struct IndexEntry {
+        std::string path;
+        std::string checksum;
+        std::uint64_t offset = 0; // Content position in the bundle (text bundles: after decompression)
+        std::uint64_t length = 0;
+        std::uint64_t tokens = 0; // From the entry's "Tokens:" header; 0 if it has none
+    };
+
+    /**
+     * @brief The entries of a bundle without their content.
+     */
+    struct BundleIndex {
+        bool normalized = true; // Checksums cover newline-terminated content (text bundles); false - raw bytes (v2)
+        std::vector<IndexEntry> entries;
+    };
+
+    /**
+     * @brief Indexes a plain text, binary or NDJSON bundle held in memory.
+     * Binary and NDJSON bundles are read from their entry metadata; text bundles only at their separator
+     * lines, so entry content is located but never copied or hashed.
+     * @param data The whole bundle (not compressed).
+     * @return The entries, in bundle order.
+     * @throws BundleFormatException If the bundle format is invalid.
+     */
+    BundleIndex indexBuffer(std::string_view data);
+
+    enum class Change {
+        Added,
+        Deleted,
+        Modified
+    };
+
+    /**
+     * @brief One path that differs between two file sets.
+     */
+    struct Difference {
+        Change change;
+        std::string path;
+    };
+
+    /**
+     * @brief Returns the status letter of a change: 'A', 'D' or 'M'.
+     * @param change The change.
+     * @return The letter.
+     */
+    char changeLetter(Change change);
+
+    /**
+     * @brief Checks whether the checksums of two indexes can be compared directly:
+     * both cover the same form of content, and each shared path uses one checksum type.
+     * @param from The first index.
+     * @param to The second index.
+     * @return True if compare() gives exact answers for these indexes.
+     */
+    bool comparable(const BundleIndex& from, const BundleIndex& to);
+
+    /**
+     * @brief Compares two indexes by path and checksum.
+     * @param from The old state.
+     * @param to The new state.
+     * @return The differences, ordered by path.
+     */
+    std::vector<Difference> compare(const BundleIndex& from, const BundleIndex& to);
+
+    /**
+     * @brief Builds an index from loaded entries, hashing newline-terminated content with SHA-256.
+     * Used when two bundles cannot be compared by their stored checksums.
+     * @param contents The entries.
+     * @param jobs Number of hashing threads (0 - one per hardware thread).
+     * @return A normalized index.
+     */
+    BundleIndex indexContents(const binary::BundleContents& contents, int jobs);
+
+    /**
+     * @brief Compares a bundle with a working tree, hashing only files whose cached checksum is stale.
+     * @param bundle The index of the bundle.
+     * @param root The working tree.
+     * @param files The files of the working tree, relative to root.
+     * @param cache Checksums remembered from earlier runs.
+     * @param jobs Number of hashing threads (0 - one per hardware thread).
+     * @return The differences (Added - only in the working tree), ordered by path.
+     * @throws FileIOException If a file cannot be read.
+     */
+    std::vector<Difference> status(const BundleIndex& bundle, const std::filesystem::path& root, const std::vector<std::string>& files, HashCache& cache, int jobs);
+
+    /**
+     * @brief Indexes working tree files the way a bundle of them would be indexed.
+     * @param root The working tree.
+     * @param files The files, relative to root.
+     * @param type "sha256" or "sha256-tree".
+     * @param normalized True to hash as text bundles do, false for raw bytes (v2).
+     * @param cache Checksums remembered from earlier runs.
+     * @param jobs Number of hashing threads (0 - one per hardware thread).
+     * @return The index.
+     * @throws FileIOException If a file cannot be read.
+     */
+    BundleIndex indexDirectory(const std::filesystem::path& root, const std::vector<std::string>& files, const std::string& type, bool normalized,
+        HashCache& cache, int jobs);
+
+    /**
+     * @brief Computes a Merkle root over the (path, checksum) pairs of an index, sorted by path.
+     *
+     * A leaf hashes as SHA-256(0x00 || path || 0x00 || checksum), an inner node as
+     * SHA-256(0x01 || left || right), pairing nodes level by level as the tree
+     * checksum does. Equal file sets give equal roots whatever their bundle order.
+     *
+     * @param index The index.
+     * @return The root as a hexadecimal string.
+     */
+    std::string fingerprint(const BundleIndex& index);
+
+} // namespace changes
+} // namespace codebundler
+
+#endif // CODEBUNDLER_CHANGES_HPP
@@ -0,0 +1,137 @@
+#ifndef CODEBUNDLER_CHUNKSTORE_HPP
+#define CODEBUNDLER_CHUNKSTORE_HPP
+
+#include <cstdint>
+#include <filesystem> // Requires C++17
+#include <iosfwd>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace codebundler {
+namespace store {
+
+    constexpr size_t MIN_CHUNK_SIZE = 2 * 1024;
+    constexpr size_t AVERAGE_CHUNK_SIZE = 8 * 1024;
+    constexpr size_t MAX_CHUNK_SIZE = 64 * 1024;
+
+    /**
+     * @brief Splits data into content-defined chunks (FastCDC).
+     *
+     * A gear rolling hash is updated per byte and a chunk ends where its masked
+     * bits are zero. Below the average size a stricter mask is used and above it
+     * a looser one (normalized chunking), so sizes cluster around the average
+     * while an edit only moves the boundaries next to it.
+     *
+     * @param data The data to split.
+     * @return The chunk lengths, in order; they add up to data.size().
+     */
+    std::vector<size_t> chunkLengths(std::string_view data);
+
+    /**
+     * @brief What adding a bundle to a store wrote.
+     */
+    struct AddResult {
+        size_t chunks = 0;
+        size_t newChunks = 0;
+        std::uint64_t bytes = 0;
+        std::uint64_t newBytes = 0; // Chunk bytes that were not in the store yet
+    };
+
+    /**
+     * @brief A directory of content-addressed chunks plus one recipe per stored bundle.
+     *
+     * Layout: chunks/<2 hex digits>/<SHA-256 of the chunk> and recipes/<name>. A recipe
+     * lists the bundle's entries (path, position, length) and its bytes as a sequence of
+     * chunk references and short literals (headers and separators). Entry contents are
+     * chunked on their own, so an unchanged file yields the same chunks in every version,
+     * wherever it sits in the bundle. Compressed bundles are stored in their text form.
+     */
+    class ChunkStore {
+    public:
+        /**
+         * @brief Opens (and, when adding, creates) a store.
+         * @param directory The store directory.
+         * @param jobs Number of chunking, hashing and reading threads (0 - one per hardware thread).
+         */
+        explicit ChunkStore(std::filesystem::path directory, int jobs = 0);
+
+        /**
+         * @brief Chunks a bundle into the store under a name, replacing an older recipe of that name.
+         * @param name The recipe name (no '/', not starting with '.').
+         * @param bundlePath The bundle file (any format, or a compressed container).
+         * @return Chunk counts and sizes.
+         * @throws FileIOException If the bundle cannot be read or the store cannot be written.
+         */
+        AddResult add(const std::string& name, const std::string& bundlePath);
+
+        /**
+         * @brief Writes a stored bundle, byte for byte, verifying every chunk read.
+         * @param name The recipe name.
+         * @param outputStream The stream to write the bundle to.
+         * @throws FileIOException If the recipe or a chunk is missing.
+         * @throws ChecksumMismatchException If a chunk is corrupt.
+         */
+        void get(const std::string& name, std::ostream& outputStream);
+
+        /**
+         * @brief Returns the content of one entry of a stored bundle, reading only its chunks.
+         * @param name The recipe name.
+         * @param path The entry path.
+         * @return The content as stored in the bundle.
+         * @throws FileIOException If the recipe, the entry or a chunk is missing.
+         * @throws ChecksumMismatchException If a chunk is corrupt.
+         */
+        std::string getEntry(const std::string& name, const std::string& path);
+
+        /**
+         * @brief Lists the stored recipe names, sorted.
+         * @return The names.
+         */
+        std::vector<std::string> list() const;
+
+        /**
+         * @brief Removes a recipe; its chunks stay until gc().
+         * @param name The recipe name.
+         * @throws FileIOException If there is no such recipe.
+         */
+        void remove(const std::string& name);
+
+        /**
+         * @brief Deletes chunks no recipe refers to. Must not run while bundles are being added.
+         * @return The number of chunks deleted.
+         */
+        size_t gc();
+
+    private:
+        struct Segment {
+            std::string chunk; // SHA-256 of the chunk; empty for a literal
+            std::string literal;
+            std::uint64_t length = 0;
+        };
+        struct Recipe {
+            std::uint64_t size = 0;
+            struct Entry {
+                std::string path;
+                std::uint64_t offset = 0;
+                std::uint64_t length = 0;
+            };
+            std::vector<Entry> entries;
+            std::vector<Segment> segments;
+        };
+
+        std::filesystem::path recipePath(const std::string& name) const;
+        std::filesystem::path chunkPath(const std::string& hash) const;
+        Recipe readRecipe(const std::string& name) const;
+        void writeRecipe(const std::string& name, const Recipe& recipe) const;
+        std::string readChunk(const std::string& hash) const;
+        bool writeChunk(const std::string& hash, std::string_view data) const;
+
+        std::filesystem::path m_directory;
+        int m_jobs;
+    };
+
+} // namespace store
+} // namespace codebundler
+
+#endif // CODEBUNDLER_CHUNKSTORE_HPP
@@ -0,0 +1,77 @@
+#ifndef CODEBUNDLER_COMPRESSEDBUNDLE_HPP
+#define CODEBUNDLER_COMPRESSEDBUNDLE_HPP
+
+#include <iosfwd>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace codebundler {
+namespace compressed {
+
+    /**
+     * @brief One rendered bundle entry (Filename/Checksum lines, content and trailing separator).
+     */
+    struct EntryChunk {
+        std::string path;
+        std::string text;
+    };
+
+    /**
+     * @brief Checks whether a codec name is supported by this build.
+     * @param codec "zstd" or "lz4".
+     * @return True if the codec was compiled in.
+     */
+    bool isCodecAvailable(const std::string& codec);
+
+    /**
+     * @brief Writes a compressed bundle container.
+     *
+     * The container starts with a magic number, followed by independently
+     * compressed frames: one for the bundle preamble (leading separator and
+     * description) and one per entry or group of small entries. A frame table at
+     * the end records every frame's position and which entry lives where, so a
+     * reader can decompress frames in parallel or pick out single entries.
+     * Decompressing all frames in order yields exactly the plain text bundle.
+     *
+     * @param outputStream The stream to write the container to.
+     * @param preamble The bundle header text.
+     * @param entries The rendered entries, in bundle order.
+     * @param codec "zstd" or "lz4".
+     * @param jobs Number of compression threads (0 - one per hardware thread).
+     * @throws CodeBundlerException If the codec is unavailable or compression fails.
+     * @throws FileIOException If writing fails.
+     */
+    void writeBundle(std::ostream& outputStream, const std::string& preamble, const std::vector<EntryChunk>& entries, const std::string& codec, int jobs);
+
+    /**
+     * @brief Checks whether data starts with the compressed container magic number.
+     * @param data The first bytes of a bundle (at least 8 for a positive answer).
+     * @return True if the data looks like a compressed container.
+     */
+    bool isCompressedBundle(std::string_view data);
+
+    /**
+     * @brief Checks, without consuming anything, whether a stream holds a compressed container.
+     * Text bundles never start with the container's first (non-ASCII) magic byte.
+     * @param inputStream The stream to peek at.
+     * @return True if the next byte starts a compressed container.
+     */
+    bool startsCompressedBundle(std::istream& inputStream);
+
+    /**
+     * @brief Decompresses a container back into plain bundle text.
+     * @param container The complete container bytes.
+     * @param onlyFiles If non-empty, only frames holding these entries are decompressed,
+     *                  and only these entries appear in the result.
+     * @param jobs Number of decompression threads (0 - one per hardware thread).
+     * @return The plain text bundle (or the subset of it holding the selected entries).
+     * @throws BundleFormatException If the container is malformed.
+     * @throws CodeBundlerException If the codec is unavailable or decompression fails.
+     */
+    std::string readBundle(std::string_view container, const std::vector<std::string>& onlyFiles, int jobs);
+
+} // namespace compressed
+} // namespace codebundler
+
+#endif // CODEBUNDLER_COMPRESSEDBUNDLE_HPP
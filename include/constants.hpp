@@ -1,6 +1,7 @@
 #ifndef CODEBUNDLER_CONSTANTS_HPP
 #define CODEBUNDLER_CONSTANTS_HPP
 
+#include <cstddef>
 #include <string>
 
 namespace codebundler {
@@ -8,6 +9,19 @@ namespace codebundler {
 // Constants - Using 'inline const' (C++17) to define them in the header without ODR issues
 inline const std::string FILENAME_PREFIX = "Filename: ";
 inline const std::string CHECKSUM_PREFIX = "Checksum: ";
+inline const std::string LENGTH_PREFIX = "Length: ";
+inline const std::string TOKENS_PREFIX = "Tokens: "; // Estimated token count of the entry content (bundle --token-budget)
+inline const std::string DESCRIPTION_PREFIX = "Description: ";
+// Header comment line naming the optional entry headers a text bundle uses, e.g. "Entry headers: Length";
+// without it, entry lines starting with such a prefix are content, as in bundles that predate these headers
+inline const std::string ENTRY_HEADERS_PREFIX = "Entry headers: ";
+inline const std::string AUTO_SEPARATOR = "auto"; // --separator value asking the bundler to pick one that no file contains
+inline const std::string SHARD_PREFIX = "Shard: ";
+inline const std::string SHARD_MANIFEST_HEADER = "# CodeBundle shard manifest v1";
+
+// Checksum values carrying this tag are SHA-256 tree hashes; untagged values are plain SHA-256
+inline const std::string TREE_CHECKSUM_TAG = "SHA256-TREE:";
+inline constexpr size_t TREE_CHUNK_SIZE = 1 << 20; // Leaf size of the SHA-256 tree hash
 
 } // namespace codebundler
 
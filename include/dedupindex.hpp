@@ -0,0 +1,83 @@
+#ifndef CODEBUNDLER_DEDUPINDEX_HPP
+#define CODEBUNDLER_DEDUPINDEX_HPP
+
+#include <cstdint>
+#include <filesystem> // Requires C++17
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace codebundler {
+
+/**
+ * @brief Creates files whose content was already extracted from the first copy.
+ *
+ * Remembers, by checksum, the first file written for each content. A later
+ * entry with the same checksum is then created as a reflink (`FICLONE`, on
+ * filesystems such as Btrfs and XFS) or a hard link of that file instead of
+ * writing its bytes again. Files are created under a temporary name and
+ * renamed into place, so an existing file is replaced rather than written
+ * through. Hard links share their permission bits, so an entry is only linked
+ * to a first copy with the same mode. Safe to use from multiple threads.
+ */
+class DedupIndex {
+public:
+    /**
+     * @brief Constructs an empty index.
+     * @param mode "copy" (no deduplication), "reflink" or "hardlink".
+     * @param verbose Verbosity level for reporting linked files.
+     * @throws CodeBundlerException If the mode is unknown.
+     */
+    explicit DedupIndex(const std::string& mode, int verbose = 0);
+
+    bool enabled() const { return m_mode != Mode::Copy; }
+
+    /**
+     * @brief Creates target from an earlier file with the same content, if there is one.
+     * @param checksum The checksum of the content (empty disables the lookup).
+     * @param target The file to create.
+     * @param mode The permission bits of the file (0 - 0644).
+     * @return True if the file was created; false if it must be written normally
+     *         (no earlier copy, a hard link whose first copy has another mode, or
+     *         the filesystem does not support the link type).
+     */
+    bool materialize(const std::string& checksum, const std::filesystem::path& target, std::uint32_t mode = 0644);
+
+    /**
+     * @brief Records that a file now holds the content with a checksum.
+     * @param checksum The checksum of the content (empty is ignored).
+     * @param path The file written.
+     * @param mode The permission bits it was written with (0 - 0644).
+     */
+    void remember(const std::string& checksum, const std::filesystem::path& path, std::uint32_t mode = 0644);
+
+    /**
+     * @brief Returns how many files were created by linking.
+     * @return The number of materialized files.
+     */
+    size_t linkedCount() const;
+
+private:
+    enum class Mode {
+        Copy,
+        Reflink,
+        Hardlink
+    };
+
+    struct FirstCopy {
+        std::filesystem::path path;
+        std::uint32_t permissions; // Normalized as by permissionsOf()
+    };
+
+    static std::uint32_t permissionsOf(std::uint32_t mode) { return (mode & 0777) != 0 ? mode & 0777 : 0644; }
+
+    Mode m_mode;
+    int m_verbose;
+    mutable std::mutex m_mutex;
+    std::unordered_map<std::string, FirstCopy> m_firstCopies;
+    size_t m_linked = 0;
+};
+
+} // namespace codebundler
+
+#endif // CODEBUNDLER_DEDUPINDEX_HPP
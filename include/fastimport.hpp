@@ -0,0 +1,77 @@
+#ifndef CODEBUNDLER_FASTIMPORT_HPP
+#define CODEBUNDLER_FASTIMPORT_HPP
+
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace codebundler {
+
+/**
+ * @brief Writes bundle entries as a `git fast-import` stream creating one commit.
+ *
+ * Each file becomes a blob command as soon as it is added, so content goes
+ * from the parser's buffer to git without touching the working tree. commit()
+ * then writes a commit whose tree holds exactly the added files.
+ */
+class FastImportWriter {
+public:
+    /**
+     * @brief Constructs a writer.
+     * @param outputStream The stream fed to `git fast-import`.
+     * @param branch The branch to commit to (without "refs/heads/").
+     * @param parent The commit to build on, or empty for a root commit.
+     */
+    FastImportWriter(std::ostream& outputStream, std::string branch, std::string parent = "");
+
+    /**
+     * @brief Writes a file's content as a blob.
+     * @param path The path of the file in the commit.
+     * @param content The file content.
+     * @param mode Permission bits; any execute bit makes the file executable.
+     * @throws FileIOException If writing fails.
+     */
+    void addFile(const std::string& path, std::string_view content, std::uint32_t mode = 0644);
+
+    /**
+     * @brief Writes the commit referencing all added files.
+     * @param committer Identity and date as printed by `git var GIT_COMMITTER_IDENT`.
+     * @param message The commit message.
+     * @throws FileIOException If writing fails.
+     */
+    void commit(const std::string& committer, const std::string& message);
+
+    size_t fileCount() const { return m_files.size(); }
+
+    /**
+     * @brief Returns the committer identity configured for a repository, or a fallback.
+     * @param repository The repository directory.
+     * @return The identity and current date, in `git var GIT_COMMITTER_IDENT` format.
+     */
+    static std::string committerIdentity(const std::string& repository);
+
+    /**
+     * @brief Returns the commit a branch points to.
+     * @param repository The repository directory.
+     * @param branch The branch name (without "refs/heads/").
+     * @return The commit hash, or empty if the branch does not exist.
+     */
+    static std::string branchTip(const std::string& repository, const std::string& branch);
+
+private:
+    struct File {
+        std::string path;
+        bool executable;
+    };
+
+    std::ostream& m_out;
+    std::string m_branch;
+    std::string m_parent;
+    std::vector<File> m_files; // Blob marks are index + 1
+};
+
+} // namespace codebundler
+
+#endif // CODEBUNDLER_FASTIMPORT_HPP
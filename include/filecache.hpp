@@ -0,0 +1,94 @@
+#ifndef CODEBUNDLER_FILECACHE_HPP
+#define CODEBUNDLER_FILECACHE_HPP
+
+#include <cstdint>
+#include <filesystem> // Requires C++17
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace codebundler {
+
+/**
+ * @brief The normalized content of a file together with its checksum.
+ */
+struct CachedFile {
+    std::string content; // Content as written to a bundle (newline-terminated lines)
+    std::string checksum; // Checksum of content, as written on the "Checksum:" line
+};
+
+/**
+ * @brief Keeps file contents and checksums in memory between bundle runs.
+ *
+ * Entries are keyed by path and validated against the file's `stat` data
+ * (device, inode, size and modification time) on every lookup, so a file that
+ * changed on disk is re-read and re-hashed, while an unchanged file costs a
+ * single `stat` call. Safe to use from multiple threads.
+ */
+class FileCache {
+public:
+    /**
+     * @brief Constructs an empty cache.
+     * @param checksumType The checksum to compute for cached files ("sha256" or "sha256-tree").
+     * @param jobs Number of threads for tree hashes (0 - one per hardware thread).
+     */
+    explicit FileCache(std::string checksumType = "sha256", int jobs = 0);
+
+    /**
+     * @brief Returns the content and checksum of a file, reading it only if it changed.
+     * @param path The path of the file.
+     * @return The cached (or freshly loaded) file data.
+     * @throws FileIOException If the file cannot be read.
+     */
+    std::shared_ptr<const CachedFile> get(const std::filesystem::path& path);
+
+    /**
+     * @brief Drops the cached entry for a path, if any.
+     * @param path The path to forget.
+     */
+    void invalidate(const std::filesystem::path& path);
+
+    /**
+     * @brief Drops every cached entry.
+     */
+    void clear();
+
+    /**
+     * @brief Reads a file and computes its bundle content and checksum, bypassing any cache.
+     * @param path The path of the file.
+     * @param checksumType The checksum to compute ("sha256" or "sha256-tree").
+     * @param jobs Number of threads for tree hashes (0 - one per hardware thread).
+     * @return The loaded file data.
+     * @throws FileIOException If the file cannot be read.
+     */
+    static std::shared_ptr<const CachedFile> load(const std::filesystem::path& path, const std::string& checksumType = "sha256", int jobs = 0);
+
+private:
+    struct Stamp {
+        std::uint64_t device = 0;
+        std::uint64_t inode = 0;
+        std::int64_t size = -1;
+        std::int64_t mtimeNs = 0;
+        bool operator==(const Stamp& other) const
+        {
+            return device == other.device && inode == other.inode && size == other.size && mtimeNs == other.mtimeNs;
+        }
+    };
+
+    struct Slot {
+        Stamp stamp;
+        std::shared_ptr<const CachedFile> file;
+    };
+
+    static bool statFile(const std::filesystem::path& path, Stamp& stamp);
+
+    std::string m_checksumType;
+    int m_jobs;
+    std::mutex m_mutex;
+    std::unordered_map<std::string, Slot> m_entries;
+};
+
+} // namespace codebundler
+
+#endif // CODEBUNDLER_FILECACHE_HPP
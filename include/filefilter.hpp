@@ -0,0 +1,75 @@
+#ifndef CODEBUNDLER_FILEFILTER_HPP
+#define CODEBUNDLER_FILEFILTER_HPP
+
+#include "options.hpp"
+#include "pathmatcher.hpp"
+#include <cstdint>
+#include <filesystem> // Requires C++17
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+namespace codebundler {
+
+/**
+ * @brief Counts of what FileFilter kept and skipped, for --stats.
+ */
+struct FilterStats {
+    size_t listed = 0;
+    size_t kept = 0;
+    std::uint64_t keptBytes = 0; // Sizes on disk, as seen by stat
+    size_t skippedByPattern = 0;
+    size_t skippedBySize = 0;
+    size_t skippedAsBinary = 0;
+
+    /**
+     * @brief Writes the counts as a short report.
+     * @param out The stream to write to.
+     */
+    void print(std::ostream& out) const;
+};
+
+/**
+ * @brief Drops unwanted files from a file list before any of them is read.
+ *
+ * Checks run cheapest first and on all files in parallel: --include/--exclude
+ * globs on the path alone, then --max-file-size on stat results, then (with
+ * --skip-binary) a NUL-byte scan of at most the first 8 KiB. Globs use
+ * .gitignore semantics: a pattern without '/' matches a name at any depth, and
+ * a pattern matching a directory matches everything below it.
+ */
+class FileFilter {
+public:
+    /**
+     * @brief Compiles the patterns and limits of the options.
+     * @param options The include/exclude patterns, size limit and binary setting.
+     */
+    explicit FileFilter(const Options& options);
+
+    /**
+     * @brief Returns the files that pass all checks, in their original order.
+     * @param files Paths relative to root.
+     * @param root The directory the paths are relative to.
+     * @return The kept paths.
+     */
+    std::vector<std::string> apply(const std::vector<std::string>& files, const std::filesystem::path& root);
+
+    /**
+     * @brief Checks a path against the include/exclude patterns only.
+     * @param path A path with '/' separators.
+     * @return True if the path is selected.
+     */
+    bool selectsPath(const std::string& path) const;
+
+    const FilterStats& stats() const { return m_stats; }
+
+private:
+    Options m_options;
+    IgnoreRules m_include;
+    IgnoreRules m_exclude;
+    FilterStats m_stats;
+};
+
+} // namespace codebundler
+
+#endif // CODEBUNDLER_FILEFILTER_HPP
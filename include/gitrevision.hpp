@@ -0,0 +1,53 @@
+#ifndef CODEBUNDLER_GITREVISION_HPP
+#define CODEBUNDLER_GITREVISION_HPP
+
+#include <cstdint>
+#include <filesystem> // Requires C++17
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace codebundler {
+namespace revision {
+
+    /**
+     * @brief A file of a git tree, as listed by `git ls-tree -r`.
+     */
+    struct TreeEntry {
+        std::string path;
+        std::uint32_t mode = 0; // Git file mode, e.g. 0100644, 0100755 or 0120000 (symlink)
+        std::string objectId;
+    };
+
+    /**
+     * @brief Lists the regular files of a revision, in tree order.
+     * Symbolic links and submodules are left out, as they have no file content to bundle.
+     * @param repository The repository directory.
+     * @param revision Any commit or tree name git understands (e.g. "HEAD~3", a tag or a hash).
+     * @return The files of the revision's tree.
+     * @throws GitCommandException If the revision cannot be listed.
+     */
+    std::vector<TreeEntry> listTree(const std::filesystem::path& repository, const std::string& revision);
+
+    // Receives each blob in the order of the entries it was requested for
+    using BlobHandler = std::function<void(const TreeEntry& entry, std::string content)>;
+
+    /**
+     * @brief Reads the blobs of tree entries through a single `git cat-file --batch` process.
+     *
+     * All object names are written to git from one thread while another reads the
+     * answers into a bounded queue, so git decompresses objects while the handler
+     * (running on the calling thread) hashes and writes earlier ones.
+     *
+     * @param repository The repository directory.
+     * @param entries The entries whose blobs to read.
+     * @param handler Called once per entry, in order.
+     * @throws GitCommandException If git cannot be started or an object is missing.
+     * @throws FileIOException If the pipe to git fails.
+     */
+    void readBlobs(const std::filesystem::path& repository, const std::vector<TreeEntry>& entries, const BlobHandler& handler);
+
+} // namespace revision
+} // namespace codebundler
+
+#endif // CODEBUNDLER_GITREVISION_HPP
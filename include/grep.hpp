@@ -0,0 +1,101 @@
+#ifndef CODEBUNDLER_GREP_HPP
+#define CODEBUNDLER_GREP_HPP
+
+#include <cstddef>
+#include <regex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace codebundler {
+namespace grep {
+
+    enum class Syntax {
+        Basic, // POSIX basic regular expressions (grep's default)
+        Extended, // POSIX extended regular expressions (-E)
+        Fixed // A literal string (-F)
+    };
+
+    /**
+     * @brief Returns a string every line matching a pattern must contain, for prefiltering.
+     *
+     * The longest run of ordinary characters that is not made optional by a
+     * quantifier; empty when nothing is certain (alternation, or no literal).
+     *
+     * @param pattern The pattern.
+     * @param syntax How the pattern is written.
+     * @return The required literal, possibly empty.
+     */
+    std::string requiredLiteral(const std::string& pattern, Syntax syntax);
+
+    /**
+     * @brief Decides which lines match a pattern.
+     *
+     * Lines are only handed to the regex engine if they contain the pattern's
+     * required literal, found with memmem over the whole entry rather than line
+     * by line; fixed strings need no regex at all.
+     */
+    class Matcher {
+    public:
+        /**
+         * @brief Compiles a pattern.
+         * @param pattern The pattern.
+         * @param syntax How the pattern is written.
+         * @param ignoreCase True to match regardless of case.
+         * @throws ArgumentParserException If the pattern is not a valid regular expression.
+         */
+        Matcher(const std::string& pattern, Syntax syntax, bool ignoreCase = false);
+
+        /**
+         * @brief The literal every matching line contains (empty if none is known).
+         */
+        const std::string& literal() const { return m_literal; }
+
+        /**
+         * @brief Checks a line that contains literal().
+         * @param line The line, without its newline.
+         * @return True if the line matches.
+         */
+        bool matches(std::string_view line) const;
+
+    private:
+        std::string m_literal;
+        bool m_literalOnly = false; // The literal decides alone (-F without -i)
+        std::regex m_regex;
+    };
+
+    /**
+     * @brief One matching line.
+     */
+    struct Match {
+        std::string path;
+        size_t line = 0; // 1-based, relative to the entry
+        std::string text;
+    };
+
+    /**
+     * @brief Finds the matching lines of each entry of a bundle held in memory.
+     * Entries are located by the separator scan (or entry table, or decoded from NDJSON) and searched in parallel.
+     * @param data A plain text, binary or NDJSON bundle (not compressed), typically a mapping.
+     * @param matcher The pattern.
+     * @param jobs Number of search threads (0 - one per hardware thread).
+     * @return The matches, in bundle and line order.
+     * @throws BundleFormatException If the bundle format is invalid.
+     */
+    std::vector<Match> searchBuffer(std::string_view data, const Matcher& matcher, int jobs);
+
+    /**
+     * @brief Finds the matching lines of a bundle file of any format, or of all shards of a manifest.
+     * @param path The bundle file (mapped; compressed bundles are decompressed first).
+     * @param matcher The pattern.
+     * @param jobs Number of search threads (0 - one per hardware thread).
+     * @return The matches, in bundle and line order.
+     * @throws FileIOException If the bundle cannot be read.
+     * @throws BundleFormatException If the bundle format is invalid.
+     */
+    std::vector<Match> searchFile(const std::string& path, const Matcher& matcher, int jobs);
+
+} // namespace grep
+} // namespace codebundler
+
+#endif // CODEBUNDLER_GREP_HPP
@@ -0,0 +1,94 @@
+#ifndef CODEBUNDLER_HASHCACHE_HPP
+#define CODEBUNDLER_HASHCACHE_HPP
+
+#include <cstdint>
+#include <filesystem> // Requires C++17
+#include <functional>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace codebundler {
+
+/**
+ * @brief Remembers the checksums of working tree files between runs.
+ *
+ * Other values derived from file content (such as token counts) are kept the
+ * same way under their own kind.
+ *
+ * Entries are stored in a small text file and keyed by path and checksum kind
+ * (plain or tree hash, of raw or newline-normalized content). They are trusted
+ * only while the file's inode, size and modification time are unchanged, so an
+ * unchanged file costs one `stat` call instead of a read and a hash. Files
+ * modified within the last two seconds are not remembered, since a later
+ * change within the same timestamp tick would go unnoticed. Safe to use from
+ * multiple threads.
+ */
+class HashCache {
+public:
+    /**
+     * @brief Loads the cache file, if it exists (a corrupt file is ignored).
+     * @param cacheFile Where the checksums are kept; empty for an in-memory cache.
+     */
+    explicit HashCache(std::filesystem::path cacheFile = {});
+
+    /**
+     * @brief Returns the default cache file for a directory: inside its .git
+     * directory when there is one, otherwise under $XDG_CACHE_HOME (or ~/.cache).
+     * @param directory The working tree the checksums belong to.
+     * @return The cache file path (its directory may not exist yet).
+     */
+    static std::filesystem::path defaultLocation(const std::filesystem::path& directory);
+
+    /**
+     * @brief Returns the checksum of a file as a bundle entry would carry it.
+     * @param root The working tree.
+     * @param path The file, relative to root.
+     * @param type "sha256" or "sha256-tree".
+     * @param normalized True for text bundles (newline-terminated content), false for raw bytes.
+     * @param jobs Number of threads for tree hashes (0 - one per hardware thread).
+     * @return The checksum value.
+     * @throws FileIOException If the file cannot be read.
+     */
+    std::string checksum(const std::filesystem::path& root, const std::string& path, const std::string& type, bool normalized, int jobs);
+
+    /**
+     * @brief Returns any value derived from a file's content, computing it only on a miss.
+     * @param root The working tree.
+     * @param path The file, relative to root.
+     * @param kind Names the kind of value, without spaces (e.g. "tokens-v1").
+     * @param compute Computes the value (without newlines) from the file's path on disk.
+     * @return The value.
+     */
+    std::string value(const std::filesystem::path& root, const std::string& path, const std::string& kind,
+        const std::function<std::string(const std::filesystem::path&)>& compute);
+
+    /**
+     * @brief Returns how many checksums had to be computed.
+     * @return The number of cache misses.
+     */
+    size_t misses() const { return m_misses; }
+
+    /**
+     * @brief Writes the cache file if any checksum was added (failures are ignored).
+     */
+    void save();
+
+private:
+    struct Slot {
+        std::uint64_t inode = 0;
+        std::int64_t size = 0;
+        std::int64_t mtimeNs = 0;
+        std::string value; // A checksum, or another value of the kind in the key
+    };
+
+    std::filesystem::path m_cacheFile;
+    std::mutex m_mutex;
+    std::unordered_map<std::string, Slot> m_entries; // Key: kind '\0' path
+    size_t m_misses = 0;
+    bool m_dirty = false;
+};
+
+} // namespace codebundler
+
+#endif // CODEBUNDLER_HASHCACHE_HPP
@@ -0,0 +1,96 @@
+#ifndef CODEBUNDLER_JOURNAL_HPP
+#define CODEBUNDLER_JOURNAL_HPP
+
+#include <cstdint>
+#include <filesystem> // Requires C++17
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace codebundler {
+
+/**
+ * @brief An append-only record of the entries an unbundle run has completed.
+ *
+ * Each line records an entry's ordinal, a byte offset into the bundle and its
+ * checksum, and is appended with a single write(2) once the file is in place,
+ * so the journal survives the process being killed at any point (a torn last
+ * line is dropped on reading). A resumed run skips what the journal records:
+ * for text bundles the offset is where the entry's trailing separator starts
+ * and parsing continues from there; binary bundles, extracted out of order,
+ * skip the recorded ordinals of their entry table. The journal names the
+ * bundle by size and a hash of its first 64 KiB, so a different bundle is
+ * never resumed by mistake. A final "done" line marks a bundle that was
+ * extracted completely. Safe to use from multiple threads.
+ */
+class Journal {
+public:
+    struct Record {
+        std::uint64_t ordinal = 0; // Position of the entry in the bundle
+        std::uint64_t offset = 0; // Text bundles: end of the entry's content; binary: start of its blob
+        std::string checksum; // "-" if the entry carried none
+        std::string path;
+    };
+
+    /**
+     * @brief Returns where the journal for extracting a bundle into a directory lives.
+     * @param outputDirectory The extraction directory.
+     * @param bundlePath The bundle file.
+     * @return The journal path (a hidden file in outputDirectory named after the bundle).
+     */
+    static std::filesystem::path defaultLocation(const std::filesystem::path& outputDirectory, const std::string& bundlePath);
+
+    /**
+     * @brief Opens a journal for a bundle.
+     * @param journalFile The journal path.
+     * @param bundle The bundle bytes (only its size and first 64 KiB are read).
+     * @param resume True to keep the records of an earlier run, false to start over.
+     * @throws BundleFormatException If resuming a journal written for another bundle.
+     * @throws FileIOException If the journal cannot be opened or written.
+     */
+    Journal(std::filesystem::path journalFile, std::string_view bundle, bool resume);
+    ~Journal();
+
+    Journal(const Journal&) = delete;
+    Journal& operator=(const Journal&) = delete;
+
+    /**
+     * @brief Returns the records kept from the earlier run, in the order they were written.
+     */
+    const std::vector<Record>& committed() const { return m_committed; }
+
+    /**
+     * @brief Tells whether the earlier run extracted the whole bundle.
+     */
+    bool finished() const { return m_finished; }
+
+    /**
+     * @brief Appends the record of an entry whose file is in place.
+     * @param record The record.
+     * @throws FileIOException If the journal cannot be written.
+     */
+    void commit(const Record& record);
+
+    /**
+     * @brief Marks the whole bundle as extracted.
+     * @throws FileIOException If the journal cannot be written.
+     */
+    void finish();
+
+    /**
+     * @brief Deletes the journal, once nothing can need to resume from it.
+     */
+    void remove();
+
+private:
+    std::filesystem::path m_journalFile;
+    std::vector<Record> m_committed;
+    std::mutex m_mutex;
+    int m_fd = -1;
+    bool m_finished = false;
+};
+
+} // namespace codebundler
+
+#endif // CODEBUNDLER_JOURNAL_HPP
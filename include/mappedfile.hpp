@@ -0,0 +1,61 @@
+#ifndef CODEBUNDLER_MAPPEDFILE_HPP
+#define CODEBUNDLER_MAPPEDFILE_HPP
+
+#include <cstddef>
+#include <filesystem> // Requires C++17
+#include <string>
+#include <string_view>
+
+namespace codebundler {
+
+/**
+ * @brief Read-only memory mapping of a whole file (RAII).
+ */
+class MappedFile {
+public:
+    /**
+     * @brief How the file's bytes are brought into memory.
+     */
+    enum class Access {
+        Map, // mmap (no copy; pages fault in on first touch)
+        Read // read(2) into a heap buffer (faster on some network filesystems)
+    };
+
+    /**
+     * @brief Maps (or reads) a file into memory.
+     * @param path The file to map.
+     * @param access Map the file or read it into a buffer.
+     * @throws FileIOException If the file cannot be opened or mapped (e.g. pipes and other
+     *         non-regular files).
+     */
+    explicit MappedFile(const std::filesystem::path& path, Access access = Access::Map);
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    /**
+     * @brief Returns the mapped bytes.
+     * @return A view of the whole file (empty for an empty file).
+     */
+    std::string_view view() const { return std::string_view(m_data, m_size); }
+
+    size_t size() const { return m_size; }
+
+    /**
+     * @brief Returns the file descriptor, kept open for the lifetime of the mapping.
+     * @return The open file descriptor.
+     */
+    int fd() const { return m_fd; }
+
+private:
+    int m_fd = -1;
+    const char* m_data = nullptr;
+    size_t m_size = 0;
+    std::string m_buffer; // Holds the bytes with Access::Read
+    bool m_mapped = false;
+};
+
+} // namespace codebundler
+
+#endif // CODEBUNDLER_MAPPEDFILE_HPP
@@ -0,0 +1,120 @@
+#ifndef CODEBUNDLER_NDJSON_HPP
+#define CODEBUNDLER_NDJSON_HPP
+
+#include "binarybundle.hpp"
+#include <iosfwd>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace codebundler {
+namespace ndjson {
+
+    constexpr int FORMAT_VERSION = 1;
+
+    /**
+     * @brief Appends a JSON string literal (with quotes) holding data.
+     *
+     * Runs of bytes that need no escaping are found by the scanner's vector
+     * kernel and copied whole; non-ASCII bytes are checked as UTF-8.
+     *
+     * @param out The string to append to.
+     * @param data The bytes to encode.
+     * @return False if data is not valid UTF-8; out is then left as it was.
+     */
+    bool appendString(std::string& out, std::string_view data);
+
+    /**
+     * @brief Decodes the body of a JSON string literal (the text between its quotes).
+     * @param literal The escaped text.
+     * @return The decoded bytes.
+     * @throws BundleFormatException If an escape sequence is malformed.
+     */
+    std::string decodeString(std::string_view literal);
+
+    /**
+     * @brief Renders one entry as a JSON object line (including its newline).
+     *
+     * Fields, in this order: path, checksum, size (content bytes), mode, then
+     * content. Content that is not valid UTF-8 is stored base64 encoded and
+     * marked with "encoding":"base64" before the content field.
+     *
+     * @param entry The file to render.
+     * @param checksum The checksum of entry.content.
+     * @return The line.
+     */
+    std::string renderEntry(const binary::FileEntry& entry, const std::string& checksum);
+
+    /**
+     * @brief Writes an NDJSON bundle: a header object line, then one object line per entry.
+     *
+     * The header holds the format marker, version, separator (used when the
+     * bundle is converted to text) and description. Entries are hashed and
+     * rendered in parallel a window at a time and written in bundle order.
+     * Content is stored byte for byte, as in a binary bundle.
+     *
+     * @param outputStream The stream to write to.
+     * @param separator The separator to record.
+     * @param description The bundle description.
+     * @param entries The files, in bundle order.
+     * @param checksumType "sha256" or "sha256-tree".
+     * @param jobs Number of threads (0 - one per hardware thread).
+     * @throws CodeBundlerException If a path is not valid UTF-8.
+     * @throws FileIOException If writing fails.
+     */
+    void writeBundle(std::ostream& outputStream, const std::string& separator, const std::string& description, const std::vector<binary::FileEntry>& entries,
+        const std::string& checksumType = "sha256", int jobs = 0);
+
+    /**
+     * @brief Checks whether data starts with the NDJSON bundle header.
+     * @param data The first bytes of a bundle.
+     * @return True if the data looks like an NDJSON bundle.
+     */
+    bool isNdjsonBundle(std::string_view data);
+
+    /**
+     * @brief Checks, without consuming anything, whether a stream might hold an NDJSON bundle.
+     * @param inputStream The stream to peek at.
+     * @return True if the next byte opens a JSON object.
+     */
+    bool startsNdjsonBundle(std::istream& inputStream);
+
+    /**
+     * @brief Read-only view of an NDJSON bundle held in memory.
+     * Entry lines are parsed in parallel; content stays encoded until content() is used.
+     * Entry offsets are those of the entries' lines.
+     */
+    class Reader {
+    public:
+        /**
+         * @brief Parses the header and the metadata of every entry line.
+         * @param data The whole bundle; must outlive the reader.
+         * @param jobs Number of parsing threads (0 - one per hardware thread).
+         * @throws BundleFormatException If a line is malformed or the version is unknown.
+         */
+        explicit Reader(std::string_view data, int jobs = 0);
+
+        const std::string& separator() const { return m_separator; }
+        const std::string& description() const { return m_description; }
+        const std::vector<binary::Entry>& entries() const { return m_entries; }
+
+        /**
+         * @brief Decodes the content of an entry.
+         * @param entry An entry of this bundle.
+         * @return The content bytes.
+         * @throws BundleFormatException If the content is malformed or does not match the recorded size.
+         */
+        std::string content(const binary::Entry& entry) const;
+
+    private:
+        std::string m_separator;
+        std::string m_description;
+        std::vector<binary::Entry> m_entries;
+        std::vector<std::string_view> m_contents; // Encoded content of each entry
+        std::vector<bool> m_base64;
+    };
+
+} // namespace ndjson
+} // namespace codebundler
+
+#endif // CODEBUNDLER_NDJSON_HPP
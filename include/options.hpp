@@ -1,7 +1,10 @@
 #ifndef CODEBUNDLER_OPTIONS_HPP
 #define CODEBUNDLER_OPTIONS_HPP
 
+#include <cstddef>
+#include <cstdint>
 #include <string>
+#include <vector>
 
 namespace codebundler {
 
@@ -13,6 +16,29 @@ struct Options {
     int verbose = 0; // 0 - silent, 1 - errors, 2 - warnings, 3 - info,
                      // 4 - debug
     std::string separator = "========= BOUNDARY ==========";
+    std::string rootDirectory = "."; // where tracked files are listed and read from
+    bool walk = false; // bundle/list: walk rootDirectory (honouring ignore files) instead of asking git
+    bool recurseSubmodules = false; // bundle: also bundle the files of checked out submodules
+    std::vector<std::string> repositories; // bundle: repositories below rootDirectory bundled together, entries prefixed with their directory
+    int jobs = 0; // worker threads; 0 - one per hardware thread
+    std::string compression; // bundle: empty (plain text), "zstd" or "lz4"
+    std::string format = "v1"; // bundle/convert: "v1" (text), "v2" (binary, aligned blobs) or "ndjson" (one JSON object per entry)
+    std::string inputFormat; // unbundle: the format the input must have ("v1", "v2" or "ndjson"); empty - any
+    std::string checksum = "sha256"; // bundle: "sha256" or "sha256-tree" (parallel tree hash)
+    bool lengthHeaders = false; // bundle: emit "Length:" so parsers can skip content
+    std::size_t readBufferSize = 1 << 20; // unbundle: bytes per read when the bundle comes from a stream
+    std::string io = "mmap"; // unbundle: "mmap" or "read" - how a bundle file is brought into memory
+    std::string dedup = "copy"; // unbundle: "copy", "reflink" or "hardlink" for duplicate content
+    std::vector<std::string> onlyFiles; // unbundle: extract just these entries (all if empty)
+    bool journal = false; // unbundle: record completed entries in a journal next to the output
+    bool resume = false; // unbundle: skip the entries an earlier run's journal records
+    std::vector<std::string> includePatterns; // bundle: only paths matching one of these globs (all if empty)
+    std::vector<std::string> excludePatterns; // bundle: skip paths matching any of these globs
+    std::uint64_t maxFileSize = 0; // bundle: skip larger files; 0 - no limit
+    bool skipBinary = false; // bundle: skip files with a NUL byte in their first 8 KiB
+    bool stats = false; // bundle: report how many files were bundled and skipped
+    std::uint64_t tokenBudget = 0; // bundle: keep the bundle within this many estimated tokens; 0 - no limit
+    std::string priorityRules; // bundle: "glob=weight,..." deciding which files a token budget keeps first
 };
 
 }
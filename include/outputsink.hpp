@@ -0,0 +1,84 @@
+#ifndef CODEBUNDLER_OUTPUTSINK_HPP
+#define CODEBUNDLER_OUTPUTSINK_HPP
+
+#include <cstddef>
+#include <exception>
+#include <memory>
+#include <streambuf>
+#include <string>
+#include <string_view>
+
+namespace codebundler {
+
+/**
+ * @brief Buffered writer on a raw file descriptor, usable directly or as a std::streambuf.
+ *
+ * Small writes are collected in a page-aligned buffer and written in large
+ * blocks. Large entries are written with one writev(2) of the buffered bytes
+ * and the entry's parts. Bytes are always copied into the descriptor, so the
+ * caller's memory may change once a write returns. Errors from the streambuf
+ * interface set the stream's badbit; flush() reports them.
+ */
+class OutputSink : public std::streambuf {
+public:
+    /**
+     * @brief Wraps a file descriptor (not owned; it is not closed).
+     * @param fd The descriptor to write to, e.g. STDOUT_FILENO.
+     * @param name Names the output in error messages.
+     * @param bufferSize Bytes collected before a write.
+     */
+    OutputSink(int fd, std::string name, size_t bufferSize = 1 << 20);
+
+    /**
+     * @brief Flushes what is still buffered; errors are ignored (call flush() to see them).
+     */
+    ~OutputSink() override;
+
+    OutputSink(const OutputSink&) = delete;
+    OutputSink& operator=(const OutputSink&) = delete;
+
+    /**
+     * @brief Appends data, writing out the buffer whenever it fills.
+     * @param data The bytes to write.
+     * @throws FileIOException If writing fails.
+     */
+    void write(std::string_view data);
+
+    /**
+     * @brief Writes head, content and tail in order, gathered into one write when content is large.
+     * @param head Bytes before the content (e.g. an entry's header lines).
+     * @param content The content.
+     * @param tail Bytes after the content (e.g. the separator line).
+     * @throws FileIOException If writing fails.
+     */
+    void writeParts(std::string_view head, std::string_view content, std::string_view tail);
+
+    /**
+     * @brief Writes out everything buffered.
+     * @throws FileIOException If this or an earlier write through the streambuf interface failed.
+     */
+    void flush();
+
+protected:
+    int_type overflow(int_type ch) override;
+    std::streamsize xsputn(const char* data, std::streamsize count) override;
+    int sync() override;
+
+private:
+    struct FreeDeleter {
+        void operator()(char* buffer) const;
+    };
+
+    void writeBuffered(std::string_view extra = {}, std::string_view more = {}, std::string_view last = {});
+    void waitWritable();
+
+    int m_fd;
+    std::string m_name;
+    std::unique_ptr<char, FreeDeleter> m_buffer;
+    size_t m_bufferSize;
+    std::exception_ptr m_failure; // First failure seen through the streambuf interface, rethrown by flush()
+};
+
+} // namespace codebundler
+
+#endif // CODEBUNDLER_OUTPUTSINK_HPP
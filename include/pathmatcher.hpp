@@ -0,0 +1,97 @@
+#ifndef CODEBUNDLER_PATHMATCHER_HPP
+#define CODEBUNDLER_PATHMATCHER_HPP
+
+#include <bitset>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace codebundler {
+
+/**
+ * @brief A glob compiled once into a small automaton and matched in linear time.
+ *
+ * Syntax follows .gitignore: `*` and `?` do not match '/', `[...]` is a character
+ * class (`[!...]` or `[^...]` negated, ranges allowed), `\` escapes the next
+ * character, and `**` matches across directories (a `**` segment followed by
+ * '/' also matches no directory at all).
+ */
+class GlobPattern {
+public:
+    explicit GlobPattern(std::string_view pattern);
+
+    /**
+     * @brief Checks whether the whole path matches the pattern.
+     * @param path A path with '/' separators.
+     * @return True on a match.
+     */
+    bool matches(std::string_view path) const;
+
+private:
+    enum class Op {
+        Literal,
+        AnyChar, // ?
+        Class, // [...]
+        Star, // * - any run without '/'
+        DoubleStar // ** - any run, optionally skipping the following '/'
+    };
+    struct Token {
+        Op op = Op::Literal;
+        char literal = 0;
+        bool skipsSlash = false; // DoubleStar in "**/": may also match nothing, slash included
+        std::bitset<256> set {};
+    };
+    std::vector<Token> m_tokens;
+
+    // Most ignore patterns are a plain name or "*.ext"; those skip the automaton
+    enum class Shape {
+        General,
+        Exact, // Only literals
+        Suffix // A star followed by literals
+    };
+    Shape m_shape = Shape::General;
+    std::string m_literal; // The literals of an Exact or Suffix pattern
+
+    bool matchesGeneral(std::string_view path) const;
+};
+
+/**
+ * @brief The rules of one .gitignore (or .ignore) file.
+ */
+class IgnoreRules {
+public:
+    enum class Match {
+        None,
+        Ignored,
+        Included // Matched by a negated ("!") rule
+    };
+
+    /**
+     * @brief Adds the rules of an ignore file.
+     * @param content The file content; blank lines and '#' comments are skipped.
+     */
+    void addRules(std::string_view content);
+
+    /**
+     * @brief Finds the last rule matching a path.
+     * @param relativePath The path relative to the ignore file's directory.
+     * @param isDirectory Whether the path names a directory (for rules ending in '/').
+     * @return The verdict of the last matching rule, or None.
+     */
+    Match match(std::string_view relativePath, bool isDirectory) const;
+
+    bool empty() const { return m_rules.empty(); }
+
+private:
+    struct Rule {
+        GlobPattern pattern;
+        bool negated;
+        bool directoryOnly;
+        bool anchored; // Contains a '/': matched against the relative path, not just the name
+    };
+    std::vector<Rule> m_rules;
+};
+
+} // namespace codebundler
+
+#endif // CODEBUNDLER_PATHMATCHER_HPP
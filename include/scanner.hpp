@@ -0,0 +1,113 @@
+#ifndef CODEBUNDLER_SCANNER_HPP
+#define CODEBUNDLER_SCANNER_HPP
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace codebundler {
+namespace scanner {
+
+    /**
+     * @brief The instruction-set specific implementations of the scanning kernel.
+     */
+    enum class Kernel {
+        Auto, // Best kernel supported by the running CPU
+        Scalar,
+        SSE42,
+        AVX2,
+        AVX512,
+        NEON
+    };
+
+    /**
+     * @brief Checks whether a kernel was compiled in and is supported by the running CPU.
+     * @param kernel The kernel to check.
+     * @return True if the kernel can be used.
+     */
+    bool isKernelSupported(Kernel kernel);
+
+    /**
+     * @brief Returns the kernel chosen for Kernel::Auto (detected once via CPUID, unless one is preferred).
+     * @return The active kernel.
+     */
+    Kernel activeKernel();
+
+    /**
+     * @brief Makes Kernel::Auto use a particular kernel (e.g. one measured faster by tune).
+     * @param kernel The kernel; ignored unless supported. Kernel::Auto restores detection.
+     */
+    void preferKernel(Kernel kernel);
+
+    /**
+     * @brief Looks up a kernel by its printable name.
+     * @param name A name returned by kernelName().
+     * @param kernel Receives the kernel.
+     * @return False if the name is unknown.
+     */
+    bool parseKernelName(const std::string& name, Kernel& kernel);
+
+    /**
+     * @brief Returns a printable name for a kernel ("scalar", "sse4.2", "avx2", "avx512", "neon").
+     * @param kernel The kernel.
+     * @return The kernel's name.
+     */
+    const char* kernelName(Kernel kernel);
+
+    /**
+     * @brief Finds the offset of every line start in a buffer.
+     * Offset 0 is always included for a non-empty buffer; a trailing newline does not start a line.
+     * @param data The buffer to scan.
+     * @param kernel The kernel to use.
+     * @return Offsets of line starts in increasing order.
+     */
+    std::vector<size_t> findLineStarts(std::string_view data, Kernel kernel = Kernel::Auto);
+
+    /**
+     * @brief Finds every line that is a separator line.
+     *
+     * Candidate positions are found by matching the separator's first and last
+     * bytes at line starts a whole vector at a time, then confirmed with memcmp.
+     *
+     * @param data The buffer to scan.
+     * @param separator The separator (must not be empty or contain a newline).
+     * @param wholeLine If true the line must equal the separator (bundler collision check);
+     *                  if false it only has to start with it (how the unbundler detects separators).
+     * @param kernel The kernel to use.
+     * @return Offsets of the starts of matching lines in increasing order.
+     */
+    std::vector<size_t> findSeparatorLines(std::string_view data, const std::string& separator, bool wholeLine, Kernel kernel = Kernel::Auto);
+
+    /**
+     * @brief Checks whether any line of a buffer starts with the separator, stopping at the first match.
+     * Such a line would end the entry early, as the unbundler splits at separator prefixes.
+     * @param data The buffer to scan.
+     * @param separator The separator.
+     * @param kernel The kernel to use.
+     * @return True if some line starts with the separator.
+     */
+    bool containsSeparatorLine(std::string_view data, const std::string& separator, Kernel kernel = Kernel::Auto);
+
+    /**
+     * @brief Checks whether a buffer contains a NUL byte (the usual sign of a binary file).
+     * @param data The buffer to scan.
+     * @param kernel The kernel to use.
+     * @return True if some byte is zero.
+     */
+    bool containsNulByte(std::string_view data, Kernel kernel = Kernel::Auto);
+
+    /**
+     * @brief Finds the first byte a JSON string cannot hold verbatim without a check:
+     * a control character, '"', '\\', or a byte of a non-ASCII UTF-8 sequence.
+     * @param data The buffer to scan.
+     * @param from The offset to start at.
+     * @param kernel The kernel to use.
+     * @return The offset of that byte, or data.size() if there is none.
+     */
+    size_t findJsonSpecial(std::string_view data, size_t from, Kernel kernel = Kernel::Auto);
+
+} // namespace scanner
+} // namespace codebundler
+
+#endif // CODEBUNDLER_SCANNER_HPP
@@ -0,0 +1,74 @@
+#ifndef CODEBUNDLER_SEPARATORSET_HPP
+#define CODEBUNDLER_SEPARATORSET_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace codebundler {
+
+/**
+ * @brief Picks a separator that no file collides with, checking all candidates in one pass.
+ *
+ * The candidates are compiled into a trie. Line starts beginning with the
+ * candidates' common prefix are found by the scanner's vector kernels, and
+ * only there is the trie walked, so each file is scanned once however many
+ * candidates there are. A line collides with a candidate if it starts with it,
+ * the way the unbundler recognizes separators. Safe to feed from several
+ * threads at once.
+ */
+class SeparatorSet {
+public:
+    static constexpr size_t MAX_CANDIDATES = 64;
+
+    /**
+     * @brief Compiles the default family of candidates (see defaultCandidates()).
+     */
+    SeparatorSet();
+
+    /**
+     * @brief Compiles the given candidates, in order of preference.
+     * @param candidates Up to MAX_CANDIDATES non-empty strings without newlines.
+     * @throws std::invalid_argument If the candidates are unusable.
+     */
+    explicit SeparatorSet(std::vector<std::string> candidates);
+
+    /**
+     * @brief Returns the default separator followed by numbered variants of it
+     * ("========= BOUNDARY 1 ==========", ...), MAX_CANDIDATES in all.
+     * @return The candidates, in order of preference.
+     */
+    static std::vector<std::string> defaultCandidates();
+
+    /**
+     * @brief Records which candidates start a line of data.
+     * @param data The content of one file, as it will be written to the bundle.
+     */
+    void scan(std::string_view data);
+
+    /**
+     * @brief Returns the first candidate that no scanned data collided with.
+     * @return The separator to use.
+     * @throws CodeBundlerException If every candidate collided.
+     */
+    std::string pick() const;
+
+private:
+    struct Node {
+        std::vector<std::pair<char, int>> children;
+        int candidate = -1; // Index of the candidate ending here, if any
+    };
+
+    std::vector<std::string> m_candidates;
+    std::vector<Node> m_nodes;
+    std::string m_prefix; // Common prefix of all candidates
+    int m_prefixNode = 0; // Trie node reached after m_prefix
+    std::atomic<std::uint64_t> m_collisions { 0 }; // Bit i set - candidate i occurs
+};
+
+} // namespace codebundler
+
+#endif // CODEBUNDLER_SEPARATORSET_HPP
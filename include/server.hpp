@@ -0,0 +1,127 @@
+#ifndef CODEBUNDLER_SERVER_HPP
+#define CODEBUNDLER_SERVER_HPP
+
+#include "filecache.hpp"
+#include "options.hpp"
+#include <condition_variable>
+#include <cstdint>
+#include <iosfwd>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace codebundler {
+
+/**
+ * @brief A request sent from `codebundler --remote` to a running server.
+ */
+struct RemoteRequest {
+    std::string command; // bundle, list or verify
+    std::string directory; // Repository directory (absolute)
+    std::string argument; // Bundle file for verify
+    std::string separator;
+    std::string description;
+    std::string checksum; // Checksum type for bundle; empty for the server's default
+    bool lengthHeaders = false; // bundle: emit "Length:" headers
+};
+
+/**
+ * @brief Long-lived bundling daemon answering requests over a Unix domain socket.
+ *
+ * Keeps, per repository, the tracked-file list and a FileCache of contents and
+ * checksums warm in memory. The file list is refreshed only when the Git index
+ * changes, and cached files are re-read only when their `stat` data changes, so
+ * requests against an unchanged repository do no file reads or hashing at all.
+ *
+ * Files are revalidated by `stat` rather than watched with inotify, so there
+ * are no watch limits to hit and no event queue that can overflow and lose
+ * changes; a request costs one `stat` per file.
+ *
+ * Each connection is served on its own thread, with a timeout on reading the
+ * request and on writing the reply, so a silent or stalled client cannot hold
+ * up the others. The FileCache is shared by all threads; only refreshing and
+ * copying the file list is serialized, so a slow reader does not block other
+ * requests for the same repository. Bundles are streamed to the client as
+ * they are written.
+ */
+class Server {
+public:
+    /**
+     * @brief Constructs a Server.
+     * @param options Default options for requests (separator, verbosity).
+     * @param socketPath Filesystem path of the Unix domain socket to listen on.
+     */
+    Server(Options options, std::string socketPath);
+
+    ~Server();
+
+    Server(const Server&) = delete;
+    Server& operator=(const Server&) = delete;
+
+    /**
+     * @brief Listens on the socket and serves requests until SIGINT or SIGTERM.
+     * @throws FileIOException If the socket cannot be created or bound.
+     */
+    void run();
+
+    /**
+     * @brief Makes run() return once the requests in flight are answered; may be called from another thread.
+     */
+    void stop();
+
+private:
+    // Identifies a version of the Git index; git replaces the file by rename, so the inode counts too
+    struct IndexStamp {
+        std::uint64_t device = 0;
+        std::uint64_t inode = 0;
+        std::int64_t size = -1;
+        std::int64_t mtimeNs = 0;
+        bool operator==(const IndexStamp& other) const
+        {
+            return device == other.device && inode == other.inode && size == other.size && mtimeNs == other.mtimeNs;
+        }
+    };
+
+    struct RepoState {
+        RepoState(const std::string& checksum, int jobs)
+            : cache(checksum, jobs)
+        {
+        }
+        std::mutex mutex; // Guards files and indexStamp; the cache has its own lock
+        FileCache cache;
+        std::vector<std::string> files;
+        std::string indexPath; // Git index; its stat data tells when to re-list files
+        IndexStamp indexStamp; // Default: matches no stat, so the first request lists the files
+    };
+
+    Options m_options;
+    std::string m_socketPath;
+    int m_stopFd = -1; // eventfd signalled by stop()
+    std::map<std::string, std::unique_ptr<RepoState>> m_repos; // Keyed by directory and checksum type
+    std::mutex m_reposMutex; // Guards m_repos
+    std::mutex m_connectionsMutex;
+    std::condition_variable m_connectionsDone;
+    size_t m_activeConnections = 0;
+
+    void serveConnection(int fd);
+    void handleConnection(int fd);
+    void handleRequest(const RemoteRequest& request, std::ostream& output);
+    RepoState& repoFor(const std::string& directory, const std::string& checksum);
+    std::vector<std::string> trackedFiles(const std::string& directory, RepoState& repo);
+};
+
+/**
+ * @brief Sends a request to a running server and copies the result to a stream as it arrives.
+ * @param socketPath Filesystem path of the server's Unix domain socket.
+ * @param request The request to send.
+ * @param outputStream The stream receiving the result.
+ * @throws FileIOException If the server cannot be reached.
+ * @throws CodeBundlerException If the server reports an error.
+ */
+void sendRemoteRequest(const std::string& socketPath, const RemoteRequest& request, std::ostream& outputStream);
+
+} // namespace codebundler
+
+#endif // CODEBUNDLER_SERVER_HPP
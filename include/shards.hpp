@@ -0,0 +1,94 @@
+#ifndef CODEBUNDLER_SHARDS_HPP
+#define CODEBUNDLER_SHARDS_HPP
+
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace codebundler {
+namespace shards {
+
+    /**
+     * @brief One shard listed in a manifest.
+     */
+    struct Shard {
+        std::string path; // Relative to the manifest's directory
+        size_t fileCount = 0;
+        std::uint64_t bytes = 0; // Sum of the file sizes assigned to the shard
+    };
+
+    /**
+     * @brief The manifest written next to a set of shards.
+     *
+     * Text format: the SHARD_MANIFEST_HEADER line, an optional "Description:" line,
+     * then one "Shard: <files> <bytes> <path>" line per shard.
+     */
+    struct Manifest {
+        std::string description;
+        std::vector<Shard> shards;
+    };
+
+    /**
+     * @brief Splits files into shards of about a target size.
+     *
+     * Uses as many shards as the total size needs and fills them longest file first,
+     * each going to the currently smallest shard (LPT scheduling), so shard sizes
+     * stay within one file of each other. Files larger than the target still get
+     * placed whole.
+     *
+     * @param sizes The size of each file.
+     * @param targetSize The wanted shard size in bytes (non-zero).
+     * @return Per shard, the indices of its files in ascending order; no shard is empty.
+     */
+    std::vector<std::vector<size_t>> balance(const std::vector<std::uint64_t>& sizes, std::uint64_t targetSize);
+
+    /**
+     * @brief Checks that a shard path pattern holds exactly one %d-style placeholder.
+     * @param pattern A pattern such as "out-%03d.txt".
+     * @return True if the pattern is usable.
+     */
+    bool isValidPattern(const std::string& pattern);
+
+    /**
+     * @brief Expands the placeholder of a shard path pattern.
+     * @param pattern A valid pattern (see isValidPattern).
+     * @param index The shard number.
+     * @return The pattern with the number in place of the placeholder ("out-007.txt").
+     */
+    std::string shardPath(const std::string& pattern, size_t index);
+
+    /**
+     * @brief Derives the manifest path from a shard path pattern.
+     * @param pattern A valid pattern (see isValidPattern).
+     * @return The pattern with "manifest" in place of the placeholder ("out-manifest.txt").
+     */
+    std::string manifestPath(const std::string& pattern);
+
+    /**
+     * @brief Checks whether data starts with the manifest header line.
+     * @param data The first bytes of a file.
+     * @return True if the data looks like a shard manifest.
+     */
+    bool isManifest(std::string_view data);
+
+    /**
+     * @brief Writes a manifest.
+     * @param outputStream The stream to write to.
+     * @param manifest The description and shards to list.
+     */
+    void writeManifest(std::ostream& outputStream, const Manifest& manifest);
+
+    /**
+     * @brief Parses a manifest.
+     * @param data The whole manifest file.
+     * @return The description and shards.
+     * @throws BundleFormatException If the manifest is malformed.
+     */
+    Manifest readManifest(std::string_view data);
+
+} // namespace shards
+} // namespace codebundler
+
+#endif // CODEBUNDLER_SHARDS_HPP
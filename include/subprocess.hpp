@@ -0,0 +1,113 @@
+#ifndef CODEBUNDLER_SUBPROCESS_HPP
+#define CODEBUNDLER_SUBPROCESS_HPP
+
+#include <filesystem> // Requires C++17
+#include <streambuf>
+#include <string>
+#include <vector>
+
+namespace codebundler {
+
+/**
+ * @brief A child process with pipes to its standard input and/or output.
+ *
+ * Unlike utilities::executeCommand (popen), no shell is involved and both
+ * directions can be open at once, so a long-lived process such as
+ * `git cat-file --batch` can be fed requests while its answers are read.
+ */
+class Subprocess {
+public:
+    /**
+     * @brief Starts a process.
+     * @param argv The program and its arguments (looked up in PATH).
+     * @param workingDirectory Directory to run in (empty for the current one).
+     * @param pipeStdin Connect a pipe to the child's standard input.
+     * @param pipeStdout Connect a pipe to the child's standard output.
+     * @throws CodeBundlerException If the process cannot be started.
+     */
+    Subprocess(const std::vector<std::string>& argv, const std::filesystem::path& workingDirectory = {}, bool pipeStdin = true, bool pipeStdout = false);
+    ~Subprocess();
+
+    Subprocess(const Subprocess&) = delete;
+    Subprocess& operator=(const Subprocess&) = delete;
+
+    int stdinFd() const { return m_stdin; }
+    int stdoutFd() const { return m_stdout; }
+
+    /**
+     * @brief Closes the child's standard input, signalling the end of requests.
+     */
+    void closeStdin();
+
+    /**
+     * @brief Closes the read end of the child's standard output; further writes by the child fail.
+     */
+    void closeStdout();
+
+    /**
+     * @brief Closes the pipes and waits for the child to exit.
+     * @return The exit code, or -1 if the child was killed by a signal.
+     */
+    int wait();
+
+private:
+    int m_pid = -1;
+    int m_stdin = -1;
+    int m_stdout = -1;
+};
+
+/**
+ * @brief Buffered output stream buffer writing to a file descriptor (e.g. a pipe).
+ * Write errors throw FileIOException from the stream operation that hits them.
+ */
+class FdOutputBuf : public std::streambuf {
+public:
+    explicit FdOutputBuf(int fd);
+    ~FdOutputBuf() override;
+
+protected:
+    int_type overflow(int_type c) override;
+    std::streamsize xsputn(const char* data, std::streamsize count) override;
+    int sync() override;
+
+private:
+    int m_fd;
+    std::vector<char> m_buffer;
+
+    void writeAll(const char* data, size_t size);
+};
+
+/**
+ * @brief Reads exactly or up to a number of bytes, and lines, from a file descriptor (e.g. a pipe).
+ */
+class FdReader {
+public:
+    explicit FdReader(int fd);
+
+    /**
+     * @brief Reads one line, without its terminator.
+     * @param line Receives the line.
+     * @param delimiter The line terminator ('\0' for NUL-separated output such as `git ls-tree -z`).
+     * @return False at end of input.
+     */
+    bool readLine(std::string& line, char delimiter = '\n');
+
+    /**
+     * @brief Reads exactly count bytes.
+     * @param count The number of bytes.
+     * @return The bytes.
+     * @throws FileIOException On a read error or premature end of input.
+     */
+    std::string readExactly(size_t count);
+
+private:
+    int m_fd;
+    std::string m_buffer;
+    size_t m_position = 0;
+
+    bool fill();
+};
+
+} // namespace codebundler
+
+#endif // CODEBUNDLER_SUBPROCESS_HPP
@@ -0,0 +1,56 @@
+#ifndef CODEBUNDLER_TARWRITER_HPP
+#define CODEBUNDLER_TARWRITER_HPP
+
+#include <cstdint>
+#include <ctime>
+#include <iosfwd>
+#include <string>
+#include <string_view>
+
+namespace codebundler {
+
+/**
+ * @brief Writes files as a POSIX (ustar) tar stream.
+ *
+ * Paths that do not fit the ustar name/prefix fields, and files of 8 GiB or
+ * more, get a pax extended header. Only regular files are written; extracting
+ * tools create the parent directories themselves.
+ */
+class TarWriter {
+public:
+    /**
+     * @brief Constructs a writer.
+     * @param outputStream The stream receiving the archive.
+     * @param modificationTime The modification time recorded for every file.
+     */
+    explicit TarWriter(std::ostream& outputStream, std::time_t modificationTime = std::time(nullptr));
+
+    /**
+     * @brief Appends a file.
+     * @param path The path of the file in the archive.
+     * @param content The file content.
+     * @param mode Permission bits.
+     * @throws FileIOException If writing fails.
+     */
+    void addFile(const std::string& path, std::string_view content, std::uint32_t mode = 0644);
+
+    /**
+     * @brief Writes the end-of-archive marker. No files may be added afterwards.
+     * @throws FileIOException If writing fails.
+     */
+    void finish();
+
+    size_t fileCount() const { return m_fileCount; }
+
+private:
+    std::ostream& m_out;
+    std::time_t m_modificationTime;
+    size_t m_fileCount = 0;
+
+    void writeHeader(const std::string& name, const std::string& prefix, std::uint64_t size, std::uint32_t mode, char type);
+    void writePadded(std::string_view data);
+};
+
+} // namespace codebundler
+
+#endif // CODEBUNDLER_TARWRITER_HPP
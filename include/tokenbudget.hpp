@@ -0,0 +1,88 @@
+#ifndef CODEBUNDLER_TOKENBUDGET_HPP
+#define CODEBUNDLER_TOKENBUDGET_HPP
+
+#include "pathmatcher.hpp"
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace codebundler {
+namespace tokens {
+
+    constexpr size_t MAX_BYTES_PER_TOKEN = 16; // No estimated token covers more bytes than this
+    constexpr std::uint64_t NOT_A_CANDIDATE = std::numeric_limits<std::uint64_t>::max(); // Cost of a file choose() must skip
+
+    /**
+     * @brief Estimates how many tokens a BPE tokenizer (GPT-style) turns text into.
+     *
+     * The text is split the way such tokenizers pre-tokenize it: runs of
+     * letters (taking one leading space along), digits, punctuation, spaces,
+     * newlines and non-ASCII bytes. Each run then counts as its length divided
+     * by the typical bytes per token of its kind, rounded up. No vocabulary is
+     * involved, so this is an estimate rather than an exact count, but it takes a
+     * single table-driven pass over the bytes.
+     *
+     * @param text The text.
+     * @return The estimated token count.
+     */
+    std::uint64_t estimate(std::string_view text);
+
+    /**
+     * @brief Returns the fewest tokens estimate() can give for a number of bytes.
+     * @param bytes The text size.
+     * @return A lower bound of the estimate, known without reading the text.
+     */
+    inline std::uint64_t lowerBound(std::uint64_t bytes)
+    {
+        return (bytes + MAX_BYTES_PER_TOKEN - 1) / MAX_BYTES_PER_TOKEN;
+    }
+
+    /**
+     * @brief Weights that decide which files a token budget keeps first.
+     *
+     * Written as comma-separated glob=weight pairs, e.g. "src/=10,*.md=1,tests/=-1".
+     * Globs use .gitignore syntax (a pattern matching a directory matches everything
+     * below it); the first matching rule gives a path its weight, and paths matching
+     * no rule weigh 0. A negative weight keeps the file out of the bundle.
+     */
+    class PriorityRules {
+    public:
+        /**
+         * @brief Parses rules.
+         * @param spec The rules; empty for none.
+         * @throws ArgumentParserException If a rule is not glob=weight.
+         */
+        explicit PriorityRules(const std::string& spec);
+
+        /**
+         * @brief Returns the weight of a path.
+         * @param path A path with '/' separators.
+         * @return The weight of the first matching rule, or 0.
+         */
+        int priority(const std::string& path) const;
+
+    private:
+        struct Rule {
+            IgnoreRules pattern;
+            int weight;
+        };
+        std::vector<Rule> m_rules;
+    };
+
+    /**
+     * @brief Picks the files that fit a token budget, highest priority first.
+     * Files are considered by descending priority (ties in bundle order) and each is
+     * taken if it still fits, so a large file does not stop smaller ones after it.
+     * @param priorities The weight of each file; negative ones are never taken.
+     * @param costs The tokens each file adds to the bundle, or NOT_A_CANDIDATE.
+     * @param budget The token budget.
+     * @return The indices of the chosen files, in increasing order.
+     */
+    std::vector<size_t> choose(const std::vector<int>& priorities, const std::vector<std::uint64_t>& costs, std::uint64_t budget);
+
+} // namespace tokens
+} // namespace codebundler
+
+#endif // CODEBUNDLER_TOKENBUDGET_HPP
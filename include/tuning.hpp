@@ -0,0 +1,77 @@
+#ifndef CODEBUNDLER_TUNING_HPP
+#define CODEBUNDLER_TUNING_HPP
+
+#include "options.hpp"
+#include <cstddef>
+#include <filesystem> // Requires C++17
+#include <iosfwd>
+#include <string>
+
+namespace codebundler {
+namespace tuning {
+
+    /**
+     * @brief Settings measured by `codebundler tune`. Zero or empty fields are not set.
+     */
+    struct Settings {
+        int bundleJobs = 0; // Threads for reading and hashing many small files
+        int unbundleJobs = 0; // Threads for creating and writing output files
+        std::size_t readBufferSize = 0; // Bytes per read of a streamed bundle
+        std::string io; // "mmap" or "read" for bundle files
+        std::string scanKernel; // Separator scanning kernel, as named by scanner::kernelName()
+    };
+
+    /**
+     * @brief Returns where settings are kept: $CODEBUNDLER_CONFIG, else
+     * $XDG_CONFIG_HOME/codebundler/config, else ~/.config/codebundler/config.
+     * @return The path, or an empty path if no home directory is known.
+     */
+    std::filesystem::path defaultConfigPath();
+
+    /**
+     * @brief Reads a config file of "key = value" lines ('#' starts a comment).
+     * @param file The file; a missing file yields empty settings.
+     * @return The settings.
+     * @throws CodeBundlerException If a line is malformed or a value is out of range.
+     */
+    Settings load(const std::filesystem::path& file);
+
+    /**
+     * @brief Writes settings to a config file, replacing it atomically.
+     * @param file The file; missing parent directories are created.
+     * @param settings The settings.
+     * @param comment A comment written above the settings (may be empty).
+     * @throws FileIOException If writing fails.
+     */
+    void save(const std::filesystem::path& file, const Settings& settings, const std::string& comment);
+
+    /**
+     * @brief Applies settings to the options of a command.
+     * @param settings The settings.
+     * @param command "bundle" or "unbundle" (other commands only get the scan kernel).
+     * @param jobsGiven True if --jobs was given, which takes precedence.
+     * @param options The options to update.
+     */
+    void apply(const Settings& settings, const std::string& command, bool jobsGiven, Options& options);
+
+    /**
+     * @brief Runs short micro-benchmarks and picks the fastest settings.
+     *
+     * Measures the separator scan per kernel, SHA-256 throughput, small-file
+     * open/read/hash latency per thread count, file write bandwidth per thread
+     * count, sequential read throughput per buffer size, and mmap against
+     * read(2). Scratch files live in a temporary directory inside directory,
+     * so filesystem effects (network mounts, slow disks) are what gets measured;
+     * the directory is removed afterwards.
+     *
+     * @param directory The directory bundles will be read from or extracted to.
+     * @param report Receives one human-readable line per measurement.
+     * @return The chosen settings.
+     * @throws FileIOException If the scratch files cannot be written.
+     */
+    Settings calibrate(const std::filesystem::path& directory, std::ostream& report);
+
+} // namespace tuning
+} // namespace codebundler
+
+#endif // CODEBUNDLER_TUNING_HPP
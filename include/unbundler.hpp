@@ -1,14 +1,24 @@
 #ifndef CODEBUNDLER_UNBUNDLER_HPP
 #define CODEBUNDLER_UNBUNDLER_HPP
 
+#include "binarybundle.hpp"
+#include "changes.hpp"
 #include "options.hpp"
+#include "shards.hpp"
+#include <cstdint>
 #include <filesystem> // Requires C++17
+#include <functional>
 #include <iosfwd> // Forward declaration for std::istream
+#include <memory>
+#include <set>
 #include <string>
+#include <string_view>
 #include <vector>
 
 namespace codebundler {
 
+class Journal;
+
 /**
  * @brief Extracts files from a CodeBundle archive.
  */
@@ -33,6 +43,9 @@ public:
 
     /**
      * @brief Unbundles files from a specified bundle file into a target directory.
+     * A shard manifest written by Bundler::bundleToShards() extracts all of its shards.
+     * With Options::journal, completed entries are recorded in a Journal in the output
+     * directory, and Options::resume skips those an interrupted run recorded.
      * @param inputFilePath The path to the bundle file.
      * @param outputDirectory The directory where files will be extracted. Defaults to current directory.
      * @throws BundleFormatException If the bundle format is invalid or separator cannot be detected.
@@ -60,8 +73,74 @@ public:
      */
     bool verifyBundleFile(const std::string& inputFilePath);
 
+    /**
+     * @brief Reads every entry of a bundle of any format (text, compressed or binary) into memory.
+     * Checksums are verified unless disabled; --only selections are honoured.
+     * @param inputFilePath The path to the bundle file.
+     * @return The separator, description and entries of the bundle.
+     * @throws BundleFormatException If the bundle format is invalid.
+     * @throws ChecksumMismatchException If checksum verification is enabled and fails.
+     * @throws FileIOException If the bundle file cannot be read.
+     */
+    binary::BundleContents readContents(const std::string& inputFilePath);
+
+    /**
+     * @brief Lists the paths stored in a bundle file.
+     * For binary bundles only the entry table is read; other formats are parsed. For a
+     * shard manifest, the entries of all shards are listed.
+     * @param inputFilePath The path to the bundle file.
+     * @return The entry paths, in bundle order.
+     * @throws BundleFormatException If the bundle format is invalid.
+     * @throws FileIOException If the bundle file cannot be read.
+     */
+    std::vector<std::string> listEntries(const std::string& inputFilePath);
+
+    /**
+     * @brief Reads the paths and checksums of a bundle's entries without verifying content.
+     * Binary bundles are read from the entry table; text bundles only at their separator
+     * lines (compressed ones are decompressed first). A shard manifest indexes all shards.
+     * @param inputFilePath The path to the bundle file.
+     * @return The entries, in bundle order.
+     * @throws BundleFormatException If the bundle format is invalid.
+     * @throws FileIOException If the bundle file cannot be read.
+     */
+    changes::BundleIndex readIndex(const std::string& inputFilePath);
+
+    // Receives each verified entry's path, content and permission bits (text bundles: 0644)
+    using FileSink = std::function<void(const std::string& path, std::string_view content, std::uint32_t mode)>;
+
+    /**
+     * @brief Passes the entries of a bundle file to a sink instead of writing them to files,
+     * e.g. to turn them into a git fast-import or tar stream. No files or directories are
+     * created; checksums are verified (unless disabled) and --only selections are honoured.
+     * Binary bundles pass their blobs straight from the mapping.
+     * @param inputFilePath The path to the bundle file.
+     * @param sink Receives the entries, in bundle order.
+     * @return The bundle description.
+     * @throws BundleFormatException If the bundle format is invalid or holds an unsafe path.
+     * @throws ChecksumMismatchException If checksum verification is enabled and fails.
+     * @throws FileIOException If the bundle cannot be read.
+     */
+    std::string exportFromFile(const std::string& inputFilePath, const FileSink& sink);
+
+    /**
+     * @brief Passes the entries of a bundle read from a stream to a sink; see exportFromFile().
+     * Text bundles are parsed as they arrive.
+     * @param inputStream The stream containing the bundle content.
+     * @param sink Receives the entries, in bundle order.
+     * @return The bundle description.
+     */
+    std::string exportFromStream(std::istream& inputStream, const FileSink& sink);
+
 private:
     Options m_options;
+    std::shared_ptr<Journal> m_journal; // Set while a journaled extraction runs
+    bool m_keepJournal = false; // Shards keep their finished journals until the whole manifest is extracted
+    bool m_requireOnlyFiles = true; // Shards leave the --only check to the manifest, as each holds some of the files
+    std::set<std::string> m_foundOnlyFiles; // Entries selected with --only that were found
+
+    // Receives each verified entry (and its calculated checksum, if any) instead of it being written to a file
+    using EntryHandler = std::function<void(const std::string& filename, std::string content, const std::string& checksum)>;
 
     enum class ParserState {
         EXPECT_SEPARATOR_OR_HEADER, // Expecting optional header lines or the separator after the header
@@ -82,10 +161,99 @@ private:
      * @param inputStream The stream to read from.
      * @param outputDirectory The directory to extract to (used only if verifyOnly is false).
      * @param verifyOnly If true, only verify checksums; do not write files.
-     * @return True if verification passed (only relevant if verifyOnly is true), otherwise void.
-     * @throws Various exceptions based on errors encountered.
+     * @param entryHandler If set, receives the entries instead of them being written.
+     * @param description If set, receives the bundle description.
+     * @throws BundleFormatException If the bundle cannot be parsed or lacks an entry selected with --only.
+     * @throws Various other exceptions based on errors encountered.
+     */
+    void processBundle(std::istream& inputStream, const std::filesystem::path& outputDirectory, const EntryHandler& entryHandler = nullptr,
+        std::string* description = nullptr);
+
+    /**
+     * @brief Unbundles a text bundle from a stream with reading, parsing/hashing and writing
+     * on separate threads connected by bounded queues, so I/O on both ends overlaps with
+     * SHA-256 work. Each file is written to a temporary name and renamed into place after
+     * its checksum was verified.
+     * @param inputStream The stream to read from (typically stdin or a pipe).
+     * @param outputDirectory The directory to extract to.
+     */
+    void processBundlePipelined(std::istream& inputStream, const std::filesystem::path& outputDirectory);
+
+    /**
+     * @brief Reads a length-prefixed content block from the stream.
+     * @param inputStream The stream to read from.
+     * @param length The number of bytes announced by the "Length:" header.
+     * @return The bytes read (shorter than length only at end of stream).
+     */
+    static std::string readBlock(std::istream& inputStream, size_t length);
+
+    /**
+     * @brief Extracts all shards listed in a manifest, several at a time.
+     * @param manifestPath The manifest file; shard paths are relative to its directory.
+     * @param manifest The parsed manifest.
+     * @param outputDirectory The directory to extract into.
+     */
+    void unbundleShards(const std::string& manifestPath, const shards::Manifest& manifest, const std::filesystem::path& outputDirectory);
+
+    /**
+     * @brief Unbundles a bundle held entirely in memory, plain, compressed or binary.
+     * @param data The bundle bytes.
+     * @param outputDirectory The directory to extract to.
+     * @param fd A descriptor of the file holding data, or -1 if it has none.
+     */
+    void unbundleFromBuffer(std::string_view data, const std::filesystem::path& outputDirectory, int fd = -1);
+
+    /**
+     * @brief Checks a bundle against the required input format, if one was given.
+     * @param detected The format the bundle turned out to have ("v1", "v2" or "ndjson").
+     * @throws BundleFormatException If the formats differ.
+     */
+    void checkInputFormat(const std::string& detected) const;
+
+    /**
+     * @brief Records the entries selected with --only that a bundle holds, and requires all of them.
+     * @param found The selected entries found in the bundle.
+     * @throws BundleFormatException If a selected entry is missing (unless this unbundles a shard).
+     */
+    void requireOnlyFiles(const std::set<std::string>& found);
+
+    /**
+     * @brief Returns the entries of an entry table that were selected with --only.
+     * @param entries The entries of a binary or NDJSON bundle.
+     */
+    std::set<std::string> selectedEntries(const std::vector<binary::Entry>& entries) const;
+
+    /**
+     * @brief Parses an in-memory bundle, splitting entries at separator lines found by the scanner.
+     * Entry headers are fed to the parser as lines and each entry's content as a single block,
+     * so parser work is per entry rather than per line.
+     * @param data The plain text bundle.
+     * @param outputDirectory The directory to extract to.
+     * @param entryHandler If set, receives the entries instead of them being written.
+     * @param description If set, receives the bundle description.
+     * @throws BundleFormatException If the bundle cannot be parsed or lacks an entry selected with --only.
+     */
+    void processBuffer(std::string_view data, const std::filesystem::path& outputDirectory, const EntryHandler& entryHandler = nullptr,
+        std::string* description = nullptr);
+
+    /**
+     * @brief Extracts the entries of a binary or NDJSON bundle, verifying and writing them in parallel.
+     * When a binary bundle is backed by a file, blobs are copied into the output files inside
+     * the kernel (copy_file_range, falling back to sendfile) without passing through user space.
+     * @param reader A binary::Reader or ndjson::Reader.
+     * @param fd A descriptor of the file holding the blobs at their entry offsets, or -1 to write from memory.
+     * @param outputDirectory The directory to extract to.
+     */
+    template <typename EntryReader>
+    void extractEntries(const EntryReader& reader, int fd, const std::filesystem::path& outputDirectory);
+
+    /**
+     * @brief Passes the entries of a bundle held in memory, plain, compressed or binary, to a sink.
+     * @param data The bundle bytes.
+     * @param sink Receives the entries.
+     * @return The bundle description.
      */
-    bool processBundle(std::istream& inputStream, const std::filesystem::path& outputDirectory);
+    std::string exportFromBuffer(std::string_view data, const FileSink& sink);
 };
 
 } // namespace codebundler
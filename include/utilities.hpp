@@ -2,7 +2,9 @@
 #define CODEBUNDLER_UTILITIES_HPP
 
 #include <filesystem> // Requires C++17
+#include <functional>
 #include <string>
+#include <string_view>
 #include <vector>
 
 namespace codebundler {
@@ -18,6 +20,14 @@ namespace utilities {
 
     std::string readFileContent(const std::filesystem::path& filepath);
 
+    /**
+     * @brief Reads a file byte for byte, without any line normalization.
+     * @param filepath The path to the file.
+     * @return The raw content of the file.
+     * @throws FileIOException If the file cannot be opened or read.
+     */
+    std::string readFileBytes(const std::filesystem::path& filepath);
+
     /**
      * @brief Checks if a file contains a specific delimiter.
      * @param lines The lines of the file as a vector of strings.
@@ -26,6 +36,14 @@ namespace utilities {
      */
     bool fileContainsDelimiter(const std::vector<std::string>& lines, const std::string& delimiter);
 
+    /**
+     * @brief Checks if newline-terminated content contains a line starting with a delimiter.
+     * @param content The content to scan (as produced by linesToString).
+     * @param delimiter The delimiter to check for.
+     * @return true if some line of the content starts with the delimiter, false otherwise.
+     */
+    bool contentContainsDelimiter(const std::string& content, const std::string& delimiter);
+
     /**
      * @brief Converts a vector of strings to a single string, joining
      * them with newlines.
@@ -42,6 +60,15 @@ namespace utilities {
      */
     void writeFileContent(const std::filesystem::path& filepath, const std::string& content);
 
+    /**
+     * @brief Replaces a file's content atomically, so readers see either the old or the new file.
+     * Writes to a temporary file in the same directory and renames it over the target.
+     * @param filepath The path to the file to replace.
+     * @param content The string content to write.
+     * @throws FileIOException If the temporary file cannot be written or renamed.
+     */
+    void replaceFileAtomically(const std::filesystem::path& filepath, const std::string& content);
+
     /**
      * @brief Executes a shell command and captures its standard output.
      * @param command The command to execute.
@@ -58,12 +85,68 @@ namespace utilities {
      */
     std::vector<std::string> getGitTrackedFiles();
 
+    /**
+     * @brief Retrieves the files tracked by the Git repository at a given directory.
+     * @param repository The directory to run `git ls-files` in.
+     * @param recurseSubmodules True to list the files of checked out submodules too, instead of the submodules themselves.
+     * @return A vector of tracked file paths relative to the given directory.
+     * @throws GitCommandException If the `git ls-files` command fails or returns a non-zero exit code.
+     * @throws std::runtime_error If the Git command cannot be executed.
+     */
+    std::vector<std::string> getGitTrackedFiles(const std::filesystem::path& repository, bool recurseSubmodules = false);
+
+    /**
+     * @brief Reads a list of repository directories, one per line ('#' starts a comment line).
+     * @param listFile The file; directories in it are relative to the file's own directory.
+     * @return The normalized directories, in file order ("." for the list file's directory itself).
+     * @throws FileIOException If the file cannot be read.
+     * @throws CodeBundlerException If a directory is absolute, leaves the list file's directory or is repeated.
+     */
+    std::vector<std::string> readRepositoryList(const std::filesystem::path& listFile);
+
+    /**
+     * @brief Quotes a string for safe use as a single POSIX shell word.
+     * @param word The string to quote.
+     * @return The quoted string.
+     */
+    std::string shellQuote(const std::string& word);
+
     /**
      * @brief Calculates the SHA-256 hash of a string.
      * @param content The string content to hash.
      * @return The SHA-256 hash represented as a hexadecimal string.
      */
-    std::string calculateSHA256(const std::string& content);
+    std::string calculateSHA256(std::string_view content);
+
+    /**
+     * @brief Calculates a SHA-256 tree hash, hashing the leaves in parallel.
+     *
+     * The content is split into TREE_CHUNK_SIZE leaves (empty content is one empty
+     * leaf). A leaf hashes as SHA-256(0x00 || chunk), an inner node as
+     * SHA-256(0x01 || left || right); an unpaired last node moves up a level unchanged.
+     *
+     * @param content The content to hash.
+     * @param jobs Number of threads (0 - one per hardware thread).
+     * @return The root hash as a hexadecimal string.
+     */
+    std::string calculateTreeSHA256(std::string_view content, int jobs);
+
+    /**
+     * @brief Returns the type of a checksum as written on a "Checksum:" line.
+     * @param checksum The checksum value.
+     * @return "sha256-tree" for tagged tree hashes, "sha256" otherwise.
+     */
+    std::string checksumType(const std::string& checksum);
+
+    /**
+     * @brief Calculates a checksum in the form written on a "Checksum:" line.
+     * @param content The content to hash.
+     * @param type "sha256" (bare hex) or "sha256-tree" (hex prefixed with TREE_CHECKSUM_TAG).
+     * @param jobs Number of threads for tree hashes (0 - one per hardware thread).
+     * @return The checksum value.
+     * @throws CodeBundlerException If the type is unknown.
+     */
+    std::string calculateChecksum(std::string_view content, const std::string& type, int jobs);
 
     /**
      * @brief Trims leading and trailing whitespace from a string.
@@ -80,6 +163,33 @@ namespace utilities {
      */
     bool startsWith(const std::string& str, const std::string& prefix);
 
+    /**
+     * @brief Checks whether a header comment line declares an optional entry header.
+     * @param line A line of the bundle's header comment.
+     * @param prefix The entry header's prefix, e.g. LENGTH_PREFIX.
+     * @return True if line is an ENTRY_HEADERS_PREFIX line naming that header.
+     */
+    bool declaresEntryHeader(std::string_view line, const std::string& prefix);
+
+    /**
+     * @brief Resolves a requested worker count, mapping 0 to the number of hardware threads.
+     * @param jobs The requested number of workers.
+     * @return The number of workers to use (at least 1).
+     */
+    unsigned resolveJobs(int jobs);
+
+    /**
+     * @brief Runs a task for every index in [0, count) on a pool of worker threads.
+     * Workers claim indices from a shared counter, so uneven tasks balance out.
+     * The first exception thrown by a task is rethrown after all workers finish.
+     * Called from a task of another pool, it runs inline on that worker, so nested
+     * work (e.g. a tree hash per file) never starts more than jobs threads.
+     * @param count The number of indices.
+     * @param jobs The number of workers (0 - one per hardware thread).
+     * @param task The task to run for each index.
+     */
+    void parallelFor(size_t count, int jobs, const std::function<void(size_t)>& task);
+
 } // namespace utilities
 } // namespace codebundler
 
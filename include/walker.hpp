@@ -0,0 +1,30 @@
+#ifndef CODEBUNDLER_WALKER_HPP
+#define CODEBUNDLER_WALKER_HPP
+
+#include <filesystem> // Requires C++17
+#include <string>
+#include <vector>
+
+namespace codebundler {
+namespace walker {
+
+    /**
+     * @brief Lists the files below a directory the way `git ls-files` lists a repository.
+     *
+     * Directories are read with getdents64 by a pool of threads sharing a queue of
+     * directories still to visit. Each directory's .gitignore and .ignore rules (in
+     * that order) apply to everything below it, with deeper files taking precedence;
+     * ignored directories are not entered. `.git` is always skipped, and symbolic
+     * links are listed only if they point to a regular file.
+     *
+     * @param root The directory to walk.
+     * @param jobs Number of threads (0 - one per hardware thread).
+     * @return Paths relative to root, sorted bytewise (as git sorts them).
+     * @throws FileIOException If root cannot be read.
+     */
+    std::vector<std::string> listFiles(const std::filesystem::path& root, int jobs);
+
+} // namespace walker
+} // namespace codebundler
+
+#endif // CODEBUNDLER_WALKER_HPP
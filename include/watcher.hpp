@@ -0,0 +1,77 @@
+#ifndef CODEBUNDLER_WATCHER_HPP
+#define CODEBUNDLER_WATCHER_HPP
+
+#include "bundler.hpp"
+#include "options.hpp"
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace codebundler {
+
+/**
+ * @brief Keeps a bundle file continuously up to date with the tracked files.
+ *
+ * Builds the bundle once, then uses inotify to watch the directories holding
+ * tracked files (and the Git index, for files being added or removed). After
+ * changes settle for the debounce interval, only the affected entries are
+ * re-rendered; the bundle is reassembled from cached per-file chunks and
+ * replaced atomically, so readers never see a torn bundle. When inotify drops
+ * events because its queue overflowed, every tracked file is re-read instead.
+ * A file that cannot be read keeps its last good entry; a file holding the
+ * separator stops the watcher with an error, as it fails a one-shot bundle.
+ */
+class BundleWatcher {
+public:
+    /**
+     * @brief Constructs a BundleWatcher.
+     * @param options Configuration options for bundling.
+     * @param outputFilePath The bundle file to keep up to date.
+     * @param description An optional description to include in the bundle header.
+     * @param debounceMs Quiet period after the last change before the bundle is rewritten.
+     */
+    BundleWatcher(const Options& options, std::string outputFilePath, std::string description, int debounceMs = 200);
+
+    ~BundleWatcher();
+
+    BundleWatcher(const BundleWatcher&) = delete;
+    BundleWatcher& operator=(const BundleWatcher&) = delete;
+
+    /**
+     * @brief Writes the bundle and keeps rewriting it on changes until SIGINT or SIGTERM.
+     * @throws GitCommandException If `git ls-files` fails.
+     * @throws FileIOException If inotify cannot be set up or the bundle cannot be written.
+     * @throws CodeBundlerException If a tracked file contains a line starting with the separator.
+     */
+    void run();
+
+    /**
+     * @brief Makes run() return; may be called from another thread.
+     */
+    void stop();
+
+private:
+    Options m_options;
+    Bundler m_bundler;
+    std::string m_outputFilePath;
+    std::string m_description;
+    int m_debounceMs;
+
+    std::vector<std::string> m_files; // Tracked files in bundle order
+    std::map<std::string, std::string> m_chunks; // Rendered entry per tracked file
+    std::string m_gitDirectory;
+    int m_inotifyFd = -1;
+    int m_stopFd = -1; // eventfd signalled by stop()
+    std::map<int, std::string> m_watchedDirectories; // Watch descriptor -> directory (relative to root)
+
+    void refreshFileList();
+    void renderEntry(const std::string& filePath);
+    void writeBundle();
+    void watchDirectories();
+    bool collectChanges(std::set<std::string>& changedFiles, bool& indexChanged, bool& overflowed, int timeoutMs);
+};
+
+} // namespace codebundler
+
+#endif // CODEBUNDLER_WATCHER_HPP
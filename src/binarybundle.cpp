@@ -0,0 +1,238 @@
+#include "binarybundle.hpp"
+#include "constants.hpp"
+#include "exceptions.hpp"
+#include "utilities.hpp"
+#include <cstdint>
+#include <limits>
+#include <ostream>
+
+namespace codebundler {
+namespace binary {
+
+    namespace {
+
+        // Starts with a non-ASCII byte (like the compressed container) so it can never be mistaken for a text bundle
+        const std::string HEADER_MAGIC = std::string("\x89" "CBB\r\n\x1a\n", 8);
+        constexpr size_t HEADER_SIZE = 64;
+        constexpr size_t ENTRY_SIZE = 64;
+        constexpr size_t HASH_SIZE = 32;
+
+        enum ChecksumKind : uint32_t {
+            CHECKSUM_SHA256 = 0,
+            CHECKSUM_SHA256_TREE = 1
+        };
+
+        void putU32(std::string& out, uint32_t value)
+        {
+            for (int i = 0; i < 4; ++i) {
+                out += static_cast<char>((value >> (8 * i)) & 0xff);
+            }
+        }
+
+        void putU64(std::string& out, uint64_t value)
+        {
+            for (int i = 0; i < 8; ++i) {
+                out += static_cast<char>((value >> (8 * i)) & 0xff);
+            }
+        }
+
+        uint64_t getLE(std::string_view data, size_t offset, int bytes)
+        {
+            uint64_t value = 0;
+            for (int i = 0; i < bytes; ++i) {
+                value |= static_cast<uint64_t>(static_cast<unsigned char>(data[offset + i])) << (8 * i);
+            }
+            return value;
+        }
+
+        uint64_t alignUp(uint64_t value, uint64_t alignment)
+        {
+            return (value + alignment - 1) / alignment * alignment;
+        }
+
+        std::string hexToRaw(const std::string& hex)
+        {
+            std::string raw(HASH_SIZE, '\0');
+            for (size_t i = 0; i < HASH_SIZE && 2 * i + 1 < hex.size(); ++i) {
+                raw[i] = static_cast<char>(std::stoi(hex.substr(2 * i, 2), nullptr, 16));
+            }
+            return raw;
+        }
+
+        std::string rawToHex(std::string_view raw)
+        {
+            static const char digits[] = "0123456789abcdef";
+            std::string hex;
+            hex.reserve(raw.size() * 2);
+            for (unsigned char c : raw) {
+                hex += digits[c >> 4];
+                hex += digits[c & 0x0f];
+            }
+            return hex;
+        }
+
+        // Strings are referenced by (offset, length) pairs into the string table
+        uint32_t addString(std::string& table, const std::string& value)
+        {
+            if (table.size() + value.size() > std::numeric_limits<uint32_t>::max()) {
+                throw CodeBundlerException("Binary bundle string table exceeds 4 GiB.");
+            }
+            uint32_t offset = static_cast<uint32_t>(table.size());
+            table += value;
+            return offset;
+        }
+
+        std::string getString(std::string_view table, uint64_t offset, uint64_t length)
+        {
+            if (offset > table.size() || length > table.size() - offset) {
+                throw BundleFormatException("Binary bundle string reference out of range.");
+            }
+            return std::string(table.substr(offset, length));
+        }
+
+    } // anonymous namespace
+
+    /**
+     * @brief Writes a binary (format v2) bundle.
+     */
+    void writeBundle(std::ostream& outputStream, const std::string& separator, const std::string& description, const std::vector<FileEntry>& entries,
+        const std::string& checksumType, int jobs)
+    {
+        if (entries.size() > std::numeric_limits<uint32_t>::max()) {
+            throw CodeBundlerException("Too many entries for a binary bundle.");
+        }
+
+        std::string strings;
+        uint32_t separatorOffset = addString(strings, separator);
+        uint32_t descriptionOffset = addString(strings, description);
+        std::vector<uint32_t> pathOffsets;
+        pathOffsets.reserve(entries.size());
+        for (const auto& entry : entries) {
+            pathOffsets.push_back(addString(strings, entry.path));
+        }
+
+        const uint64_t entryTableOffset = alignUp(HEADER_SIZE + strings.size(), 8);
+        const uint64_t firstBlob = alignUp(entryTableOffset + entries.size() * ENTRY_SIZE, BLOB_ALIGNMENT);
+
+        // Hash files in parallel; a tree hash also splits each large file over the threads
+        const bool tree = checksumType == "sha256-tree";
+        std::vector<std::string> digests(entries.size());
+        utilities::parallelFor(entries.size(), tree ? 1 : jobs, [&](size_t i) {
+            std::string checksum = utilities::calculateChecksum(entries[i].content, checksumType, jobs);
+            digests[i] = hexToRaw(checksum.substr(tree ? TREE_CHECKSUM_TAG.size() : 0));
+        });
+
+        std::string table;
+        table.reserve(entries.size() * ENTRY_SIZE);
+        uint64_t blobOffset = firstBlob;
+        for (size_t i = 0; i < entries.size(); ++i) {
+            const auto& entry = entries[i];
+            putU32(table, pathOffsets[i]);
+            putU32(table, static_cast<uint32_t>(entry.path.size()));
+            putU32(table, entry.mode);
+            putU32(table, tree ? CHECKSUM_SHA256_TREE : CHECKSUM_SHA256);
+            putU64(table, blobOffset);
+            putU64(table, entry.content.size());
+            table += digests[i];
+            blobOffset = alignUp(blobOffset + entry.content.size(), BLOB_ALIGNMENT);
+        }
+
+        std::string header = HEADER_MAGIC;
+        putU32(header, FORMAT_VERSION);
+        putU32(header, static_cast<uint32_t>(entries.size()));
+        putU64(header, HEADER_SIZE);
+        putU64(header, strings.size());
+        putU64(header, entryTableOffset);
+        putU32(header, separatorOffset);
+        putU32(header, static_cast<uint32_t>(separator.size()));
+        putU32(header, descriptionOffset);
+        putU32(header, static_cast<uint32_t>(description.size()));
+        putU32(header, static_cast<uint32_t>(BLOB_ALIGNMENT));
+        putU32(header, 0); // Reserved
+
+        header += strings;
+        header.resize(entryTableOffset, '\0');
+        header += table;
+        header.resize(firstBlob, '\0');
+        outputStream.write(header.data(), static_cast<std::streamsize>(header.size()));
+
+        const std::string padding(BLOB_ALIGNMENT, '\0');
+        uint64_t position = firstBlob;
+        for (const auto& entry : entries) {
+            outputStream.write(entry.content.data(), static_cast<std::streamsize>(entry.content.size()));
+            position += entry.content.size();
+            uint64_t aligned = alignUp(position, BLOB_ALIGNMENT);
+            outputStream.write(padding.data(), static_cast<std::streamsize>(aligned - position));
+            position = aligned;
+        }
+
+        if (!outputStream) {
+            throw FileIOException("Stream error occurred while writing binary bundle");
+        }
+    }
+
+    /**
+     * @brief Checks whether data starts with the binary bundle magic number.
+     */
+    bool isBinaryBundle(std::string_view data)
+    {
+        return data.size() >= HEADER_MAGIC.size() && data.compare(0, HEADER_MAGIC.size(), HEADER_MAGIC) == 0;
+    }
+
+    //--------------------------------------------------------------------------
+    // Reader
+    //--------------------------------------------------------------------------
+
+    Reader::Reader(std::string_view data)
+        : m_data(data)
+    {
+        if (!isBinaryBundle(data) || data.size() < HEADER_SIZE) {
+            throw BundleFormatException("Not a binary bundle.");
+        }
+        uint64_t version = getLE(data, 8, 4);
+        if (version != FORMAT_VERSION) {
+            throw BundleFormatException("Unsupported binary bundle version " + std::to_string(version) + ".");
+        }
+        uint64_t entryCount = getLE(data, 12, 4);
+        uint64_t stringTableOffset = getLE(data, 16, 8);
+        uint64_t stringTableSize = getLE(data, 24, 8);
+        uint64_t entryTableOffset = getLE(data, 32, 8);
+
+        if (stringTableOffset > data.size() || stringTableSize > data.size() - stringTableOffset
+            || entryTableOffset > data.size() || entryCount > (data.size() - entryTableOffset) / ENTRY_SIZE) {
+            throw BundleFormatException("Binary bundle tables out of range.");
+        }
+        std::string_view strings = data.substr(stringTableOffset, stringTableSize);
+        m_separator = getString(strings, getLE(data, 40, 4), getLE(data, 44, 4));
+        m_description = getString(strings, getLE(data, 48, 4), getLE(data, 52, 4));
+
+        m_entries.reserve(entryCount);
+        for (uint64_t i = 0; i < entryCount; ++i) {
+            size_t record = entryTableOffset + i * ENTRY_SIZE;
+            Entry entry;
+            entry.path = getString(strings, getLE(data, record, 4), getLE(data, record + 4, 4));
+            entry.mode = static_cast<uint32_t>(getLE(data, record + 8, 4));
+            uint64_t kind = getLE(data, record + 12, 4);
+            entry.offset = getLE(data, record + 16, 8);
+            entry.length = getLE(data, record + 24, 8);
+            if (kind == CHECKSUM_SHA256) {
+                entry.checksum = rawToHex(data.substr(record + 32, HASH_SIZE));
+            } else if (kind == CHECKSUM_SHA256_TREE) {
+                entry.checksum = TREE_CHECKSUM_TAG + rawToHex(data.substr(record + 32, HASH_SIZE));
+            } else {
+                throw BundleFormatException("Unknown checksum type in binary bundle: " + entry.path);
+            }
+            if (entry.offset > data.size() || entry.length > data.size() - entry.offset) {
+                throw BundleFormatException("Binary bundle blob out of range: " + entry.path);
+            }
+            m_entries.push_back(std::move(entry));
+        }
+    }
+
+    std::string_view Reader::content(const Entry& entry) const
+    {
+        return m_data.substr(entry.offset, entry.length);
+    }
+
+} // namespace binary
+} // namespace codebundler
@@ -2,10 +2,11 @@
 #include "constants.hpp"
 #include "exceptions.hpp"
 #include "options.hpp"
+#include "utilities.hpp"
 
+#include <algorithm> // For std::find
 #include <cctype> // For std::isspace in trim
 #include <filesystem> // For std::filesystem::create_directories, std::filesystem::path
-#include <fstream> // For std::ofstream
 #include <iostream> // For std::cout, std::cerr
 #include <sstream> // For std::stringstream
 #include <stdexcept> // For std::runtime_error
@@ -14,6 +15,7 @@
 BundleParser::BundleParser(const codebundler::Options& options, Hasher hasher, std::filesystem::path outputPath)
     : options_(options)
     , hasher_(std::move(hasher))
+    , dedup_(options.dedup, options.verbose)
     , outputPath_(outputPath)
 {
     auto builder = fsm_.get_builder();
@@ -35,7 +37,12 @@ BundleParser::BundleParser(const codebundler::Options& options, Hasher hasher, s
         .to("DONE");
     
     builder.from("EXPECT FILENAME OR COMMENT")
-        .action([this](const InputType& input) { skip(input); })
+        .predicate([this](const InputType& input) { return isEOF(input); })
+        .action([this](const InputType& input) { done(input); })
+        .to("DONE"); // A bundle without entries, e.g. a compressed one read with an unmatched --only
+
+    builder.from("EXPECT FILENAME OR COMMENT")
+        .action([this](const InputType& input) { rememberDescription(input); })
         .to("IN COMMENT"); // If not filename or checksum, assume comment start
     
     // IN COMMENT transitions
@@ -50,14 +57,19 @@ BundleParser::BundleParser(const codebundler::Options& options, Hasher hasher, s
         .to("DONE");
     
     builder.from("IN COMMENT")
-        .action([this](const InputType& input) { skip(input); })
+        .action([this](const InputType& input) { rememberCommentLine(input); })
         .to("IN COMMENT"); // Continue skipping comment lines
     
     // EXPECT CHECKSUM OR CONTENT transitions
+    builder.from("EXPECT CHECKSUM OR CONTENT")
+        .predicate([this](const InputType& input) { return isBlock(input); })
+        .action([this](const InputType& input) { rememberContentBlock(input); })
+        .to("EXPECT SEPARATOR");
+
     builder.from("EXPECT CHECKSUM OR CONTENT")
         .predicate([this](const InputType& input) { return isChecksum(input); })
         .action([this](const InputType& input) { rememberChecksum(input); })
-        .to("IN CONTENT");
+        .to("EXPECT LENGTH OR CONTENT");
     
     builder.from("EXPECT CHECKSUM OR CONTENT")
         .predicate([this](const InputType& input) { return isSeparator(input); })
@@ -73,7 +85,67 @@ BundleParser::BundleParser(const codebundler::Options& options, Hasher hasher, s
         .action([this](const InputType& input) { rememberContentLine(input); })
         .to("IN CONTENT"); // If not checksum/sep/EOF, assume content
     
+    // EXPECT LENGTH OR CONTENT transitions (optional "Length:" header after the checksum)
+    builder.from("EXPECT LENGTH OR CONTENT")
+        .predicate([this](const InputType& input) { return isBlock(input); })
+        .action([this](const InputType& input) { rememberContentBlock(input); })
+        .to("EXPECT SEPARATOR");
+
+    builder.from("EXPECT LENGTH OR CONTENT")
+        .predicate([this](const InputType& input) { return isTokens(input); })
+        .action([this](const InputType& input) { skip(input); })
+        .to("EXPECT LENGTH OR CONTENT"); // The token count is informational; "Length:" may still follow
+
+    builder.from("EXPECT LENGTH OR CONTENT")
+        .predicate([this](const InputType& input) { return isLength(input); })
+        .action([this](const InputType& input) { rememberLength(input); })
+        .to("READ BLOCK");
+
+    builder.from("EXPECT LENGTH OR CONTENT")
+        .predicate([this](const InputType& input) { return isSeparator(input); })
+        .action([this](const InputType& input) { saveFile(input); })
+        .to("EXPECT FILENAME");
+
+    builder.from("EXPECT LENGTH OR CONTENT")
+        .predicate([this](const InputType& input) { return isEOF(input); })
+        .action([this](const InputType& input) { saveFile(input); })
+        .to("DONE");
+
+    builder.from("EXPECT LENGTH OR CONTENT")
+        .action([this](const InputType& input) { rememberContentLine(input); })
+        .to("IN CONTENT");
+
+    // READ BLOCK transitions: the whole content arrives as one input
+    builder.from("READ BLOCK")
+        .predicate([this](const InputType& input) { return isEOF(input); })
+        .action([this](const InputType& input) { errorBadFormat(input); })
+        .to("DONE");
+
+    builder.from("READ BLOCK")
+        .action([this](const InputType& input) { rememberContentBlock(input); })
+        .to("EXPECT SEPARATOR");
+
+    // EXPECT SEPARATOR transitions: only the separator may follow a block
+    builder.from("EXPECT SEPARATOR")
+        .predicate([this](const InputType& input) { return isSeparator(input); })
+        .action([this](const InputType& input) { saveFile(input); })
+        .to("EXPECT FILENAME");
+
+    builder.from("EXPECT SEPARATOR")
+        .predicate([this](const InputType& input) { return isEOF(input); })
+        .action([this](const InputType& input) { saveFile(input); })
+        .to("DONE");
+
+    builder.from("EXPECT SEPARATOR")
+        .action([this](const InputType& input) { errorBadFormat(input); })
+        .to("DONE");
+
     // IN CONTENT transitions
+    builder.from("IN CONTENT")
+        .predicate([this](const InputType& input) { return isBlock(input); })
+        .action([this](const InputType& input) { rememberContentBlock(input); })
+        .to("EXPECT SEPARATOR");
+
     builder.from("IN CONTENT")
         .predicate([this](const InputType& input) { return isSeparator(input); })
         .action([this](const InputType& input) { saveFile(input); })
@@ -140,6 +212,31 @@ bool BundleParser::isChecksum(const InputType& input) const
     return result;
 }
 
+bool BundleParser::isLength(const InputType& input) const
+{
+    bool result = lengthHeaders_ && input && input.value().find(codebundler::LENGTH_PREFIX, 0) == 0
+        && input.value().size() > codebundler::LENGTH_PREFIX.size()
+        && input.value().find_first_not_of("0123456789", codebundler::LENGTH_PREFIX.size()) == std::string::npos;
+    options_.verbose > 2 && std::cerr << "predicate: isLength ('" << (input ? input.value() : "EOF") << "') -> " << (result ? "true" : "false") << std::endl;
+    return result;
+}
+
+bool BundleParser::isTokens(const InputType& input) const
+{
+    bool result = tokenHeaders_ && !blockInput_ && input && input.value().find(codebundler::TOKENS_PREFIX, 0) == 0
+        && input.value().size() > codebundler::TOKENS_PREFIX.size()
+        && input.value().find_first_not_of("0123456789", codebundler::TOKENS_PREFIX.size()) == std::string::npos;
+    options_.verbose > 2 && std::cerr << "predicate: isTokens ('" << (input ? input.value() : "EOF") << "') -> " << (result ? "true" : "false") << std::endl;
+    return result;
+}
+
+bool BundleParser::isBlock(const InputType& input) const
+{
+    bool result = input && blockInput_;
+    options_.verbose > 2 && std::cerr << "predicate: isBlock -> " << (result ? "true" : "false") << std::endl;
+    return result;
+}
+
 bool BundleParser::isEOF(const InputType& input) const
 {
     bool result = !input.has_value();
@@ -158,6 +255,27 @@ void BundleParser::rememberSeparator(const InputType& input)
     }
 }
 
+void BundleParser::rememberDescription(const InputType& input)
+{
+    rememberCommentLine(input);
+    if (input && input->rfind(codebundler::DESCRIPTION_PREFIX, 0) == 0) {
+        description_ = input->substr(codebundler::DESCRIPTION_PREFIX.size());
+    }
+}
+
+void BundleParser::rememberCommentLine(const InputType& input)
+{
+    skip(input);
+    if (input && codebundler::utilities::declaresEntryHeader(*input, codebundler::LENGTH_PREFIX)) {
+        lengthHeaders_ = true;
+        options_.verbose > 2 && std::cerr << "action: rememberCommentLine -> entries may carry Length headers" << std::endl;
+    }
+    if (input && codebundler::utilities::declaresEntryHeader(*input, codebundler::TOKENS_PREFIX)) {
+        tokenHeaders_ = true;
+        options_.verbose > 2 && std::cerr << "action: rememberCommentLine -> entries may carry Tokens headers" << std::endl;
+    }
+}
+
 void BundleParser::rememberFilename(const InputType& input)
 {
     if (input) {
@@ -189,6 +307,39 @@ void BundleParser::rememberContentLine(const InputType& input)
     }
 }
 
+void BundleParser::rememberLength(const InputType& input)
+{
+    if (input) {
+        try {
+            blockLength_ = std::stoull(input.value().substr(codebundler::LENGTH_PREFIX.length()));
+        } catch (const std::out_of_range&) {
+            throw codebundler::BundleFormatException("Length header out of range for '" + filename_ + "'.");
+        }
+        options_.verbose > 2 && std::cerr << "action: rememberLength -> expecting " << *blockLength_ << " bytes" << std::endl;
+    } else {
+        options_.verbose > 2 && std::cerr << "action: rememberLength (skipped on EOF)" << std::endl;
+    }
+}
+
+void BundleParser::rememberContentBlock(const InputType& input)
+{
+    if (input) {
+        if (blockLength_ && input.value().size() != *blockLength_) {
+            throw codebundler::BundleFormatException("Content of '" + filename_ + "' is shorter than its Length header.");
+        }
+        block_ += input.value();
+        blockLength_.reset();
+        options_.verbose > 2 && std::cerr << "action: rememberContentBlock -> " << block_.size() << " bytes" << std::endl;
+    } else {
+        options_.verbose > 2 && std::cerr << "action: rememberContentBlock (skipped on EOF)" << std::endl;
+    }
+}
+
+std::optional<size_t> BundleParser::pendingBlockLength() const
+{
+    return blockLength_;
+}
+
 void BundleParser::saveFile(const InputType& /*input*/)
 {
     options_.verbose > 2 && std::cerr << "action: saveFile" << std::endl;
@@ -205,6 +356,19 @@ void BundleParser::saveFile(const InputType& /*input*/)
         throw codebundler::BundleFormatException("Empty filename.");
     }
 
+    if (!options_.onlyFiles.empty()
+        && std::find(options_.onlyFiles.begin(), options_.onlyFiles.end(), filename_) == options_.onlyFiles.end()) {
+        options_.verbose > 2 && std::cerr << "  Not selected, skipping: '" << filename_ << "'" << std::endl;
+        filename_.clear();
+        checksum_.clear();
+        lines_.clear();
+        block_.clear();
+        return;
+    }
+    if (!options_.onlyFiles.empty()) {
+        selectedFiles_.insert(filename_);
+    }
+
     std::filesystem::path filepath = outputPath_ / filename_;
 
     // we'll get the file contents regardless
@@ -213,6 +377,7 @@ void BundleParser::saveFile(const InputType& /*input*/)
         fileContentStream << lines_[i] << "\n";
     }
     std::string fileContent = fileContentStream.str(); // Reconstruct content
+    fileContent += block_; // Content read in one piece, if any
 
     // things to check:
     //   - have hasher?   (h)
@@ -262,7 +427,9 @@ void BundleParser::saveFile(const InputType& /*input*/)
         } else {
 
             // 1 1 x x
-            calculatedChecksum = hasher_(fileContent);
+            // Tree hashes split the work over all cores; plain checksums use the hasher
+            std::string type = codebundler::utilities::checksumType(checksum_);
+            calculatedChecksum = type == "sha256" ? hasher_(fileContent) : codebundler::utilities::calculateChecksum(fileContent, type, options_.jobs);
             bool match = (calculatedChecksum == checksum_);
 
             if (!match) {
@@ -286,6 +453,16 @@ void BundleParser::saveFile(const InputType& /*input*/)
         }
     }
 
+    if (entryHandler_) {
+        options_.verbose > 2 && std::cerr << "  Handing entry to callback: '" << filename_ << "'" << std::endl;
+        entryHandler_(filename_, std::move(fileContent), calculatedChecksum);
+        filename_.clear();
+        checksum_.clear();
+        lines_.clear();
+        block_.clear();
+        return;
+    }
+
     options_.verbose > 2 && std::cerr << "  Saving file: '" << filepath << "'" << std::endl;
 
     // Create parent directories if they don't exist
@@ -294,24 +471,27 @@ void BundleParser::saveFile(const InputType& /*input*/)
         std::filesystem::create_directories(filepath.parent_path());
     }
 
-    // Open file in binary mode to write content correctly
-    std::ofstream fileStream;
-    fileStream.exceptions(std::ios::badbit | std::ios::failbit); // Throw exceptions on failure
-    options_.verbose > 2 && std::cerr << "  Opening file for writing: " << filepath << std::endl;
+    options_.verbose > 2 && std::cerr << "  Writing file: " << filepath << std::endl;
     if (options_.trialRun) {
         options_.verbose > 2 && std::cerr << "  Trial run: file not actually written." << std::endl;
+    } else if (dedup_.materialize(calculatedChecksum, filepath)) {
+        options_.verbose > 2 && std::cerr << "  Duplicate content linked: '" << filename_ << "'" << std::endl;
     } else {
-        fileStream.open(filepath, std::ios::out | std::ios::trunc);
-
-        fileStream.write(fileContent.data(), fileContent.size());
-        fileStream.close(); // Close explicitly after write
+        // Written under a temporary name and renamed into place, so an existing path that is a
+        // hard link to another file (e.g. from an earlier --dedup hardlink run) is replaced, not written through
+        codebundler::utilities::replaceFileAtomically(filepath, fileContent);
+        dedup_.remember(calculatedChecksum, filepath);
         options_.verbose > 2 && std::cerr << "  File saved successfully: '" << filename_ << "'" << std::endl;
     }
+    if (savedHandler_ && !options_.trialRun) {
+        savedHandler_(filename_, checksum_.empty() ? calculatedChecksum : checksum_);
+    }
 
     // Reset state for the next file
     filename_.clear();
     checksum_.clear();
     lines_.clear();
+    block_.clear();
 }
 
 void BundleParser::skip(const InputType& input)
@@ -346,6 +526,19 @@ void BundleParser::errorBadFormat(const InputType& /*input*/)
 }
 
 // --- Public Method Definition ---
+bool BundleParser::parseBlock(const std::string& content)
+{
+    blockInput_ = true;
+    try {
+        bool done = parse(std::make_optional(content));
+        blockInput_ = false;
+        return done;
+    } catch (...) {
+        blockInput_ = false;
+        throw;
+    }
+}
+
 bool BundleParser::parse(const InputType& input)
 {
     lineCount_ += 1;
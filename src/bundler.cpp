@@ -1,18 +1,36 @@
 #include "bundler.hpp"
+#include "compressedbundle.hpp"
 #include "constants.hpp"
 #include "exceptions.hpp"
+#include "filefilter.hpp"
+#include "gitrevision.hpp"
+#include "hashcache.hpp"
+#include "ndjson.hpp"
+#include "outputsink.hpp"
+#include "scanner.hpp"
+#include "separatorset.hpp"
+#include "shards.hpp"
+#include "tokenbudget.hpp"
 #include "utilities.hpp"
+#include "walker.hpp"
+#include <algorithm>
+#include <atomic>
+#include <fcntl.h>
 #include <filesystem> // For path manipulation
 #include <fstream>
 #include <iostream> // For std::cerr, std::cout
+#include <iterator>
+#include <sstream>
+#include <unistd.h>
 
 namespace codebundler {
 
 //--------------------------------------------------------------------------
 // Constructor
 //--------------------------------------------------------------------------
-Bundler::Bundler(const Options& options)
+Bundler::Bundler(const Options& options, FileCache* cache)
     : m_options(options)
+    , m_cache(cache)
 {
     if (m_options.separator.empty()) {
         // Prevent empty separator which would break parsing
@@ -29,12 +47,294 @@ Bundler::Bundler(const Options& options)
  */
 void Bundler::bundleToStream(std::ostream& outputStream, const std::string& description)
 {
-    m_options.verbose > 0 && std::cerr << "Gathering files tracked by Git..." << std::endl;
-    std::vector<std::string> filesToBundle = utilities::getGitTrackedFiles();
+    bundleFilesToStream(outputStream, gatherFiles(), description);
+}
+
+/**
+ * @brief Bundles the gathered files into shards of about a target size, plus a manifest.
+ */
+std::string Bundler::bundleToShards(const std::string& pathPattern, std::uint64_t shardSize, const std::string& description)
+{
+    std::vector<std::string> files = gatherFiles();
+    std::vector<std::uint64_t> sizes(files.size(), 0);
+    utilities::parallelFor(files.size(), m_options.jobs, [&](size_t i) {
+        std::error_code ec;
+        std::uint64_t size = std::filesystem::file_size(filePathOf(files[i]), ec);
+        sizes[i] = ec ? 0 : size; // Reading the file later reports the error
+    });
+    std::vector<std::vector<size_t>> assignment = shards::balance(sizes, shardSize);
+
+    const std::string manifestPath = shards::manifestPath(pathPattern);
+    const std::filesystem::path manifestDirectory = std::filesystem::path(manifestPath).parent_path();
+    shards::Manifest manifest;
+    manifest.description = description;
+    manifest.shards.resize(assignment.size());
+
+    // Shards are independent bundles, so they are written side by side, one thread each
+    Options shardOptions = m_options;
+    shardOptions.jobs = 1;
+    utilities::parallelFor(assignment.size(), m_options.jobs, [&](size_t shard) {
+        std::vector<std::string> shardFiles;
+        shardFiles.reserve(assignment[shard].size());
+        shards::Shard& entry = manifest.shards[shard];
+        for (size_t index : assignment[shard]) {
+            shardFiles.push_back(files[index]);
+            entry.bytes += sizes[index];
+        }
+        entry.fileCount = shardFiles.size();
+        const std::string path = shards::shardPath(pathPattern, shard);
+        entry.path = std::filesystem::path(path).lexically_relative(manifestDirectory.empty() ? "." : manifestDirectory).generic_string();
+
+        std::ofstream outputFileStream(path, std::ios::binary | std::ios::trunc);
+        if (!outputFileStream) {
+            throw FileIOException("Failed to open shard file for writing", path);
+        }
+        m_options.verbose > 0 && std::cerr << "Writing shard " << path << " (" << entry.fileCount << " files, " << entry.bytes << " bytes)." << std::endl;
+        Bundler(shardOptions).bundleFilesToStream(outputFileStream, shardFiles, description);
+        if (!outputFileStream.flush()) {
+            throw FileIOException("Failed to write shard file", path);
+        }
+    });
+
+    std::ofstream manifestStream(manifestPath, std::ios::binary | std::ios::trunc);
+    if (!manifestStream) {
+        throw FileIOException("Failed to open shard manifest for writing", manifestPath);
+    }
+    shards::writeManifest(manifestStream, manifest);
+    if (!manifestStream.flush()) {
+        throw FileIOException("Failed to write shard manifest", manifestPath);
+    }
+    m_options.verbose > 0 && std::cerr << "Wrote " << manifest.shards.size() << " shards, listed in " << manifestPath << "." << std::endl;
+    return manifestPath;
+}
+
+/**
+ * @brief Bundles the files of a git revision into the provided output stream.
+ */
+void Bundler::bundleRevisionToStream(std::ostream& outputStream, const std::string& revision, const std::string& description)
+{
+    m_options.verbose > 0 && std::cerr << "Listing files of revision " << revision << "..." << std::endl;
+    std::vector<revision::TreeEntry> tree = revision::listTree(m_options.rootDirectory, revision);
+    m_options.verbose > 0 && std::cerr << "Found " << tree.size() << " files." << std::endl;
+
+    if (hasFileFilters()) {
+        // Only the path patterns apply here; main rejects the size and binary checks with --rev
+        FileFilter filter(m_options);
+        size_t listed = tree.size();
+        tree.erase(std::remove_if(tree.begin(), tree.end(), [&filter](const revision::TreeEntry& entry) { return !filter.selectsPath(entry.path); }),
+            tree.end());
+        m_options.verbose > 0 && std::cerr << "Kept " << tree.size() << " of " << listed << " files after filtering." << std::endl;
+    }
+
+    if (m_options.format != "v1") {
+        std::vector<binary::FileEntry> entries;
+        entries.reserve(tree.size());
+        revision::readBlobs(m_options.rootDirectory, tree, [&entries](const revision::TreeEntry& entry, std::string content) {
+            entries.push_back(binary::FileEntry { entry.path, std::move(content), entry.mode & 0777 });
+        });
+        writeRawEntries(outputStream, description, entries);
+        return;
+    }
+
+    // Text entries hold newline-terminated content, as utilities::readFileContent produces from a checkout
+    auto renderEntry = [this](std::ostream& out, const revision::TreeEntry& entry, std::string content) {
+        if (!content.empty() && content.back() != '\n') {
+            content += '\n';
+        }
+        m_options.verbose > 0 && std::cerr << "Bundling: " << entry.path << std::endl;
+        writeEntry(out, entry.path, content, utilities::calculateChecksum(content, m_options.checksum, m_options.jobs));
+    };
+
+    // With --separator auto all blobs are read (and scanned) before anything is written
+    std::vector<std::string> blobs;
+    const bool preloaded = m_options.separator == AUTO_SEPARATOR;
+    if (preloaded) {
+        SeparatorSet candidates;
+        blobs.reserve(tree.size());
+        revision::readBlobs(m_options.rootDirectory, tree, [&](const revision::TreeEntry&, std::string content) {
+            candidates.scan(content);
+            blobs.push_back(std::move(content));
+        });
+        m_options.separator = candidates.pick();
+        m_options.verbose > 0 && std::cerr << "Using separator: " << m_options.separator << std::endl;
+    }
+    auto forEachBlob = [&](const revision::BlobHandler& handler) {
+        if (!preloaded) {
+            revision::readBlobs(m_options.rootDirectory, tree, handler);
+            return;
+        }
+        for (size_t i = 0; i < tree.size(); ++i) {
+            handler(tree[i], std::move(blobs[i]));
+        }
+    };
+
+    if (!m_options.compression.empty()) {
+        std::ostringstream preamble;
+        writeHeader(preamble, description);
+        std::vector<compressed::EntryChunk> entries;
+        entries.reserve(tree.size());
+        forEachBlob([&](const revision::TreeEntry& entry, std::string content) {
+            std::ostringstream rendered;
+            renderEntry(rendered, entry, std::move(content));
+            entries.push_back(compressed::EntryChunk { entry.path, rendered.str() });
+        });
+        m_options.verbose > 0 && std::cerr << "Compressing " << entries.size() << " entries with " << m_options.compression << "." << std::endl;
+        compressed::writeBundle(outputStream, preamble.str(), entries, m_options.compression, m_options.jobs);
+        return;
+    }
+
+    writeHeader(outputStream, description);
+    forEachBlob([&](const revision::TreeEntry& entry, std::string content) {
+        renderEntry(outputStream, entry, std::move(content));
+    });
+    m_options.verbose > 0 && std::cerr << "Bundle creation finished." << std::endl;
+}
+
+/**
+ * @brief Lists the files to bundle: git's tracked files or the walk, then the file filters.
+ */
+std::vector<std::string> Bundler::gatherFiles()
+{
+    std::vector<std::string> filesToBundle;
+    if (m_options.walk) {
+        m_options.verbose > 0 && std::cerr << "Walking " << m_options.rootDirectory << "..." << std::endl;
+        filesToBundle = walker::listFiles(m_options.rootDirectory, m_options.jobs);
+    } else if (!m_options.repositories.empty()) {
+        m_options.verbose > 0 && std::cerr << "Gathering files tracked by " << m_options.repositories.size() << " repositories..." << std::endl;
+        filesToBundle = gatherRepositoryFiles();
+    } else {
+        m_options.verbose > 0 && std::cerr << "Gathering files tracked by Git..." << std::endl;
+        filesToBundle = utilities::getGitTrackedFiles(m_options.rootDirectory, m_options.recurseSubmodules);
+    }
     m_options.verbose > 0 && std::cerr << "Found " << filesToBundle.size() << " files." << std::endl;
 
+    if (hasFileFilters()) {
+        FileFilter filter(m_options);
+        filesToBundle = filter.apply(filesToBundle, m_options.rootDirectory);
+        m_options.verbose > 0 && std::cerr << "Kept " << filesToBundle.size() << " files after filtering." << std::endl;
+        if (m_options.stats) {
+            filter.stats().print(std::cerr);
+        }
+    }
+
+    if (m_options.tokenBudget > 0) {
+        filesToBundle = selectForTokenBudget(filesToBundle);
+    }
+
     if (filesToBundle.empty()) {
-        m_options.verbose > 0 && std::cerr << "Warning: No files found by 'git ls-files'. Bundle will be empty." << std::endl;
+        m_options.verbose > 0 && std::cerr << "Warning: No files found. Bundle will be empty." << std::endl;
+    }
+    return filesToBundle;
+}
+
+/**
+ * @brief Lists the tracked files of every repository concurrently, each prefixed with its directory.
+ */
+std::vector<std::string> Bundler::gatherRepositoryFiles()
+{
+    const std::vector<std::string>& repositories = m_options.repositories;
+    std::vector<std::vector<std::string>> lists(repositories.size());
+    utilities::parallelFor(repositories.size(), m_options.jobs, [&](size_t i) {
+        lists[i] = utilities::getGitTrackedFiles(std::filesystem::path(m_options.rootDirectory) / repositories[i], m_options.recurseSubmodules);
+        if (repositories[i] != ".") {
+            for (auto& file : lists[i]) {
+                file = repositories[i] + "/" + file;
+            }
+        }
+        m_options.verbose > 1 && std::cerr << "Found " << lists[i].size() << " files in " << repositories[i] << "." << std::endl;
+    });
+
+    // Repositories in list order, each in git's order, so the bundle does not depend on timing
+    std::vector<std::string> files;
+    for (auto& list : lists) {
+        files.insert(files.end(), std::make_move_iterator(list.begin()), std::make_move_iterator(list.end()));
+    }
+    return files;
+}
+
+/**
+ * @brief Keeps the highest-priority files that fit the token budget.
+ */
+std::vector<std::string> Bundler::selectForTokenBudget(const std::vector<std::string>& files)
+{
+    const tokens::PriorityRules rules(m_options.priorityRules);
+    const std::string separator = (m_options.separator == AUTO_SEPARATOR ? Options().separator : m_options.separator) + "\n";
+    const std::uint64_t preamble = 2 * tokens::estimate(separator) + tokens::estimate(ENTRY_HEADERS_PREFIX + "Tokens Length\n");
+    const std::uint64_t budget = m_options.tokenBudget > preamble ? m_options.tokenBudget - preamble : 0;
+
+    HashCache cache(HashCache::defaultLocation(m_options.rootDirectory));
+    std::vector<int> priorities(files.size(), 0);
+    std::vector<std::uint64_t> counts(files.size(), 0);
+    std::vector<std::uint64_t> costs(files.size(), tokens::NOT_A_CANDIDATE);
+    std::atomic<size_t> unread { 0 };
+    utilities::parallelFor(files.size(), m_options.jobs, [&](size_t i) {
+        priorities[i] = rules.priority(files[i]);
+        if (priorities[i] < 0) {
+            return;
+        }
+        // The entry header costs tokens too; a checksum-like string stands in for the real one
+        const std::uint64_t overhead = tokens::estimate(FILENAME_PREFIX + files[i] + "\n" + CHECKSUM_PREFIX + utilities::calculateSHA256(files[i]) + "\n"
+            + TOKENS_PREFIX + "00000\n" + separator);
+        std::error_code ec;
+        std::uint64_t size = std::filesystem::file_size(filePathOf(files[i]), ec);
+        if (!ec && tokens::lowerBound(size) + overhead > budget) {
+            ++unread; // Cannot fit even alone; not worth reading
+            return;
+        }
+        std::string count = cache.value(m_options.rootDirectory, files[i], "tokens-v1", [](const std::filesystem::path& path) {
+            return std::to_string(tokens::estimate(utilities::readFileBytes(path)));
+        });
+        counts[i] = std::stoull(count);
+        costs[i] = counts[i] + overhead;
+    });
+    cache.save();
+
+    std::vector<std::string> chosen;
+    std::uint64_t used = preamble;
+    for (size_t index : tokens::choose(priorities, costs, budget)) {
+        chosen.push_back(files[index]);
+        m_tokenCounts[files[index]] = counts[index];
+        used += costs[index];
+    }
+    m_options.verbose > 0 && std::cerr << "Token budget: kept " << chosen.size() << " of " << files.size() << " files (about " << used << " of "
+                                       << m_options.tokenBudget << " tokens)." << std::endl;
+    if (m_options.stats) {
+        std::cerr << "Token budget:          " << m_options.tokenBudget << "\n"
+                  << "Estimated tokens:      " << used << "\n"
+                  << "Files within budget:   " << chosen.size() << "\n"
+                  << "Files over budget:     " << files.size() - chosen.size() << " (" << unread << " not read)\n";
+    }
+    return chosen;
+}
+
+/**
+ * @brief Bundles an already gathered list of files into the provided output stream.
+ */
+void Bundler::bundleFilesToStream(std::ostream& outputStream, const std::vector<std::string>& filesToBundle, const std::string& description)
+{
+    if (m_options.separator == AUTO_SEPARATOR && m_options.format == "v1") {
+        // Load (and scan) every file first; the bundle is then written from the cache without rereading
+        FileCache localCache(m_options.checksum, m_options.jobs);
+        FileCache* cache = m_cache ? m_cache : &localCache;
+        SeparatorSet candidates;
+        utilities::parallelFor(filesToBundle.size(), m_options.jobs, [&](size_t i) {
+            candidates.scan(cache->get(filePathOf(filesToBundle[i]))->content);
+        });
+        Options resolved = m_options;
+        resolved.separator = candidates.pick();
+        m_options.verbose > 0 && std::cerr << "Using separator: " << resolved.separator << std::endl;
+        Bundler resolvedBundler(resolved, cache);
+        resolvedBundler.m_tokenCounts = m_tokenCounts;
+        resolvedBundler.bundleFilesToStream(outputStream, filesToBundle, description);
+        return;
+    }
+    if (!m_options.compression.empty()) {
+        writeCompressedBundle(outputStream, filesToBundle, description);
+        return;
+    }
+    if (m_options.format != "v1") {
+        writeRawBundle(outputStream, filesToBundle, description);
+        return;
     }
 
     writeHeader(outputStream, description);
@@ -56,17 +356,159 @@ void Bundler::bundleToStream(std::ostream& outputStream, const std::string& desc
  */
 void Bundler::bundleToFile(const std::string& outputFilePath, const std::string& description)
 {
-    std::ofstream outputFileStream(outputFilePath, std::ios::binary | std::ios::trunc);
-    if (!outputFileStream) {
+    int fd = ::open(outputFilePath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+    if (fd < 0) {
         throw FileIOException("Failed to open output bundle file for writing", outputFilePath);
     }
     m_options.verbose > 0 && std::cerr << "Writing bundle to: " << outputFilePath << std::endl;
-    bundleToStream(outputFileStream, description);
+    try {
+        OutputSink sink(fd, outputFilePath);
+        bundleFilesToSink(sink, gatherFiles(), description);
+        sink.flush();
+    } catch (...) {
+        ::close(fd);
+        throw;
+    }
+    if (::close(fd) != 0) {
+        throw FileIOException("Failed to write bundle file", outputFilePath);
+    }
 }
 
-//--------------------------------------------------------------------------
-// Private Methods
-//--------------------------------------------------------------------------
+/**
+ * @brief Bundles the files bundleToStream() would bundle into a file descriptor, e.g. stdout.
+ */
+void Bundler::bundleToFd(int fd, const std::string& description)
+{
+    OutputSink sink(fd, "<output>");
+    bundleFilesToSink(sink, gatherFiles(), description);
+    sink.flush();
+}
+
+/**
+ * @brief Bundles an already gathered list of files into a sink.
+ */
+void Bundler::bundleFilesToSink(OutputSink& sink, const std::vector<std::string>& filesToBundle, const std::string& description)
+{
+    if (m_options.separator == AUTO_SEPARATOR || !m_options.compression.empty() || m_options.format != "v1") {
+        // Written as a whole by the stream code; the sink still turns it into large writes
+        std::ostream outputStream(&sink);
+        bundleFilesToStream(outputStream, filesToBundle, description);
+        outputStream.flush();
+        return;
+    }
+
+    std::ostringstream header;
+    writeHeader(header, description);
+    sink.write(header.str());
+
+    for (const auto& filePath : filesToBundle) {
+        m_options.verbose > 0 && std::cerr << "Bundling: " << filePath << std::endl;
+        try {
+            writeFileEntry(sink, filePath);
+        } catch (const FileIOException& e) {
+            std::cerr << "Error processing file '" << filePath << "': " << e.what() << ". Aborting." << std::endl;
+            throw;
+        }
+    }
+    m_options.verbose > 0 && std::cerr << "Bundle creation finished." << std::endl;
+}
+
+/**
+ * @brief Renders all entries in parallel and writes them as a compressed container.
+ */
+void Bundler::writeCompressedBundle(std::ostream& outputStream, const std::vector<std::string>& filesToBundle, const std::string& description)
+{
+    std::ostringstream preamble;
+    writeHeader(preamble, description);
+
+    std::vector<compressed::EntryChunk> entries(filesToBundle.size());
+    utilities::parallelFor(filesToBundle.size(), m_options.jobs, [&](size_t i) {
+        std::ostringstream entry;
+        try {
+            writeFileEntry(entry, filesToBundle[i]);
+        } catch (const FileIOException& e) {
+            std::cerr << "Error processing file '" << filesToBundle[i] << "': " << e.what() << ". Aborting." << std::endl;
+            throw;
+        }
+        entries[i] = compressed::EntryChunk { filesToBundle[i], entry.str() };
+    });
+
+    m_options.verbose > 0 && std::cerr << "Compressing " << entries.size() << " entries with " << m_options.compression << "." << std::endl;
+    compressed::writeBundle(outputStream, preamble.str(), entries, m_options.compression, m_options.jobs);
+}
+
+/**
+ * @brief Reads all files byte for byte in parallel and writes them as a binary (v2) or NDJSON bundle.
+ */
+void Bundler::writeRawBundle(std::ostream& outputStream, const std::vector<std::string>& filesToBundle, const std::string& description)
+{
+    std::vector<binary::FileEntry> entries(filesToBundle.size());
+    utilities::parallelFor(filesToBundle.size(), m_options.jobs, [&](size_t i) {
+        std::filesystem::path fsPath = std::filesystem::path(m_options.rootDirectory) / filesToBundle[i];
+        entries[i].path = filesToBundle[i];
+        entries[i].content = utilities::readFileBytes(fsPath);
+        entries[i].mode = static_cast<uint32_t>(std::filesystem::status(fsPath).permissions() & std::filesystem::perms::mask) & 0777;
+    });
+
+    writeRawEntries(outputStream, description, entries);
+}
+
+/**
+ * @brief Writes entries holding exact file bytes in the configured raw format.
+ */
+void Bundler::writeRawEntries(std::ostream& outputStream, const std::string& description, const std::vector<binary::FileEntry>& entries)
+{
+    if (m_options.format == "ndjson") {
+        m_options.verbose > 0 && std::cerr << "Writing NDJSON bundle with " << entries.size() << " entries." << std::endl;
+        ndjson::writeBundle(outputStream, pickSeparator(entries), description, entries, m_options.checksum, m_options.jobs);
+        return;
+    }
+    m_options.verbose > 0 && std::cerr << "Writing binary bundle with " << entries.size() << " entries." << std::endl;
+    binary::writeBundle(outputStream, pickSeparator(entries), description, entries, m_options.checksum, m_options.jobs);
+}
+
+/**
+ * @brief Returns the configured separator, or with --separator auto one no entry collides with.
+ */
+std::string Bundler::pickSeparator(const std::vector<binary::FileEntry>& entries) const
+{
+    if (m_options.separator != AUTO_SEPARATOR) {
+        return m_options.separator;
+    }
+    SeparatorSet candidates;
+    utilities::parallelFor(entries.size(), m_options.jobs, [&](size_t i) { candidates.scan(entries[i].content); });
+    std::string separator = candidates.pick();
+    m_options.verbose > 0 && std::cerr << "Using separator: " << separator << std::endl;
+    return separator;
+}
+
+/**
+ * @brief Writes already loaded entries as a bundle in the configured format.
+ */
+void Bundler::bundleContentsToStream(std::ostream& outputStream, const binary::BundleContents& contents)
+{
+    if (!contents.separator.empty()) {
+        m_options.separator = contents.separator;
+    }
+    if (m_options.format != "v1") {
+        writeRawEntries(outputStream, contents.description, contents.entries);
+        return;
+    }
+
+    writeHeader(outputStream, contents.description);
+    for (const auto& entry : contents.entries) {
+        // Text bundles store newline-terminated content; checksums cover it as stored
+        std::string content = entry.content;
+        if (!content.empty() && content.back() != '\n') {
+            content += '\n';
+        }
+        try {
+            writeEntry(outputStream, entry.path, content, utilities::calculateChecksum(content, m_options.checksum, m_options.jobs));
+        } catch (const CodeBundlerException& e) {
+            throw CodeBundlerException("Cannot convert '" + entry.path + "' to a text bundle: " + e.what());
+        }
+    }
+}
 
 /**
  * @brief Writes the bundle header to the output stream.
@@ -74,8 +516,21 @@ void Bundler::bundleToFile(const std::string& outputFilePath, const std::string&
 void Bundler::writeHeader(std::ostream& outputStream, const std::string& description)
 {
     outputStream << m_options.separator << "\n";
-    if (!description.empty()) {
-        outputStream << "Description: " << description << "\n";
+    // Readers only take "Tokens:" and "Length:" lines as headers when the bundle says so; content may start with one
+    std::string entryHeaders;
+    if (!m_tokenCounts.empty()) {
+        entryHeaders = TOKENS_PREFIX.substr(0, TOKENS_PREFIX.find(':'));
+    }
+    if (m_options.lengthHeaders) {
+        entryHeaders += (entryHeaders.empty() ? "" : " ") + LENGTH_PREFIX.substr(0, LENGTH_PREFIX.find(':'));
+    }
+    if (!description.empty() || !entryHeaders.empty()) {
+        if (!description.empty()) {
+            outputStream << DESCRIPTION_PREFIX << description << "\n";
+        }
+        if (!entryHeaders.empty()) {
+            outputStream << ENTRY_HEADERS_PREFIX << entryHeaders << "\n";
+        }
         outputStream << m_options.separator << "\n";
     }
     // Add more header info if needed (e.g., timestamp, tool version)
@@ -85,24 +540,54 @@ void Bundler::writeHeader(std::ostream& outputStream, const std::string& descrip
  * @brief Writes a single file entry (header and content) to the output stream.
  */
 void Bundler::writeFileEntry(std::ostream& outputStream, const std::string& filePath)
+{
+    std::filesystem::path fsPath = filePathOf(filePath);
+    auto file = m_cache ? m_cache->get(fsPath) : FileCache::load(fsPath, m_options.checksum, m_options.jobs);
+    writeEntry(outputStream, filePath, file->content, file->checksum);
+}
+
+/**
+ * @brief Returns the location of a file to bundle.
+ */
+std::filesystem::path Bundler::filePathOf(const std::string& filePath) const
 {
     // Use filesystem::path for potentially better path handling, but keep string for git output
-    std::filesystem::path fsPath(filePath);
-    std::vector<std::string> fileLines = utilities::readFileLines(fsPath);
-    if (utilities::fileContainsDelimiter(fileLines, m_options.separator)) {
-        throw CodeBundlerException("File contains the bundle separator, which is not allowed.");
+    return m_options.rootDirectory == "." ? std::filesystem::path(filePath) : std::filesystem::path(m_options.rootDirectory) / filePath;
+}
+
+/**
+ * @brief Writes a single file entry to a sink from one private read of the file.
+ */
+void Bundler::writeFileEntry(OutputSink& sink, const std::string& filePath)
+{
+    std::filesystem::path fsPath = filePathOf(filePath);
+    if (m_cache) {
+        auto file = m_cache->get(fsPath);
+        writeEntry(sink, filePath, file->content, file->checksum);
+        return;
     }
-    std::string fileContent = utilities::linesToString(fileLines);
-    std::string checksum = utilities::calculateSHA256(fileContent);
+    // The separator check, the checksum and the write all see this one snapshot, even if the file changes meanwhile
+    std::string content = utilities::readFileBytes(fsPath);
+    if (!content.empty() && content.back() != '\n') {
+        content += '\n';
+    }
+    writeEntry(sink, filePath, content, utilities::calculateChecksum(content, m_options.checksum, m_options.jobs));
+}
 
-    // Normalize path separators for consistency in the bundle? Optional.
-    // std::string normalizedPath = fsPath.generic_string(); // Use forward slashes
+/**
+ * @brief Writes a single entry from newline-terminated content and its checksum.
+ */
+void Bundler::writeEntry(std::ostream& outputStream, const std::string& filePath, const std::string& fileContent, const std::string& checksum)
+{
+    if (utilities::contentContainsDelimiter(fileContent, m_options.separator)) {
+        throw CodeBundlerException("File contains the bundle separator, which is not allowed.");
+    }
 
-    outputStream << codebundler::FILENAME_PREFIX << filePath << "\n"; // Keep original path from git
-    outputStream << codebundler::CHECKSUM_PREFIX << checksum << "\n";
-    outputStream << fileContent; // Write content directly
     // Ensure a newline separates content from the next separator if content doesn't end with one
-    if (!fileContent.empty() && fileContent.back() != '\n') {
+    bool needsNewline = !fileContent.empty() && fileContent.back() != '\n';
+    outputStream << entryHeader(filePath, checksum, fileContent.size() + (needsNewline ? 1 : 0));
+    outputStream << fileContent; // Write content directly
+    if (needsNewline) {
         outputStream << "\n";
     }
     outputStream << m_options.separator << "\n";
@@ -113,4 +598,31 @@ void Bundler::writeFileEntry(std::ostream& outputStream, const std::string& file
     }
 }
 
+/**
+ * @brief Writes a single entry from newline-terminated content as one gathered write.
+ */
+void Bundler::writeEntry(OutputSink& sink, const std::string& filePath, std::string_view content, const std::string& checksum)
+{
+    if (scanner::containsSeparatorLine(content, m_options.separator)) {
+        throw CodeBundlerException("File contains the bundle separator, which is not allowed.");
+    }
+    sink.writeParts(entryHeader(filePath, checksum, content.size()), content, m_options.separator + "\n");
+}
+
+/**
+ * @brief Returns the header lines of an entry (filename, checksum and, if set, tokens and length).
+ */
+std::string Bundler::entryHeader(const std::string& filePath, const std::string& checksum, size_t contentSize) const
+{
+    std::string header = FILENAME_PREFIX + filePath + "\n"; // Keep original path from git
+    header += CHECKSUM_PREFIX + checksum + "\n";
+    if (auto tokens = m_tokenCounts.find(filePath); tokens != m_tokenCounts.end()) {
+        header += TOKENS_PREFIX + std::to_string(tokens->second) + "\n";
+    }
+    if (m_options.lengthHeaders) {
+        header += LENGTH_PREFIX + std::to_string(contentSize) + "\n";
+    }
+    return header;
+}
+
 } // namespace codebundler
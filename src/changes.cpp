@@ -0,0 +1,258 @@
+#include "changes.hpp"
+#include "constants.hpp"
+#include "exceptions.hpp"
+#include "hashcache.hpp"
+#include "ndjson.hpp"
+#include "scanner.hpp"
+#include "utilities.hpp"
+#include <algorithm>
+#include <array>
+#include <cstdlib>
+#include <map>
+#include <picosha2.h>
+#include <unordered_map>
+
+namespace codebundler {
+namespace changes {
+
+    namespace {
+
+        using Digest = std::array<unsigned char, picosha2::k_digest_size>;
+
+        Digest hashParts(unsigned char domain, std::initializer_list<std::string_view> parts)
+        {
+            picosha2::hash256_one_by_one hasher;
+            hasher.process(&domain, &domain + 1);
+            for (std::string_view part : parts) {
+                hasher.process(part.begin(), part.end());
+            }
+            hasher.finish();
+            Digest digest;
+            hasher.get_hash_bytes(digest.begin(), digest.end());
+            return digest;
+        }
+
+        std::string_view view(const Digest& digest)
+        {
+            return std::string_view(reinterpret_cast<const char*>(digest.data()), digest.size());
+        }
+
+        std::map<std::string, std::string> byPath(const BundleIndex& index)
+        {
+            std::map<std::string, std::string> checksums;
+            for (const auto& entry : index.entries) {
+                checksums[entry.path] = entry.checksum; // A later duplicate wins, as on extraction
+            }
+            return checksums;
+        }
+
+    } // anonymous namespace
+
+    BundleIndex indexBuffer(std::string_view data)
+    {
+        BundleIndex index;
+        if (binary::isBinaryBundle(data) || ndjson::isNdjsonBundle(data)) {
+            // Both store content byte for byte and list it in an entry table
+            index.normalized = false;
+            auto entries = binary::isBinaryBundle(data) ? binary::Reader(data).entries() : ndjson::Reader(data).entries();
+            for (const auto& entry : entries) {
+                index.entries.push_back({ entry.path, entry.checksum, entry.offset, entry.length });
+            }
+            return index;
+        }
+
+        // Entry headers directly follow separator lines, so only those lines are looked at
+        std::string separator = utilities::trim(std::string(data.substr(0, data.find('\n'))));
+        if (separator.empty()) {
+            throw BundleFormatException("Bundle does not start with a separator line.");
+        }
+        auto lineAt = [&data](size_t& position) {
+            size_t end = std::min(data.find('\n', position), data.size());
+            std::string_view line = data.substr(position, end - position);
+            position = std::min(end + 1, data.size());
+            return line;
+        };
+        std::vector<size_t> separators = scanner::findSeparatorLines(data, separator, false);
+        bool lengthHeaders = false;
+        bool tokenHeaders = false;
+        for (size_t i = 0; i < separators.size(); ++i) {
+            size_t position = separators[i];
+            lineAt(position);
+            const size_t blockEnd = i + 1 < separators.size() ? separators[i + 1] : data.size();
+            std::string_view filenameLine = lineAt(position);
+            if (filenameLine.substr(0, FILENAME_PREFIX.size()) != FILENAME_PREFIX) {
+                // Description or comment block, or the end; a comment may declare entry headers
+                for (std::string_view line = filenameLine;; line = lineAt(position)) {
+                    lengthHeaders = lengthHeaders || utilities::declaresEntryHeader(line, LENGTH_PREFIX);
+                    tokenHeaders = tokenHeaders || utilities::declaresEntryHeader(line, TOKENS_PREFIX);
+                    if (position >= blockEnd) {
+                        break;
+                    }
+                }
+                continue;
+            }
+            IndexEntry entry;
+            entry.path = utilities::trim(std::string(filenameLine.substr(FILENAME_PREFIX.size())));
+            size_t headerEnd = position;
+            std::string_view line = lineAt(headerEnd);
+            if (line.substr(0, CHECKSUM_PREFIX.size()) == CHECKSUM_PREFIX) {
+                entry.checksum = utilities::trim(std::string(line.substr(CHECKSUM_PREFIX.size())));
+                position = headerEnd;
+                line = lineAt(headerEnd);
+            }
+            if (tokenHeaders && line.substr(0, TOKENS_PREFIX.size()) == TOKENS_PREFIX) {
+                entry.tokens = std::strtoull(std::string(line.substr(TOKENS_PREFIX.size())).c_str(), nullptr, 10);
+                position = headerEnd;
+                line = lineAt(headerEnd);
+            }
+            if (lengthHeaders && line.substr(0, LENGTH_PREFIX.size()) == LENGTH_PREFIX) {
+                position = headerEnd;
+            }
+            entry.offset = position;
+            entry.length = blockEnd - position;
+            index.entries.push_back(std::move(entry));
+        }
+        return index;
+    }
+
+    char changeLetter(Change change)
+    {
+        switch (change) {
+        case Change::Added:
+            return 'A';
+        case Change::Deleted:
+            return 'D';
+        default:
+            return 'M';
+        }
+    }
+
+    bool comparable(const BundleIndex& from, const BundleIndex& to)
+    {
+        if (from.normalized != to.normalized) {
+            return false;
+        }
+        std::unordered_map<std::string, std::string> types;
+        for (const auto& entry : from.entries) {
+            types[entry.path] = utilities::checksumType(entry.checksum);
+        }
+        for (const auto& entry : to.entries) {
+            auto it = types.find(entry.path);
+            if (it != types.end() && it->second != utilities::checksumType(entry.checksum)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    std::vector<Difference> compare(const BundleIndex& from, const BundleIndex& to)
+    {
+        std::map<std::string, std::string> before = byPath(from);
+        std::map<std::string, std::string> after = byPath(to);
+        std::vector<Difference> differences;
+        auto left = before.begin();
+        auto right = after.begin();
+        while (left != before.end() || right != after.end()) {
+            if (right == after.end() || (left != before.end() && left->first < right->first)) {
+                differences.push_back({ Change::Deleted, left->first });
+                ++left;
+            } else if (left == before.end() || right->first < left->first) {
+                differences.push_back({ Change::Added, right->first });
+                ++right;
+            } else {
+                if (left->second != right->second || left->second.empty()) {
+                    differences.push_back({ Change::Modified, left->first });
+                }
+                ++left;
+                ++right;
+            }
+        }
+        return differences;
+    }
+
+    BundleIndex indexContents(const binary::BundleContents& contents, int jobs)
+    {
+        BundleIndex index;
+        index.entries.resize(contents.entries.size());
+        utilities::parallelFor(contents.entries.size(), jobs, [&](size_t i) {
+            const binary::FileEntry& entry = contents.entries[i];
+            index.entries[i].path = entry.path;
+            if (!entry.content.empty() && entry.content.back() != '\n') {
+                index.entries[i].checksum = utilities::calculateSHA256(entry.content + '\n');
+            } else {
+                index.entries[i].checksum = utilities::calculateSHA256(entry.content);
+            }
+        });
+        return index;
+    }
+
+    std::vector<Difference> status(const BundleIndex& bundle, const std::filesystem::path& root, const std::vector<std::string>& files, HashCache& cache, int jobs)
+    {
+        // Only files the bundle also holds need hashing; the others are additions either way
+        std::map<std::string, std::string> stored = byPath(bundle);
+        std::vector<std::string> shared;
+        for (const auto& file : files) {
+            if (stored.count(file)) {
+                shared.push_back(file);
+            }
+        }
+        std::vector<std::string> current(shared.size());
+        utilities::parallelFor(shared.size(), jobs, [&](size_t i) {
+            const std::string& expected = stored.at(shared[i]);
+            current[i] = cache.checksum(root, shared[i], utilities::checksumType(expected), bundle.normalized, jobs);
+        });
+
+        BundleIndex tree;
+        tree.normalized = bundle.normalized;
+        for (const auto& file : files) {
+            tree.entries.push_back({ file, std::string() });
+        }
+        std::unordered_map<std::string, std::string> hashed;
+        for (size_t i = 0; i < shared.size(); ++i) {
+            hashed[shared[i]] = std::move(current[i]);
+        }
+        for (auto& entry : tree.entries) {
+            auto it = hashed.find(entry.path);
+            if (it != hashed.end()) {
+                entry.checksum = it->second;
+            }
+        }
+        return compare(bundle, tree);
+    }
+
+    BundleIndex indexDirectory(const std::filesystem::path& root, const std::vector<std::string>& files, const std::string& type, bool normalized,
+        HashCache& cache, int jobs)
+    {
+        BundleIndex index;
+        index.normalized = normalized;
+        index.entries.resize(files.size());
+        utilities::parallelFor(files.size(), jobs, [&](size_t i) {
+            index.entries[i].path = files[i];
+            index.entries[i].checksum = cache.checksum(root, files[i], type, normalized, jobs);
+        });
+        return index;
+    }
+
+    std::string fingerprint(const BundleIndex& index)
+    {
+        std::map<std::string, std::string> sorted = byPath(index);
+        std::vector<Digest> level;
+        level.reserve(sorted.size() + 1);
+        for (const auto& [path, checksum] : sorted) {
+            level.push_back(hashParts(0x00, { path, std::string_view("\0", 1), checksum }));
+        }
+        if (level.empty()) {
+            level.push_back(hashParts(0x00, {}));
+        }
+        while (level.size() > 1) {
+            std::vector<Digest> parents((level.size() + 1) / 2);
+            for (size_t i = 0; i < parents.size(); ++i) {
+                parents[i] = 2 * i + 1 < level.size() ? hashParts(0x01, { view(level[2 * i]), view(level[2 * i + 1]) }) : level[2 * i];
+            }
+            level = std::move(parents);
+        }
+        return picosha2::bytes_to_hex_string(level[0].begin(), level[0].end());
+    }
+
+} // namespace changes
+} // namespace codebundler
@@ -0,0 +1,453 @@
+#include "chunkstore.hpp"
+#include "changes.hpp"
+#include "compressedbundle.hpp"
+#include "exceptions.hpp"
+#include "shards.hpp"
+#include "utilities.hpp"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <fstream>
+#include <ostream>
+#include <set>
+#include <sstream>
+#include <unistd.h>
+
+namespace codebundler {
+namespace store {
+
+    namespace {
+
+        const std::string RECIPE_HEADER = "codebundler recipe v1";
+        constexpr size_t READ_BATCH = 256; // Chunks read in parallel before being written out in order
+
+        // Normalized chunking masks for an 8 KiB average: 15 bits below it, 11 bits above (from the FastCDC paper)
+        constexpr std::uint64_t MASK_SMALL = 0x0003590703530000ULL;
+        constexpr std::uint64_t MASK_LARGE = 0x0000d90003530000ULL;
+
+        // Fixed pseudo-random gear table (splitmix64), so chunk boundaries are stable across builds
+        const std::array<std::uint64_t, 256>& gearTable()
+        {
+            static const std::array<std::uint64_t, 256> table = [] {
+                std::array<std::uint64_t, 256> values {};
+                std::uint64_t state = 0x636f646562756e64ULL;
+                for (auto& value : values) {
+                    std::uint64_t z = (state += 0x9e3779b97f4a7c15ULL);
+                    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+                    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+                    value = z ^ (z >> 31);
+                }
+                return values;
+            }();
+            return table;
+        }
+
+        size_t cutPoint(const unsigned char* data, size_t size)
+        {
+            if (size <= MIN_CHUNK_SIZE) {
+                return size;
+            }
+            size = std::min(size, MAX_CHUNK_SIZE);
+            const size_t normal = std::min(size, AVERAGE_CHUNK_SIZE);
+            const auto& gear = gearTable();
+            std::uint64_t hash = 0;
+            size_t i = MIN_CHUNK_SIZE;
+            for (; i < normal; ++i) {
+                hash = (hash << 1) + gear[data[i]];
+                if (!(hash & MASK_SMALL)) {
+                    return i + 1;
+                }
+            }
+            for (; i < size; ++i) {
+                hash = (hash << 1) + gear[data[i]];
+                if (!(hash & MASK_LARGE)) {
+                    return i + 1;
+                }
+            }
+            return size;
+        }
+
+        void checkName(const std::string& name)
+        {
+            if (name.empty() || name[0] == '.' || name.find('/') != std::string::npos || name.find('\n') != std::string::npos) {
+                throw CodeBundlerException("Invalid store name: '" + name + "'.");
+            }
+        }
+
+        // Reads "<keyword> ..." lines and raw byte runs from a recipe
+        class RecipeReader {
+        public:
+            explicit RecipeReader(const std::string& data)
+                : m_data(data)
+            {
+            }
+
+            bool atEnd() const { return m_position >= m_data.size(); }
+
+            std::string line()
+            {
+                size_t end = m_data.find('\n', m_position);
+                if (end == std::string::npos) {
+                    throw BundleFormatException("Truncated store recipe.");
+                }
+                std::string text = m_data.substr(m_position, end - m_position);
+                m_position = end + 1;
+                return text;
+            }
+
+            std::string bytes(std::uint64_t length)
+            {
+                if (length > m_data.size() - m_position) {
+                    throw BundleFormatException("Truncated store recipe.");
+                }
+                std::string text = m_data.substr(m_position, length);
+                m_position += length;
+                return text;
+            }
+
+        private:
+            const std::string& m_data;
+            size_t m_position = 0;
+        };
+
+    } // anonymous namespace
+
+    /**
+     * @brief Splits data into content-defined chunks (FastCDC).
+     */
+    std::vector<size_t> chunkLengths(std::string_view data)
+    {
+        std::vector<size_t> lengths;
+        const auto* bytes = reinterpret_cast<const unsigned char*>(data.data());
+        for (size_t position = 0; position < data.size();) {
+            size_t length = cutPoint(bytes + position, data.size() - position);
+            lengths.push_back(length);
+            position += length;
+        }
+        return lengths;
+    }
+
+    ChunkStore::ChunkStore(std::filesystem::path directory, int jobs)
+        : m_directory(std::move(directory))
+        , m_jobs(jobs)
+    {
+    }
+
+    /**
+     * @brief Chunks a bundle into the store under a name.
+     */
+    AddResult ChunkStore::add(const std::string& name, const std::string& bundlePath)
+    {
+        checkName(name);
+        std::string data = utilities::readFileBytes(bundlePath);
+        if (shards::isManifest(data)) {
+            throw CodeBundlerException("A shard manifest cannot be stored; add the shards one by one.");
+        }
+        if (compressed::isCompressedBundle(data)) {
+            data = compressed::readBundle(data, {}, m_jobs);
+        }
+        changes::BundleIndex index = changes::indexBuffer(data);
+
+        // Pieces cover the bundle: entry contents, and the headers and padding between them
+        struct Piece {
+            std::uint64_t offset;
+            std::uint64_t length;
+            std::vector<Segment> segments;
+        };
+        std::vector<Piece> pieces;
+        std::uint64_t covered = 0;
+        auto addPiece = [&](std::uint64_t offset, std::uint64_t length) {
+            if (length > 0) {
+                pieces.push_back({ offset, length, {} });
+            }
+        };
+        std::vector<changes::IndexEntry> entries = index.entries;
+        std::sort(entries.begin(), entries.end(), [](const auto& a, const auto& b) { return a.offset < b.offset; });
+        for (const auto& entry : entries) {
+            if (entry.offset < covered) {
+                continue; // Overlapping entries (never written by the bundler) stay part of the earlier piece
+            }
+            addPiece(covered, entry.offset - covered);
+            addPiece(entry.offset, entry.length);
+            covered = entry.offset + entry.length;
+        }
+        addPiece(covered, data.size() - covered);
+
+        std::filesystem::create_directories(m_directory / "chunks");
+        std::filesystem::create_directories(m_directory / "recipes");
+
+        std::atomic<size_t> newChunks { 0 };
+        std::atomic<std::uint64_t> newBytes { 0 };
+        utilities::parallelFor(pieces.size(), m_jobs, [&](size_t i) {
+            Piece& piece = pieces[i];
+            std::string_view content = std::string_view(data).substr(piece.offset, piece.length);
+            if (content.size() < MIN_CHUNK_SIZE) {
+                piece.segments.push_back({ "", std::string(content), content.size() });
+                return;
+            }
+            size_t position = 0;
+            for (size_t length : chunkLengths(content)) {
+                std::string_view chunk = content.substr(position, length);
+                std::string hash = utilities::calculateSHA256(chunk);
+                if (writeChunk(hash, chunk)) {
+                    ++newChunks;
+                    newBytes += length;
+                }
+                piece.segments.push_back({ std::move(hash), "", length });
+                position += length;
+            }
+        });
+
+        Recipe recipe;
+        recipe.size = data.size();
+        for (const auto& entry : index.entries) {
+            recipe.entries.push_back({ entry.path, entry.offset, entry.length });
+        }
+        AddResult result;
+        result.newChunks = newChunks;
+        result.newBytes = newBytes;
+        for (auto& piece : pieces) {
+            for (auto& segment : piece.segments) {
+                if (!segment.chunk.empty()) {
+                    ++result.chunks;
+                    result.bytes += segment.length;
+                }
+                recipe.segments.push_back(std::move(segment));
+            }
+        }
+        writeRecipe(name, recipe);
+        return result;
+    }
+
+    /**
+     * @brief Writes a stored bundle, byte for byte, verifying every chunk read.
+     */
+    void ChunkStore::get(const std::string& name, std::ostream& outputStream)
+    {
+        Recipe recipe = readRecipe(name);
+        for (size_t batch = 0; batch < recipe.segments.size(); batch += READ_BATCH) {
+            size_t count = std::min(READ_BATCH, recipe.segments.size() - batch);
+            std::vector<std::string> contents(count);
+            utilities::parallelFor(count, m_jobs, [&](size_t i) {
+                const Segment& segment = recipe.segments[batch + i];
+                if (!segment.chunk.empty()) {
+                    contents[i] = readChunk(segment.chunk);
+                }
+            });
+            for (size_t i = 0; i < count; ++i) {
+                const Segment& segment = recipe.segments[batch + i];
+                const std::string& bytes = segment.chunk.empty() ? segment.literal : contents[i];
+                outputStream.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+            }
+        }
+        if (!outputStream) {
+            throw FileIOException("Stream error occurred while writing stored bundle", name);
+        }
+    }
+
+    /**
+     * @brief Returns the content of one entry of a stored bundle, reading only its chunks.
+     */
+    std::string ChunkStore::getEntry(const std::string& name, const std::string& path)
+    {
+        Recipe recipe = readRecipe(name);
+        auto entry = std::find_if(recipe.entries.rbegin(), recipe.entries.rend(), [&path](const auto& e) { return e.path == path; });
+        if (entry == recipe.entries.rend()) {
+            throw FileIOException("No such entry in stored bundle '" + name + "'", path);
+        }
+        const std::uint64_t begin = entry->offset;
+        const std::uint64_t end = entry->offset + entry->length;
+
+        std::vector<size_t> needed;
+        std::vector<std::uint64_t> starts;
+        std::uint64_t position = 0;
+        for (size_t i = 0; i < recipe.segments.size() && position < end; ++i) {
+            if (position + recipe.segments[i].length > begin) {
+                needed.push_back(i);
+                starts.push_back(position);
+            }
+            position += recipe.segments[i].length;
+        }
+        std::vector<std::string> contents(needed.size());
+        utilities::parallelFor(needed.size(), m_jobs, [&](size_t i) {
+            const Segment& segment = recipe.segments[needed[i]];
+            contents[i] = segment.chunk.empty() ? segment.literal : readChunk(segment.chunk);
+        });
+
+        std::string content;
+        content.reserve(entry->length);
+        for (size_t i = 0; i < needed.size(); ++i) {
+            std::uint64_t from = begin > starts[i] ? begin - starts[i] : 0;
+            std::uint64_t to = std::min<std::uint64_t>(contents[i].size(), end - starts[i]);
+            content.append(contents[i], from, to - from);
+        }
+        return content;
+    }
+
+    std::vector<std::string> ChunkStore::list() const
+    {
+        std::vector<std::string> names;
+        std::error_code ec;
+        for (const auto& item : std::filesystem::directory_iterator(m_directory / "recipes", ec)) {
+            std::string name = item.path().filename().string();
+            if (item.is_regular_file() && name[0] != '.') {
+                names.push_back(name);
+            }
+        }
+        std::sort(names.begin(), names.end());
+        return names;
+    }
+
+    void ChunkStore::remove(const std::string& name)
+    {
+        checkName(name);
+        std::error_code ec;
+        if (!std::filesystem::remove(recipePath(name), ec)) {
+            throw FileIOException("No such stored bundle", name);
+        }
+    }
+
+    /**
+     * @brief Deletes chunks no recipe refers to.
+     */
+    size_t ChunkStore::gc()
+    {
+        std::set<std::string> referenced;
+        for (const auto& name : list()) {
+            for (const auto& segment : readRecipe(name).segments) {
+                if (!segment.chunk.empty()) {
+                    referenced.insert(segment.chunk);
+                }
+            }
+        }
+        size_t removed = 0;
+        std::error_code ec;
+        for (const auto& item : std::filesystem::recursive_directory_iterator(m_directory / "chunks", ec)) {
+            if (item.is_regular_file() && !referenced.count(item.path().filename().string())) {
+                std::error_code removeError;
+                removed += std::filesystem::remove(item.path(), removeError) ? 1 : 0;
+            }
+        }
+        return removed;
+    }
+
+    //--------------------------------------------------------------------------
+    // Private Methods
+    //--------------------------------------------------------------------------
+
+    std::filesystem::path ChunkStore::recipePath(const std::string& name) const
+    {
+        return m_directory / "recipes" / name;
+    }
+
+    std::filesystem::path ChunkStore::chunkPath(const std::string& hash) const
+    {
+        return m_directory / "chunks" / hash.substr(0, 2) / hash;
+    }
+
+    ChunkStore::Recipe ChunkStore::readRecipe(const std::string& name) const
+    {
+        checkName(name);
+        if (!std::filesystem::exists(recipePath(name))) {
+            throw FileIOException("No such stored bundle", name);
+        }
+        const std::string data = utilities::readFileBytes(recipePath(name));
+        RecipeReader reader(data);
+        if (reader.line() != RECIPE_HEADER) {
+            throw BundleFormatException("Not a store recipe: " + name);
+        }
+        Recipe recipe;
+        while (!reader.atEnd()) {
+            std::istringstream fields(reader.line());
+            std::string keyword;
+            fields >> keyword;
+            if (keyword == "size") {
+                fields >> recipe.size;
+            } else if (keyword == "entry") {
+                // entry <offset> <length> <path length> <path>; the length keeps spaces in paths intact
+                Recipe::Entry entry;
+                size_t pathLength = 0;
+                fields >> entry.offset >> entry.length >> pathLength;
+                fields.get();
+                entry.path.resize(pathLength);
+                fields.read(entry.path.data(), static_cast<std::streamsize>(pathLength));
+                recipe.entries.push_back(std::move(entry));
+            } else if (keyword == "chunk") {
+                Segment segment;
+                fields >> segment.length >> segment.chunk;
+                recipe.segments.push_back(std::move(segment));
+            } else if (keyword == "literal") {
+                Segment segment;
+                fields >> segment.length;
+                segment.literal = reader.bytes(segment.length);
+                reader.line(); // The newline after the bytes
+                recipe.segments.push_back(std::move(segment));
+            } else {
+                throw BundleFormatException("Unexpected line in store recipe: " + name);
+            }
+            if (fields.fail()) {
+                throw BundleFormatException("Malformed store recipe: " + name);
+            }
+        }
+        return recipe;
+    }
+
+    void ChunkStore::writeRecipe(const std::string& name, const Recipe& recipe) const
+    {
+        std::ostringstream output;
+        output << RECIPE_HEADER << "\n"
+               << "size " << recipe.size << "\n";
+        for (const auto& entry : recipe.entries) {
+            output << "entry " << entry.offset << " " << entry.length << " " << entry.path.size() << " " << entry.path << "\n";
+        }
+        for (const auto& segment : recipe.segments) {
+            if (segment.chunk.empty()) {
+                output << "literal " << segment.literal.size() << "\n"
+                       << segment.literal << "\n";
+            } else {
+                output << "chunk " << segment.length << " " << segment.chunk << "\n";
+            }
+        }
+        utilities::replaceFileAtomically(recipePath(name), output.str());
+    }
+
+    std::string ChunkStore::readChunk(const std::string& hash) const
+    {
+        std::string data = utilities::readFileBytes(chunkPath(hash));
+        std::string actual = utilities::calculateSHA256(data);
+        if (actual != hash) {
+            throw ChecksumMismatchException(chunkPath(hash).string(), hash, actual);
+        }
+        return data;
+    }
+
+    // Returns false if the chunk was already stored
+    bool ChunkStore::writeChunk(const std::string& hash, std::string_view data) const
+    {
+        static std::atomic<unsigned> counter { 0 };
+        const std::filesystem::path path = chunkPath(hash);
+        std::error_code ec;
+        if (std::filesystem::exists(path, ec)) {
+            return false;
+        }
+        std::filesystem::create_directories(path.parent_path());
+        // A unique temporary name, as two threads may store the same chunk at once
+        std::filesystem::path temporary = path;
+        temporary += ".tmp." + std::to_string(::getpid()) + "." + std::to_string(counter++);
+        {
+            std::ofstream output(temporary, std::ios::binary | std::ios::trunc);
+            output.write(data.data(), static_cast<std::streamsize>(data.size()));
+            if (!output.flush()) {
+                throw FileIOException("Failed to write chunk", temporary.string());
+            }
+        }
+        std::filesystem::rename(temporary, path, ec);
+        if (ec) {
+            std::filesystem::remove(temporary, ec);
+            throw FileIOException("Failed to store chunk", path.string());
+        }
+        return true;
+    }
+
+} // namespace store
+} // namespace codebundler
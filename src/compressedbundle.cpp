@@ -0,0 +1,370 @@
+#include "compressedbundle.hpp"
+#include "exceptions.hpp"
+#include "utilities.hpp"
+#include <algorithm>
+#include <climits>
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <set>
+
+#ifdef CODEBUNDLER_HAVE_ZSTD
+#include <zstd.h>
+#endif
+#ifdef CODEBUNDLER_HAVE_LZ4
+#include <lz4.h>
+#endif
+
+namespace codebundler {
+namespace compressed {
+
+    namespace {
+
+        // Starts with a non-ASCII byte (like PNG) so it can never be mistaken for a text bundle
+        const std::string HEADER_MAGIC = std::string("\x89" "CBZ\r\n\x1a\n", 8);
+        const std::string TRAILER_MAGIC = "CBZTABLE";
+        constexpr size_t TRAILER_SIZE = 8 + 8 + 8; // table offset, table size, magic
+        constexpr size_t TARGET_FRAME_SIZE = 256 * 1024; // Small entries are grouped up to this size
+        constexpr size_t FRAME_RECORD_SIZE = 8 + 8 + 8; // offset, compressed size, raw size
+        constexpr size_t MIN_LOCATION_RECORD_SIZE = 4 + 8 + 8 + 4; // frame, offset, length, path length
+        constexpr int ZSTD_LEVEL = 3;
+
+        enum Codec : uint32_t {
+            CODEC_ZSTD = 1,
+            CODEC_LZ4 = 2
+        };
+
+        struct Frame {
+            uint64_t offset = 0;
+            uint64_t compressedSize = 0;
+            uint64_t rawSize = 0;
+        };
+
+        struct EntryLocation {
+            uint32_t frame = 0;
+            uint64_t offsetInFrame = 0;
+            uint64_t length = 0;
+            std::string path;
+        };
+
+        void putU32(std::string& out, uint32_t value)
+        {
+            for (int i = 0; i < 4; ++i) {
+                out += static_cast<char>((value >> (8 * i)) & 0xff);
+            }
+        }
+
+        void putU64(std::string& out, uint64_t value)
+        {
+            for (int i = 0; i < 8; ++i) {
+                out += static_cast<char>((value >> (8 * i)) & 0xff);
+            }
+        }
+
+        // Bounds-checked little-endian reader over the frame table
+        class Reader {
+        public:
+            Reader(std::string_view data, size_t offset, size_t end)
+                : m_data(data)
+                , m_pos(offset)
+                , m_end(end)
+            {
+            }
+            uint64_t get(int bytes)
+            {
+                need(static_cast<size_t>(bytes));
+                uint64_t value = 0;
+                for (int i = 0; i < bytes; ++i) {
+                    value |= static_cast<uint64_t>(static_cast<unsigned char>(m_data[m_pos++])) << (8 * i);
+                }
+                return value;
+            }
+            std::string getString(size_t length)
+            {
+                need(length);
+                std::string value(m_data.substr(m_pos, length));
+                m_pos += length;
+                return value;
+            }
+            size_t remaining() const
+            {
+                return m_end - m_pos;
+            }
+
+        private:
+            void need(size_t bytes) const
+            {
+                if (m_end - m_pos < bytes) {
+                    throw BundleFormatException("Truncated compressed bundle frame table.");
+                }
+            }
+            std::string_view m_data;
+            size_t m_pos;
+            size_t m_end;
+        };
+
+        uint32_t codecId(const std::string& codec)
+        {
+            if (codec == "zstd") {
+                return CODEC_ZSTD;
+            }
+            if (codec == "lz4") {
+                return CODEC_LZ4;
+            }
+            throw CodeBundlerException("Unknown compression codec: " + codec);
+        }
+
+        std::string compressFrame(uint32_t codec, const std::string& raw)
+        {
+#ifdef CODEBUNDLER_HAVE_ZSTD
+            if (codec == CODEC_ZSTD) {
+                std::string out(ZSTD_compressBound(raw.size()), '\0');
+                size_t size = ZSTD_compress(&out[0], out.size(), raw.data(), raw.size(), ZSTD_LEVEL);
+                if (ZSTD_isError(size)) {
+                    throw CodeBundlerException(std::string("zstd compression failed: ") + ZSTD_getErrorName(size));
+                }
+                out.resize(size);
+                return out;
+            }
+#endif
+#ifdef CODEBUNDLER_HAVE_LZ4
+            if (codec == CODEC_LZ4) {
+                if (raw.size() > static_cast<size_t>(INT_MAX / 2)) {
+                    throw CodeBundlerException("Entry too large for an lz4 frame; use zstd.");
+                }
+                std::string out(static_cast<size_t>(LZ4_compressBound(static_cast<int>(raw.size()))), '\0');
+                int size = LZ4_compress_default(raw.data(), &out[0], static_cast<int>(raw.size()), static_cast<int>(out.size()));
+                if (size <= 0 && !raw.empty()) {
+                    throw CodeBundlerException("lz4 compression failed.");
+                }
+                out.resize(static_cast<size_t>(size));
+                return out;
+            }
+#endif
+            (void)raw;
+            throw CodeBundlerException("Compression codec " + std::to_string(codec) + " is not available in this build.");
+        }
+
+        std::string decompressFrame(uint32_t codec, const char* data, size_t size, size_t rawSize)
+        {
+            // The raw size comes from the file, so check it against the frame before allocating
+#ifdef CODEBUNDLER_HAVE_ZSTD
+            if (codec == CODEC_ZSTD) {
+                constexpr size_t maxRatio = 128 * 1024 / 4; // A block holds at most 128 KiB and takes at least 4 bytes
+                if (rawSize / maxRatio > size) {
+                    throw BundleFormatException("Corrupt zstd frame in compressed bundle.");
+                }
+                std::string out(rawSize, '\0');
+                size_t got = ZSTD_decompress(&out[0], out.size(), data, size);
+                if (ZSTD_isError(got) || got != rawSize) {
+                    throw BundleFormatException("Corrupt zstd frame in compressed bundle.");
+                }
+                return out;
+            }
+#endif
+#ifdef CODEBUNDLER_HAVE_LZ4
+            if (codec == CODEC_LZ4) {
+                constexpr size_t maxRatio = 255; // Each match-length byte expands to at most 255 bytes
+                if (rawSize > static_cast<size_t>(INT_MAX) || size > static_cast<size_t>(INT_MAX) || rawSize / maxRatio > size) {
+                    throw BundleFormatException("Corrupt lz4 frame in compressed bundle.");
+                }
+                std::string out(rawSize, '\0');
+                int got = LZ4_decompress_safe(data, &out[0], static_cast<int>(size), static_cast<int>(rawSize));
+                if (got < 0 || static_cast<size_t>(got) != rawSize) {
+                    throw BundleFormatException("Corrupt lz4 frame in compressed bundle.");
+                }
+                return out;
+            }
+#endif
+            (void)data;
+            (void)size;
+            (void)rawSize;
+            throw CodeBundlerException("Compression codec " + std::to_string(codec) + " is not available in this build.");
+        }
+
+    } // anonymous namespace
+
+    bool isCodecAvailable(const std::string& codec)
+    {
+#ifdef CODEBUNDLER_HAVE_ZSTD
+        if (codec == "zstd") {
+            return true;
+        }
+#endif
+#ifdef CODEBUNDLER_HAVE_LZ4
+        if (codec == "lz4") {
+            return true;
+        }
+#endif
+        (void)codec;
+        return false;
+    }
+
+    /**
+     * @brief Writes a compressed bundle container.
+     */
+    void writeBundle(std::ostream& outputStream, const std::string& preamble, const std::vector<EntryChunk>& entries, const std::string& codec, int jobs)
+    {
+        const uint32_t id = codecId(codec);
+        if (!isCodecAvailable(codec)) {
+            throw CodeBundlerException("Compression codec '" + codec + "' is not available in this build.");
+        }
+
+        // Group entries into frames: frame 0 is the preamble, then consecutive
+        // entries are packed together until a frame reaches the target size.
+        // An entry of at least the target size gets a frame of its own, so
+        // extracting a small neighbour never decompresses it.
+        std::vector<std::string> rawFrames { preamble };
+        std::vector<EntryLocation> locations;
+        for (const auto& entry : entries) {
+            if (rawFrames.size() == 1 || rawFrames.back().size() >= TARGET_FRAME_SIZE
+                || (entry.text.size() >= TARGET_FRAME_SIZE && !rawFrames.back().empty())) {
+                rawFrames.emplace_back();
+            }
+            EntryLocation location;
+            location.frame = static_cast<uint32_t>(rawFrames.size() - 1);
+            location.offsetInFrame = rawFrames.back().size();
+            location.length = entry.text.size();
+            location.path = entry.path;
+            locations.push_back(std::move(location));
+            rawFrames.back() += entry.text;
+        }
+
+        std::vector<std::string> compressedFrames(rawFrames.size());
+        utilities::parallelFor(rawFrames.size(), jobs, [&](size_t i) {
+            compressedFrames[i] = compressFrame(id, rawFrames[i]);
+        });
+
+        outputStream.write(HEADER_MAGIC.data(), static_cast<std::streamsize>(HEADER_MAGIC.size()));
+        uint64_t offset = HEADER_MAGIC.size();
+        std::vector<Frame> frames;
+        for (size_t i = 0; i < compressedFrames.size(); ++i) {
+            outputStream.write(compressedFrames[i].data(), static_cast<std::streamsize>(compressedFrames[i].size()));
+            frames.push_back(Frame { offset, compressedFrames[i].size(), rawFrames[i].size() });
+            offset += compressedFrames[i].size();
+        }
+
+        std::string table;
+        putU32(table, id);
+        putU32(table, static_cast<uint32_t>(frames.size()));
+        for (const auto& frame : frames) {
+            putU64(table, frame.offset);
+            putU64(table, frame.compressedSize);
+            putU64(table, frame.rawSize);
+        }
+        putU32(table, static_cast<uint32_t>(locations.size()));
+        for (const auto& location : locations) {
+            putU32(table, location.frame);
+            putU64(table, location.offsetInFrame);
+            putU64(table, location.length);
+            putU32(table, static_cast<uint32_t>(location.path.size()));
+            table += location.path;
+        }
+        const uint64_t tableSize = table.size();
+        putU64(table, offset);
+        putU64(table, tableSize);
+        table += TRAILER_MAGIC;
+        outputStream.write(table.data(), static_cast<std::streamsize>(table.size()));
+
+        if (!outputStream) {
+            throw FileIOException("Stream error occurred while writing compressed bundle");
+        }
+    }
+
+    bool isCompressedBundle(std::string_view data)
+    {
+        return data.compare(0, HEADER_MAGIC.size(), HEADER_MAGIC) == 0;
+    }
+
+    bool startsCompressedBundle(std::istream& inputStream)
+    {
+        return inputStream.peek() == static_cast<unsigned char>(HEADER_MAGIC[0]);
+    }
+
+    /**
+     * @brief Decompresses a container back into plain bundle text.
+     */
+    std::string readBundle(std::string_view container, const std::vector<std::string>& onlyFiles, int jobs)
+    {
+        if (!isCompressedBundle(container) || container.size() < HEADER_MAGIC.size() + TRAILER_SIZE
+            || container.compare(container.size() - TRAILER_MAGIC.size(), TRAILER_MAGIC.size(), TRAILER_MAGIC) != 0) {
+            throw BundleFormatException("Not a compressed bundle, or its frame table is missing.");
+        }
+
+        Reader trailer(container, container.size() - TRAILER_SIZE, container.size());
+        uint64_t tableOffset = trailer.get(8);
+        uint64_t tableSize = trailer.get(8);
+        if (tableOffset < HEADER_MAGIC.size() || tableSize > container.size() || tableOffset + tableSize != container.size() - TRAILER_SIZE) {
+            throw BundleFormatException("Compressed bundle frame table is out of range.");
+        }
+
+        Reader table(container, static_cast<size_t>(tableOffset), container.size() - TRAILER_SIZE);
+        uint32_t codec = static_cast<uint32_t>(table.get(4));
+        // Counts come from the file, so check them against the table before allocating
+        const uint64_t frameCount = table.get(4);
+        if (frameCount > table.remaining() / FRAME_RECORD_SIZE) {
+            throw BundleFormatException("Compressed bundle frame count exceeds its frame table.");
+        }
+        std::vector<Frame> frames(static_cast<size_t>(frameCount));
+        for (auto& frame : frames) {
+            frame.offset = table.get(8);
+            frame.compressedSize = table.get(8);
+            frame.rawSize = table.get(8);
+            if (frame.offset > tableOffset || frame.compressedSize > tableOffset - frame.offset) {
+                throw BundleFormatException("Compressed bundle frame is out of range.");
+            }
+        }
+        const uint64_t locationCount = table.get(4);
+        if (locationCount > table.remaining() / MIN_LOCATION_RECORD_SIZE) {
+            throw BundleFormatException("Compressed bundle entry count exceeds its frame table.");
+        }
+        std::vector<EntryLocation> locations(static_cast<size_t>(locationCount));
+        for (auto& location : locations) {
+            location.frame = static_cast<uint32_t>(table.get(4));
+            location.offsetInFrame = table.get(8);
+            location.length = table.get(8);
+            location.path = table.getString(static_cast<size_t>(table.get(4)));
+            if (location.frame >= frames.size() || location.offsetInFrame > frames[location.frame].rawSize
+                || location.length > frames[location.frame].rawSize - location.offsetInFrame) {
+                throw BundleFormatException("Compressed bundle entry is out of range.");
+            }
+        }
+        if (frames.empty()) {
+            throw BundleFormatException("Compressed bundle has no preamble frame.");
+        }
+
+        // Decide which frames are needed: all, or the preamble plus frames holding selected entries
+        std::vector<bool> needed(frames.size(), onlyFiles.empty());
+        needed[0] = true;
+        std::set<std::string> selected(onlyFiles.begin(), onlyFiles.end());
+        for (const auto& location : locations) {
+            if (selected.count(location.path)) {
+                needed[location.frame] = true;
+            }
+        }
+
+        std::vector<std::string> rawFrames(frames.size());
+        utilities::parallelFor(frames.size(), jobs, [&](size_t i) {
+            if (needed[i]) {
+                rawFrames[i] = decompressFrame(codec, container.data() + frames[i].offset,
+                    static_cast<size_t>(frames[i].compressedSize), static_cast<size_t>(frames[i].rawSize));
+            }
+        });
+
+        std::string text = std::move(rawFrames[0]);
+        if (onlyFiles.empty()) {
+            for (size_t i = 1; i < rawFrames.size(); ++i) {
+                text += rawFrames[i];
+            }
+            return text;
+        }
+        for (const auto& location : locations) {
+            if (selected.count(location.path)) {
+                text.append(rawFrames[location.frame], static_cast<size_t>(location.offsetInFrame), static_cast<size_t>(location.length));
+            }
+        }
+        return text;
+    }
+
+} // namespace compressed
+} // namespace codebundler
@@ -0,0 +1,114 @@
+#include "dedupindex.hpp"
+#include "exceptions.hpp"
+#include <cerrno>
+#include <fcntl.h>
+#include <iostream> // For std::cerr
+#include <linux/fs.h> // For FICLONE
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+namespace codebundler {
+
+namespace {
+
+    std::filesystem::path temporaryName(const std::filesystem::path& target)
+    {
+        std::filesystem::path tempPath = target;
+        tempPath += ".tmp." + std::to_string(::getpid());
+        return tempPath;
+    }
+
+    bool cloneFile(const std::filesystem::path& source, const std::filesystem::path& target, std::uint32_t mode)
+    {
+        int sourceFd = ::open(source.c_str(), O_RDONLY | O_CLOEXEC);
+        if (sourceFd < 0) {
+            return false;
+        }
+        mode_t permissions = (mode & 0777) != 0 ? static_cast<mode_t>(mode & 0777) : 0644;
+        int targetFd = ::open(target.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, permissions);
+        if (targetFd < 0) {
+            ::close(sourceFd);
+            return false;
+        }
+        bool cloned = ::ioctl(targetFd, FICLONE, sourceFd) == 0;
+        ::close(sourceFd);
+        cloned = ::close(targetFd) == 0 && cloned;
+        return cloned;
+    }
+
+} // anonymous namespace
+
+DedupIndex::DedupIndex(const std::string& mode, int verbose)
+    : m_verbose(verbose)
+{
+    if (mode == "copy" || mode.empty()) {
+        m_mode = Mode::Copy;
+    } else if (mode == "reflink") {
+        m_mode = Mode::Reflink;
+    } else if (mode == "hardlink") {
+        m_mode = Mode::Hardlink;
+    } else {
+        throw CodeBundlerException("Unknown dedup mode: " + mode);
+    }
+}
+
+/**
+ * @brief Creates target from an earlier file with the same content, if there is one.
+ */
+bool DedupIndex::materialize(const std::string& checksum, const std::filesystem::path& target, std::uint32_t mode)
+{
+    if (!enabled() || checksum.empty()) {
+        return false;
+    }
+    std::filesystem::path source;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto it = m_firstCopies.find(checksum);
+        if (it == m_firstCopies.end()) {
+            return false;
+        }
+        if (m_mode == Mode::Hardlink && it->second.permissions != permissionsOf(mode)) {
+            // A hard link would give this entry the first copy's permission bits
+            m_verbose > 1 && std::cerr << "  Not linking " << target << " to " << it->second.path << ": modes differ." << std::endl;
+            return false;
+        }
+        source = it->second.path;
+    }
+
+    std::filesystem::path tempPath = temporaryName(target);
+    std::error_code ec;
+    std::filesystem::remove(tempPath, ec);
+    bool created = m_mode == Mode::Hardlink ? ::link(source.c_str(), tempPath.c_str()) == 0 : cloneFile(source, tempPath, mode);
+    if (created) {
+        std::filesystem::rename(tempPath, target, ec);
+        created = !ec;
+    }
+    if (!created) {
+        // Unsupported filesystem, different device, ...: the caller writes the bytes instead
+        std::filesystem::remove(tempPath, ec);
+        m_verbose > 1 && std::cerr << "  Cannot link " << target << " to " << source << ", writing it." << std::endl;
+        return false;
+    }
+
+    m_verbose > 1 && std::cerr << "  Linked " << target << " to " << source << std::endl;
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_linked++;
+    return true;
+}
+
+void DedupIndex::remember(const std::string& checksum, const std::filesystem::path& path, std::uint32_t mode)
+{
+    if (!enabled() || checksum.empty()) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_firstCopies.emplace(checksum, FirstCopy { path, permissionsOf(mode) });
+}
+
+size_t DedupIndex::linkedCount() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_linked;
+}
+
+} // namespace codebundler
@@ -0,0 +1,92 @@
+#include "fastimport.hpp"
+#include "exceptions.hpp"
+#include "utilities.hpp"
+#include <ctime>
+#include <ostream>
+
+namespace codebundler {
+
+namespace {
+
+    // Paths with special characters are written C-style quoted, as fast-import expects
+    std::string quotePath(const std::string& path)
+    {
+        if (path.find_first_of("\"\\\n") == std::string::npos) {
+            return path;
+        }
+        std::string quoted = "\"";
+        for (char c : path) {
+            if (c == '"' || c == '\\') {
+                quoted += '\\';
+                quoted += c;
+            } else if (c == '\n') {
+                quoted += "\\n";
+            } else {
+                quoted += c;
+            }
+        }
+        return quoted + "\"";
+    }
+
+} // anonymous namespace
+
+FastImportWriter::FastImportWriter(std::ostream& outputStream, std::string branch, std::string parent)
+    : m_out(outputStream)
+    , m_branch(std::move(branch))
+    , m_parent(std::move(parent))
+{
+}
+
+/**
+ * @brief Writes a file's content as a blob.
+ */
+void FastImportWriter::addFile(const std::string& path, std::string_view content, std::uint32_t mode)
+{
+    m_files.push_back(File { path, (mode & 0111) != 0 });
+    m_out << "blob\nmark :" << m_files.size() << "\ndata " << content.size() << "\n";
+    m_out.write(content.data(), static_cast<std::streamsize>(content.size()));
+    m_out << "\n";
+    if (!m_out) {
+        throw FileIOException("Failed to write fast-import stream for file", path);
+    }
+}
+
+/**
+ * @brief Writes the commit referencing all added files.
+ */
+void FastImportWriter::commit(const std::string& committer, const std::string& message)
+{
+    m_out << "commit refs/heads/" << m_branch << "\n";
+    m_out << "committer " << committer << "\n";
+    m_out << "data " << message.size() << "\n"
+          << message << "\n";
+    if (!m_parent.empty()) {
+        m_out << "from " << m_parent << "\n";
+    }
+    m_out << "deleteall\n"; // The tree is exactly the bundle, not the parent plus the bundle
+    for (size_t i = 0; i < m_files.size(); ++i) {
+        m_out << "M " << (m_files[i].executable ? "100755" : "100644") << " :" << i + 1 << " " << quotePath(m_files[i].path) << "\n";
+    }
+    m_out << "\n";
+    m_out.flush();
+    if (!m_out) {
+        throw FileIOException("Failed to write fast-import stream for commit", m_branch);
+    }
+}
+
+std::string FastImportWriter::committerIdentity(const std::string& repository)
+{
+    auto [exit_code, output] = utilities::executeCommand("git -C " + utilities::shellQuote(repository) + " var GIT_COMMITTER_IDENT 2>/dev/null");
+    if (exit_code == 0 && !utilities::trim(output).empty()) {
+        return utilities::trim(output);
+    }
+    return "codebundler <codebundler@localhost> " + std::to_string(std::time(nullptr)) + " +0000";
+}
+
+std::string FastImportWriter::branchTip(const std::string& repository, const std::string& branch)
+{
+    auto [exit_code, output] = utilities::executeCommand("git -C " + utilities::shellQuote(repository) + " rev-parse --verify -q " + utilities::shellQuote("refs/heads/" + branch) + " 2>/dev/null");
+    return exit_code == 0 ? utilities::trim(output) : "";
+}
+
+} // namespace codebundler
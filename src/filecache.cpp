@@ -0,0 +1,78 @@
+#include "filecache.hpp"
+#include "exceptions.hpp"
+#include "utilities.hpp"
+#include <sys/stat.h> // For stat
+
+namespace codebundler {
+
+FileCache::FileCache(std::string checksumType, int jobs)
+    : m_checksumType(std::move(checksumType))
+    , m_jobs(jobs)
+{
+}
+
+/**
+ * @brief Returns the content and checksum of a file, reading it only if it changed.
+ */
+std::shared_ptr<const CachedFile> FileCache::get(const std::filesystem::path& path)
+{
+    Stamp stamp;
+    if (!statFile(path, stamp)) {
+        invalidate(path);
+        throw FileIOException("Failed to stat file", path.string());
+    }
+
+    const std::string key = path.string();
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto it = m_entries.find(key);
+        if (it != m_entries.end() && it->second.stamp == stamp) {
+            return it->second.file;
+        }
+    }
+
+    // Read and hash outside the lock so other threads are not held up
+    auto file = load(path, m_checksumType, m_jobs);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_entries[key] = Slot { stamp, file };
+    return file;
+}
+
+void FileCache::invalidate(const std::filesystem::path& path)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_entries.erase(path.string());
+}
+
+void FileCache::clear()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_entries.clear();
+}
+
+/**
+ * @brief Reads a file and computes its bundle content and checksum, bypassing any cache.
+ */
+std::shared_ptr<const CachedFile> FileCache::load(const std::filesystem::path& path, const std::string& checksumType, int jobs)
+{
+    auto file = std::make_shared<CachedFile>();
+    file->content = utilities::readFileContent(path);
+    file->checksum = utilities::calculateChecksum(file->content, checksumType, jobs);
+    return file;
+}
+
+bool FileCache::statFile(const std::filesystem::path& path, Stamp& stamp)
+{
+    struct stat st;
+    if (::stat(path.c_str(), &st) != 0) {
+        return false;
+    }
+    stamp.device = static_cast<std::uint64_t>(st.st_dev);
+    stamp.inode = static_cast<std::uint64_t>(st.st_ino);
+    stamp.size = static_cast<std::int64_t>(st.st_size);
+    stamp.mtimeNs = static_cast<std::int64_t>(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+    return true;
+}
+
+} // namespace codebundler
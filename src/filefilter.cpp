@@ -0,0 +1,123 @@
+#include "filefilter.hpp"
+#include "scanner.hpp"
+#include "utilities.hpp"
+#include <fcntl.h>
+#include <ostream>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace codebundler {
+
+namespace {
+
+    constexpr size_t BINARY_PROBE_SIZE = 8192; // Like git, only the start of a file is looked at
+
+    enum class Verdict : unsigned char {
+        Kept,
+        Pattern,
+        Size,
+        Binary
+    };
+
+    // True if the rules match the path or one of its parent directories
+    bool matchesPathOrParent(const IgnoreRules& rules, const std::string& path)
+    {
+        for (size_t slash = path.find('/'); slash != std::string::npos; slash = path.find('/', slash + 1)) {
+            if (rules.match(std::string_view(path).substr(0, slash), true) == IgnoreRules::Match::Ignored) {
+                return true;
+            }
+        }
+        return rules.match(path, false) == IgnoreRules::Match::Ignored;
+    }
+
+    bool looksBinary(const std::filesystem::path& path)
+    {
+        int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            return false; // Reading the file later reports the error
+        }
+        char buffer[BINARY_PROBE_SIZE];
+        ssize_t got = ::pread(fd, buffer, sizeof(buffer), 0);
+        ::close(fd);
+        return got > 0 && scanner::containsNulByte(std::string_view(buffer, static_cast<size_t>(got)));
+    }
+
+} // anonymous namespace
+
+void FilterStats::print(std::ostream& out) const
+{
+    out << "Files listed:          " << listed << "\n"
+        << "Files bundled:         " << kept << " (" << keptBytes << " bytes)\n"
+        << "Skipped by pattern:    " << skippedByPattern << "\n"
+        << "Skipped by size limit: " << skippedBySize << "\n"
+        << "Skipped as binary:     " << skippedAsBinary << "\n";
+}
+
+FileFilter::FileFilter(const Options& options)
+    : m_options(options)
+{
+    for (const auto& pattern : options.includePatterns) {
+        m_include.addRules(pattern);
+    }
+    for (const auto& pattern : options.excludePatterns) {
+        m_exclude.addRules(pattern);
+    }
+}
+
+bool FileFilter::selectsPath(const std::string& path) const
+{
+    if (!m_include.empty() && !matchesPathOrParent(m_include, path)) {
+        return false;
+    }
+    return m_exclude.empty() || !matchesPathOrParent(m_exclude, path);
+}
+
+/**
+ * @brief Returns the files that pass all checks, in their original order.
+ */
+std::vector<std::string> FileFilter::apply(const std::vector<std::string>& files, const std::filesystem::path& root)
+{
+    std::vector<Verdict> verdicts(files.size(), Verdict::Kept);
+    std::vector<std::uint64_t> sizes(files.size(), 0);
+    utilities::parallelFor(files.size(), m_options.jobs, [&](size_t i) {
+        if (!selectsPath(files[i])) {
+            verdicts[i] = Verdict::Pattern;
+            return;
+        }
+        std::filesystem::path fsPath = root == "." ? std::filesystem::path(files[i]) : root / files[i];
+        struct stat st;
+        if (::stat(fsPath.c_str(), &st) == 0) {
+            sizes[i] = static_cast<std::uint64_t>(st.st_size);
+        }
+        if (m_options.maxFileSize > 0 && sizes[i] > m_options.maxFileSize) {
+            verdicts[i] = Verdict::Size;
+        } else if (m_options.skipBinary && looksBinary(fsPath)) {
+            verdicts[i] = Verdict::Binary;
+        }
+    });
+
+    std::vector<std::string> kept;
+    kept.reserve(files.size());
+    m_stats.listed += files.size();
+    for (size_t i = 0; i < files.size(); ++i) {
+        switch (verdicts[i]) {
+        case Verdict::Kept:
+            kept.push_back(files[i]);
+            m_stats.keptBytes += sizes[i];
+            break;
+        case Verdict::Pattern:
+            ++m_stats.skippedByPattern;
+            break;
+        case Verdict::Size:
+            ++m_stats.skippedBySize;
+            break;
+        case Verdict::Binary:
+            ++m_stats.skippedAsBinary;
+            break;
+        }
+    }
+    m_stats.kept += kept.size();
+    return kept;
+}
+
+} // namespace codebundler
@@ -0,0 +1,142 @@
+#include "gitrevision.hpp"
+#include "boundedqueue.hpp"
+#include "exceptions.hpp"
+#include "subprocess.hpp"
+#include <exception>
+#include <optional>
+#include <sstream>
+#include <thread>
+#include <utility>
+
+namespace codebundler {
+namespace revision {
+
+    namespace {
+
+        constexpr size_t BLOB_QUEUE_DEPTH = 16; // Blobs read ahead of the handler
+        constexpr std::uint32_t MODE_TYPE_MASK = 0170000;
+        constexpr std::uint32_t MODE_REGULAR_FILE = 0100000;
+
+    } // anonymous namespace
+
+    /**
+     * @brief Lists the regular files of a revision, in tree order.
+     */
+    std::vector<TreeEntry> listTree(const std::filesystem::path& repository, const std::string& revision)
+    {
+        const std::string command = "git ls-tree -r -z --full-tree " + revision;
+        Subprocess git({ "git", "ls-tree", "-r", "-z", "--full-tree", revision }, repository, false, true);
+        FdReader reader(git.stdoutFd());
+
+        // Each record: "<mode> SP <type> SP <object> TAB <path>" terminated by NUL
+        std::vector<TreeEntry> entries;
+        std::string record;
+        while (reader.readLine(record, '\0')) {
+            size_t tab = record.find('\t');
+            std::istringstream fields(record.substr(0, tab));
+            std::string mode;
+            std::string type;
+            TreeEntry entry;
+            if (tab == std::string::npos || !(fields >> mode >> type >> entry.objectId)) {
+                throw GitCommandException("Unexpected output: " + record, command);
+            }
+            entry.mode = static_cast<std::uint32_t>(std::stoul(mode, nullptr, 8));
+            entry.path = record.substr(tab + 1);
+            if (type == "blob" && (entry.mode & MODE_TYPE_MASK) == MODE_REGULAR_FILE) {
+                entries.push_back(std::move(entry));
+            }
+        }
+
+        int exitCode = git.wait();
+        if (exitCode != 0) {
+            throw GitCommandException("exited with code " + std::to_string(exitCode), command);
+        }
+        return entries;
+    }
+
+    /**
+     * @brief Reads the blobs of tree entries through a single `git cat-file --batch` process.
+     */
+    void readBlobs(const std::filesystem::path& repository, const std::vector<TreeEntry>& entries, const BlobHandler& handler)
+    {
+        const std::string command = "git cat-file --batch";
+        Subprocess git({ "git", "cat-file", "--batch" }, repository, true, true);
+
+        // Requests: all object names up front; the pipe to git bounds how far ahead they get
+        std::exception_ptr requestError;
+        std::thread requester([&] {
+            try {
+                FdOutputBuf buffer(git.stdinFd());
+                std::ostream requests(&buffer);
+                for (const auto& entry : entries) {
+                    requests << entry.objectId << '\n';
+                }
+                requests.flush();
+            } catch (...) {
+                requestError = std::current_exception();
+            }
+            git.closeStdin();
+        });
+
+        // Answers: "<object> <type> <size>\n<content>\n" per request, or "<object> missing\n"
+        BoundedQueue<std::string> blobs(BLOB_QUEUE_DEPTH);
+        std::exception_ptr answerError;
+        std::thread answerReader([&] {
+            try {
+                FdReader reader(git.stdoutFd());
+                for (const auto& entry : entries) {
+                    std::string header;
+                    if (!reader.readLine(header)) {
+                        throw GitCommandException("Output ended before object " + entry.objectId, command);
+                    }
+                    std::istringstream fields(header);
+                    std::string object;
+                    std::string type;
+                    size_t size = 0;
+                    if (!(fields >> object >> type >> size) || type != "blob") {
+                        throw GitCommandException("Cannot read blob of '" + entry.path + "': " + header, command);
+                    }
+                    std::string content = reader.readExactly(size);
+                    reader.readExactly(1); // Newline after the content
+                    if (!blobs.push(std::move(content))) {
+                        break; // The consumer gave up
+                    }
+                }
+            } catch (...) {
+                answerError = std::current_exception();
+            }
+            blobs.close();
+        });
+
+        std::exception_ptr handlerError;
+        try {
+            for (const auto& entry : entries) {
+                std::optional<std::string> content = blobs.pop();
+                if (!content) {
+                    break; // The reader failed; its error is reported below
+                }
+                handler(entry, std::move(*content));
+            }
+        } catch (...) {
+            handlerError = std::current_exception();
+        }
+
+        // Unblock everything: the reader stops at the closed queue, git at the closed pipe, the requester at EPIPE
+        blobs.close();
+        answerReader.join();
+        git.closeStdout();
+        requester.join();
+        int exitCode = git.wait();
+
+        for (const auto& error : { handlerError, answerError, requestError }) {
+            if (error) {
+                std::rethrow_exception(error);
+            }
+        }
+        if (exitCode != 0) {
+            throw GitCommandException("exited with code " + std::to_string(exitCode), command);
+        }
+    }
+
+} // namespace revision
+} // namespace codebundler
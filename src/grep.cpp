@@ -0,0 +1,271 @@
+#include "grep.hpp"
+#include "changes.hpp"
+#include "compressedbundle.hpp"
+#include "exceptions.hpp"
+#include "mappedfile.hpp"
+#include "ndjson.hpp"
+#include "shards.hpp"
+#include "utilities.hpp"
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+
+namespace codebundler {
+namespace grep {
+
+    namespace {
+
+        constexpr size_t SEARCH_UNIT_SIZE = 1 << 20; // Large entries are split into line-aligned pieces of about this size
+
+        // A line-aligned piece of one entry's content, searched by one thread
+        struct Unit {
+            size_t entry;
+            size_t begin;
+            size_t end;
+            std::vector<Match> matches; // Line numbers relative to the unit
+            size_t newlines = 0; // Lines the unit spans, to number the units after it
+        };
+
+        bool isQuantifier(const std::string& pattern, size_t i, bool extended)
+        {
+            if (i >= pattern.size()) {
+                return false;
+            }
+            if (pattern[i] == '*') {
+                return true;
+            }
+            if (extended) {
+                return pattern[i] == '?' || pattern[i] == '+' || pattern[i] == '{';
+            }
+            return pattern[i] == '\\' && i + 1 < pattern.size() && (pattern[i + 1] == '{' || pattern[i + 1] == '?' || pattern[i + 1] == '+');
+        }
+
+        // Escapes a fixed string for use in a basic regular expression
+        std::string escapeBasic(const std::string& text)
+        {
+            std::string escaped;
+            for (char c : text) {
+                if (std::strchr(".[]*^$\\", c)) {
+                    escaped += '\\';
+                }
+                escaped += c;
+            }
+            return escaped;
+        }
+
+        void searchUnit(std::string_view content, Unit& unit, const std::string& path, const Matcher& matcher)
+        {
+            const std::string& literal = matcher.literal();
+            const char* base = content.data();
+            size_t counted = unit.begin; // Newlines before this offset are in unit.newlines
+            size_t pos = unit.begin;
+            while (pos < unit.end) {
+                size_t lineStart = pos;
+                if (!literal.empty()) {
+                    // Jump straight to the next occurrence of the literal; glibc's memmem is vectorized
+                    const void* hit = ::memmem(base + pos, unit.end - pos, literal.data(), literal.size());
+                    if (!hit) {
+                        break;
+                    }
+                    size_t offset = static_cast<const char*>(hit) - base;
+                    const void* newline = offset > pos ? ::memrchr(base + pos, '\n', offset - pos) : nullptr;
+                    lineStart = newline ? static_cast<const char*>(newline) - base + 1 : pos;
+                }
+                const void* newline = std::memchr(base + lineStart, '\n', unit.end - lineStart);
+                size_t lineEnd = newline ? static_cast<const char*>(newline) - base : unit.end;
+
+                unit.newlines += std::count(base + counted, base + lineStart, '\n');
+                counted = lineStart;
+                std::string_view line = content.substr(lineStart, lineEnd - lineStart);
+                if (matcher.matches(line)) {
+                    unit.matches.push_back({ path, unit.newlines + 1, std::string(line) });
+                }
+                pos = lineEnd + 1;
+            }
+            unit.newlines += std::count(base + counted, base + unit.end, '\n');
+        }
+
+    } // anonymous namespace
+
+    /**
+     * @brief Returns a string every line matching a pattern must contain, for prefiltering.
+     */
+    std::string requiredLiteral(const std::string& pattern, Syntax syntax)
+    {
+        if (syntax == Syntax::Fixed) {
+            return pattern;
+        }
+        const bool extended = syntax == Syntax::Extended;
+        std::string best;
+        std::string run;
+        auto endRun = [&best, &run]() {
+            if (run.size() > best.size()) {
+                best = run;
+            }
+            run.clear();
+        };
+
+        int depth = 0; // Inside a group, characters may be optional as a whole
+        for (size_t i = 0; i < pattern.size(); ++i) {
+            char c = pattern[i];
+            if (c == '\\' && i + 1 < pattern.size()) {
+                char next = pattern[++i];
+                if (!extended && next == '|') {
+                    return ""; // GNU basic alternation
+                }
+                if (!extended && (next == '(' || next == ')')) {
+                    depth += next == '(' ? 1 : -1;
+                    endRun();
+                } else if (!extended && next == '{') {
+                    endRun();
+                    size_t close = pattern.find("\\}", i);
+                    i = close == std::string::npos ? pattern.size() : close + 1;
+                } else if (depth == 0 && std::ispunct(static_cast<unsigned char>(next)) && !isQuantifier(pattern, i + 1, extended)) {
+                    run += next; // An escaped punctuation character stands for itself
+                } else {
+                    endRun(); // Character classes such as \w, or an optional character
+                }
+                continue;
+            }
+            if (extended && c == '|') {
+                return "";
+            }
+            if (c == '[') {
+                // Skip the bracket expression; "]" right after "[" or "[^" is a member
+                endRun();
+                size_t close = i + 1;
+                close += close < pattern.size() && pattern[close] == '^' ? 1 : 0;
+                close += close < pattern.size() && pattern[close] == ']' ? 1 : 0;
+                close = pattern.find(']', close);
+                i = close == std::string::npos ? pattern.size() : close;
+                continue;
+            }
+            if (extended && c == '{') {
+                endRun();
+                size_t close = pattern.find('}', i);
+                i = close == std::string::npos ? pattern.size() : close;
+                continue;
+            }
+            if (extended && (c == '(' || c == ')')) {
+                depth += c == '(' ? 1 : -1;
+                endRun();
+                continue;
+            }
+            bool special = c == '.' || c == '*' || c == '^' || c == '$' || (extended && (c == '?' || c == '+'));
+            if (special || depth > 0 || isQuantifier(pattern, i + 1, extended)) {
+                endRun();
+                continue;
+            }
+            run += c;
+        }
+        endRun();
+        return best;
+    }
+
+    Matcher::Matcher(const std::string& pattern, Syntax syntax, bool ignoreCase)
+    {
+        if (syntax == Syntax::Fixed && !ignoreCase) {
+            m_literal = pattern;
+            m_literalOnly = true;
+            return;
+        }
+        auto flags = syntax == Syntax::Extended ? std::regex::extended : std::regex::basic;
+        if (ignoreCase) {
+            flags |= std::regex::icase;
+        }
+        try {
+            m_regex = std::regex(syntax == Syntax::Fixed ? escapeBasic(pattern) : pattern, flags | std::regex::optimize);
+        } catch (const std::regex_error& e) {
+            throw ArgumentParserException("Invalid pattern '" + pattern + "': " + e.what());
+        }
+        // The prefilter compares bytes exactly, so it cannot serve case-insensitive matching
+        m_literal = ignoreCase ? "" : requiredLiteral(pattern, syntax);
+    }
+
+    bool Matcher::matches(std::string_view line) const
+    {
+        return m_literalOnly || std::regex_search(line.begin(), line.end(), m_regex);
+    }
+
+    /**
+     * @brief Finds the matching lines of each entry of a bundle held in memory.
+     */
+    std::vector<Match> searchBuffer(std::string_view data, const Matcher& matcher, int jobs)
+    {
+        std::vector<std::string> paths;
+        std::vector<std::string_view> contents;
+        std::vector<std::string> decoded; // NDJSON content has to be unescaped first
+        if (ndjson::isNdjsonBundle(data)) {
+            ndjson::Reader reader(data, jobs);
+            decoded.resize(reader.entries().size());
+            utilities::parallelFor(decoded.size(), jobs, [&](size_t i) { decoded[i] = reader.content(reader.entries()[i]); });
+            for (size_t i = 0; i < decoded.size(); ++i) {
+                paths.push_back(reader.entries()[i].path);
+                contents.push_back(decoded[i]);
+            }
+        } else {
+            for (auto& entry : changes::indexBuffer(data).entries) {
+                paths.push_back(std::move(entry.path));
+                contents.push_back(data.substr(entry.offset, entry.length));
+            }
+        }
+
+        std::vector<Unit> units;
+        for (size_t i = 0; i < contents.size(); ++i) {
+            std::string_view content = contents[i];
+            for (size_t begin = 0; begin < content.size();) {
+                size_t end = begin + SEARCH_UNIT_SIZE;
+                if (end >= content.size()) {
+                    end = content.size();
+                } else {
+                    const void* newline = std::memchr(content.data() + end, '\n', content.size() - end);
+                    end = newline ? static_cast<const char*>(newline) - content.data() + 1 : content.size();
+                }
+                units.push_back({ i, begin, end, {}, 0 });
+                begin = end;
+            }
+        }
+
+        utilities::parallelFor(units.size(), jobs, [&](size_t i) {
+            searchUnit(contents[units[i].entry], units[i], paths[units[i].entry], matcher);
+        });
+
+        std::vector<Match> matches;
+        size_t linesBefore = 0;
+        for (size_t i = 0; i < units.size(); ++i) {
+            if (i > 0 && units[i].entry != units[i - 1].entry) {
+                linesBefore = 0;
+            }
+            for (auto& match : units[i].matches) {
+                match.line += linesBefore;
+                matches.push_back(std::move(match));
+            }
+            linesBefore += units[i].newlines;
+        }
+        return matches;
+    }
+
+    /**
+     * @brief Finds the matching lines of a bundle file of any format, or of all shards of a manifest.
+     */
+    std::vector<Match> searchFile(const std::string& path, const Matcher& matcher, int jobs)
+    {
+        MappedFile mapped(path);
+        if (shards::isManifest(mapped.view())) {
+            std::vector<Match> matches;
+            const std::filesystem::path manifestDirectory = std::filesystem::path(path).parent_path();
+            for (const auto& shard : shards::readManifest(mapped.view()).shards) {
+                for (auto& match : searchFile((manifestDirectory / shard.path).string(), matcher, jobs)) {
+                    matches.push_back(std::move(match));
+                }
+            }
+            return matches;
+        }
+        if (compressed::isCompressedBundle(mapped.view())) {
+            return searchBuffer(compressed::readBundle(mapped.view(), {}, jobs), matcher, jobs);
+        }
+        return searchBuffer(mapped.view(), matcher, jobs);
+    }
+
+} // namespace grep
+} // namespace codebundler
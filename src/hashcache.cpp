@@ -0,0 +1,137 @@
+#include "hashcache.hpp"
+#include "filecache.hpp"
+#include "utilities.hpp"
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <sys/stat.h>
+
+namespace codebundler {
+
+namespace {
+
+    const std::string CACHE_HEADER = "codebundler hash cache v1";
+    constexpr std::int64_t RACY_WINDOW_NS = 2'000'000'000;
+
+    std::string cacheKind(const std::string& type, bool normalized)
+    {
+        return type + (normalized ? "/text" : "/raw");
+    }
+
+} // anonymous namespace
+
+HashCache::HashCache(std::filesystem::path cacheFile)
+    : m_cacheFile(std::move(cacheFile))
+{
+    if (m_cacheFile.empty()) {
+        return;
+    }
+    std::ifstream input(m_cacheFile, std::ios::binary);
+    std::string line;
+    if (!input || !std::getline(input, line) || line != CACHE_HEADER) {
+        return;
+    }
+    // Line format: <inode> <size> <mtime ns> <kind> <value> <path>
+    while (std::getline(input, line)) {
+        std::istringstream fields(line);
+        Slot slot;
+        std::string kind;
+        if (!(fields >> slot.inode >> slot.size >> slot.mtimeNs >> kind >> slot.value) || fields.get() != ' ') {
+            m_entries.clear();
+            return;
+        }
+        std::string path;
+        std::getline(fields, path);
+        m_entries[kind + '\0' + path] = std::move(slot);
+    }
+}
+
+std::filesystem::path HashCache::defaultLocation(const std::filesystem::path& directory)
+{
+    std::error_code ec;
+    std::filesystem::path canonical = std::filesystem::weakly_canonical(directory, ec);
+    if (ec) {
+        canonical = std::filesystem::absolute(directory);
+    }
+    if (std::filesystem::is_directory(canonical / ".git", ec)) {
+        return canonical / ".git" / "codebundler-hashes";
+    }
+    std::filesystem::path cacheHome;
+    if (const char* xdg = std::getenv("XDG_CACHE_HOME"); xdg && *xdg) {
+        cacheHome = xdg;
+    } else if (const char* home = std::getenv("HOME"); home && *home) {
+        cacheHome = std::filesystem::path(home) / ".cache";
+    } else {
+        return {};
+    }
+    return cacheHome / "codebundler" / ("hashes-" + utilities::calculateSHA256(canonical.string()).substr(0, 16));
+}
+
+/**
+ * @brief Returns the checksum of a file as a bundle entry would carry it.
+ */
+std::string HashCache::checksum(const std::filesystem::path& root, const std::string& path, const std::string& type, bool normalized, int jobs)
+{
+    return value(root, path, cacheKind(type, normalized), [&](const std::filesystem::path& fsPath) {
+        return normalized ? FileCache::load(fsPath, type, jobs)->checksum : utilities::calculateChecksum(utilities::readFileBytes(fsPath), type, jobs);
+    });
+}
+
+/**
+ * @brief Returns any value derived from a file's content, computing it only on a miss.
+ */
+std::string HashCache::value(const std::filesystem::path& root, const std::string& path, const std::string& kind,
+    const std::function<std::string(const std::filesystem::path&)>& compute)
+{
+    const std::filesystem::path fsPath = root == "." ? std::filesystem::path(path) : root / path;
+    const std::string key = kind + '\0' + path;
+    struct stat st;
+    const bool statted = ::stat(fsPath.c_str(), &st) == 0;
+    Slot current;
+    if (statted) {
+        current.inode = static_cast<std::uint64_t>(st.st_ino);
+        current.size = static_cast<std::int64_t>(st.st_size);
+        current.mtimeNs = static_cast<std::int64_t>(st.st_mtim.tv_sec) * 1'000'000'000 + st.st_mtim.tv_nsec;
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto it = m_entries.find(key);
+        if (it != m_entries.end() && it->second.inode == current.inode && it->second.size == current.size && it->second.mtimeNs == current.mtimeNs) {
+            return it->second.value;
+        }
+    }
+
+    // Read and compute outside the lock so other threads are not held up
+    current.value = compute(fsPath);
+
+    std::int64_t now = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+    std::lock_guard<std::mutex> lock(m_mutex);
+    ++m_misses;
+    if (statted && now - current.mtimeNs > RACY_WINDOW_NS && path.find('\n') == std::string::npos) {
+        m_entries[key] = current;
+        m_dirty = true;
+    }
+    return current.value;
+}
+
+void HashCache::save()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_dirty || m_cacheFile.empty()) {
+        return;
+    }
+    std::ostringstream output;
+    output << CACHE_HEADER << "\n";
+    for (const auto& [key, slot] : m_entries) {
+        size_t split = key.find('\0');
+        output << slot.inode << " " << slot.size << " " << slot.mtimeNs << " " << key.substr(0, split) << " " << slot.value << " " << key.substr(split + 1) << "\n";
+    }
+    try {
+        std::filesystem::create_directories(m_cacheFile.parent_path());
+        utilities::replaceFileAtomically(m_cacheFile, output.str());
+        m_dirty = false;
+    } catch (const std::exception&) {
+        // The cache only saves time; a read-only location is not an error
+    }
+}
+
+} // namespace codebundler
@@ -0,0 +1,127 @@
+#include "journal.hpp"
+#include "exceptions.hpp"
+#include "utilities.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sstream>
+#include <unistd.h>
+
+namespace codebundler {
+
+namespace {
+
+    const std::string JOURNAL_HEADER = "codebundler journal v1";
+    const std::string JOURNAL_DONE = "done";
+    constexpr size_t IDENTITY_PREFIX_SIZE = 64 * 1024;
+
+    std::string bundleIdentity(std::string_view bundle)
+    {
+        return "bundle " + std::to_string(bundle.size()) + " " + utilities::calculateSHA256(bundle.substr(0, IDENTITY_PREFIX_SIZE));
+    }
+
+    void writeAll(int fd, const std::string& text, const std::filesystem::path& journalFile)
+    {
+        size_t written = 0;
+        while (written < text.size()) {
+            ssize_t count = ::write(fd, text.data() + written, text.size() - written);
+            if (count < 0 && errno == EINTR) {
+                continue;
+            }
+            if (count < 0) {
+                throw FileIOException("Failed to write journal: " + std::string(std::strerror(errno)), journalFile.string());
+            }
+            written += static_cast<size_t>(count);
+        }
+    }
+
+} // anonymous namespace
+
+std::filesystem::path Journal::defaultLocation(const std::filesystem::path& outputDirectory, const std::string& bundlePath)
+{
+    return outputDirectory / (".codebundler-journal." + std::filesystem::path(bundlePath).filename().string());
+}
+
+Journal::Journal(std::filesystem::path journalFile, std::string_view bundle, bool resume)
+    : m_journalFile(std::move(journalFile))
+{
+    const std::string identity = bundleIdentity(bundle);
+    std::string kept = JOURNAL_HEADER + "\n" + identity + "\n";
+
+    std::error_code ec;
+    if (resume && std::filesystem::exists(m_journalFile, ec)) {
+        const std::string data = utilities::readFileBytes(m_journalFile);
+        std::istringstream input(data.substr(0, data.rfind('\n') + 1)); // A torn last line is dropped
+        std::string header;
+        std::string bundleLine;
+        if (!std::getline(input, header) || header != JOURNAL_HEADER || !std::getline(input, bundleLine)) {
+            throw BundleFormatException("Not a codebundler journal: " + m_journalFile.string());
+        }
+        if (bundleLine != identity) {
+            throw BundleFormatException("The journal " + m_journalFile.string() + " was written for a different bundle.");
+        }
+        // Line format: <ordinal> <offset> <checksum> <path>
+        std::string line;
+        while (std::getline(input, line)) {
+            if (line == JOURNAL_DONE) {
+                m_finished = true;
+                kept += line + "\n";
+                continue;
+            }
+            std::istringstream fields(line);
+            Record record;
+            if (!(fields >> record.ordinal >> record.offset >> record.checksum) || fields.get() != ' ') {
+                throw BundleFormatException("Malformed journal line in " + m_journalFile.string() + ": " + line);
+            }
+            std::getline(fields, record.path);
+            kept += line + "\n";
+            m_committed.push_back(std::move(record));
+        }
+    }
+
+    if (!m_journalFile.parent_path().empty()) {
+        std::filesystem::create_directories(m_journalFile.parent_path());
+    }
+    // Rewritten from what was kept, so appends never follow a torn line
+    utilities::replaceFileAtomically(m_journalFile, kept);
+    m_fd = ::open(m_journalFile.c_str(), O_WRONLY | O_APPEND | O_CLOEXEC);
+    if (m_fd < 0) {
+        throw FileIOException("Failed to open journal: " + std::string(std::strerror(errno)), m_journalFile.string());
+    }
+}
+
+Journal::~Journal()
+{
+    if (m_fd >= 0) {
+        ::close(m_fd);
+    }
+}
+
+void Journal::commit(const Record& record)
+{
+    std::string line = std::to_string(record.ordinal) + " " + std::to_string(record.offset) + " " + (record.checksum.empty() ? "-" : record.checksum) + " "
+        + record.path + "\n";
+    std::lock_guard<std::mutex> lock(m_mutex);
+    writeAll(m_fd, line, m_journalFile);
+}
+
+void Journal::finish()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    writeAll(m_fd, JOURNAL_DONE + "\n", m_journalFile);
+    m_finished = true;
+}
+
+void Journal::remove()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_fd >= 0) {
+        ::close(m_fd);
+        m_fd = -1;
+    }
+    std::error_code ec;
+    std::filesystem::remove(m_journalFile, ec);
+}
+
+} // namespace codebundler
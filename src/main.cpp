@@ -1,12 +1,32 @@
+#include "binarybundle.hpp"
 #include "bundleparser.hpp"
 #include "bundler.hpp"
+#include "changes.hpp"
+#include "chunkstore.hpp"
+#include "constants.hpp"
 #include "exceptions.hpp"
+#include "fastimport.hpp"
+#include "grep.hpp"
+#include "hashcache.hpp"
+#include "ndjson.hpp"
 #include "options.hpp"
+#include "server.hpp"
+#include "shards.hpp"
+#include "subprocess.hpp"
+#include "tarwriter.hpp"
+#include "tokenbudget.hpp"
+#include "tuning.hpp"
 #include "unbundler.hpp"
 #include "utilities.hpp" // May need utilities here too
+#include "walker.hpp"
+#include "watcher.hpp"
+#include <cctype>
+#include <cstdint>
 #include <filesystem> // Requires C++17
+#include <fstream>
 #include <iostream>
 #include <string>
+#include <unistd.h> // For STDOUT_FILENO
 #include <vector>
 
 namespace { // Use an anonymous namespace for local helpers
@@ -20,17 +40,136 @@ Commands:
     --separator <sep>          Specify a custom separator string (default: ")"
               << defaultSeparator
               << R"(").
+                               "auto" picks the first of a family of separators that no file
+                               contains (files are loaded before the bundle is written).
     --description <desc>       Add an optional description to the bundle header.
+    --walk <dir>               Bundle the files below dir instead of git's tracked files, skipping
+                               what .gitignore and .ignore files exclude (no repository needed).
+    --rev <revision>           Bundle the files of a commit (or tree) from the object database
+                               instead of the working tree, e.g. --rev HEAD~3 or --rev v1.0.
+    --recurse-submodules       Bundle the files of checked out submodules instead of the submodules.
+    --repos <file>             Bundle several repositories into one bundle. file lists one directory
+                               per line, relative to file's directory; entries are prefixed with it.
+                               All repositories are listed concurrently and read by one worker pool.
+    --include <glob>           Bundle only paths matching glob (repeatable; .gitignore syntax, so
+                               "*.cpp" matches at any depth and "src/" everything below src).
+    --exclude <glob>           Skip paths matching glob (repeatable).
+    --max-file-size <n[K|M|G]> Skip files larger than n bytes.
+    --skip-binary              Skip files with a NUL byte in their first 8 KiB.
+    --stats                    Report how many files were bundled and why others were skipped.
+    --token-budget <n>         Keep the bundle within about n tokens (as counted by GPT-style BPE
+                               tokenizers, estimated): files are taken by priority while they fit.
+                               Text bundles record each entry's estimate on a "Tokens:" line.
+    --priority <rules>         Which files a token budget keeps first, as comma-separated glob=weight
+                               pairs, e.g. "src/=10,*.md=1,tests/=-1". The first matching rule
+                               counts; unmatched files weigh 0 and negative weights exclude.
+    --shard-size <n[K|M|G]>    Split the bundle into shards of about n bytes, balanced by file size.
+                               output_file must hold a %d or %03d placeholder for the shard number;
+                               a manifest is written with "manifest" in its place. Unbundling the
+                               manifest extracts all shards concurrently.
+    --length-headers           Add a "Length:" header to each entry so unbundling reads content
+                               in one block instead of line by line.
+    --watch                    Keep output_file up to date, rewriting changed entries on every save.
+    --debounce <ms>            Quiet period before a --watch rewrite (default: 200).
+    --compress <zstd|lz4>      Write a compressed container with one frame per entry (or group of
+                               small entries) and a frame table for parallel/partial decompression.
+    --checksum <sha256|sha256-tree>
+                               Checksum type. sha256-tree hashes 1 MiB chunks as a Merkle tree
+                               so large files hash (and later verify) on all cores.
+    --format <v1|v2|ndjson>    v1: text bundle (default). v2: binary bundle with an entry table and
+                               page-aligned blobs; stores files byte for byte (binary files too).
+                               ndjson: a header line, then one JSON object per entry (path, checksum,
+                               size, mode, content; base64 with "encoding" for non-UTF-8 content).
+    -j, --jobs <n>             Number of worker threads (default: one per hardware thread).
     -v, --verbose              Enable verbose output (1-4 levels).
 
   unbundle [input_file] [output_dir] Unbundle files from archive. Reads from stdin if no input_file.
                                Extracts to current directory if no output_dir.
                                (Separator is detected automatically from the first line).
     --no-verify                Disable SHA256 checksum verification during unbundling.
+    --format <v1|v2|ndjson>    Fail unless the input has this format (default: detect it).
     --trial-run                Perform a trial run without writing files.
+    --dedup <copy|reflink|hardlink>
+                               Create files whose content was already extracted as reflinks
+                               (Btrfs, XFS) or hard links of the first copy; falls back to
+                               writing when unsupported (default: copy).
+    --only <path>              Extract only this entry (repeatable). Compressed bundles decompress
+                               only the frames holding the selected entries. Fails if a selected
+                               entry is not in the bundle.
+    --git-fast-import          Commit the entries to the git repository in output_dir through
+                               `git fast-import` instead of writing files. With output_dir "-"
+                               the fast-import stream is written to stdout.
+    --branch <name>            Branch to commit to with --git-fast-import (default: codebundler).
+    --to-tar <file>            Write the entries as a tar archive to file ("-" for stdout)
+                               instead of extracting them.
+    --journal                  Record each completed entry in a journal in output_dir (deleted
+                               once the whole bundle is extracted).
+    --resume                   Continue an interrupted --journal run: text bundles are parsed from
+                               the last journaled entry on, binary ones skip journaled entries.
+    -j, --jobs <n>             Number of worker threads (default: one per hardware thread).
     -v, --verbose              Enable verbose output (1-4 levels).
 
+  list [input_file]            List the files that would be bundled, or the entries of a bundle
+                               (for v2 bundles only the entry table is read).
+    --walk <dir>               List the files bundle --walk would bundle.
+
+  convert <input> <output>     Convert a bundle between the text (v1), binary (v2) and NDJSON formats.
+    --format <v1|v2|ndjson>    Output format (default: v2 for a text bundle, v1 otherwise).
+    --checksum <sha256|sha256-tree>
+                               Checksum type of the output (default: sha256).
+
+  diff <bundle_a> <bundle_b>   List the paths that differ between two bundles ("A", "D" or "M" and
+                               the path) by comparing entry checksums, without reading content.
+                               Exits with 1 if anything differs, 2 on errors.
+
+  status <bundle> [dir]        List the paths that differ between a bundle and the files git tracks
+                               in dir (default: current directory). Files are hashed only when the
+                               checksum remembered from an earlier run is stale. Exits with 1 if
+                               anything differs, 2 on errors.
+    --walk <dir>               Compare with the files bundle --walk would bundle.
+
+  fingerprint [bundle]         Print a Merkle root over the sorted (path, checksum) pairs of a bundle,
+                               or of the files that would be bundled; equal file sets give equal
+                               fingerprints (usable as a build cache key).
+    --walk <dir>               Fingerprint the files bundle --walk would bundle.
+    --checksum, --format       The checksums to fingerprint the working tree with (as bundle).
+
+  grep [-F|-E] [-i] <pattern> <bundle>
+                               Print the lines of bundle entries that match pattern as
+                               path:line:text, without extracting (line numbers count from the
+                               start of each entry). Exits with 1 if no line matches, 2 on errors.
+    -E                         pattern is an extended regular expression (default: basic).
+    -F                         pattern is a fixed string.
+    -i                         Ignore case.
+    -e <pattern>               Give the pattern as an option (e.g. one starting with "-").
+
+  store add <dir> <bundle> [name]
+                               Chunk a bundle into a deduplicating store at dir (content-defined
+                               chunks, each kept once however many bundles share it) under name
+                               (default: the bundle's file name).
+  store get <dir> <name> [output_file]
+                               Rebuild a stored bundle byte for byte (stdout if no output_file).
+    --entry <path>             Print only the content of one entry, reading just its chunks.
+  store list <dir>             List the stored bundles.
+  store remove <dir> <name>    Forget a stored bundle; run gc to free its chunks.
+  store gc <dir>               Delete the chunks no stored bundle refers to.
+
+  verify <input_file>          Verify bundle checksums without extracting (same as unbundle --trial-run).
+
+  tune [dir]                   Run short benchmarks in dir (default: current directory) - separator
+                               scan per CPU kernel, hashing, small-file reads and file writes per
+                               thread count, read buffer sizes, mmap vs read - and save the fastest
+                               settings. bundle and unbundle start from them; --jobs still wins.
+    --config <file>            Settings file (default: $CODEBUNDLER_CONFIG, else
+                               $XDG_CONFIG_HOME/codebundler/config or ~/.config/codebundler/config).
+                               Also accepted by bundle and unbundle.
+
+  serve --socket <path>        Run as a daemon answering bundle, list and verify requests
+                               on a Unix domain socket, keeping file lists, contents and
+                               checksums of each repository warm between requests.
+
 Options:
+  --remote <path>              Send a bundle, list or verify command to a running server.
   -h, --help                   Show this help message.
 )";
 }
@@ -42,10 +181,56 @@ struct Arguments {
     std::string outputFile;
     std::string outputDir = "."; // Default to current directory for unbundle
     std::string description;
+    std::string socketPath; // serve: socket to listen on
+    std::string remoteSocket; // client: socket of a running server
+    std::string format; // bundle/convert: requested output format, empty if not given
+    std::string revision; // bundle: revision to bundle instead of the working tree
+    std::string otherFile; // diff: the second bundle
+    std::vector<std::string> storeArgs; // store: action, store directory and the action's arguments
+    std::string entry; // store get: the single entry to print, empty if not given
+    std::string pattern; // grep: the pattern to search for
+    bool patternGiven = false; // grep: the pattern was set (it may be empty)
+    codebundler::grep::Syntax syntax = codebundler::grep::Syntax::Basic; // grep: how the pattern is written
+    bool ignoreCase = false; // grep: -i
+    std::uint64_t shardSize = 0; // bundle: split into shards of about this size; 0 - one bundle
+    bool gitFastImport = false; // unbundle: commit to git instead of writing files
+    std::string branch; // unbundle --git-fast-import: target branch, empty if not given
+    std::string tarFile; // unbundle: tar archive to write instead of extracting, empty if not given
+    std::string repositoryList; // bundle: file listing the repositories to bundle together
+    std::string configFile; // tune/bundle/unbundle: settings file, empty for tuning::defaultConfigPath()
+    bool jobsGiven = false; // --jobs was given, so tuned thread counts do not apply
+    bool watch = false;
+    int debounceMs = 200;
     bool showHelp = false;
     codebundler::Options options;
 };
 
+// Parses "4096", "512K", "10M" or "1G"; returns 0 for anything else
+std::uint64_t parseByteSize(const std::string& text)
+{
+    size_t digits = 0;
+    while (digits < text.size() && std::isdigit(static_cast<unsigned char>(text[digits]))) {
+        ++digits;
+    }
+    if (digits == 0 || digits > 15 || text.size() > digits + 1) {
+        return 0;
+    }
+    std::uint64_t value = std::stoull(text.substr(0, digits));
+    if (digits == text.size()) {
+        return value;
+    }
+    switch (std::toupper(static_cast<unsigned char>(text[digits]))) {
+    case 'K':
+        return value << 10;
+    case 'M':
+        return value << 20;
+    case 'G':
+        return value << 30;
+    default:
+        return 0;
+    }
+}
+
 // VERY basic argument parser. Consider a library (like CLI11) for more complex needs.
 Arguments parseArguments(int argc, char* argv[])
 {
@@ -57,13 +242,22 @@ Arguments parseArguments(int argc, char* argv[])
         return args;
     }
 
-    args.command = tokens[0];
+    size_t currentArg = 0;
+    if (tokens[currentArg] == "--remote") {
+        if (currentArg + 2 >= tokens.size()) {
+            throw codebundler::ArgumentParserException("--remote requires a socket path and a command.");
+        }
+        args.remoteSocket = tokens[currentArg + 1];
+        currentArg += 2;
+    }
+
+    args.command = tokens[currentArg];
     if (args.command == "-h" || args.command == "--help") {
         args.showHelp = true;
         return args;
     }
 
-    size_t currentArg = 1;
+    currentArg++;
     while (currentArg < tokens.size()) {
         const std::string& token = tokens[currentArg];
 
@@ -113,6 +307,273 @@ Arguments parseArguments(int argc, char* argv[])
             } else {
                 throw codebundler::ArgumentParserException("--output-dir requires an argument.");
             }
+        } else if (token == "--walk") {
+            if (args.command != "bundle" && args.command != "list" && args.command != "status" && args.command != "fingerprint") {
+                throw codebundler::ArgumentParserException("--walk is only applicable to the 'bundle', 'list', 'status' and 'fingerprint' commands.");
+            }
+            if (++currentArg < tokens.size()) {
+                args.options.rootDirectory = tokens[currentArg];
+                args.options.walk = true;
+            } else {
+                throw codebundler::ArgumentParserException("--walk requires a directory.");
+            }
+        } else if (args.command == "grep" && (token == "-F" || token == "-E" || token == "-i")) {
+            if (token == "-i") {
+                args.ignoreCase = true;
+            } else {
+                args.syntax = token == "-F" ? codebundler::grep::Syntax::Fixed : codebundler::grep::Syntax::Extended;
+            }
+        } else if (args.command == "grep" && token == "-e") {
+            if (++currentArg < tokens.size() && !args.patternGiven) {
+                args.pattern = tokens[currentArg];
+                args.patternGiven = true;
+            } else {
+                throw codebundler::ArgumentParserException("-e requires a pattern (and only one may be given).");
+            }
+        } else if (token == "--entry") {
+            if (args.command != "store") {
+                throw codebundler::ArgumentParserException("--entry is only applicable to the 'store get' command.");
+            }
+            if (++currentArg < tokens.size()) {
+                args.entry = tokens[currentArg];
+            } else {
+                throw codebundler::ArgumentParserException("--entry requires a path.");
+            }
+        } else if (token == "--recurse-submodules" || token == "--repos") {
+            if (args.command != "bundle") {
+                throw codebundler::ArgumentParserException(token + " is only applicable to the 'bundle' command.");
+            }
+            if (token == "--recurse-submodules") {
+                args.options.recurseSubmodules = true;
+            } else if (++currentArg < tokens.size()) {
+                args.repositoryList = tokens[currentArg];
+            } else {
+                throw codebundler::ArgumentParserException("--repos requires a file listing repositories.");
+            }
+        } else if (token == "--rev") {
+            if (args.command != "bundle") {
+                throw codebundler::ArgumentParserException("--rev is only applicable to the 'bundle' command.");
+            }
+            if (++currentArg < tokens.size() && tokens[currentArg].rfind("-", 0) != 0) {
+                args.revision = tokens[currentArg];
+            } else {
+                throw codebundler::ArgumentParserException("--rev requires a revision.");
+            }
+        } else if (token == "--include" || token == "--exclude") {
+            if (args.command != "bundle") {
+                throw codebundler::ArgumentParserException(token + " is only applicable to the 'bundle' command.");
+            }
+            if (++currentArg < tokens.size()) {
+                auto& patterns = token == "--include" ? args.options.includePatterns : args.options.excludePatterns;
+                patterns.push_back(tokens[currentArg]);
+            } else {
+                throw codebundler::ArgumentParserException(token + " requires a pattern.");
+            }
+        } else if (token == "--max-file-size") {
+            if (args.command != "bundle") {
+                throw codebundler::ArgumentParserException("--max-file-size is only applicable to the 'bundle' command.");
+            }
+            if (++currentArg < tokens.size()) {
+                args.options.maxFileSize = parseByteSize(tokens[currentArg]);
+                if (args.options.maxFileSize == 0) {
+                    throw codebundler::ArgumentParserException("--max-file-size requires a size such as 512K or 10M.");
+                }
+            } else {
+                throw codebundler::ArgumentParserException("--max-file-size requires an argument.");
+            }
+        } else if (token == "--token-budget") {
+            if (args.command != "bundle") {
+                throw codebundler::ArgumentParserException("--token-budget is only applicable to the 'bundle' command.");
+            }
+            const std::string value = ++currentArg < tokens.size() ? tokens[currentArg] : "";
+            if (value.empty() || value.size() > 15 || value.find_first_not_of("0123456789") != std::string::npos || std::stoull(value) == 0) {
+                throw codebundler::ArgumentParserException("--token-budget requires a positive number of tokens.");
+            }
+            args.options.tokenBudget = std::stoull(value);
+        } else if (token == "--priority") {
+            if (args.command != "bundle") {
+                throw codebundler::ArgumentParserException("--priority is only applicable to the 'bundle' command.");
+            }
+            if (++currentArg < tokens.size()) {
+                args.options.priorityRules = tokens[currentArg];
+                codebundler::tokens::PriorityRules rules(args.options.priorityRules); // Reports malformed rules now
+            } else {
+                throw codebundler::ArgumentParserException("--priority requires rules such as 'src/=10,*.md=1'.");
+            }
+        } else if (token == "--shard-size") {
+            if (args.command != "bundle") {
+                throw codebundler::ArgumentParserException("--shard-size is only applicable to the 'bundle' command.");
+            }
+            if (++currentArg < tokens.size()) {
+                args.shardSize = parseByteSize(tokens[currentArg]);
+                if (args.shardSize == 0) {
+                    throw codebundler::ArgumentParserException("--shard-size requires a size such as 512K or 64M.");
+                }
+            } else {
+                throw codebundler::ArgumentParserException("--shard-size requires an argument.");
+            }
+        } else if (token == "--skip-binary") {
+            if (args.command != "bundle") {
+                throw codebundler::ArgumentParserException("--skip-binary is only applicable to the 'bundle' command.");
+            }
+            args.options.skipBinary = true;
+        } else if (token == "--stats") {
+            if (args.command != "bundle") {
+                throw codebundler::ArgumentParserException("--stats is only applicable to the 'bundle' command.");
+            }
+            args.options.stats = true;
+        } else if (token == "--length-headers") {
+            if (args.command != "bundle") {
+                throw codebundler::ArgumentParserException("--length-headers is only applicable to the 'bundle' command.");
+            }
+            args.options.lengthHeaders = true;
+        } else if (token == "--watch") {
+            if (args.command != "bundle") {
+                throw codebundler::ArgumentParserException("--watch is only applicable to the 'bundle' command.");
+            }
+            args.watch = true;
+        } else if (token == "--debounce") {
+            if (args.command != "bundle") {
+                throw codebundler::ArgumentParserException("--debounce is only applicable to the 'bundle' command.");
+            }
+            if (++currentArg < tokens.size()) {
+                try {
+                    args.debounceMs = std::stoi(tokens[currentArg]);
+                } catch (const std::exception&) {
+                    throw codebundler::ArgumentParserException("--debounce requires a number of milliseconds.");
+                }
+            } else {
+                throw codebundler::ArgumentParserException("--debounce requires an argument.");
+            }
+        } else if (token == "--compress") {
+            if (args.command != "bundle") {
+                throw codebundler::ArgumentParserException("--compress is only applicable to the 'bundle' command.");
+            }
+            if (++currentArg < tokens.size()) {
+                args.options.compression = tokens[currentArg];
+                if (args.options.compression != "zstd" && args.options.compression != "lz4") {
+                    throw codebundler::ArgumentParserException("--compress must be 'zstd' or 'lz4'.");
+                }
+            } else {
+                throw codebundler::ArgumentParserException("--compress requires an argument.");
+            }
+        } else if (token == "--checksum") {
+            if (args.command != "bundle" && args.command != "convert" && args.command != "fingerprint") {
+                throw codebundler::ArgumentParserException("--checksum is only applicable to the 'bundle', 'convert' and 'fingerprint' commands.");
+            }
+            if (++currentArg < tokens.size()) {
+                args.options.checksum = tokens[currentArg];
+                if (args.options.checksum != "sha256" && args.options.checksum != "sha256-tree") {
+                    throw codebundler::ArgumentParserException("--checksum must be 'sha256' or 'sha256-tree'.");
+                }
+            } else {
+                throw codebundler::ArgumentParserException("--checksum requires an argument.");
+            }
+        } else if (token == "--format") {
+            if (args.command != "bundle" && args.command != "unbundle" && args.command != "convert" && args.command != "fingerprint") {
+                throw codebundler::ArgumentParserException("--format is only applicable to the 'bundle', 'unbundle', 'convert' and 'fingerprint' commands.");
+            }
+            if (++currentArg < tokens.size()) {
+                args.format = tokens[currentArg];
+                if (args.format != "v1" && args.format != "v2" && args.format != "ndjson") {
+                    throw codebundler::ArgumentParserException("--format must be 'v1', 'v2' or 'ndjson'.");
+                }
+                if (args.command == "unbundle") {
+                    args.options.inputFormat = args.format;
+                }
+            } else {
+                throw codebundler::ArgumentParserException("--format requires an argument.");
+            }
+        } else if (token == "--dedup" || token.rfind("--dedup=", 0) == 0) {
+            if (args.command != "unbundle") {
+                throw codebundler::ArgumentParserException("--dedup is only applicable to the 'unbundle' command.");
+            }
+            if (token != "--dedup") {
+                args.options.dedup = token.substr(std::string("--dedup=").size());
+            } else if (++currentArg < tokens.size()) {
+                args.options.dedup = tokens[currentArg];
+            } else {
+                throw codebundler::ArgumentParserException("--dedup requires an argument.");
+            }
+            if (args.options.dedup != "copy" && args.options.dedup != "reflink" && args.options.dedup != "hardlink") {
+                throw codebundler::ArgumentParserException("--dedup must be 'copy', 'reflink' or 'hardlink'.");
+            }
+        } else if (token == "--git-fast-import") {
+            if (args.command != "unbundle") {
+                throw codebundler::ArgumentParserException("--git-fast-import is only applicable to the 'unbundle' command.");
+            }
+            args.gitFastImport = true;
+        } else if (token == "--to-tar") {
+            if (args.command != "unbundle") {
+                throw codebundler::ArgumentParserException("--to-tar is only applicable to the 'unbundle' command.");
+            }
+            if (++currentArg < tokens.size()) {
+                args.tarFile = tokens[currentArg];
+            } else {
+                throw codebundler::ArgumentParserException("--to-tar requires an argument.");
+            }
+        } else if (token == "--branch") {
+            if (args.command != "unbundle") {
+                throw codebundler::ArgumentParserException("--branch is only applicable to the 'unbundle' command.");
+            }
+            if (++currentArg < tokens.size()) {
+                args.branch = tokens[currentArg];
+            } else {
+                throw codebundler::ArgumentParserException("--branch requires an argument.");
+            }
+        } else if (token == "--journal" || token == "--resume") {
+            if (args.command != "unbundle") {
+                throw codebundler::ArgumentParserException(token + " is only applicable to the 'unbundle' command.");
+            }
+            args.options.journal = true;
+            args.options.resume = args.options.resume || token == "--resume";
+        } else if (token == "--only") {
+            if (args.command != "unbundle") {
+                throw codebundler::ArgumentParserException("--only is only applicable to the 'unbundle' command.");
+            }
+            if (++currentArg < tokens.size()) {
+                args.options.onlyFiles.push_back(tokens[currentArg]);
+            } else {
+                throw codebundler::ArgumentParserException("--only requires an argument.");
+            }
+        } else if (token == "-j" || token == "--jobs") {
+            if (++currentArg < tokens.size()) {
+                try {
+                    args.options.jobs = std::stoi(tokens[currentArg]);
+                } catch (const std::exception&) {
+                    throw codebundler::ArgumentParserException("--jobs requires a number.");
+                }
+                if (args.options.jobs < 0) {
+                    throw codebundler::ArgumentParserException("--jobs cannot be negative.");
+                }
+                args.jobsGiven = true;
+            } else {
+                throw codebundler::ArgumentParserException("--jobs requires an argument.");
+            }
+        } else if (token == "--config") {
+            if (args.command != "tune" && args.command != "bundle" && args.command != "unbundle") {
+                throw codebundler::ArgumentParserException("--config is only applicable to the 'tune', 'bundle' and 'unbundle' commands.");
+            }
+            if (++currentArg < tokens.size()) {
+                args.configFile = tokens[currentArg];
+            } else {
+                throw codebundler::ArgumentParserException("--config requires an argument.");
+            }
+        } else if (token == "--socket") {
+            if (args.command != "serve") {
+                throw codebundler::ArgumentParserException("--socket is only applicable to the 'serve' command.");
+            }
+            if (++currentArg < tokens.size()) {
+                args.socketPath = tokens[currentArg];
+            } else {
+                throw codebundler::ArgumentParserException("--socket requires an argument.");
+            }
+        } else if (token == "--remote") {
+            if (++currentArg < tokens.size()) {
+                args.remoteSocket = tokens[currentArg];
+            } else {
+                throw codebundler::ArgumentParserException("--remote requires an argument.");
+            }
         } else if (token == "-h" || token == "--help") {
             args.showHelp = true;
             return args; // Stop parsing if help is requested
@@ -139,6 +600,53 @@ Arguments parseArguments(int argc, char* argv[])
                     // Covers case where outputDir was already set for unbundle, or too many args for verify
                     throw codebundler::ArgumentParserException("Unexpected positional argument for " + args.command + ": " + token);
                 }
+            } else if (args.command == "diff") {
+                if (args.inputFile.empty()) {
+                    args.inputFile = token;
+                } else if (args.otherFile.empty()) {
+                    args.otherFile = token;
+                } else {
+                    throw codebundler::ArgumentParserException("Unexpected positional argument for diff: " + token);
+                }
+            } else if (args.command == "status") {
+                if (args.inputFile.empty()) {
+                    args.inputFile = token;
+                } else if (!args.options.walk && args.options.rootDirectory == ".") {
+                    args.options.rootDirectory = token;
+                } else {
+                    throw codebundler::ArgumentParserException("Unexpected positional argument for status: " + token);
+                }
+            } else if (args.command == "verify" || args.command == "list" || args.command == "fingerprint") {
+                if (args.inputFile.empty()) {
+                    args.inputFile = token;
+                } else {
+                    throw codebundler::ArgumentParserException("Unexpected positional argument for " + args.command + ": " + token);
+                }
+            } else if (args.command == "grep") {
+                if (!args.patternGiven) {
+                    args.pattern = token;
+                    args.patternGiven = true;
+                } else if (args.inputFile.empty()) {
+                    args.inputFile = token;
+                } else {
+                    throw codebundler::ArgumentParserException("Unexpected positional argument for grep: " + token);
+                }
+            } else if (args.command == "store") {
+                args.storeArgs.push_back(token);
+            } else if (args.command == "tune") {
+                if (args.options.rootDirectory == ".") {
+                    args.options.rootDirectory = token;
+                } else {
+                    throw codebundler::ArgumentParserException("Unexpected positional argument for tune: " + token);
+                }
+            } else if (args.command == "convert") {
+                if (args.inputFile.empty()) {
+                    args.inputFile = token;
+                } else if (args.outputFile.empty()) {
+                    args.outputFile = token;
+                } else {
+                    throw codebundler::ArgumentParserException("Unexpected positional argument for convert: " + token);
+                }
             } else {
                 // Handles case where the command itself is unknown or arg appears before valid command
                 throw codebundler::ArgumentParserException("Unknown command or misplaced argument: " + token);
@@ -148,9 +656,105 @@ Arguments parseArguments(int argc, char* argv[])
     }
 
     // --- Post-parsing validation ---
-    if (args.command != "bundle" && args.command != "unbundle") {
+    if (args.command != "bundle" && args.command != "unbundle" && args.command != "list" && args.command != "verify" && args.command != "serve" && args.command != "convert"
+        && args.command != "diff" && args.command != "status" && args.command != "fingerprint" && args.command != "store"
+        && args.command != "grep" && args.command != "tune") {
         // This check might be redundant if the positional arg logic catches unknown commands, but good for clarity
-        throw codebundler::ArgumentParserException("Invalid command: " + args.command + ". Must be 'bundle', 'unbundle'.");
+        throw codebundler::ArgumentParserException("Invalid command: " + args.command
+            + ". Must be 'bundle', 'unbundle', 'list', 'verify', 'convert', 'diff', 'status', 'fingerprint', 'grep', 'store', 'tune' or 'serve'.");
+    }
+    if (args.command == "grep" && args.inputFile.empty()) {
+        throw codebundler::ArgumentParserException("grep requires a pattern and a bundle.");
+    }
+    if (args.command == "store") {
+        const std::string action = args.storeArgs.empty() ? "" : args.storeArgs[0];
+        const size_t count = args.storeArgs.size();
+        const bool valid = (action == "add" && (count == 3 || count == 4)) || (action == "get" && (count == 3 || count == 4))
+            || (action == "list" && count == 2) || (action == "remove" && count == 3) || (action == "gc" && count == 2);
+        if (!valid) {
+            throw codebundler::ArgumentParserException("Usage: store add <dir> <bundle> [name], store get <dir> <name> [output_file], "
+                                                       "store list <dir>, store remove <dir> <name> or store gc <dir>.");
+        }
+        if (!args.entry.empty() && action != "get") {
+            throw codebundler::ArgumentParserException("--entry is only applicable to the 'store get' command.");
+        }
+    }
+    if (args.command == "diff" && args.otherFile.empty()) {
+        throw codebundler::ArgumentParserException("diff requires two bundles.");
+    }
+    if (args.command == "status" && args.inputFile.empty()) {
+        throw codebundler::ArgumentParserException("status requires a bundle.");
+    }
+    if (args.command == "convert" && args.outputFile.empty()) {
+        throw codebundler::ArgumentParserException("convert requires an input and an output file.");
+    }
+    if ((args.format == "v2" || args.format == "ndjson") && (!args.options.compression.empty() || args.watch || !args.remoteSocket.empty())) {
+        throw codebundler::ArgumentParserException("--format " + args.format + " cannot be combined with --compress, --watch or --remote.");
+    }
+    if (!args.format.empty() && args.command != "unbundle") {
+        args.options.format = args.format;
+    }
+    if (args.options.walk && (!args.revision.empty() || args.watch || !args.remoteSocket.empty() || (args.command != "status" && !args.inputFile.empty()))) {
+        throw codebundler::ArgumentParserException("--walk cannot be combined with --rev, --watch, --remote or a bundle to list or fingerprint.");
+    }
+    if ((!args.repositoryList.empty() || args.options.recurseSubmodules)
+        && (args.options.walk || !args.revision.empty() || args.watch || !args.remoteSocket.empty())) {
+        throw codebundler::ArgumentParserException("--repos and --recurse-submodules cannot be combined with --walk, --rev, --watch or --remote.");
+    }
+    if (!args.revision.empty() && (args.watch || !args.remoteSocket.empty())) {
+        throw codebundler::ArgumentParserException("--rev cannot be combined with --watch or --remote.");
+    }
+    if (args.options.tokenBudget > 0 && (!args.revision.empty() || args.watch || !args.remoteSocket.empty() || args.shardSize > 0)) {
+        throw codebundler::ArgumentParserException("--token-budget cannot be combined with --rev, --watch, --remote or --shard-size.");
+    }
+    if (!args.options.priorityRules.empty() && args.options.tokenBudget == 0) {
+        throw codebundler::ArgumentParserException("--priority requires --token-budget.");
+    }
+    if (args.shardSize > 0 && (!args.revision.empty() || args.watch || !args.remoteSocket.empty())) {
+        throw codebundler::ArgumentParserException("--shard-size cannot be combined with --rev, --watch or --remote.");
+    }
+    if (args.shardSize > 0 && !codebundler::shards::isValidPattern(args.outputFile)) {
+        throw codebundler::ArgumentParserException("--shard-size requires an output file name with one %d placeholder, e.g. out-%03d.txt.");
+    }
+    if (!args.remoteSocket.empty() && (!args.options.includePatterns.empty() || !args.options.excludePatterns.empty() || args.options.maxFileSize > 0
+            || args.options.skipBinary || args.options.stats)) {
+        throw codebundler::ArgumentParserException("File filters cannot be combined with --remote.");
+    }
+    if (!args.revision.empty() && (args.options.maxFileSize > 0 || args.options.skipBinary || args.options.stats)) {
+        throw codebundler::ArgumentParserException("--rev supports --include and --exclude, but not --max-file-size, --skip-binary or --stats.");
+    }
+    if (!args.branch.empty() && !args.gitFastImport) {
+        throw codebundler::ArgumentParserException("--branch requires --git-fast-import.");
+    }
+    if (args.gitFastImport && (args.options.trialRun || args.options.dedup != "copy")) {
+        throw codebundler::ArgumentParserException("--git-fast-import cannot be combined with --trial-run or --dedup.");
+    }
+    if (args.options.journal && (args.inputFile.empty() || args.inputFile == "-" || args.options.trialRun || !args.options.onlyFiles.empty() || args.gitFastImport || !args.tarFile.empty())) {
+        throw codebundler::ArgumentParserException("--journal and --resume need an input_file and cannot be combined with --trial-run, --only, --git-fast-import or --to-tar.");
+    }
+    if (!args.tarFile.empty() && (args.gitFastImport || args.options.trialRun || args.options.dedup != "copy" || args.outputDir != ".")) {
+        throw codebundler::ArgumentParserException("--to-tar cannot be combined with --git-fast-import, --trial-run, --dedup or an output directory.");
+    }
+    if (args.command == "serve" && args.socketPath.empty()) {
+        throw codebundler::ArgumentParserException("serve requires --socket <path>.");
+    }
+    if (args.watch && args.options.separator == codebundler::AUTO_SEPARATOR) {
+        throw codebundler::ArgumentParserException("--separator auto cannot be combined with --watch.");
+    }
+    if (args.watch && (args.outputFile.empty() || !args.remoteSocket.empty())) {
+        throw codebundler::ArgumentParserException("--watch requires a local output file.");
+    }
+    if (!args.options.compression.empty() && (args.watch || !args.remoteSocket.empty())) {
+        throw codebundler::ArgumentParserException("--compress cannot be combined with --watch or --remote.");
+    }
+    if (args.command == "verify" && args.inputFile.empty()) {
+        throw codebundler::ArgumentParserException("verify requires an input file.");
+    }
+    if (!args.remoteSocket.empty() && args.command != "bundle" && args.command != "list" && args.command != "verify") {
+        throw codebundler::ArgumentParserException("--remote only supports the 'bundle', 'list' and 'verify' commands.");
+    }
+    if (!args.remoteSocket.empty() && args.command == "list" && !args.inputFile.empty()) {
+        throw codebundler::ArgumentParserException("--remote list does not take a bundle file.");
     }
     // Validation for --no-verify and --description already handled inline during parsing.
     // Separator validation also handled inline for unbundle.
@@ -164,6 +768,10 @@ Arguments parseArguments(int argc, char* argv[])
 int main(int argc, char* argv[])
 {
     Arguments args;
+    int exitCode = 0;
+    // Like grep(1) and diff(1), these exit with 1 for a result, so their errors exit with 2
+    const std::string command = argc > 1 ? argv[1] : "";
+    const int errorExitCode = command == "grep" || command == "diff" || command == "status" ? 2 : 1;
     try {
         args = parseArguments(argc, argv);
 
@@ -188,16 +796,258 @@ int main(int argc, char* argv[])
             return 0;
         }
 
-        if (args.command == "bundle") {
+        if ((args.command == "bundle" || args.command == "unbundle") && args.remoteSocket.empty()) {
+            // Settings measured by `tune`; explicit options still win
+            std::filesystem::path configPath = args.configFile.empty() ? codebundler::tuning::defaultConfigPath() : std::filesystem::path(args.configFile);
+            if (!configPath.empty()) {
+                codebundler::tuning::apply(codebundler::tuning::load(configPath), args.command, args.jobsGiven, args.options);
+                args.options.verbose > 0 && std::filesystem::exists(configPath) && std::cerr << "Using tuned settings from " << configPath.string() << std::endl;
+            }
+        }
+
+        if (!args.repositoryList.empty()) {
+            // Repositories are listed relative to the list file, which makes its directory the root
+            const std::filesystem::path listDirectory = std::filesystem::path(args.repositoryList).parent_path();
+            args.options.rootDirectory = listDirectory.empty() ? "." : listDirectory.string();
+            args.options.repositories = codebundler::utilities::readRepositoryList(args.repositoryList);
+        }
+
+        if (!args.remoteSocket.empty()) {
+            codebundler::RemoteRequest request;
+            request.command = args.command;
+            request.directory = std::filesystem::canonical(args.options.rootDirectory).string();
+            request.argument = args.inputFile.empty() ? "" : std::filesystem::absolute(args.inputFile).string();
+            request.separator = args.options.separator;
+            request.description = args.description;
+            request.checksum = args.options.checksum;
+            request.lengthHeaders = args.options.lengthHeaders;
+            if (args.command == "bundle" && !args.outputFile.empty()) {
+                std::ofstream outputFileStream(args.outputFile, std::ios::binary | std::ios::trunc);
+                if (!outputFileStream) {
+                    throw codebundler::FileIOException("Failed to open output bundle file for writing", args.outputFile);
+                }
+                codebundler::sendRemoteRequest(args.remoteSocket, request, outputFileStream);
+            } else {
+                codebundler::sendRemoteRequest(args.remoteSocket, request, std::cout);
+            }
+
+        } else if (args.command == "serve") {
+            codebundler::Server server(args.options, args.socketPath);
+            server.run();
+
+        } else if (args.command == "list" && !args.inputFile.empty()) {
+            codebundler::Unbundler unbundler(args.options);
+            for (const auto& file : unbundler.listEntries(args.inputFile)) {
+                std::cout << file << "\n";
+            }
+
+        } else if (args.command == "list" && args.options.walk) {
+            for (const auto& file : codebundler::walker::listFiles(args.options.rootDirectory, args.options.jobs)) {
+                std::cout << file << "\n";
+            }
+
+        } else if (args.command == "list") {
+            for (const auto& file : codebundler::utilities::getGitTrackedFiles()) {
+                std::cout << file << "\n";
+            }
+
+        } else if (args.command == "convert") {
+            codebundler::Unbundler unbundler(args.options);
+            if (args.format.empty()) {
+                // Default to the other format
+                std::ifstream probe(args.inputFile, std::ios::binary);
+                std::string magic(32, '\0');
+                probe.read(&magic[0], static_cast<std::streamsize>(magic.size()));
+                magic.resize(static_cast<size_t>(probe.gcount()));
+                const bool text = !codebundler::binary::isBinaryBundle(magic) && !codebundler::ndjson::isNdjsonBundle(magic);
+                args.options.format = text ? "v2" : "v1";
+            }
+            codebundler::binary::BundleContents contents = unbundler.readContents(args.inputFile);
+
+            std::ofstream outputFileStream(args.outputFile, std::ios::binary | std::ios::trunc);
+            if (!outputFileStream) {
+                throw codebundler::FileIOException("Failed to open output bundle file for writing", args.outputFile);
+            }
+            codebundler::Bundler bundler(args.options);
+            bundler.bundleContentsToStream(outputFileStream, contents);
+            args.options.verbose > 0 && std::cerr << "Converted " << contents.entries.size() << " entries to format " << args.options.format << "." << std::endl;
+
+        } else if (args.command == "diff") {
+            codebundler::Unbundler unbundler(args.options);
+            codebundler::changes::BundleIndex from = unbundler.readIndex(args.inputFile);
+            codebundler::changes::BundleIndex to = unbundler.readIndex(args.otherFile);
+            if (!codebundler::changes::comparable(from, to)) {
+                // Different formats or checksum types: fall back to hashing the content of both
+                args.options.verbose > 0 && std::cerr << "Checksums are not comparable; hashing entry content." << std::endl;
+                from = codebundler::changes::indexContents(unbundler.readContents(args.inputFile), args.options.jobs);
+                to = codebundler::changes::indexContents(unbundler.readContents(args.otherFile), args.options.jobs);
+            }
+            std::vector<codebundler::changes::Difference> differences = codebundler::changes::compare(from, to);
+            for (const auto& difference : differences) {
+                std::cout << codebundler::changes::changeLetter(difference.change) << " " << difference.path << "\n";
+            }
+            exitCode = differences.empty() ? 0 : 1;
+
+        } else if (args.command == "status") {
+            codebundler::Unbundler unbundler(args.options);
+            codebundler::changes::BundleIndex bundle = unbundler.readIndex(args.inputFile);
+            const std::filesystem::path root = args.options.rootDirectory;
+            std::vector<std::string> files = args.options.walk ? codebundler::walker::listFiles(root, args.options.jobs) : codebundler::utilities::getGitTrackedFiles(root);
+            codebundler::HashCache cache(codebundler::HashCache::defaultLocation(root));
+            std::vector<codebundler::changes::Difference> differences = codebundler::changes::status(bundle, root, files, cache, args.options.jobs);
+            cache.save();
+            args.options.verbose > 0 && std::cerr << "Hashed " << cache.misses() << " of " << files.size() << " files." << std::endl;
+            for (const auto& difference : differences) {
+                std::cout << codebundler::changes::changeLetter(difference.change) << " " << difference.path << "\n";
+            }
+            exitCode = differences.empty() ? 0 : 1;
+
+        } else if (args.command == "fingerprint") {
+            codebundler::changes::BundleIndex index;
+            if (!args.inputFile.empty()) {
+                codebundler::Unbundler unbundler(args.options);
+                index = unbundler.readIndex(args.inputFile);
+            } else {
+                const std::filesystem::path root = args.options.rootDirectory;
+                std::vector<std::string> files = args.options.walk ? codebundler::walker::listFiles(root, args.options.jobs) : codebundler::utilities::getGitTrackedFiles(root);
+                codebundler::HashCache cache(codebundler::HashCache::defaultLocation(root));
+                index = codebundler::changes::indexDirectory(root, files, args.options.checksum, args.options.format == "v1", cache, args.options.jobs);
+                cache.save();
+            }
+            std::cout << codebundler::changes::fingerprint(index) << std::endl;
+
+        } else if (args.command == "grep") {
+            codebundler::grep::Matcher matcher(args.pattern, args.syntax, args.ignoreCase);
+            std::vector<codebundler::grep::Match> matches = codebundler::grep::searchFile(args.inputFile, matcher, args.options.jobs);
+            for (const auto& match : matches) {
+                std::cout << match.path << ":" << match.line << ":" << match.text << "\n";
+            }
+            exitCode = matches.empty() ? 1 : 0;
+
+        } else if (args.command == "tune") {
+            std::filesystem::path configPath = args.configFile.empty() ? codebundler::tuning::defaultConfigPath() : std::filesystem::path(args.configFile);
+            if (configPath.empty()) {
+                throw codebundler::CodeBundlerException("No place to keep the settings: set HOME or CODEBUNDLER_CONFIG, or give --config.");
+            }
+            const std::filesystem::path directory = std::filesystem::absolute(args.options.rootDirectory);
+            std::cout << "Measuring in " << directory.string() << " ..." << std::endl;
+            codebundler::tuning::Settings settings = codebundler::tuning::calibrate(directory, std::cout);
+            codebundler::tuning::save(configPath, settings, "Measured by codebundler tune in " + directory.string());
+            std::cout << "bundle-jobs = " << settings.bundleJobs << ", unbundle-jobs = " << settings.unbundleJobs << ", read-buffer = " << settings.readBufferSize
+                      << ", io = " << settings.io << ", scan-kernel = " << settings.scanKernel << "\n"
+                      << "Saved to " << configPath.string() << std::endl;
+
+        } else if (args.command == "store") {
+            const std::string& action = args.storeArgs[0];
+            codebundler::store::ChunkStore store(args.storeArgs[1], args.options.jobs);
+            if (action == "add") {
+                const std::string& bundle = args.storeArgs[2];
+                std::string name = args.storeArgs.size() > 3 ? args.storeArgs[3] : std::filesystem::path(bundle).filename().string();
+                codebundler::store::AddResult result = store.add(name, bundle);
+                args.options.verbose > 0 && std::cerr << "Stored " << name << ": " << result.chunks << " chunks (" << result.bytes << " bytes), "
+                                                      << result.newChunks << " new (" << result.newBytes << " bytes)." << std::endl;
+            } else if (action == "get" && !args.entry.empty()) {
+                std::cout << store.getEntry(args.storeArgs[2], args.entry);
+            } else if (action == "get" && args.storeArgs.size() > 3) {
+                std::ofstream outputFileStream(args.storeArgs[3], std::ios::binary | std::ios::trunc);
+                if (!outputFileStream) {
+                    throw codebundler::FileIOException("Failed to open output bundle file for writing", args.storeArgs[3]);
+                }
+                store.get(args.storeArgs[2], outputFileStream);
+            } else if (action == "get") {
+                store.get(args.storeArgs[2], std::cout);
+            } else if (action == "list") {
+                for (const auto& name : store.list()) {
+                    std::cout << name << "\n";
+                }
+            } else if (action == "remove") {
+                store.remove(args.storeArgs[2]);
+            } else {
+                size_t removed = store.gc();
+                args.options.verbose > 0 && std::cerr << "Deleted " << removed << " unreferenced chunks." << std::endl;
+            }
+
+        } else if (args.command == "verify") {
+            args.options.trialRun = true;
+            codebundler::Unbundler unbundler(args.options);
+            unbundler.unbundleFromFile(args.inputFile);
+
+        } else if (args.command == "bundle" && args.watch) {
+            codebundler::BundleWatcher watcher(args.options, args.outputFile, args.description, args.debounceMs);
+            watcher.run();
+
+        } else if (args.command == "bundle" && !args.revision.empty()) {
+            codebundler::Bundler bundler(args.options);
+            if (args.outputFile.empty()) {
+                bundler.bundleRevisionToStream(std::cout, args.revision, args.description);
+            } else {
+                std::ofstream outputFileStream(args.outputFile, std::ios::binary | std::ios::trunc);
+                if (!outputFileStream) {
+                    throw codebundler::FileIOException("Failed to open output bundle file for writing", args.outputFile);
+                }
+                bundler.bundleRevisionToStream(outputFileStream, args.revision, args.description);
+            }
+
+        } else if (args.command == "bundle" && args.shardSize > 0) {
+            codebundler::Bundler bundler(args.options);
+            bundler.bundleToShards(args.outputFile, args.shardSize, args.description);
+
+        } else if (args.command == "bundle") {
             codebundler::Bundler bundler(args.options); // Use provided or default separator
             if (args.outputFile.empty()) {
-                // Bundle to standard output
-                bundler.bundleToStream(std::cout, args.description);
+                // Bundle to standard output, written to the descriptor directly (spliced into pipes)
+                bundler.bundleToFd(STDOUT_FILENO, args.description);
             } else {
                 // Bundle to a file
                 bundler.bundleToFile(args.outputFile, args.description);
             }
 
+        } else if (args.command == "unbundle" && !args.tarFile.empty()) {
+            codebundler::Unbundler unbundler(args.options);
+            std::ofstream tarFileStream;
+            if (args.tarFile != "-") {
+                tarFileStream.open(args.tarFile, std::ios::binary | std::ios::trunc);
+                if (!tarFileStream) {
+                    throw codebundler::FileIOException("Failed to open tar file for writing", args.tarFile);
+                }
+            }
+            codebundler::TarWriter writer(args.tarFile == "-" ? std::cout : tarFileStream);
+            auto sink = [&writer](const std::string& path, std::string_view content, uint32_t mode) { writer.addFile(path, content, mode); };
+            if (args.inputFile.empty()) {
+                unbundler.exportFromStream(std::cin, sink);
+            } else {
+                unbundler.exportFromFile(args.inputFile, sink);
+            }
+            writer.finish();
+            args.options.verbose > 0 && std::cerr << "Wrote " << writer.fileCount() << " files to " << args.tarFile << "." << std::endl;
+
+        } else if (args.command == "unbundle" && args.gitFastImport) {
+            codebundler::Unbundler unbundler(args.options);
+            const std::string branch = args.branch.empty() ? "codebundler" : args.branch;
+            auto importBundle = [&](std::ostream& stream, const std::string& parent, const std::string& committer) {
+                codebundler::FastImportWriter writer(stream, branch, parent);
+                auto sink = [&writer](const std::string& path, std::string_view content, uint32_t mode) { writer.addFile(path, content, mode); };
+                std::string description = args.inputFile.empty() ? unbundler.exportFromStream(std::cin, sink) : unbundler.exportFromFile(args.inputFile, sink);
+                writer.commit(committer, description.empty() ? "Import bundle" : description);
+            };
+
+            if (args.outputDir == "-") {
+                // The caller pipes the stream into git fast-import (possibly on another machine)
+                importBundle(std::cout, "", codebundler::FastImportWriter::committerIdentity("."));
+            } else {
+                codebundler::Subprocess git({ "git", "fast-import", "--quiet" }, args.outputDir);
+                {
+                    codebundler::FdOutputBuf buffer(git.stdinFd());
+                    std::ostream stream(&buffer);
+                    importBundle(stream, codebundler::FastImportWriter::branchTip(args.outputDir, branch), codebundler::FastImportWriter::committerIdentity(args.outputDir));
+                }
+                int gitStatus = git.wait();
+                if (gitStatus != 0) {
+                    throw codebundler::GitCommandException("git fast-import failed with exit code " + std::to_string(gitStatus), "git fast-import");
+                }
+                args.options.verbose > 0 && std::cerr << "Committed bundle to branch " << branch << "." << std::endl;
+            }
+
         } else if (args.command == "unbundle") {
             // Separator is auto-detected by Unbundler, no longer set here
 
@@ -217,20 +1067,20 @@ int main(int argc, char* argv[])
         std::cerr << "Argument Error: " << e.what() << std::endl
                   << std::endl;
         printUsage(args.options.separator);
-        return 1;
+        return errorExitCode;
     } catch (const codebundler::CodeBundlerException& e) {
         // Catch specific bundler exceptions (IO, Git, Format, Checksum)
         std::cerr << "Error: " << e.what() << std::endl;
-        return 1;
+        return errorExitCode;
     } catch (const std::exception& e) {
         // Catch any other standard exceptions
         std::cerr << "An unexpected error occurred: " << e.what() << std::endl;
-        return 1;
+        return errorExitCode;
     } catch (...) {
         // Catch any non-standard exceptions
         std::cerr << "An unknown error occurred." << std::endl;
-        return 1;
+        return errorExitCode;
     }
 
-    return 0; // Success (only reached for bundle command now)
+    return exitCode; // 0, or 1 when diff or status found differences or grep found no match
 }
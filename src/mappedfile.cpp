@@ -0,0 +1,70 @@
+#include "mappedfile.hpp"
+#include "exceptions.hpp"
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace codebundler {
+
+MappedFile::MappedFile(const std::filesystem::path& path, Access access)
+{
+    m_fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (m_fd < 0) {
+        throw FileIOException("Failed to open file for mapping: " + std::string(std::strerror(errno)), path.string());
+    }
+
+    struct stat st;
+    if (::fstat(m_fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+        ::close(m_fd);
+        throw FileIOException("Not a regular file, cannot map", path.string());
+    }
+
+    m_size = static_cast<size_t>(st.st_size);
+    if (m_size == 0) {
+        return; // Nothing to map; view() is empty
+    }
+
+    if (access == Access::Read) {
+        m_buffer.resize(m_size);
+        size_t done = 0;
+        while (done < m_size) {
+            ssize_t got = ::pread(m_fd, &m_buffer[done], m_size - done, static_cast<off_t>(done));
+            if (got < 0 && errno == EINTR) {
+                continue;
+            }
+            if (got <= 0) {
+                int error = got < 0 ? errno : EIO;
+                ::close(m_fd);
+                throw FileIOException("Failed to read file: " + std::string(std::strerror(error)), path.string());
+            }
+            done += static_cast<size_t>(got);
+        }
+        m_data = m_buffer.data();
+        return;
+    }
+
+    void* mapped = ::mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, m_fd, 0);
+    if (mapped == MAP_FAILED) {
+        int error = errno;
+        ::close(m_fd);
+        throw FileIOException("Failed to map file: " + std::string(std::strerror(error)), path.string());
+    }
+    ::madvise(mapped, m_size, MADV_SEQUENTIAL);
+    m_data = static_cast<const char*>(mapped);
+    m_mapped = true;
+}
+
+MappedFile::~MappedFile()
+{
+    if (m_mapped) {
+        ::munmap(const_cast<char*>(m_data), m_size);
+    }
+    if (m_fd >= 0) {
+        ::close(m_fd);
+    }
+}
+
+} // namespace codebundler
@@ -0,0 +1,548 @@
+#include "ndjson.hpp"
+#include "exceptions.hpp"
+#include "scanner.hpp"
+#include "utilities.hpp"
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring> // For memchr
+#include <istream>
+#include <ostream>
+
+namespace codebundler {
+namespace ndjson {
+
+    namespace {
+
+        const std::string HEADER_MAGIC = "{\"codebundler\":\"ndjson\"";
+        constexpr size_t RENDER_WINDOW = 256; // Entries rendered per parallel round before writing
+        const char BASE64_DIGITS[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+        // Length of the well-formed UTF-8 sequence at pos, or 0 (overlong forms, surrogates and values past U+10FFFF are rejected)
+        size_t utf8SequenceLength(std::string_view data, size_t pos)
+        {
+            auto byte = [&data](size_t i) { return static_cast<unsigned char>(data[i]); };
+            auto continuation = [&](size_t i) { return i < data.size() && (byte(i) & 0xc0) == 0x80; };
+            unsigned char lead = byte(pos);
+            if (lead >= 0xc2 && lead <= 0xdf) {
+                return continuation(pos + 1) ? 2 : 0;
+            }
+            if (lead >= 0xe0 && lead <= 0xef) {
+                if (!continuation(pos + 1) || !continuation(pos + 2)) {
+                    return 0;
+                }
+                unsigned char second = byte(pos + 1);
+                return (lead == 0xe0 && second < 0xa0) || (lead == 0xed && second > 0x9f) ? 0 : 3;
+            }
+            if (lead >= 0xf0 && lead <= 0xf4) {
+                if (!continuation(pos + 1) || !continuation(pos + 2) || !continuation(pos + 3)) {
+                    return 0;
+                }
+                unsigned char second = byte(pos + 1);
+                return (lead == 0xf0 && second < 0x90) || (lead == 0xf4 && second > 0x8f) ? 0 : 4;
+            }
+            return 0;
+        }
+
+        void appendUtf8(std::string& out, uint32_t codePoint)
+        {
+            if (codePoint < 0x80) {
+                out += static_cast<char>(codePoint);
+            } else if (codePoint < 0x800) {
+                out += static_cast<char>(0xc0 | (codePoint >> 6));
+                out += static_cast<char>(0x80 | (codePoint & 0x3f));
+            } else if (codePoint < 0x10000) {
+                out += static_cast<char>(0xe0 | (codePoint >> 12));
+                out += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3f));
+                out += static_cast<char>(0x80 | (codePoint & 0x3f));
+            } else {
+                out += static_cast<char>(0xf0 | (codePoint >> 18));
+                out += static_cast<char>(0x80 | ((codePoint >> 12) & 0x3f));
+                out += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3f));
+                out += static_cast<char>(0x80 | (codePoint & 0x3f));
+            }
+        }
+
+        void appendBase64(std::string& out, std::string_view data)
+        {
+            out.reserve(out.size() + (data.size() + 2) / 3 * 4);
+            size_t i = 0;
+            for (; i + 3 <= data.size(); i += 3) {
+                uint32_t group = static_cast<uint32_t>(static_cast<unsigned char>(data[i])) << 16
+                    | static_cast<uint32_t>(static_cast<unsigned char>(data[i + 1])) << 8 | static_cast<unsigned char>(data[i + 2]);
+                out += BASE64_DIGITS[group >> 18];
+                out += BASE64_DIGITS[(group >> 12) & 0x3f];
+                out += BASE64_DIGITS[(group >> 6) & 0x3f];
+                out += BASE64_DIGITS[group & 0x3f];
+            }
+            if (i < data.size()) {
+                uint32_t group = static_cast<uint32_t>(static_cast<unsigned char>(data[i])) << 16;
+                if (i + 1 < data.size()) {
+                    group |= static_cast<uint32_t>(static_cast<unsigned char>(data[i + 1])) << 8;
+                }
+                out += BASE64_DIGITS[group >> 18];
+                out += BASE64_DIGITS[(group >> 12) & 0x3f];
+                out += i + 1 < data.size() ? BASE64_DIGITS[(group >> 6) & 0x3f] : '=';
+                out += '=';
+            }
+        }
+
+        std::string decodeBase64(std::string_view text)
+        {
+            static const auto values = [] {
+                std::array<int8_t, 256> table {};
+                table.fill(-1);
+                for (int i = 0; i < 64; ++i) {
+                    table[static_cast<unsigned char>(BASE64_DIGITS[i])] = static_cast<int8_t>(i);
+                }
+                return table;
+            }();
+            if (text.size() % 4 != 0) {
+                throw BundleFormatException("Malformed base64 content in NDJSON bundle.");
+            }
+            size_t padding = 0;
+            while (padding < 2 && padding < text.size() && text[text.size() - 1 - padding] == '=') {
+                ++padding;
+            }
+            std::string out;
+            out.reserve(text.size() / 4 * 3);
+            uint32_t group = 0;
+            for (size_t i = 0; i < text.size() - padding; ++i) {
+                int8_t value = values[static_cast<unsigned char>(text[i])];
+                if (value < 0) {
+                    throw BundleFormatException("Malformed base64 content in NDJSON bundle.");
+                }
+                group = group << 6 | static_cast<uint32_t>(value);
+                if (i % 4 == 3) {
+                    out += static_cast<char>(group >> 16);
+                    out += static_cast<char>((group >> 8) & 0xff);
+                    out += static_cast<char>(group & 0xff);
+                    group = 0;
+                }
+            }
+            if (padding == 2) {
+                out += static_cast<char>(group >> 4);
+            } else if (padding == 1) {
+                out += static_cast<char>(group >> 10);
+                out += static_cast<char>((group >> 2) & 0xff);
+            }
+            return out;
+        }
+
+        /**
+         * @brief Parses one line holding a flat JSON object whose values are strings, numbers or literals.
+         * String values are returned still escaped so content is only decoded on demand.
+         */
+        class ObjectParser {
+        public:
+            ObjectParser(std::string_view line, size_t lineNumber)
+                : m_line(line)
+                , m_lineNumber(lineNumber)
+            {
+            }
+
+            // Calls field(key, value, isString) for every member
+            template <typename Handler>
+            void parse(Handler field)
+            {
+                skipSpace();
+                expect('{');
+                skipSpace();
+                if (peek() == '}') {
+                    ++m_pos;
+                    return;
+                }
+                while (true) {
+                    skipSpace();
+                    expect('"');
+                    std::string key = decodeString(stringBody());
+                    skipSpace();
+                    expect(':');
+                    skipSpace();
+                    if (peek() == '"') {
+                        ++m_pos;
+                        field(key, stringBody(), true);
+                    } else {
+                        size_t start = m_pos;
+                        while (m_pos < m_line.size() && m_line[m_pos] != ',' && m_line[m_pos] != '}' && m_line[m_pos] != ' ') {
+                            ++m_pos;
+                        }
+                        if (start == m_pos) {
+                            fail("missing value for \"" + key + "\"");
+                        }
+                        field(key, m_line.substr(start, m_pos - start), false);
+                    }
+                    skipSpace();
+                    if (peek() == '}') {
+                        ++m_pos;
+                        break;
+                    }
+                    expect(',');
+                }
+                skipSpace();
+                if (m_pos != m_line.size()) {
+                    fail("trailing characters");
+                }
+            }
+
+            [[noreturn]] void fail(const std::string& reason) const
+            {
+                throw BundleFormatException("Malformed NDJSON bundle line " + std::to_string(m_lineNumber) + ": " + reason + ".");
+            }
+
+        private:
+            char peek() const { return m_pos < m_line.size() ? m_line[m_pos] : '\0'; }
+
+            void skipSpace()
+            {
+                while (m_pos < m_line.size() && (m_line[m_pos] == ' ' || m_line[m_pos] == '\t' || m_line[m_pos] == '\r')) {
+                    ++m_pos;
+                }
+            }
+
+            void expect(char c)
+            {
+                if (peek() != c) {
+                    fail(std::string("expected '") + c + "'");
+                }
+                ++m_pos;
+            }
+
+            // Returns the escaped text up to the closing quote (the opening one is consumed) and moves past it
+            std::string_view stringBody()
+            {
+                size_t start = m_pos;
+                while (true) {
+                    size_t special = scanner::findJsonSpecial(m_line, m_pos);
+                    if (special == m_line.size()) {
+                        fail("unterminated string");
+                    }
+                    if (m_line[special] == '"') {
+                        m_pos = special + 1;
+                        return m_line.substr(start, special - start);
+                    }
+                    // Skip the escaped character, or step over a non-ASCII byte
+                    m_pos = special + (m_line[special] == '\\' ? 2 : 1);
+                }
+            }
+
+            std::string_view m_line;
+            size_t m_lineNumber;
+            size_t m_pos = 0;
+        };
+
+        uint64_t parseNumber(const ObjectParser& parser, std::string_view text, const char* field)
+        {
+            uint64_t value = 0;
+            if (text.empty() || text.size() > 19) {
+                parser.fail(std::string("bad \"") + field + "\"");
+            }
+            for (char c : text) {
+                if (c < '0' || c > '9') {
+                    parser.fail(std::string("bad \"") + field + "\"");
+                }
+                value = value * 10 + static_cast<uint64_t>(c - '0');
+            }
+            return value;
+        }
+
+    } // anonymous namespace
+
+    /**
+     * @brief Appends a JSON string literal (with quotes) holding data.
+     */
+    bool appendString(std::string& out, std::string_view data)
+    {
+        const size_t start = out.size();
+        out.reserve(out.size() + data.size() + data.size() / 16 + 2);
+        out += '"';
+        size_t pos = 0;
+        while (pos < data.size()) {
+            size_t special = scanner::findJsonSpecial(data, pos);
+            out.append(data.data() + pos, special - pos);
+            if (special == data.size()) {
+                break;
+            }
+            unsigned char c = static_cast<unsigned char>(data[special]);
+            if (c >= 0x80) {
+                size_t length = utf8SequenceLength(data, special);
+                if (length == 0) {
+                    out.resize(start);
+                    return false;
+                }
+                out.append(data.data() + special, length);
+                pos = special + length;
+                continue;
+            }
+            switch (c) {
+            case '"':
+                out += "\\\"";
+                break;
+            case '\\':
+                out += "\\\\";
+                break;
+            case '\n':
+                out += "\\n";
+                break;
+            case '\t':
+                out += "\\t";
+                break;
+            case '\r':
+                out += "\\r";
+                break;
+            default: {
+                static const char digits[] = "0123456789abcdef";
+                out += "\\u00";
+                out += digits[c >> 4];
+                out += digits[c & 0x0f];
+                break;
+            }
+            }
+            pos = special + 1;
+        }
+        out += '"';
+        return true;
+    }
+
+    /**
+     * @brief Decodes the body of a JSON string literal.
+     */
+    std::string decodeString(std::string_view literal)
+    {
+        std::string out;
+        out.reserve(literal.size());
+        auto hex4 = [&literal](size_t at) {
+            if (at + 4 > literal.size()) {
+                throw BundleFormatException("Truncated \\u escape in NDJSON bundle.");
+            }
+            uint32_t value = 0;
+            for (size_t i = at; i < at + 4; ++i) {
+                char c = literal[i];
+                uint32_t digit = c >= '0' && c <= '9' ? c - '0' : c >= 'a' && c <= 'f' ? c - 'a' + 10 : c >= 'A' && c <= 'F' ? c - 'A' + 10 : 16;
+                if (digit == 16) {
+                    throw BundleFormatException("Malformed \\u escape in NDJSON bundle.");
+                }
+                value = value << 4 | digit;
+            }
+            return value;
+        };
+
+        size_t pos = 0;
+        while (pos < literal.size()) {
+            const void* found = std::memchr(literal.data() + pos, '\\', literal.size() - pos);
+            size_t escape = found ? static_cast<size_t>(static_cast<const char*>(found) - literal.data()) : literal.size();
+            out.append(literal.data() + pos, escape - pos);
+            if (escape + 1 >= literal.size()) {
+                if (escape < literal.size()) {
+                    throw BundleFormatException("Dangling backslash in NDJSON bundle.");
+                }
+                break;
+            }
+            pos = escape + 2;
+            switch (literal[escape + 1]) {
+            case '"':
+                out += '"';
+                break;
+            case '\\':
+                out += '\\';
+                break;
+            case '/':
+                out += '/';
+                break;
+            case 'b':
+                out += '\b';
+                break;
+            case 'f':
+                out += '\f';
+                break;
+            case 'n':
+                out += '\n';
+                break;
+            case 'r':
+                out += '\r';
+                break;
+            case 't':
+                out += '\t';
+                break;
+            case 'u': {
+                uint32_t codePoint = hex4(pos);
+                pos += 4;
+                if (codePoint >= 0xd800 && codePoint <= 0xdbff && pos + 6 <= literal.size() && literal[pos] == '\\' && literal[pos + 1] == 'u') {
+                    uint32_t low = hex4(pos + 2);
+                    if (low >= 0xdc00 && low <= 0xdfff) {
+                        codePoint = 0x10000 + ((codePoint - 0xd800) << 10) + (low - 0xdc00);
+                        pos += 6;
+                    }
+                }
+                appendUtf8(out, codePoint);
+                break;
+            }
+            default:
+                throw BundleFormatException(std::string("Unknown escape \\") + literal[escape + 1] + " in NDJSON bundle.");
+            }
+        }
+        return out;
+    }
+
+    /**
+     * @brief Renders one entry as a JSON object line.
+     */
+    std::string renderEntry(const binary::FileEntry& entry, const std::string& checksum)
+    {
+        std::string line = "{\"path\":";
+        if (!appendString(line, entry.path)) {
+            throw CodeBundlerException("Path is not valid UTF-8 and cannot be stored in an NDJSON bundle: " + entry.path);
+        }
+        line += ",\"checksum\":";
+        appendString(line, checksum);
+        line += ",\"size\":" + std::to_string(entry.content.size());
+        line += ",\"mode\":" + std::to_string(entry.mode);
+        line += ",\"content\":";
+        if (!appendString(line, entry.content)) {
+            line.resize(line.size() - std::string_view("\"content\":").size());
+            line += "\"encoding\":\"base64\",\"content\":\"";
+            appendBase64(line, entry.content);
+            line += '"';
+        }
+        line += "}\n";
+        return line;
+    }
+
+    /**
+     * @brief Writes an NDJSON bundle.
+     */
+    void writeBundle(std::ostream& outputStream, const std::string& separator, const std::string& description, const std::vector<binary::FileEntry>& entries,
+        const std::string& checksumType, int jobs)
+    {
+        std::string header = HEADER_MAGIC + ",\"version\":" + std::to_string(FORMAT_VERSION) + ",\"separator\":";
+        bool valid = appendString(header, separator);
+        header += ",\"description\":";
+        if (!valid || !appendString(header, description)) {
+            throw CodeBundlerException("Separator and description must be valid UTF-8 in an NDJSON bundle.");
+        }
+        header += "}\n";
+        outputStream.write(header.data(), static_cast<std::streamsize>(header.size()));
+
+        // A tree hash splits each large file over the threads itself
+        const int renderJobs = checksumType == "sha256-tree" ? 1 : jobs;
+        std::vector<std::string> lines;
+        for (size_t first = 0; first < entries.size(); first += RENDER_WINDOW) {
+            const size_t count = std::min(RENDER_WINDOW, entries.size() - first);
+            lines.assign(count, std::string());
+            utilities::parallelFor(count, renderJobs, [&](size_t i) {
+                const binary::FileEntry& entry = entries[first + i];
+                lines[i] = renderEntry(entry, utilities::calculateChecksum(entry.content, checksumType, jobs));
+            });
+            for (const auto& line : lines) {
+                outputStream.write(line.data(), static_cast<std::streamsize>(line.size()));
+            }
+        }
+
+        if (!outputStream) {
+            throw FileIOException("Stream error occurred while writing NDJSON bundle");
+        }
+    }
+
+    /**
+     * @brief Checks whether data starts with the NDJSON bundle header.
+     */
+    bool isNdjsonBundle(std::string_view data)
+    {
+        return data.compare(0, HEADER_MAGIC.size(), HEADER_MAGIC) == 0;
+    }
+
+    bool startsNdjsonBundle(std::istream& inputStream)
+    {
+        return inputStream.peek() == '{';
+    }
+
+    //--------------------------------------------------------------------------
+    // Reader
+    //--------------------------------------------------------------------------
+
+    Reader::Reader(std::string_view data, int jobs)
+    {
+        if (!isNdjsonBundle(data)) {
+            throw BundleFormatException("Not an NDJSON bundle.");
+        }
+        // JSON strings cannot hold a raw newline, so every newline ends an object
+        std::vector<size_t> starts = scanner::findLineStarts(data);
+        auto lineOf = [&data, &starts](size_t i) {
+            size_t end = i + 1 < starts.size() ? starts[i + 1] - 1 : data.size();
+            if (end > starts[i] && data[end - 1] == '\n') {
+                --end; // Trailing newline of the last line
+            }
+            return data.substr(starts[i], end - starts[i]);
+        };
+
+        ObjectParser header(lineOf(0), 1);
+        uint64_t version = 0;
+        header.parse([&](const std::string& key, std::string_view value, bool isString) {
+            if (key == "version" && !isString) {
+                version = parseNumber(header, value, "version");
+            } else if (key == "separator" && isString) {
+                m_separator = decodeString(value);
+            } else if (key == "description" && isString) {
+                m_description = decodeString(value);
+            }
+        });
+        if (version != FORMAT_VERSION) {
+            throw BundleFormatException("Unsupported NDJSON bundle version " + std::to_string(version) + ".");
+        }
+
+        std::vector<size_t> lines;
+        for (size_t i = 1; i < starts.size(); ++i) {
+            if (!lineOf(i).empty()) {
+                lines.push_back(i);
+            }
+        }
+        m_entries.resize(lines.size());
+        m_contents.resize(lines.size());
+        std::vector<char> base64(lines.size(), 0); // vector<bool> is not safe to fill from several threads
+        utilities::parallelFor(lines.size(), jobs, [&](size_t i) {
+            binary::Entry& entry = m_entries[i];
+            entry.offset = starts[lines[i]];
+            ObjectParser parser(lineOf(lines[i]), lines[i] + 1);
+            bool hasPath = false;
+            bool hasSize = false;
+            bool hasContent = false;
+            parser.parse([&](const std::string& key, std::string_view value, bool isString) {
+                if (key == "path" && isString) {
+                    entry.path = decodeString(value);
+                    hasPath = true;
+                } else if (key == "checksum" && isString) {
+                    entry.checksum = decodeString(value);
+                } else if (key == "size" && !isString) {
+                    entry.length = parseNumber(parser, value, "size");
+                    hasSize = true;
+                } else if (key == "mode" && !isString) {
+                    entry.mode = static_cast<uint32_t>(parseNumber(parser, value, "mode"));
+                } else if (key == "encoding" && isString) {
+                    if (value != "base64" && value != "utf-8") {
+                        parser.fail("unknown encoding");
+                    }
+                    base64[i] = value == "base64";
+                } else if (key == "content" && isString) {
+                    m_contents[i] = value;
+                    hasContent = true;
+                }
+            });
+            if (!hasPath || !hasSize || !hasContent) {
+                parser.fail("an entry needs \"path\", \"size\" and \"content\"");
+            }
+        });
+        m_base64.assign(base64.begin(), base64.end());
+    }
+
+    std::string Reader::content(const binary::Entry& entry) const
+    {
+        size_t index = static_cast<size_t>(&entry - m_entries.data());
+        std::string content = m_base64[index] ? decodeBase64(m_contents[index]) : decodeString(m_contents[index]);
+        if (content.size() != entry.length) {
+            throw BundleFormatException("Content size of '" + entry.path + "' does not match its recorded size in the NDJSON bundle.");
+        }
+        return content;
+    }
+
+} // namespace ndjson
+} // namespace codebundler
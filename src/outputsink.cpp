@@ -0,0 +1,174 @@
+#include "outputsink.hpp"
+#include "exceptions.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <new>
+#include <poll.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+namespace codebundler {
+
+namespace {
+    constexpr size_t BUFFER_ALIGNMENT = 4096;
+    // Content at least this large is written from where it lies instead of being copied into the buffer
+    constexpr size_t GATHER_THRESHOLD = 64 * 1024;
+}
+
+void OutputSink::FreeDeleter::operator()(char* buffer) const
+{
+    std::free(buffer);
+}
+
+OutputSink::OutputSink(int fd, std::string name, size_t bufferSize)
+    : m_fd(fd)
+    , m_name(std::move(name))
+    , m_bufferSize((std::max(bufferSize, BUFFER_ALIGNMENT) + BUFFER_ALIGNMENT - 1) / BUFFER_ALIGNMENT * BUFFER_ALIGNMENT)
+{
+    char* buffer = static_cast<char*>(std::aligned_alloc(BUFFER_ALIGNMENT, m_bufferSize));
+    if (!buffer) {
+        throw std::bad_alloc();
+    }
+    m_buffer.reset(buffer);
+    setp(buffer, buffer + m_bufferSize);
+
+    struct stat st;
+    if (::fstat(m_fd, &st) == 0 && S_ISFIFO(st.st_mode)) {
+        // Room for a whole buffer per write; best effort, as unprivileged users may be limited to less
+        ::fcntl(m_fd, F_SETPIPE_SZ, static_cast<int>(std::min<size_t>(m_bufferSize, 1 << 20)));
+    }
+}
+
+OutputSink::~OutputSink()
+{
+    try {
+        writeBuffered();
+    } catch (...) {
+        // Ignored; flush() reports write errors
+    }
+}
+
+void OutputSink::write(std::string_view data)
+{
+    if (data.size() <= static_cast<size_t>(epptr() - pptr())) {
+        std::memcpy(pptr(), data.data(), data.size());
+        pbump(static_cast<int>(data.size()));
+    } else if (data.size() >= GATHER_THRESHOLD) {
+        writeBuffered(data);
+    } else {
+        writeBuffered();
+        std::memcpy(pptr(), data.data(), data.size());
+        pbump(static_cast<int>(data.size()));
+    }
+}
+
+void OutputSink::writeParts(std::string_view head, std::string_view content, std::string_view tail)
+{
+    if (content.size() < GATHER_THRESHOLD) {
+        write(head);
+        write(content);
+        write(tail);
+    } else {
+        writeBuffered(head, content, tail);
+    }
+}
+
+void OutputSink::flush()
+{
+    if (m_failure) {
+        std::rethrow_exception(m_failure);
+    }
+    writeBuffered();
+}
+
+/**
+ * @brief Writes the buffered bytes followed by up to three more runs in one writev(2), then empties the buffer.
+ */
+void OutputSink::writeBuffered(std::string_view extra, std::string_view more, std::string_view last)
+{
+    iovec parts[4];
+    int count = 0;
+    for (std::string_view part : { std::string_view(pbase(), static_cast<size_t>(pptr() - pbase())), extra, more, last }) {
+        if (!part.empty()) {
+            parts[count].iov_base = const_cast<char*>(part.data());
+            parts[count].iov_len = part.size();
+            ++count;
+        }
+    }
+    setp(m_buffer.get(), m_buffer.get() + m_bufferSize); // The buffered bytes stay in place until written
+
+    iovec* next = parts;
+    while (count > 0) {
+        ssize_t written = ::writev(m_fd, next, count);
+        if (written < 0 && errno == EINTR) {
+            continue;
+        }
+        if (written < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            waitWritable(); // Non-blocking descriptor inherited from the caller (e.g. ssh)
+            continue;
+        }
+        if (written < 0) {
+            throw FileIOException("Failed to write bundle output: " + std::string(std::strerror(errno)), m_name);
+        }
+        size_t done = static_cast<size_t>(written);
+        while (count > 0 && done >= next->iov_len) {
+            done -= next->iov_len;
+            ++next;
+            --count;
+        }
+        if (count > 0) {
+            next->iov_base = static_cast<char*>(next->iov_base) + done;
+            next->iov_len -= done;
+        }
+    }
+}
+
+void OutputSink::waitWritable()
+{
+    pollfd waiting { m_fd, POLLOUT, 0 };
+    while (::poll(&waiting, 1, -1) < 0 && errno == EINTR) {
+    }
+}
+
+OutputSink::int_type OutputSink::overflow(int_type ch)
+{
+    try {
+        writeBuffered();
+    } catch (...) {
+        m_failure = m_failure ? m_failure : std::current_exception();
+        return traits_type::eof();
+    }
+    if (!traits_type::eq_int_type(ch, traits_type::eof())) {
+        *pptr() = traits_type::to_char_type(ch);
+        pbump(1);
+    }
+    return traits_type::not_eof(ch);
+}
+
+std::streamsize OutputSink::xsputn(const char* data, std::streamsize count)
+{
+    try {
+        write(std::string_view(data, static_cast<size_t>(count)));
+    } catch (...) {
+        m_failure = m_failure ? m_failure : std::current_exception();
+        return 0;
+    }
+    return count;
+}
+
+int OutputSink::sync()
+{
+    try {
+        writeBuffered();
+    } catch (...) {
+        m_failure = m_failure ? m_failure : std::current_exception();
+        return -1;
+    }
+    return 0;
+}
+
+} // namespace codebundler
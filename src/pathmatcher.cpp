@@ -0,0 +1,211 @@
+#include "pathmatcher.hpp"
+#include <algorithm>
+
+namespace codebundler {
+
+//--------------------------------------------------------------------------
+// GlobPattern
+//--------------------------------------------------------------------------
+
+GlobPattern::GlobPattern(std::string_view pattern)
+{
+    for (size_t i = 0; i < pattern.size(); ++i) {
+        char c = pattern[i];
+        Token token;
+        if (c == '\\' && i + 1 < pattern.size()) {
+            token.literal = pattern[++i];
+        } else if (c == '?') {
+            token.op = Op::AnyChar;
+        } else if (c == '*') {
+            bool segmentStart = i == 0 || pattern[i - 1] == '/';
+            if (i + 1 < pattern.size() && pattern[i + 1] == '*') {
+                while (i + 1 < pattern.size() && pattern[i + 1] == '*') {
+                    ++i;
+                }
+                token.op = Op::DoubleStar;
+                token.skipsSlash = segmentStart && i + 1 < pattern.size() && pattern[i + 1] == '/';
+            } else {
+                token.op = Op::Star;
+            }
+        } else if (c == '[' && pattern.find(']', i + 2) != std::string_view::npos) {
+            token.op = Op::Class;
+            size_t j = i + 1;
+            bool negated = pattern[j] == '!' || pattern[j] == '^';
+            if (negated) {
+                ++j;
+            }
+            // A ']' right after the opening bracket is a member, not the end
+            for (bool first = true; j < pattern.size() && (first || pattern[j] != ']'); first = false) {
+                unsigned char low = static_cast<unsigned char>(pattern[j] == '\\' && j + 1 < pattern.size() ? pattern[++j] : pattern[j]);
+                unsigned char high = low;
+                if (j + 2 < pattern.size() && pattern[j + 1] == '-' && pattern[j + 2] != ']') {
+                    high = static_cast<unsigned char>(pattern[j + 2]);
+                    j += 2;
+                }
+                for (unsigned value = low; value <= high; ++value) {
+                    token.set.set(value);
+                }
+                ++j;
+            }
+            if (negated) {
+                token.set.flip();
+            }
+            token.set.reset('/');
+            i = j;
+        } else {
+            token.literal = c;
+        }
+        m_tokens.push_back(token);
+    }
+
+    auto isLiteral = [](const Token& token) { return token.op == Op::Literal; };
+    size_t firstLiteral = !m_tokens.empty() && m_tokens[0].op == Op::Star ? 1 : 0;
+    if (std::all_of(m_tokens.begin() + firstLiteral, m_tokens.end(), isLiteral)) {
+        for (size_t i = firstLiteral; i < m_tokens.size(); ++i) {
+            m_literal += m_tokens[i].literal;
+        }
+        // A star must not swallow a '/', which the literal tail cannot contain either
+        if (firstLiteral == 0) {
+            m_shape = Shape::Exact;
+        } else if (m_literal.find('/') == std::string::npos) {
+            m_shape = Shape::Suffix;
+        }
+    }
+}
+
+bool GlobPattern::matches(std::string_view path) const
+{
+    switch (m_shape) {
+    case Shape::Exact:
+        return path == m_literal;
+    case Shape::Suffix:
+        return path.size() >= m_literal.size() && path.compare(path.size() - m_literal.size(), m_literal.size(), m_literal) == 0
+            && path.find('/') == std::string_view::npos;
+    case Shape::General:
+        break;
+    }
+    return matchesGeneral(path);
+}
+
+bool GlobPattern::matchesGeneral(std::string_view path) const
+{
+    // Simulate the automaton: state i means "the first i tokens matched so far"
+    const size_t accept = m_tokens.size();
+    std::vector<char> current(accept + 1, 0);
+    std::vector<char> next(accept + 1, 0);
+
+    // Stars may match nothing, so reaching one also reaches what follows it
+    auto close = [this, accept](std::vector<char>& states) {
+        for (size_t i = 0; i < accept; ++i) {
+            if (!states[i]) {
+                continue;
+            }
+            const Token& token = m_tokens[i];
+            if (token.op == Op::Star || token.op == Op::DoubleStar) {
+                states[i + 1] = 1;
+            }
+            if (token.skipsSlash && i + 2 <= accept) {
+                states[i + 2] = 1;
+            }
+        }
+    };
+
+    current[0] = 1;
+    close(current);
+    for (char c : path) {
+        std::fill(next.begin(), next.end(), 0);
+        bool alive = false;
+        for (size_t i = 0; i < accept; ++i) {
+            if (!current[i]) {
+                continue;
+            }
+            const Token& token = m_tokens[i];
+            switch (token.op) {
+            case Op::Literal:
+                next[i + 1] |= token.literal == c;
+                break;
+            case Op::AnyChar:
+                next[i + 1] |= c != '/';
+                break;
+            case Op::Class:
+                next[i + 1] |= token.set.test(static_cast<unsigned char>(c));
+                break;
+            case Op::Star:
+                next[i] |= c != '/';
+                break;
+            case Op::DoubleStar:
+                next[i] = 1;
+                break;
+            }
+            alive = true;
+        }
+        if (!alive) {
+            return false;
+        }
+        close(next);
+        current.swap(next);
+    }
+    return current[accept] != 0;
+}
+
+//--------------------------------------------------------------------------
+// IgnoreRules
+//--------------------------------------------------------------------------
+
+void IgnoreRules::addRules(std::string_view content)
+{
+    size_t position = 0;
+    while (position < content.size()) {
+        size_t end = content.find('\n', position);
+        end = end == std::string_view::npos ? content.size() : end;
+        std::string_view line = content.substr(position, end - position);
+        position = end + 1;
+
+        if (!line.empty() && line.back() == '\r') {
+            line.remove_suffix(1);
+        }
+        // Trailing spaces are dropped unless escaped
+        while (!line.empty() && line.back() == ' ' && !(line.size() > 1 && line[line.size() - 2] == '\\')) {
+            line.remove_suffix(1);
+        }
+        if (line.empty() || line.front() == '#') {
+            continue;
+        }
+
+        bool negated = line.front() == '!';
+        if (negated) {
+            line.remove_prefix(1);
+        } else if (line.size() > 1 && line.front() == '\\' && (line[1] == '!' || line[1] == '#')) {
+            line.remove_prefix(1);
+        }
+        bool directoryOnly = !line.empty() && line.back() == '/';
+        if (directoryOnly) {
+            line.remove_suffix(1);
+        }
+        bool anchored = line.find('/') != std::string_view::npos;
+        if (!line.empty() && line.front() == '/') {
+            line.remove_prefix(1);
+        }
+        if (line.empty()) {
+            continue;
+        }
+        m_rules.push_back(Rule { GlobPattern(line), negated, directoryOnly, anchored });
+    }
+}
+
+IgnoreRules::Match IgnoreRules::match(std::string_view relativePath, bool isDirectory) const
+{
+    size_t slash = relativePath.rfind('/');
+    std::string_view name = slash == std::string_view::npos ? relativePath : relativePath.substr(slash + 1);
+    for (auto rule = m_rules.rbegin(); rule != m_rules.rend(); ++rule) {
+        if (rule->directoryOnly && !isDirectory) {
+            continue;
+        }
+        if (rule->pattern.matches(rule->anchored ? relativePath : name)) {
+            return rule->negated ? Match::Included : Match::Ignored;
+        }
+    }
+    return Match::None;
+}
+
+} // namespace codebundler
@@ -0,0 +1,643 @@
+#include "scanner.hpp"
+#include <atomic>
+#include <cstdint>
+#include <cstring> // For memchr, memcmp
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define CODEBUNDLER_SCANNER_X86 1
+#include <immintrin.h>
+#endif
+#if defined(__aarch64__) && defined(__ARM_NEON)
+#define CODEBUNDLER_SCANNER_NEON 1
+#include <arm_neon.h>
+#endif
+
+namespace codebundler {
+namespace scanner {
+
+    namespace {
+
+        std::atomic<Kernel> preferredKernel { Kernel::Auto };
+
+        // Confirms a candidate at line start p against the full separator.
+        inline bool confirm(const char* data, size_t size, size_t p, const std::string& separator, bool wholeLine)
+        {
+            const size_t length = separator.size();
+            if (size - p < length || std::memcmp(data + p, separator.data(), length) != 0) {
+                return false;
+            }
+            return !wholeLine || p + length == size || data[p + length] == '\n';
+        }
+
+        // Records a confirmed match; returns true when the caller only wants to know whether one exists.
+        inline bool accept(std::vector<size_t>* matches, size_t p)
+        {
+            if (!matches) {
+                return true;
+            }
+            matches->push_back(p);
+            return false;
+        }
+
+        // Checks positions [from, size) one by one; used for buffer tails and by the scalar kernel.
+        bool separatorTail(const char* data, size_t size, size_t from, const std::string& separator, bool wholeLine, std::vector<size_t>* matches)
+        {
+            for (size_t p = from; p < size; ++p) {
+                if (data[p - 1] == '\n' && data[p] == separator[0] && confirm(data, size, p, separator, wholeLine) && accept(matches, p)) {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        void lineStartsTail(const char* data, size_t size, size_t from, std::vector<size_t>& starts)
+        {
+            for (size_t p = from; p < size; ++p) {
+                if (data[p] == '\n' && p + 1 < size) {
+                    starts.push_back(p + 1);
+                }
+            }
+        }
+
+        //----------------------------------------------------------------------
+        // Scalar kernel
+        //----------------------------------------------------------------------
+
+        void lineStartsScalar(const char* data, size_t size, std::vector<size_t>& starts)
+        {
+            const char* cursor = data;
+            const char* end = data + size;
+            while (cursor < end) {
+                const void* found = std::memchr(cursor, '\n', static_cast<size_t>(end - cursor));
+                if (!found) {
+                    break;
+                }
+                size_t next = static_cast<size_t>(static_cast<const char*>(found) - data) + 1;
+                if (next < size) {
+                    starts.push_back(next);
+                }
+                cursor = data + next;
+            }
+        }
+
+        bool nulByteTail(const char* data, size_t size, size_t from)
+        {
+            return from < size && std::memchr(data + from, '\0', size - from) != nullptr;
+        }
+
+        // Bytes a JSON string cannot hold as they are: controls, quote, backslash, and non-ASCII (checked as UTF-8 by the caller)
+        inline bool isJsonSpecial(unsigned char c)
+        {
+            return c < 0x20 || c == '"' || c == '\\' || c >= 0x80;
+        }
+
+        size_t jsonSpecialTail(const char* data, size_t size, size_t from)
+        {
+            for (size_t p = from; p < size; ++p) {
+                if (isJsonSpecial(static_cast<unsigned char>(data[p]))) {
+                    return p;
+                }
+            }
+            return size;
+        }
+
+        bool separatorLinesScalar(const char* data, size_t size, const std::string& separator, bool wholeLine, std::vector<size_t>* matches)
+        {
+            const char* cursor = data;
+            const char* end = data + size;
+            while (cursor < end) {
+                const void* found = std::memchr(cursor, '\n', static_cast<size_t>(end - cursor));
+                if (!found) {
+                    break;
+                }
+                size_t p = static_cast<size_t>(static_cast<const char*>(found) - data) + 1;
+                if (p < size && confirm(data, size, p, separator, wholeLine) && accept(matches, p)) {
+                    return true;
+                }
+                cursor = data + p;
+            }
+            return false;
+        }
+
+#ifdef CODEBUNDLER_SCANNER_X86
+        //----------------------------------------------------------------------
+        // SSE4.2 kernel (16 bytes per step)
+        //----------------------------------------------------------------------
+
+        __attribute__((target("sse4.2"))) void lineStartsSSE42(const char* data, size_t size, std::vector<size_t>& starts)
+        {
+            const __m128i newline = _mm_set1_epi8('\n');
+            size_t i = 0;
+            for (; i + 16 <= size; i += 16) {
+                __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+                uint32_t mask = static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(block, newline)));
+                while (mask) {
+                    size_t next = i + static_cast<size_t>(__builtin_ctz(mask)) + 1;
+                    if (next < size) {
+                        starts.push_back(next);
+                    }
+                    mask &= mask - 1;
+                }
+            }
+            lineStartsTail(data, size, i, starts);
+        }
+
+        __attribute__((target("sse4.2"))) bool nulByteSSE42(const char* data, size_t size)
+        {
+            const __m128i zero = _mm_setzero_si128();
+            size_t i = 0;
+            for (; i + 16 <= size; i += 16) {
+                __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+                if (_mm_movemask_epi8(_mm_cmpeq_epi8(block, zero)) != 0) {
+                    return true;
+                }
+            }
+            return nulByteTail(data, size, i);
+        }
+
+        // A signed compare against 0x20 also catches bytes >= 0x80, which are negative
+        __attribute__((target("sse4.2"))) size_t jsonSpecialSSE42(const char* data, size_t size, size_t from)
+        {
+            const __m128i space = _mm_set1_epi8(0x20);
+            const __m128i quote = _mm_set1_epi8('"');
+            const __m128i backslash = _mm_set1_epi8('\\');
+            size_t i = from;
+            for (; i + 16 <= size; i += 16) {
+                __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+                __m128i hits = _mm_or_si128(_mm_cmplt_epi8(block, space), _mm_or_si128(_mm_cmpeq_epi8(block, quote), _mm_cmpeq_epi8(block, backslash)));
+                uint32_t mask = static_cast<uint32_t>(_mm_movemask_epi8(hits));
+                if (mask) {
+                    return i + static_cast<size_t>(__builtin_ctz(mask));
+                }
+            }
+            return jsonSpecialTail(data, size, i);
+        }
+
+        __attribute__((target("sse4.2"))) bool separatorLinesSSE42(const char* data, size_t size, const std::string& separator, bool wholeLine, std::vector<size_t>* matches)
+        {
+            const size_t length = separator.size();
+            const __m128i newline = _mm_set1_epi8('\n');
+            const __m128i first = _mm_set1_epi8(separator.front());
+            const __m128i last = _mm_set1_epi8(separator.back());
+            size_t i = 1;
+            for (; i + 16 + length - 1 <= size; i += 16) {
+                __m128i before = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i - 1));
+                __m128i head = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+                __m128i tail = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i + length - 1));
+                __m128i hits = _mm_and_si128(_mm_cmpeq_epi8(before, newline),
+                    _mm_and_si128(_mm_cmpeq_epi8(head, first), _mm_cmpeq_epi8(tail, last)));
+                uint32_t mask = static_cast<uint32_t>(_mm_movemask_epi8(hits));
+                while (mask) {
+                    size_t p = i + static_cast<size_t>(__builtin_ctz(mask));
+                    if (confirm(data, size, p, separator, wholeLine) && accept(matches, p)) {
+                        return true;
+                    }
+                    mask &= mask - 1;
+                }
+            }
+            return separatorTail(data, size, i, separator, wholeLine, matches);
+        }
+
+        //----------------------------------------------------------------------
+        // AVX2 kernel (32 bytes per step)
+        //----------------------------------------------------------------------
+
+        __attribute__((target("avx2"))) void lineStartsAVX2(const char* data, size_t size, std::vector<size_t>& starts)
+        {
+            const __m256i newline = _mm256_set1_epi8('\n');
+            size_t i = 0;
+            for (; i + 32 <= size; i += 32) {
+                __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+                uint32_t mask = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(block, newline)));
+                while (mask) {
+                    size_t next = i + static_cast<size_t>(__builtin_ctz(mask)) + 1;
+                    if (next < size) {
+                        starts.push_back(next);
+                    }
+                    mask &= mask - 1;
+                }
+            }
+            lineStartsTail(data, size, i, starts);
+        }
+
+        __attribute__((target("avx2"))) bool nulByteAVX2(const char* data, size_t size)
+        {
+            const __m256i zero = _mm256_setzero_si256();
+            size_t i = 0;
+            for (; i + 32 <= size; i += 32) {
+                __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+                if (_mm256_movemask_epi8(_mm256_cmpeq_epi8(block, zero)) != 0) {
+                    return true;
+                }
+            }
+            return nulByteTail(data, size, i);
+        }
+
+        __attribute__((target("avx2"))) size_t jsonSpecialAVX2(const char* data, size_t size, size_t from)
+        {
+            const __m256i space = _mm256_set1_epi8(0x20);
+            const __m256i quote = _mm256_set1_epi8('"');
+            const __m256i backslash = _mm256_set1_epi8('\\');
+            size_t i = from;
+            for (; i + 32 <= size; i += 32) {
+                __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+                __m256i hits = _mm256_or_si256(_mm256_cmpgt_epi8(space, block), _mm256_or_si256(_mm256_cmpeq_epi8(block, quote), _mm256_cmpeq_epi8(block, backslash)));
+                uint32_t mask = static_cast<uint32_t>(_mm256_movemask_epi8(hits));
+                if (mask) {
+                    return i + static_cast<size_t>(__builtin_ctz(mask));
+                }
+            }
+            return jsonSpecialTail(data, size, i);
+        }
+
+        __attribute__((target("avx2"))) bool separatorLinesAVX2(const char* data, size_t size, const std::string& separator, bool wholeLine, std::vector<size_t>* matches)
+        {
+            const size_t length = separator.size();
+            const __m256i newline = _mm256_set1_epi8('\n');
+            const __m256i first = _mm256_set1_epi8(separator.front());
+            const __m256i last = _mm256_set1_epi8(separator.back());
+            size_t i = 1;
+            for (; i + 32 + length - 1 <= size; i += 32) {
+                __m256i before = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i - 1));
+                __m256i head = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+                __m256i tail = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i + length - 1));
+                __m256i hits = _mm256_and_si256(_mm256_cmpeq_epi8(before, newline),
+                    _mm256_and_si256(_mm256_cmpeq_epi8(head, first), _mm256_cmpeq_epi8(tail, last)));
+                uint32_t mask = static_cast<uint32_t>(_mm256_movemask_epi8(hits));
+                while (mask) {
+                    size_t p = i + static_cast<size_t>(__builtin_ctz(mask));
+                    if (confirm(data, size, p, separator, wholeLine) && accept(matches, p)) {
+                        return true;
+                    }
+                    mask &= mask - 1;
+                }
+            }
+            return separatorTail(data, size, i, separator, wholeLine, matches);
+        }
+
+        //----------------------------------------------------------------------
+        // AVX-512 kernel (64 bytes per step)
+        //----------------------------------------------------------------------
+
+        __attribute__((target("avx512f,avx512bw"))) void lineStartsAVX512(const char* data, size_t size, std::vector<size_t>& starts)
+        {
+            const __m512i newline = _mm512_set1_epi8('\n');
+            size_t i = 0;
+            for (; i + 64 <= size; i += 64) {
+                __m512i block = _mm512_loadu_si512(data + i);
+                uint64_t mask = _mm512_cmpeq_epi8_mask(block, newline);
+                while (mask) {
+                    size_t next = i + static_cast<size_t>(__builtin_ctzll(mask)) + 1;
+                    if (next < size) {
+                        starts.push_back(next);
+                    }
+                    mask &= mask - 1;
+                }
+            }
+            lineStartsTail(data, size, i, starts);
+        }
+
+        __attribute__((target("avx512f,avx512bw"))) bool nulByteAVX512(const char* data, size_t size)
+        {
+            const __m512i zero = _mm512_setzero_si512();
+            size_t i = 0;
+            for (; i + 64 <= size; i += 64) {
+                if (_mm512_cmpeq_epi8_mask(_mm512_loadu_si512(data + i), zero) != 0) {
+                    return true;
+                }
+            }
+            return nulByteTail(data, size, i);
+        }
+
+        __attribute__((target("avx512f,avx512bw"))) size_t jsonSpecialAVX512(const char* data, size_t size, size_t from)
+        {
+            const __m512i space = _mm512_set1_epi8(0x20);
+            const __m512i quote = _mm512_set1_epi8('"');
+            const __m512i backslash = _mm512_set1_epi8('\\');
+            size_t i = from;
+            for (; i + 64 <= size; i += 64) {
+                __m512i block = _mm512_loadu_si512(data + i);
+                uint64_t mask = _mm512_cmplt_epi8_mask(block, space) | _mm512_cmpeq_epi8_mask(block, quote) | _mm512_cmpeq_epi8_mask(block, backslash);
+                if (mask) {
+                    return i + static_cast<size_t>(__builtin_ctzll(mask));
+                }
+            }
+            return jsonSpecialTail(data, size, i);
+        }
+
+        __attribute__((target("avx512f,avx512bw"))) bool separatorLinesAVX512(const char* data, size_t size, const std::string& separator, bool wholeLine, std::vector<size_t>* matches)
+        {
+            const size_t length = separator.size();
+            const __m512i newline = _mm512_set1_epi8('\n');
+            const __m512i first = _mm512_set1_epi8(separator.front());
+            const __m512i last = _mm512_set1_epi8(separator.back());
+            size_t i = 1;
+            for (; i + 64 + length - 1 <= size; i += 64) {
+                uint64_t mask = _mm512_cmpeq_epi8_mask(_mm512_loadu_si512(data + i - 1), newline)
+                    & _mm512_cmpeq_epi8_mask(_mm512_loadu_si512(data + i), first)
+                    & _mm512_cmpeq_epi8_mask(_mm512_loadu_si512(data + i + length - 1), last);
+                while (mask) {
+                    size_t p = i + static_cast<size_t>(__builtin_ctzll(mask));
+                    if (confirm(data, size, p, separator, wholeLine) && accept(matches, p)) {
+                        return true;
+                    }
+                    mask &= mask - 1;
+                }
+            }
+            return separatorTail(data, size, i, separator, wholeLine, matches);
+        }
+#endif // CODEBUNDLER_SCANNER_X86
+
+#ifdef CODEBUNDLER_SCANNER_NEON
+        //----------------------------------------------------------------------
+        // NEON kernel (16 bytes per step; 4 mask bits per byte via shift-narrow)
+        //----------------------------------------------------------------------
+
+        inline uint64_t nibbleMask(uint8x16_t hits)
+        {
+            return vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(hits), 4)), 0);
+        }
+
+        void lineStartsNEON(const char* data, size_t size, std::vector<size_t>& starts)
+        {
+            const uint8x16_t newline = vdupq_n_u8('\n');
+            size_t i = 0;
+            for (; i + 16 <= size; i += 16) {
+                uint64_t mask = nibbleMask(vceqq_u8(vld1q_u8(reinterpret_cast<const uint8_t*>(data + i)), newline));
+                while (mask) {
+                    size_t bit = static_cast<size_t>(__builtin_ctzll(mask));
+                    size_t next = i + bit / 4 + 1;
+                    if (next < size) {
+                        starts.push_back(next);
+                    }
+                    mask &= ~(0xfULL << (bit & ~static_cast<size_t>(3)));
+                }
+            }
+            lineStartsTail(data, size, i, starts);
+        }
+
+        bool nulByteNEON(const char* data, size_t size)
+        {
+            const uint8x16_t zero = vdupq_n_u8(0);
+            size_t i = 0;
+            for (; i + 16 <= size; i += 16) {
+                if (vmaxvq_u8(vceqq_u8(vld1q_u8(reinterpret_cast<const uint8_t*>(data + i)), zero)) != 0) {
+                    return true;
+                }
+            }
+            return nulByteTail(data, size, i);
+        }
+
+        size_t jsonSpecialNEON(const char* data, size_t size, size_t from)
+        {
+            const int8x16_t space = vdupq_n_s8(0x20);
+            const uint8x16_t quote = vdupq_n_u8('"');
+            const uint8x16_t backslash = vdupq_n_u8('\\');
+            size_t i = from;
+            for (; i + 16 <= size; i += 16) {
+                uint8x16_t block = vld1q_u8(reinterpret_cast<const uint8_t*>(data + i));
+                uint8x16_t hits = vorrq_u8(vcltq_s8(vreinterpretq_s8_u8(block), space), vorrq_u8(vceqq_u8(block, quote), vceqq_u8(block, backslash)));
+                uint64_t mask = nibbleMask(hits);
+                if (mask) {
+                    return i + static_cast<size_t>(__builtin_ctzll(mask)) / 4;
+                }
+            }
+            return jsonSpecialTail(data, size, i);
+        }
+
+        bool separatorLinesNEON(const char* data, size_t size, const std::string& separator, bool wholeLine, std::vector<size_t>* matches)
+        {
+            const size_t length = separator.size();
+            const uint8x16_t newline = vdupq_n_u8('\n');
+            const uint8x16_t first = vdupq_n_u8(static_cast<uint8_t>(separator.front()));
+            const uint8x16_t last = vdupq_n_u8(static_cast<uint8_t>(separator.back()));
+            const uint8_t* bytes = reinterpret_cast<const uint8_t*>(data);
+            size_t i = 1;
+            for (; i + 16 + length - 1 <= size; i += 16) {
+                uint8x16_t hits = vandq_u8(vceqq_u8(vld1q_u8(bytes + i - 1), newline),
+                    vandq_u8(vceqq_u8(vld1q_u8(bytes + i), first), vceqq_u8(vld1q_u8(bytes + i + length - 1), last)));
+                uint64_t mask = nibbleMask(hits);
+                while (mask) {
+                    size_t bit = static_cast<size_t>(__builtin_ctzll(mask));
+                    size_t p = i + bit / 4;
+                    if (confirm(data, size, p, separator, wholeLine) && accept(matches, p)) {
+                        return true;
+                    }
+                    mask &= ~(0xfULL << (bit & ~static_cast<size_t>(3)));
+                }
+            }
+            return separatorTail(data, size, i, separator, wholeLine, matches);
+        }
+#endif // CODEBUNDLER_SCANNER_NEON
+
+        Kernel detectKernel()
+        {
+#ifdef CODEBUNDLER_SCANNER_X86
+            __builtin_cpu_init();
+            if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw")) {
+                return Kernel::AVX512;
+            }
+            if (__builtin_cpu_supports("avx2")) {
+                return Kernel::AVX2;
+            }
+            if (__builtin_cpu_supports("sse4.2")) {
+                return Kernel::SSE42;
+            }
+#endif
+#ifdef CODEBUNDLER_SCANNER_NEON
+            return Kernel::NEON;
+#endif
+            return Kernel::Scalar;
+        }
+
+        Kernel resolve(Kernel kernel)
+        {
+            if (kernel == Kernel::Auto) {
+                return activeKernel();
+            }
+            return isKernelSupported(kernel) ? kernel : Kernel::Scalar;
+        }
+
+        bool scanSeparators(std::string_view data, const std::string& separator, bool wholeLine, Kernel kernel, std::vector<size_t>* matches)
+        {
+            if (separator.empty() || data.empty()) {
+                return false;
+            }
+            // Line 0 has no preceding newline, so the vector kernels leave it to us
+            if (confirm(data.data(), data.size(), 0, separator, wholeLine) && accept(matches, 0)) {
+                return true;
+            }
+            switch (resolve(kernel)) {
+#ifdef CODEBUNDLER_SCANNER_X86
+            case Kernel::SSE42:
+                return separatorLinesSSE42(data.data(), data.size(), separator, wholeLine, matches);
+            case Kernel::AVX2:
+                return separatorLinesAVX2(data.data(), data.size(), separator, wholeLine, matches);
+            case Kernel::AVX512:
+                return separatorLinesAVX512(data.data(), data.size(), separator, wholeLine, matches);
+#endif
+#ifdef CODEBUNDLER_SCANNER_NEON
+            case Kernel::NEON:
+                return separatorLinesNEON(data.data(), data.size(), separator, wholeLine, matches);
+#endif
+            default:
+                return separatorLinesScalar(data.data(), data.size(), separator, wholeLine, matches);
+            }
+        }
+
+    } // anonymous namespace
+
+    bool isKernelSupported(Kernel kernel)
+    {
+        switch (kernel) {
+        case Kernel::Auto:
+        case Kernel::Scalar:
+            return true;
+#ifdef CODEBUNDLER_SCANNER_X86
+        case Kernel::SSE42:
+            return __builtin_cpu_supports("sse4.2");
+        case Kernel::AVX2:
+            return __builtin_cpu_supports("avx2");
+        case Kernel::AVX512:
+            return __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw");
+#endif
+#ifdef CODEBUNDLER_SCANNER_NEON
+        case Kernel::NEON:
+            return true;
+#endif
+        default:
+            return false;
+        }
+    }
+
+    Kernel activeKernel()
+    {
+        static const Kernel detected = detectKernel();
+        Kernel preferred = preferredKernel.load(std::memory_order_relaxed);
+        return preferred == Kernel::Auto ? detected : preferred;
+    }
+
+    void preferKernel(Kernel kernel)
+    {
+        if (isKernelSupported(kernel)) {
+            preferredKernel.store(kernel, std::memory_order_relaxed);
+        }
+    }
+
+    bool parseKernelName(const std::string& name, Kernel& kernel)
+    {
+        for (Kernel candidate : { Kernel::Scalar, Kernel::SSE42, Kernel::AVX2, Kernel::AVX512, Kernel::NEON }) {
+            if (name == kernelName(candidate)) {
+                kernel = candidate;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    const char* kernelName(Kernel kernel)
+    {
+        switch (kernel) {
+        case Kernel::Auto:
+            return kernelName(activeKernel());
+        case Kernel::SSE42:
+            return "sse4.2";
+        case Kernel::AVX2:
+            return "avx2";
+        case Kernel::AVX512:
+            return "avx512";
+        case Kernel::NEON:
+            return "neon";
+        default:
+            return "scalar";
+        }
+    }
+
+    std::vector<size_t> findLineStarts(std::string_view data, Kernel kernel)
+    {
+        std::vector<size_t> starts;
+        if (data.empty()) {
+            return starts;
+        }
+        starts.push_back(0);
+        switch (resolve(kernel)) {
+#ifdef CODEBUNDLER_SCANNER_X86
+        case Kernel::SSE42:
+            lineStartsSSE42(data.data(), data.size(), starts);
+            break;
+        case Kernel::AVX2:
+            lineStartsAVX2(data.data(), data.size(), starts);
+            break;
+        case Kernel::AVX512:
+            lineStartsAVX512(data.data(), data.size(), starts);
+            break;
+#endif
+#ifdef CODEBUNDLER_SCANNER_NEON
+        case Kernel::NEON:
+            lineStartsNEON(data.data(), data.size(), starts);
+            break;
+#endif
+        default:
+            lineStartsScalar(data.data(), data.size(), starts);
+            break;
+        }
+        return starts;
+    }
+
+    std::vector<size_t> findSeparatorLines(std::string_view data, const std::string& separator, bool wholeLine, Kernel kernel)
+    {
+        std::vector<size_t> matches;
+        scanSeparators(data, separator, wholeLine, kernel, &matches);
+        return matches;
+    }
+
+    bool containsSeparatorLine(std::string_view data, const std::string& separator, Kernel kernel)
+    {
+        return scanSeparators(data, separator, false, kernel, nullptr);
+    }
+
+    bool containsNulByte(std::string_view data, Kernel kernel)
+    {
+        switch (resolve(kernel)) {
+#ifdef CODEBUNDLER_SCANNER_X86
+        case Kernel::SSE42:
+            return nulByteSSE42(data.data(), data.size());
+        case Kernel::AVX2:
+            return nulByteAVX2(data.data(), data.size());
+        case Kernel::AVX512:
+            return nulByteAVX512(data.data(), data.size());
+#endif
+#ifdef CODEBUNDLER_SCANNER_NEON
+        case Kernel::NEON:
+            return nulByteNEON(data.data(), data.size());
+#endif
+        default:
+            return nulByteTail(data.data(), data.size(), 0);
+        }
+    }
+
+    size_t findJsonSpecial(std::string_view data, size_t from, Kernel kernel)
+    {
+        if (from >= data.size()) {
+            return data.size();
+        }
+        switch (resolve(kernel)) {
+#ifdef CODEBUNDLER_SCANNER_X86
+        case Kernel::SSE42:
+            return jsonSpecialSSE42(data.data(), data.size(), from);
+        case Kernel::AVX2:
+            return jsonSpecialAVX2(data.data(), data.size(), from);
+        case Kernel::AVX512:
+            return jsonSpecialAVX512(data.data(), data.size(), from);
+#endif
+#ifdef CODEBUNDLER_SCANNER_NEON
+        case Kernel::NEON:
+            return jsonSpecialNEON(data.data(), data.size(), from);
+#endif
+        default:
+            return jsonSpecialTail(data.data(), data.size(), from);
+        }
+    }
+
+} // namespace scanner
+} // namespace codebundler
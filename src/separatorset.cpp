@@ -0,0 +1,108 @@
+#include "separatorset.hpp"
+#include "exceptions.hpp"
+#include "options.hpp"
+#include "scanner.hpp"
+#include <stdexcept>
+
+namespace codebundler {
+
+namespace {
+
+    int findChild(const std::vector<std::pair<char, int>>& children, char c)
+    {
+        for (const auto& child : children) {
+            if (child.first == c) {
+                return child.second;
+            }
+        }
+        return -1;
+    }
+
+} // anonymous namespace
+
+SeparatorSet::SeparatorSet()
+    : SeparatorSet(defaultCandidates())
+{
+}
+
+SeparatorSet::SeparatorSet(std::vector<std::string> candidates)
+    : m_candidates(std::move(candidates))
+    , m_nodes(1)
+{
+    if (m_candidates.empty() || m_candidates.size() > MAX_CANDIDATES) {
+        throw std::invalid_argument("SeparatorSet needs between 1 and 64 candidates.");
+    }
+    m_prefix = m_candidates.front();
+    for (size_t i = 0; i < m_candidates.size(); ++i) {
+        const std::string& candidate = m_candidates[i];
+        if (candidate.empty() || candidate.find('\n') != std::string::npos) {
+            throw std::invalid_argument("Separator candidates must be non-empty single lines.");
+        }
+        size_t common = 0;
+        while (common < m_prefix.size() && common < candidate.size() && m_prefix[common] == candidate[common]) {
+            ++common;
+        }
+        m_prefix.resize(common);
+
+        int node = 0;
+        for (char c : candidate) {
+            int next = findChild(m_nodes[node].children, c);
+            if (next < 0) {
+                next = static_cast<int>(m_nodes.size());
+                m_nodes[node].children.emplace_back(c, next);
+                m_nodes.emplace_back();
+            }
+            node = next;
+        }
+        if (m_nodes[node].candidate < 0) {
+            m_nodes[node].candidate = static_cast<int>(i);
+        }
+    }
+    for (char c : m_prefix) {
+        m_prefixNode = findChild(m_nodes[m_prefixNode].children, c);
+    }
+}
+
+std::vector<std::string> SeparatorSet::defaultCandidates()
+{
+    const std::string base = Options().separator; // "========= BOUNDARY =========="
+    const size_t split = base.find(" =");
+    std::vector<std::string> candidates { base };
+    for (size_t i = 1; i < MAX_CANDIDATES; ++i) {
+        candidates.push_back(base.substr(0, split) + " " + std::to_string(i) + base.substr(split));
+    }
+    return candidates;
+}
+
+void SeparatorSet::scan(std::string_view data)
+{
+    std::uint64_t seen = 0;
+    const std::vector<size_t> starts = m_prefix.empty() ? scanner::findLineStarts(data) : scanner::findSeparatorLines(data, m_prefix, false);
+    for (size_t start : starts) {
+        int node = m_prefixNode;
+        for (size_t p = start + m_prefix.size();; ++p) {
+            if (m_nodes[node].candidate >= 0) {
+                seen |= std::uint64_t { 1 } << m_nodes[node].candidate;
+            }
+            if (p >= data.size() || (node = findChild(m_nodes[node].children, data[p])) < 0) {
+                break;
+            }
+        }
+    }
+    if (seen) {
+        m_collisions.fetch_or(seen, std::memory_order_relaxed);
+    }
+}
+
+std::string SeparatorSet::pick() const
+{
+    std::uint64_t collisions = m_collisions.load(std::memory_order_relaxed);
+    for (size_t i = 0; i < m_candidates.size(); ++i) {
+        if (!(collisions & (std::uint64_t { 1 } << i))) {
+            return m_candidates[i];
+        }
+    }
+    throw CodeBundlerException("Every candidate separator occurs in the bundled files; choose one with --separator.");
+}
+
+} // namespace codebundler
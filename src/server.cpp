@@ -0,0 +1,501 @@
+#include "server.hpp"
+#include "bundler.hpp"
+#include "exceptions.hpp"
+#include "unbundler.hpp"
+#include "utilities.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <iostream> // For std::cerr
+#include <ostream>
+#include <pthread.h>
+#include <streambuf>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <system_error>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+namespace codebundler {
+
+namespace {
+
+    volatile std::sig_atomic_t g_stopRequested = 0;
+
+    // How long a client may take to send its request, or to take in each part of the reply
+    constexpr time_t CLIENT_TIMEOUT_SECONDS = 30;
+    constexpr size_t CHUNK_SIZE = 64 * 1024;
+
+    void requestStop(int /*signal*/)
+    {
+        g_stopRequested = 1;
+    }
+
+    void writeAll(int fd, const char* data, size_t size)
+    {
+        while (size > 0) {
+            ssize_t written = ::write(fd, data, size);
+            if (written < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                    throw FileIOException("Timed out writing to socket", "client stopped reading");
+                }
+                throw FileIOException("Failed to write to socket", std::strerror(errno));
+            }
+            data += written;
+            size -= static_cast<size_t>(written);
+        }
+    }
+
+    sockaddr_un socketAddress(const std::string& socketPath)
+    {
+        sockaddr_un address {};
+        address.sun_family = AF_UNIX;
+        if (socketPath.size() >= sizeof(address.sun_path)) {
+            throw FileIOException("Socket path is too long", socketPath);
+        }
+        std::strncpy(address.sun_path, socketPath.c_str(), sizeof(address.sun_path) - 1);
+        return address;
+    }
+
+    // Requests are sent as "key=value" fields, each terminated by a NUL byte,
+    // with an empty field marking the end of the request.
+    std::string encodeRequest(const RemoteRequest& request)
+    {
+        std::string encoded;
+        auto field = [&encoded](const std::string& key, const std::string& value) {
+            encoded += key + "=" + value;
+            encoded += '\0';
+        };
+        field("command", request.command);
+        field("directory", request.directory);
+        field("argument", request.argument);
+        field("separator", request.separator);
+        field("description", request.description);
+        field("checksum", request.checksum);
+        field("lengthHeaders", request.lengthHeaders ? "1" : "0");
+        encoded += '\0';
+        return encoded;
+    }
+
+    bool readRequest(int fd, RemoteRequest& request)
+    {
+        std::string field;
+        char buffer[4096];
+        while (true) {
+            ssize_t got = ::read(fd, buffer, sizeof(buffer));
+            if (got < 0 && errno == EINTR) {
+                continue;
+            }
+            if (got <= 0) {
+                return false; // Client went away or timed out before finishing the request
+            }
+            for (const char* c = buffer; c < buffer + got; ++c) {
+                if (*c != '\0') {
+                    field += *c;
+                    continue;
+                }
+                if (field.empty()) {
+                    return true;
+                }
+                size_t eq = field.find('=');
+                std::string key = field.substr(0, eq);
+                std::string value = eq == std::string::npos ? "" : field.substr(eq + 1);
+                if (key == "command") {
+                    request.command = value;
+                } else if (key == "directory") {
+                    request.directory = value;
+                } else if (key == "argument") {
+                    request.argument = value;
+                } else if (key == "separator") {
+                    request.separator = value;
+                } else if (key == "description") {
+                    request.description = value;
+                } else if (key == "checksum") {
+                    request.checksum = value;
+                } else if (key == "lengthHeaders") {
+                    request.lengthHeaders = value == "1";
+                }
+                field.clear();
+            }
+        }
+    }
+
+    /**
+     * @brief Streambuf sending what is written to a socket as "<size>\n<bytes>" chunks.
+     *
+     * The reply ends with an "OK" or "ERR <message>" line after the last chunk, so
+     * the client can tell a complete reply from one cut short by an error.
+     * Write failures throw FileIOException; the stream rethrows them when its
+     * exception mask includes badbit.
+     */
+    class ChunkWriter : public std::streambuf {
+    public:
+        explicit ChunkWriter(int fd)
+            : m_fd(fd)
+            , m_buffer(CHUNK_SIZE)
+        {
+            setp(m_buffer.data(), m_buffer.data() + m_buffer.size());
+        }
+
+        void finish(const std::string& status)
+        {
+            sendChunk();
+            writeAll(m_fd, status.data(), status.size());
+        }
+
+        void discard()
+        {
+            setp(m_buffer.data(), m_buffer.data() + m_buffer.size());
+        }
+
+    protected:
+        int_type overflow(int_type ch) override
+        {
+            sendChunk();
+            if (!traits_type::eq_int_type(ch, traits_type::eof())) {
+                *pptr() = traits_type::to_char_type(ch);
+                pbump(1);
+            }
+            return traits_type::not_eof(ch);
+        }
+
+        int sync() override
+        {
+            sendChunk();
+            return 0;
+        }
+
+    private:
+        void sendChunk()
+        {
+            size_t size = static_cast<size_t>(pptr() - pbase());
+            if (size == 0) {
+                return;
+            }
+            std::string header = std::to_string(size) + "\n";
+            writeAll(m_fd, header.data(), header.size());
+            writeAll(m_fd, pbase(), size);
+            discard();
+        }
+
+        int m_fd;
+        std::vector<char> m_buffer;
+    };
+
+
+} // anonymous namespace
+
+//--------------------------------------------------------------------------
+// Constructor
+//--------------------------------------------------------------------------
+Server::Server(Options options, std::string socketPath)
+    : m_options(std::move(options))
+    , m_socketPath(std::move(socketPath))
+{
+    m_stopFd = ::eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (m_stopFd < 0) {
+        throw FileIOException("Failed to create an eventfd", std::strerror(errno));
+    }
+}
+
+Server::~Server()
+{
+    ::close(m_stopFd);
+}
+
+//--------------------------------------------------------------------------
+// Public Methods
+//--------------------------------------------------------------------------
+
+/**
+ * @brief Listens on the socket and serves requests until SIGINT or SIGTERM.
+ */
+void Server::run()
+{
+    sockaddr_un address = socketAddress(m_socketPath);
+    int listenFd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listenFd < 0) {
+        throw FileIOException("Failed to create socket", std::strerror(errno));
+    }
+    ::unlink(m_socketPath.c_str()); // Remove a stale socket from a previous run
+    if (::bind(listenFd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 || ::listen(listenFd, 16) != 0) {
+        int error = errno;
+        ::close(listenFd);
+        throw FileIOException("Failed to listen on socket " + m_socketPath, std::strerror(error));
+    }
+
+    // No SA_RESTART, so poll() returns with EINTR when asked to stop
+    g_stopRequested = 0;
+    struct sigaction action {};
+    action.sa_handler = requestStop;
+    sigemptyset(&action.sa_mask);
+    ::sigaction(SIGINT, &action, nullptr);
+    ::sigaction(SIGTERM, &action, nullptr);
+    std::signal(SIGPIPE, SIG_IGN); // A client hanging up must not kill the server
+
+    // Connection threads inherit a mask without SIGINT and SIGTERM, so the signals interrupt poll()
+    sigset_t stopSignals;
+    sigemptyset(&stopSignals);
+    sigaddset(&stopSignals, SIGINT);
+    sigaddset(&stopSignals, SIGTERM);
+
+    m_options.verbose > 0 && std::cerr << "Serving on " << m_socketPath << std::endl;
+    while (!g_stopRequested) {
+        pollfd pfds[2] = { { listenFd, POLLIN, 0 }, { m_stopFd, POLLIN, 0 } };
+        if (::poll(pfds, 2, -1) < 0) {
+            continue; // Interrupted by a signal
+        }
+        if (pfds[1].revents & POLLIN) {
+            break;
+        }
+        int clientFd = ::accept(listenFd, nullptr, nullptr);
+        if (clientFd < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            std::cerr << "Warning: accept failed: " << std::strerror(errno) << std::endl;
+            continue;
+        }
+        timeval timeout { CLIENT_TIMEOUT_SECONDS, 0 };
+        ::setsockopt(clientFd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+        ::setsockopt(clientFd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+        {
+            std::lock_guard<std::mutex> lock(m_connectionsMutex);
+            ++m_activeConnections;
+        }
+        sigset_t previous;
+        ::pthread_sigmask(SIG_BLOCK, &stopSignals, &previous);
+        try {
+            std::thread(&Server::serveConnection, this, clientFd).detach();
+        } catch (const std::system_error& e) {
+            std::cerr << "Warning: cannot start a connection thread: " << e.what() << std::endl;
+            ::close(clientFd);
+            std::lock_guard<std::mutex> lock(m_connectionsMutex);
+            --m_activeConnections;
+        }
+        ::pthread_sigmask(SIG_SETMASK, &previous, nullptr);
+    }
+
+    ::close(listenFd);
+    {
+        // Let requests in flight finish; the timeouts bound how long a client can take
+        std::unique_lock<std::mutex> lock(m_connectionsMutex);
+        m_connectionsDone.wait(lock, [this] { return m_activeConnections == 0; });
+    }
+    ::unlink(m_socketPath.c_str());
+    m_options.verbose > 0 && std::cerr << "Server stopped." << std::endl;
+}
+
+/**
+ * @brief Makes run() return once the requests in flight are answered.
+ */
+void Server::stop()
+{
+    std::uint64_t one = 1;
+    [[maybe_unused]] ssize_t written = ::write(m_stopFd, &one, sizeof(one));
+}
+
+//--------------------------------------------------------------------------
+// Private Methods
+//--------------------------------------------------------------------------
+
+void Server::serveConnection(int fd)
+{
+    handleConnection(fd);
+    ::close(fd);
+    std::lock_guard<std::mutex> lock(m_connectionsMutex);
+    if (--m_activeConnections == 0) {
+        m_connectionsDone.notify_all();
+    }
+}
+
+void Server::handleConnection(int fd)
+{
+    RemoteRequest request;
+    if (!readRequest(fd, request)) {
+        return;
+    }
+    m_options.verbose > 0 && std::cerr << "Request: " << request.command << " " << request.directory << std::endl;
+
+    ChunkWriter chunks(fd);
+    std::ostream output(&chunks);
+    output.exceptions(std::ios::badbit); // Rethrow socket write failures instead of bundling on
+    try {
+        try {
+            handleRequest(request, output);
+            output.flush();
+            chunks.finish("OK\n");
+        } catch (const std::exception& e) {
+            std::string message = e.what();
+            std::replace(message.begin(), message.end(), '\n', ' ');
+            chunks.discard();
+            chunks.finish("ERR " + message + "\n"); // Fails as well if the client went away
+        }
+    } catch (const std::exception& e) {
+        m_options.verbose > 0 && std::cerr << "Warning: " << e.what() << std::endl;
+    }
+}
+
+void Server::handleRequest(const RemoteRequest& request, std::ostream& output)
+{
+    if (request.directory.empty()) {
+        throw ArgumentParserException("Request has no directory.");
+    }
+
+    if (request.command == "bundle") {
+        Options options = m_options;
+        options.rootDirectory = request.directory;
+        if (!request.separator.empty()) {
+            options.separator = request.separator;
+        }
+        if (!request.checksum.empty()) {
+            if (request.checksum != "sha256" && request.checksum != "sha256-tree") {
+                throw ArgumentParserException("Unknown checksum type: " + request.checksum);
+            }
+            options.checksum = request.checksum;
+        }
+        options.lengthHeaders = request.lengthHeaders;
+        RepoState& repo = repoFor(request.directory, options.checksum);
+        Bundler bundler(options, &repo.cache);
+        bundler.bundleFilesToStream(output, trackedFiles(request.directory, repo), request.description);
+        return;
+    }
+
+    if (request.command == "list") {
+        RepoState& repo = repoFor(request.directory, m_options.checksum);
+        for (const auto& file : trackedFiles(request.directory, repo)) {
+            output << file << "\n";
+        }
+        return;
+    }
+
+    if (request.command == "verify") {
+        if (request.argument.empty()) {
+            throw ArgumentParserException("verify requires a bundle file.");
+        }
+        Options options = m_options;
+        options.trialRun = true;
+        Unbundler unbundler(options);
+        unbundler.unbundleFromFile((std::filesystem::path(request.directory) / request.argument).string());
+        output << "OK\n";
+        return;
+    }
+
+    throw ArgumentParserException("Unknown remote command: " + request.command);
+}
+
+Server::RepoState& Server::repoFor(const std::string& directory, const std::string& checksum)
+{
+    // Cached checksums are only valid for the type they were computed with
+    std::lock_guard<std::mutex> lock(m_reposMutex);
+    auto& slot = m_repos[directory + '\0' + checksum];
+    if (!slot) {
+        slot = std::make_unique<RepoState>(checksum, m_options.jobs);
+        auto [exit_code, output] = utilities::executeCommand("git -C " + utilities::shellQuote(directory) + " rev-parse --absolute-git-dir");
+        if (exit_code == 0) {
+            slot->indexPath = utilities::trim(output) + "/index";
+        }
+    }
+    return *slot;
+}
+
+std::vector<std::string> Server::trackedFiles(const std::string& directory, RepoState& repo)
+{
+    IndexStamp stamp;
+    struct stat st;
+    if (!repo.indexPath.empty() && ::stat(repo.indexPath.c_str(), &st) == 0) {
+        stamp.device = static_cast<std::uint64_t>(st.st_dev);
+        stamp.inode = static_cast<std::uint64_t>(st.st_ino);
+        stamp.size = static_cast<std::int64_t>(st.st_size);
+        stamp.mtimeNs = static_cast<std::int64_t>(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+    }
+
+    // Returns a copy, so the caller streams its reply without holding the lock
+    std::lock_guard<std::mutex> lock(repo.mutex);
+    if (stamp.size < 0 || !(stamp == repo.indexStamp)) {
+        m_options.verbose > 0 && std::cerr << "Refreshing file list for " << directory << std::endl;
+        repo.files = utilities::getGitTrackedFiles(directory);
+        repo.indexStamp = stamp;
+    }
+    return repo.files;
+}
+
+/**
+ * @brief Sends a request to a running server and copies the result to a stream as it arrives.
+ */
+void sendRemoteRequest(const std::string& socketPath, const RemoteRequest& request, std::ostream& outputStream)
+{
+    sockaddr_un address = socketAddress(socketPath);
+    int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        throw FileIOException("Failed to create socket", std::strerror(errno));
+    }
+    if (::connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+        int error = errno;
+        ::close(fd);
+        throw FileIOException("Failed to connect to server at " + socketPath, std::strerror(error));
+    }
+
+    try {
+        std::string encoded = encodeRequest(request);
+        writeAll(fd, encoded.data(), encoded.size());
+
+        // Chunks are copied out as they arrive; only the unconsumed tail of the last read is kept
+        std::string pending;
+        std::vector<char> buffer(CHUNK_SIZE);
+        auto receive = [&]() {
+            ssize_t got;
+            while ((got = ::read(fd, buffer.data(), buffer.size())) < 0 && errno == EINTR) {
+            }
+            if (got < 0) {
+                throw FileIOException("Failed to read from server", std::strerror(errno));
+            }
+            if (got == 0) {
+                throw CodeBundlerException("Truncated response from server.");
+            }
+            pending.append(buffer.data(), static_cast<size_t>(got));
+        };
+        while (true) {
+            size_t lineEnd;
+            while ((lineEnd = pending.find('\n')) == std::string::npos) {
+                receive();
+            }
+            std::string line = pending.substr(0, lineEnd);
+            pending.erase(0, lineEnd + 1);
+            if (line == "OK") {
+                break;
+            }
+            if (utilities::startsWith(line, "ERR ")) {
+                throw CodeBundlerException("Server error: " + line.substr(4));
+            }
+            if (line.empty() || line.size() > 19 || !std::all_of(line.begin(), line.end(), [](char c) { return c >= '0' && c <= '9'; })) {
+                throw CodeBundlerException("Malformed response from server.");
+            }
+            size_t remaining = std::stoull(line);
+            while (remaining > 0) {
+                if (pending.empty()) {
+                    receive();
+                }
+                size_t take = std::min(remaining, pending.size());
+                outputStream.write(pending.data(), static_cast<std::streamsize>(take));
+                pending.erase(0, take);
+                remaining -= take;
+            }
+        }
+    } catch (...) {
+        ::close(fd);
+        throw;
+    }
+    ::close(fd);
+}
+
+} // namespace codebundler
@@ -0,0 +1,151 @@
+#include "shards.hpp"
+#include "constants.hpp"
+#include "exceptions.hpp"
+#include <algorithm>
+#include <cctype>
+#include <functional>
+#include <numeric>
+#include <ostream>
+#include <queue>
+#include <utility>
+
+namespace codebundler {
+namespace shards {
+
+    namespace {
+
+        // Finds the placeholder "%d" or "%0<width>d"; returns {position, length} or {npos, 0}
+        std::pair<size_t, size_t> findPlaceholder(const std::string& pattern)
+        {
+            for (size_t pos = pattern.find('%'); pos != std::string::npos; pos = pattern.find('%', pos + 1)) {
+                size_t end = pos + 1;
+                while (end < pattern.size() && std::isdigit(static_cast<unsigned char>(pattern[end]))) {
+                    ++end;
+                }
+                if (end < pattern.size() && pattern[end] == 'd') {
+                    return { pos, end + 1 - pos };
+                }
+            }
+            return { std::string::npos, 0 };
+        }
+
+    } // anonymous namespace
+
+    /**
+     * @brief Splits files into shards of about a target size.
+     */
+    std::vector<std::vector<size_t>> balance(const std::vector<std::uint64_t>& sizes, std::uint64_t targetSize)
+    {
+        std::uint64_t total = std::accumulate(sizes.begin(), sizes.end(), std::uint64_t { 0 });
+        size_t shardCount = static_cast<size_t>(std::max<std::uint64_t>(1, (total + targetSize - 1) / targetSize));
+        shardCount = std::min(shardCount, std::max<size_t>(1, sizes.size()));
+
+        std::vector<size_t> order(sizes.size());
+        std::iota(order.begin(), order.end(), 0);
+        std::stable_sort(order.begin(), order.end(), [&sizes](size_t a, size_t b) { return sizes[a] > sizes[b]; });
+
+        // Min-heap of (bytes so far, shard); ties go to the lower shard number
+        using Load = std::pair<std::uint64_t, size_t>;
+        std::priority_queue<Load, std::vector<Load>, std::greater<Load>> loads;
+        for (size_t shard = 0; shard < shardCount; ++shard) {
+            loads.push({ 0, shard });
+        }
+        std::vector<std::vector<size_t>> assignment(shardCount);
+        for (size_t index : order) {
+            Load lightest = loads.top();
+            loads.pop();
+            assignment[lightest.second].push_back(index);
+            loads.push({ lightest.first + sizes[index], lightest.second });
+        }
+
+        for (auto& files : assignment) {
+            std::sort(files.begin(), files.end()); // Keep the listing order within a shard
+        }
+        assignment.erase(std::remove_if(assignment.begin(), assignment.end(), [](const auto& files) { return files.empty(); }), assignment.end());
+        return assignment;
+    }
+
+    bool isValidPattern(const std::string& pattern)
+    {
+        auto [pos, length] = findPlaceholder(pattern);
+        return pos != std::string::npos && findPlaceholder(pattern.substr(pos + length)).first == std::string::npos;
+    }
+
+    std::string shardPath(const std::string& pattern, size_t index)
+    {
+        auto [pos, length] = findPlaceholder(pattern);
+        std::string number = std::to_string(index);
+        size_t width = length > 2 ? std::stoul(pattern.substr(pos + 1, length - 2)) : 0;
+        if (number.size() < width) {
+            number.insert(0, width - number.size(), '0');
+        }
+        return pattern.substr(0, pos) + number + pattern.substr(pos + length);
+    }
+
+    std::string manifestPath(const std::string& pattern)
+    {
+        auto [pos, length] = findPlaceholder(pattern);
+        return pattern.substr(0, pos) + "manifest" + pattern.substr(pos + length);
+    }
+
+    bool isManifest(std::string_view data)
+    {
+        return data.compare(0, SHARD_MANIFEST_HEADER.size(), SHARD_MANIFEST_HEADER) == 0
+            && (data.size() == SHARD_MANIFEST_HEADER.size() || data[SHARD_MANIFEST_HEADER.size()] == '\n' || data[SHARD_MANIFEST_HEADER.size()] == '\r');
+    }
+
+    void writeManifest(std::ostream& outputStream, const Manifest& manifest)
+    {
+        outputStream << SHARD_MANIFEST_HEADER << "\n";
+        if (!manifest.description.empty()) {
+            outputStream << DESCRIPTION_PREFIX << manifest.description << "\n";
+        }
+        for (const auto& shard : manifest.shards) {
+            outputStream << SHARD_PREFIX << shard.fileCount << " " << shard.bytes << " " << shard.path << "\n";
+        }
+    }
+
+    Manifest readManifest(std::string_view data)
+    {
+        if (!isManifest(data)) {
+            throw BundleFormatException("Not a shard manifest.");
+        }
+        Manifest manifest;
+        size_t lineStart = data.find('\n');
+        while (lineStart != std::string_view::npos && lineStart + 1 < data.size()) {
+            size_t lineEnd = data.find('\n', lineStart + 1);
+            std::string line(data.substr(lineStart + 1, lineEnd == std::string_view::npos ? std::string_view::npos : lineEnd - lineStart - 1));
+            lineStart = lineEnd;
+            if (!line.empty() && line.back() == '\r') {
+                line.pop_back();
+            }
+            if (line.empty()) {
+                continue;
+            }
+            if (line.rfind(DESCRIPTION_PREFIX, 0) == 0) {
+                manifest.description = line.substr(DESCRIPTION_PREFIX.size());
+                continue;
+            }
+            if (line.rfind(SHARD_PREFIX, 0) != 0) {
+                throw BundleFormatException("Unexpected line in shard manifest: " + line);
+            }
+            size_t countEnd = line.find(' ', SHARD_PREFIX.size());
+            size_t bytesEnd = countEnd == std::string::npos ? std::string::npos : line.find(' ', countEnd + 1);
+            if (bytesEnd == std::string::npos || bytesEnd + 1 >= line.size()) {
+                throw BundleFormatException("Malformed shard line in manifest: " + line);
+            }
+            Shard shard;
+            try {
+                shard.fileCount = std::stoul(line.substr(SHARD_PREFIX.size(), countEnd - SHARD_PREFIX.size()));
+                shard.bytes = std::stoull(line.substr(countEnd + 1, bytesEnd - countEnd - 1));
+            } catch (const std::exception&) {
+                throw BundleFormatException("Malformed shard line in manifest: " + line);
+            }
+            shard.path = line.substr(bytesEnd + 1);
+            manifest.shards.push_back(std::move(shard));
+        }
+        return manifest;
+    }
+
+} // namespace shards
+} // namespace codebundler
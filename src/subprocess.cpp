@@ -0,0 +1,236 @@
+#include "subprocess.hpp"
+#include "exceptions.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace codebundler {
+
+namespace {
+
+    constexpr size_t PIPE_BUFFER_SIZE = 1 << 16;
+
+    void closeFd(int& fd)
+    {
+        if (fd >= 0) {
+            ::close(fd);
+            fd = -1;
+        }
+    }
+
+} // anonymous namespace
+
+//--------------------------------------------------------------------------
+// Subprocess
+//--------------------------------------------------------------------------
+
+Subprocess::Subprocess(const std::vector<std::string>& argv, const std::filesystem::path& workingDirectory, bool pipeStdin, bool pipeStdout)
+{
+    if (argv.empty()) {
+        throw CodeBundlerException("No command given.");
+    }
+    // A child that exits early must turn our writes into EPIPE errors, not kill us
+    std::signal(SIGPIPE, SIG_IGN);
+
+    int inPipe[2] = { -1, -1 };
+    int outPipe[2] = { -1, -1 };
+    if ((pipeStdin && ::pipe2(inPipe, O_CLOEXEC) != 0) || (pipeStdout && ::pipe2(outPipe, O_CLOEXEC) != 0)) {
+        int error = errno;
+        for (int fd : { inPipe[0], inPipe[1], outPipe[0], outPipe[1] }) {
+            closeFd(fd);
+        }
+        throw CodeBundlerException("Failed to create pipe: " + std::string(std::strerror(error)));
+    }
+
+    std::vector<char*> args;
+    for (const auto& arg : argv) {
+        args.push_back(const_cast<char*>(arg.c_str()));
+    }
+    args.push_back(nullptr);
+
+    pid_t pid = ::fork();
+    if (pid == 0) {
+        // Child: only async-signal-safe calls from here on
+        if (pipeStdin) {
+            ::dup2(inPipe[0], STDIN_FILENO);
+        }
+        if (pipeStdout) {
+            ::dup2(outPipe[1], STDOUT_FILENO);
+        }
+        if (!workingDirectory.empty() && ::chdir(workingDirectory.c_str()) != 0) {
+            ::_exit(127);
+        }
+        ::execvp(args[0], args.data());
+        ::_exit(127);
+    }
+
+    int error = errno;
+    closeFd(inPipe[0]);
+    closeFd(outPipe[1]);
+    if (pid < 0) {
+        closeFd(inPipe[1]);
+        closeFd(outPipe[0]);
+        throw CodeBundlerException("Failed to start " + argv[0] + ": " + std::strerror(error));
+    }
+    m_pid = pid;
+    m_stdin = inPipe[1];
+    m_stdout = outPipe[0];
+}
+
+Subprocess::~Subprocess()
+{
+    wait();
+}
+
+void Subprocess::closeStdin()
+{
+    closeFd(m_stdin);
+}
+
+void Subprocess::closeStdout()
+{
+    closeFd(m_stdout);
+}
+
+int Subprocess::wait()
+{
+    closeFd(m_stdin);
+    closeFd(m_stdout);
+    if (m_pid < 0) {
+        return -1;
+    }
+    int status = 0;
+    while (::waitpid(m_pid, &status, 0) < 0 && errno == EINTR) {
+    }
+    m_pid = -1;
+    return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+}
+
+//--------------------------------------------------------------------------
+// FdOutputBuf
+//--------------------------------------------------------------------------
+
+FdOutputBuf::FdOutputBuf(int fd)
+    : m_fd(fd)
+    , m_buffer(PIPE_BUFFER_SIZE)
+{
+    setp(m_buffer.data(), m_buffer.data() + m_buffer.size());
+}
+
+FdOutputBuf::~FdOutputBuf()
+{
+    try {
+        sync();
+    } catch (const FileIOException&) {
+        // Nothing sensible to do about a failing flush during destruction
+    }
+}
+
+FdOutputBuf::int_type FdOutputBuf::overflow(int_type c)
+{
+    sync();
+    if (!traits_type::eq_int_type(c, traits_type::eof())) {
+        *pptr() = traits_type::to_char_type(c);
+        pbump(1);
+    }
+    return traits_type::not_eof(c);
+}
+
+std::streamsize FdOutputBuf::xsputn(const char* data, std::streamsize count)
+{
+    if (count >= epptr() - pptr()) {
+        // Large writes (blob contents) skip the buffer
+        sync();
+        writeAll(data, static_cast<size_t>(count));
+        return count;
+    }
+    std::memcpy(pptr(), data, static_cast<size_t>(count));
+    pbump(static_cast<int>(count));
+    return count;
+}
+
+int FdOutputBuf::sync()
+{
+    size_t pending = static_cast<size_t>(pptr() - pbase());
+    setp(m_buffer.data(), m_buffer.data() + m_buffer.size());
+    writeAll(m_buffer.data(), pending);
+    return 0;
+}
+
+void FdOutputBuf::writeAll(const char* data, size_t size)
+{
+    while (size > 0) {
+        ssize_t written = ::write(m_fd, data, size);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw FileIOException("Failed to write to pipe: " + std::string(std::strerror(errno)));
+        }
+        data += written;
+        size -= static_cast<size_t>(written);
+    }
+}
+
+//--------------------------------------------------------------------------
+// FdReader
+//--------------------------------------------------------------------------
+
+FdReader::FdReader(int fd)
+    : m_fd(fd)
+{
+}
+
+bool FdReader::fill()
+{
+    if (m_position > 0) {
+        m_buffer.erase(0, m_position);
+        m_position = 0;
+    }
+    char chunk[PIPE_BUFFER_SIZE];
+    while (true) {
+        ssize_t got = ::read(m_fd, chunk, sizeof(chunk));
+        if (got < 0 && errno == EINTR) {
+            continue;
+        }
+        if (got < 0) {
+            throw FileIOException("Failed to read from pipe: " + std::string(std::strerror(errno)));
+        }
+        m_buffer.append(chunk, static_cast<size_t>(got));
+        return got > 0;
+    }
+}
+
+bool FdReader::readLine(std::string& line, char delimiter)
+{
+    size_t end;
+    while ((end = m_buffer.find(delimiter, m_position)) == std::string::npos) {
+        if (!fill()) {
+            return false;
+        }
+    }
+    line.assign(m_buffer, m_position, end - m_position);
+    m_position = end + 1;
+    return true;
+}
+
+std::string FdReader::readExactly(size_t count)
+{
+    std::string data;
+    data.reserve(count);
+    while (data.size() < count) {
+        if (m_position == m_buffer.size() && !fill()) {
+            throw FileIOException("Unexpected end of output from child process");
+        }
+        size_t take = std::min(count - data.size(), m_buffer.size() - m_position);
+        data.append(m_buffer, m_position, take);
+        m_position += take;
+    }
+    return data;
+}
+
+} // namespace codebundler
@@ -0,0 +1,136 @@
+#include "tarwriter.hpp"
+#include "exceptions.hpp"
+#include <algorithm>
+#include <cstring>
+#include <ostream>
+
+namespace codebundler {
+
+namespace {
+
+    constexpr size_t BLOCK_SIZE = 512;
+    constexpr size_t NAME_SIZE = 100;
+    constexpr size_t PREFIX_SIZE = 155;
+    constexpr std::uint64_t MAX_USTAR_SIZE = 077777777777; // 11 octal digits
+
+    // Writes value as zero-padded octal digits filling all but the last (NUL) byte of a field
+    void putOctal(char* field, size_t width, std::uint64_t value)
+    {
+        field[width - 1] = '\0';
+        for (size_t i = width - 1; i-- > 0;) {
+            field[i] = static_cast<char>('0' + (value & 7));
+            value >>= 3;
+        }
+    }
+
+    // A pax record is "<length> <key>=<value>\n", where length counts the whole record
+    std::string paxRecord(const std::string& key, const std::string& value)
+    {
+        const size_t payload = key.size() + value.size() + 3; // Space, '=' and newline
+        size_t length = payload + 1;
+        while (length != payload + std::to_string(length).size()) {
+            length = payload + std::to_string(length).size();
+        }
+        return std::to_string(length) + " " + key + "=" + value + "\n";
+    }
+
+    // Splits a path into ustar prefix and name fields; false if it does not fit
+    bool splitPath(const std::string& path, std::string& prefix, std::string& name)
+    {
+        if (path.size() <= NAME_SIZE) {
+            prefix.clear();
+            name = path;
+            return true;
+        }
+        for (size_t slash = path.find('/'); slash != std::string::npos; slash = path.find('/', slash + 1)) {
+            if (slash <= PREFIX_SIZE && path.size() - slash - 1 <= NAME_SIZE && slash + 1 < path.size()) {
+                prefix = path.substr(0, slash);
+                name = path.substr(slash + 1);
+                return true;
+            }
+        }
+        return false;
+    }
+
+} // anonymous namespace
+
+TarWriter::TarWriter(std::ostream& outputStream, std::time_t modificationTime)
+    : m_out(outputStream)
+    , m_modificationTime(modificationTime)
+{
+}
+
+/**
+ * @brief Appends a file.
+ */
+void TarWriter::addFile(const std::string& path, std::string_view content, std::uint32_t mode)
+{
+    std::string prefix;
+    std::string name;
+    bool pathFits = splitPath(path, prefix, name);
+    if (!pathFits || content.size() > MAX_USTAR_SIZE) {
+        std::string records;
+        if (!pathFits) {
+            records += paxRecord("path", path);
+            prefix.clear();
+            name = path.substr(0, NAME_SIZE); // Readers without pax support see a truncated name
+        }
+        if (content.size() > MAX_USTAR_SIZE) {
+            records += paxRecord("size", std::to_string(content.size()));
+        }
+        writeHeader("PaxHeader", "", records.size(), 0644, 'x');
+        writePadded(records);
+    }
+
+    writeHeader(name, prefix, content.size() > MAX_USTAR_SIZE ? 0 : content.size(), mode & 07777, '0');
+    writePadded(content);
+    if (!m_out) {
+        throw FileIOException("Failed to write tar stream for file", path);
+    }
+    ++m_fileCount;
+}
+
+/**
+ * @brief Writes the end-of-archive marker.
+ */
+void TarWriter::finish()
+{
+    const std::string endOfArchive(2 * BLOCK_SIZE, '\0');
+    m_out.write(endOfArchive.data(), static_cast<std::streamsize>(endOfArchive.size()));
+    m_out.flush();
+    if (!m_out) {
+        throw FileIOException("Failed to write end of tar stream");
+    }
+}
+
+void TarWriter::writeHeader(const std::string& name, const std::string& prefix, std::uint64_t size, std::uint32_t mode, char type)
+{
+    char header[BLOCK_SIZE] = {};
+    std::memcpy(header, name.data(), std::min(name.size(), NAME_SIZE));
+    putOctal(header + 100, 8, mode);
+    putOctal(header + 108, 8, 0); // uid
+    putOctal(header + 116, 8, 0); // gid
+    putOctal(header + 124, 12, size);
+    putOctal(header + 136, 12, static_cast<std::uint64_t>(m_modificationTime));
+    header[156] = type;
+    std::memcpy(header + 257, "ustar\0" "00", 8);
+    std::memcpy(header + 345, prefix.data(), std::min(prefix.size(), PREFIX_SIZE));
+
+    // The checksum is computed with its own field filled with spaces
+    std::memset(header + 148, ' ', 8);
+    std::uint32_t checksum = 0;
+    for (unsigned char c : header) {
+        checksum += c;
+    }
+    putOctal(header + 148, 7, checksum);
+    m_out.write(header, BLOCK_SIZE);
+}
+
+void TarWriter::writePadded(std::string_view data)
+{
+    static const char zeros[BLOCK_SIZE] = {};
+    m_out.write(data.data(), static_cast<std::streamsize>(data.size()));
+    m_out.write(zeros, static_cast<std::streamsize>((BLOCK_SIZE - data.size() % BLOCK_SIZE) % BLOCK_SIZE));
+}
+
+} // namespace codebundler
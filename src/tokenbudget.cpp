@@ -0,0 +1,138 @@
+#include "tokenbudget.hpp"
+#include "exceptions.hpp"
+#include <algorithm>
+#include <array>
+#include <numeric>
+
+namespace codebundler {
+namespace tokens {
+
+    namespace {
+
+        enum CharClass : unsigned char {
+            LETTER,
+            DIGIT,
+            SPACE,
+            NEWLINE,
+            PUNCTUATION,
+            HIGH, // Bytes of multi-byte UTF-8 characters
+            CLASS_COUNT
+        };
+
+        // Typical bytes per token of each kind of run: words are mostly one token, numbers are
+        // split into groups of three digits, and indentation and blank lines merge into few tokens
+        constexpr std::array<unsigned, CLASS_COUNT> BYTES_PER_TOKEN = { 6, 3, MAX_BYTES_PER_TOKEN, MAX_BYTES_PER_TOKEN, 2, 2 };
+
+        const std::array<CharClass, 256>& classTable()
+        {
+            static const std::array<CharClass, 256> table = [] {
+                std::array<CharClass, 256> classes {};
+                for (int c = 0; c < 256; ++c) {
+                    if ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z')) {
+                        classes[c] = LETTER;
+                    } else if (c >= '0' && c <= '9') {
+                        classes[c] = DIGIT;
+                    } else if (c == ' ' || c == '\t') {
+                        classes[c] = SPACE;
+                    } else if (c == '\n' || c == '\r') {
+                        classes[c] = NEWLINE;
+                    } else if (c >= 0x80) {
+                        classes[c] = HIGH;
+                    } else {
+                        classes[c] = PUNCTUATION;
+                    }
+                }
+                return classes;
+            }();
+            return table;
+        }
+
+        // True if the rules match the path or one of its parent directories
+        bool matchesPathOrParent(const IgnoreRules& rules, const std::string& path)
+        {
+            for (size_t slash = path.find('/'); slash != std::string::npos; slash = path.find('/', slash + 1)) {
+                if (rules.match(std::string_view(path).substr(0, slash), true) == IgnoreRules::Match::Ignored) {
+                    return true;
+                }
+            }
+            return rules.match(path, false) == IgnoreRules::Match::Ignored;
+        }
+
+    } // anonymous namespace
+
+    /**
+     * @brief Estimates how many tokens a BPE tokenizer (GPT-style) turns text into.
+     */
+    std::uint64_t estimate(std::string_view text)
+    {
+        const auto& classes = classTable();
+        const auto* bytes = reinterpret_cast<const unsigned char*>(text.data());
+        const size_t size = text.size();
+        std::uint64_t count = 0;
+        size_t i = 0;
+        while (i < size) {
+            CharClass kind = classes[bytes[i]];
+            // A single space is part of the word, number or symbol after it (" foo" is one token)
+            if (bytes[i] == ' ' && i + 1 < size && classes[bytes[i + 1]] != SPACE && classes[bytes[i + 1]] != NEWLINE) {
+                kind = classes[bytes[++i]];
+            }
+            size_t start = i;
+            while (i < size && classes[bytes[i]] == kind) {
+                ++i;
+            }
+            count += (i - start + BYTES_PER_TOKEN[kind] - 1) / BYTES_PER_TOKEN[kind];
+        }
+        return count;
+    }
+
+    PriorityRules::PriorityRules(const std::string& spec)
+    {
+        size_t start = 0;
+        while (start < spec.size()) {
+            size_t end = std::min(spec.find(',', start), spec.size());
+            std::string rule = spec.substr(start, end - start);
+            size_t equals = rule.rfind('=');
+            size_t digits = equals == std::string::npos ? 0 : equals + 1 + (equals + 1 < rule.size() && rule[equals + 1] == '-' ? 1 : 0);
+            if (equals == std::string::npos || equals == 0 || digits == rule.size() || digits + 6 < rule.size()
+                || rule.find_first_not_of("0123456789", digits) != std::string::npos) {
+                throw ArgumentParserException("Invalid priority rule '" + rule + "'; expected glob=weight.");
+            }
+            Rule parsed { IgnoreRules(), std::stoi(rule.substr(equals + 1)) };
+            parsed.pattern.addRules(rule.substr(0, equals));
+            m_rules.push_back(std::move(parsed));
+            start = end + 1;
+        }
+    }
+
+    int PriorityRules::priority(const std::string& path) const
+    {
+        for (const auto& rule : m_rules) {
+            if (matchesPathOrParent(rule.pattern, path)) {
+                return rule.weight;
+            }
+        }
+        return 0;
+    }
+
+    /**
+     * @brief Picks the files that fit a token budget, highest priority first.
+     */
+    std::vector<size_t> choose(const std::vector<int>& priorities, const std::vector<std::uint64_t>& costs, std::uint64_t budget)
+    {
+        std::vector<size_t> order(costs.size());
+        std::iota(order.begin(), order.end(), 0);
+        std::stable_sort(order.begin(), order.end(), [&priorities](size_t a, size_t b) { return priorities[a] > priorities[b]; });
+
+        std::vector<size_t> chosen;
+        for (size_t index : order) {
+            if (priorities[index] >= 0 && costs[index] <= budget) {
+                chosen.push_back(index);
+                budget -= costs[index];
+            }
+        }
+        std::sort(chosen.begin(), chosen.end());
+        return chosen;
+    }
+
+} // namespace tokens
+} // namespace codebundler
@@ -0,0 +1,381 @@
+#include "tuning.hpp"
+#include "exceptions.hpp"
+#include "mappedfile.hpp"
+#include "scanner.hpp"
+#include "utilities.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <iomanip>
+#include <limits>
+#include <ostream>
+#include <sstream>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+namespace codebundler {
+namespace tuning {
+
+    namespace {
+
+        constexpr size_t SCAN_BUFFER_SIZE = 16 << 20;
+        constexpr size_t HASH_BUFFER_SIZE = 8 << 20;
+        constexpr size_t SMALL_FILE_COUNT = 1000;
+        constexpr size_t SMALL_FILE_SIZE = 2048;
+        constexpr size_t WRITE_FILE_COUNT = 256;
+        constexpr size_t WRITE_FILE_SIZE = 64 << 10;
+        constexpr size_t LARGE_FILE_SIZE = 64 << 20;
+        constexpr int REPEATS = 3; // Each measurement keeps its best run
+        constexpr double CLOSE_ENOUGH = 1.05; // Fewer threads win unless more are clearly faster
+        const std::string SEPARATOR = "========= BOUNDARY ==========";
+
+        template <typename Task>
+        double bestSeconds(Task task)
+        {
+            double best = std::numeric_limits<double>::max();
+            for (int i = 0; i < REPEATS; ++i) {
+                auto start = std::chrono::steady_clock::now();
+                task();
+                best = std::min(best, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+            }
+            return best;
+        }
+
+        std::string rate(double bytes, double seconds)
+        {
+            std::ostringstream text;
+            text << std::fixed << std::setprecision(0) << bytes / seconds / (1 << 20) << " MiB/s";
+            return text.str();
+        }
+
+        // 1, 2, 4, ... up to twice the hardware threads (extra threads hide I/O latency), plus the thread count itself
+        std::vector<int> threadCounts()
+        {
+            const int hardware = std::max(1u, std::thread::hardware_concurrency());
+            std::vector<int> counts;
+            for (int jobs = 1; jobs <= 2 * hardware; jobs *= 2) {
+                counts.push_back(jobs);
+            }
+            if (std::find(counts.begin(), counts.end(), hardware) == counts.end()) {
+                counts.push_back(hardware);
+                std::sort(counts.begin(), counts.end());
+            }
+            return counts;
+        }
+
+        // The fewest threads within CLOSE_ENOUGH of the fastest run
+        int pickThreads(const std::vector<int>& counts, const std::vector<double>& seconds)
+        {
+            double fastest = *std::min_element(seconds.begin(), seconds.end());
+            for (size_t i = 0; i < counts.size(); ++i) {
+                if (seconds[i] <= fastest * CLOSE_ENOUGH) {
+                    return counts[i];
+                }
+            }
+            return counts.back();
+        }
+
+        // Source-like text with a separator line every 200 lines
+        std::string sampleText(size_t size)
+        {
+            std::string text;
+            text.reserve(size + 128);
+            for (size_t line = 0; text.size() < size; ++line) {
+                text += line % 200 == 0 ? SEPARATOR : "    result += compute(value_" + std::to_string(line % 97) + ", index); // step";
+                text += '\n';
+            }
+            text.resize(size);
+            return text;
+        }
+
+        void writeFile(const std::filesystem::path& path, std::string_view content)
+        {
+            int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+            if (fd < 0) {
+                throw FileIOException("Failed to open file for writing: " + std::string(std::strerror(errno)), path.string());
+            }
+            size_t written = 0;
+            while (written < content.size()) {
+                ssize_t result = ::write(fd, content.data() + written, content.size() - written);
+                if (result < 0 && errno == EINTR) {
+                    continue;
+                }
+                if (result < 0) {
+                    int error = errno;
+                    ::close(fd);
+                    throw FileIOException("Failed to write file: " + std::string(std::strerror(error)), path.string());
+                }
+                written += static_cast<size_t>(result);
+            }
+            ::close(fd);
+        }
+
+        // Reads a whole file with read(2) into a reused buffer; returns the byte count
+        size_t readFile(const std::filesystem::path& path, std::string& buffer)
+        {
+            int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+            if (fd < 0) {
+                throw FileIOException("Failed to open file for reading: " + std::string(std::strerror(errno)), path.string());
+            }
+            size_t total = 0;
+            while (true) {
+                ssize_t got = ::read(fd, &buffer[0], buffer.size());
+                if (got < 0 && errno == EINTR) {
+                    continue;
+                }
+                if (got <= 0) {
+                    break;
+                }
+                total += static_cast<size_t>(got);
+            }
+            ::close(fd);
+            return total;
+        }
+
+        // Removes the scratch directory however calibration ends
+        struct ScratchDirectory {
+            std::filesystem::path path;
+            explicit ScratchDirectory(const std::filesystem::path& parent)
+                : path(parent / (".codebundler-tune-" + std::to_string(::getpid())))
+            {
+                std::filesystem::create_directories(path);
+            }
+            ~ScratchDirectory()
+            {
+                std::error_code ec;
+                std::filesystem::remove_all(path, ec);
+            }
+        };
+
+        size_t parseCount(const std::string& value, const std::filesystem::path& file, size_t lineNumber)
+        {
+            size_t used = 0;
+            unsigned long long number = 0;
+            try {
+                number = std::stoull(value, &used);
+            } catch (const std::exception&) {
+                used = 0;
+            }
+            if (used == 0 || used != value.size() || number > std::numeric_limits<int>::max()) {
+                throw CodeBundlerException("Invalid number in " + file.string() + " line " + std::to_string(lineNumber) + ": " + value);
+            }
+            return static_cast<size_t>(number);
+        }
+
+    } // anonymous namespace
+
+    /**
+     * @brief Returns where settings are kept.
+     */
+    std::filesystem::path defaultConfigPath()
+    {
+        if (const char* explicitPath = std::getenv("CODEBUNDLER_CONFIG"); explicitPath && *explicitPath) {
+            return explicitPath;
+        }
+        if (const char* configHome = std::getenv("XDG_CONFIG_HOME"); configHome && *configHome) {
+            return std::filesystem::path(configHome) / "codebundler" / "config";
+        }
+        if (const char* home = std::getenv("HOME"); home && *home) {
+            return std::filesystem::path(home) / ".config" / "codebundler" / "config";
+        }
+        return {};
+    }
+
+    /**
+     * @brief Reads a config file of "key = value" lines.
+     */
+    Settings load(const std::filesystem::path& file)
+    {
+        Settings settings;
+        std::ifstream input(file);
+        if (!input) {
+            return settings;
+        }
+        std::string line;
+        for (size_t lineNumber = 1; std::getline(input, line); ++lineNumber) {
+            line = utilities::trim(line.substr(0, line.find('#')));
+            if (line.empty()) {
+                continue;
+            }
+            size_t equals = line.find('=');
+            if (equals == std::string::npos) {
+                throw CodeBundlerException("Expected \"key = value\" in " + file.string() + " line " + std::to_string(lineNumber) + ".");
+            }
+            std::string key = utilities::trim(line.substr(0, equals));
+            std::string value = utilities::trim(line.substr(equals + 1));
+            if (key == "bundle-jobs") {
+                settings.bundleJobs = static_cast<int>(parseCount(value, file, lineNumber));
+            } else if (key == "unbundle-jobs") {
+                settings.unbundleJobs = static_cast<int>(parseCount(value, file, lineNumber));
+            } else if (key == "read-buffer") {
+                settings.readBufferSize = parseCount(value, file, lineNumber);
+            } else if (key == "io") {
+                if (value != "mmap" && value != "read") {
+                    throw CodeBundlerException("io must be \"mmap\" or \"read\" in " + file.string() + " line " + std::to_string(lineNumber) + ".");
+                }
+                settings.io = value;
+            } else if (key == "scan-kernel") {
+                settings.scanKernel = value;
+            }
+            // Unknown keys are skipped so older versions can read newer files
+        }
+        return settings;
+    }
+
+    /**
+     * @brief Writes settings to a config file, replacing it atomically.
+     */
+    void save(const std::filesystem::path& file, const Settings& settings, const std::string& comment)
+    {
+        std::ostringstream text;
+        if (!comment.empty()) {
+            text << "# " << comment << "\n";
+        }
+        settings.bundleJobs > 0 && text << "bundle-jobs = " << settings.bundleJobs << "\n";
+        settings.unbundleJobs > 0 && text << "unbundle-jobs = " << settings.unbundleJobs << "\n";
+        settings.readBufferSize > 0 && text << "read-buffer = " << settings.readBufferSize << "\n";
+        !settings.io.empty() && text << "io = " << settings.io << "\n";
+        !settings.scanKernel.empty() && text << "scan-kernel = " << settings.scanKernel << "\n";
+
+        if (file.has_parent_path()) {
+            std::filesystem::create_directories(file.parent_path());
+        }
+        utilities::replaceFileAtomically(file, text.str());
+    }
+
+    /**
+     * @brief Applies settings to the options of a command.
+     */
+    void apply(const Settings& settings, const std::string& command, bool jobsGiven, Options& options)
+    {
+        scanner::Kernel kernel;
+        if (!settings.scanKernel.empty() && scanner::parseKernelName(settings.scanKernel, kernel)) {
+            scanner::preferKernel(kernel); // Ignored if this machine lacks it (e.g. a shared home directory)
+        }
+        if (command == "bundle" && !jobsGiven && settings.bundleJobs > 0) {
+            options.jobs = settings.bundleJobs;
+        }
+        if (command == "unbundle") {
+            if (!jobsGiven && settings.unbundleJobs > 0) {
+                options.jobs = settings.unbundleJobs;
+            }
+            if (settings.readBufferSize > 0) {
+                options.readBufferSize = settings.readBufferSize;
+            }
+            if (!settings.io.empty()) {
+                options.io = settings.io;
+            }
+        }
+    }
+
+    /**
+     * @brief Runs short micro-benchmarks and picks the fastest settings.
+     */
+    Settings calibrate(const std::filesystem::path& directory, std::ostream& report)
+    {
+        Settings settings;
+        ScratchDirectory scratch(directory);
+        const std::vector<int> counts = threadCounts();
+
+        // Separator scan per kernel
+        const std::string text = sampleText(SCAN_BUFFER_SIZE);
+        double fastestScan = std::numeric_limits<double>::max();
+        for (scanner::Kernel kernel : { scanner::Kernel::Scalar, scanner::Kernel::SSE42, scanner::Kernel::AVX2, scanner::Kernel::AVX512, scanner::Kernel::NEON }) {
+            if (!scanner::isKernelSupported(kernel)) {
+                continue;
+            }
+            double seconds = bestSeconds([&] { scanner::findSeparatorLines(text, SEPARATOR, false, kernel); });
+            report << "scan " << scanner::kernelName(kernel) << ": " << rate(text.size(), seconds) << "\n";
+            if (seconds < fastestScan) {
+                fastestScan = seconds;
+                settings.scanKernel = scanner::kernelName(kernel);
+            }
+        }
+
+        // Hash throughput (informational: the checksum type is a format choice left to --checksum)
+        std::string_view hashInput(text.data(), HASH_BUFFER_SIZE);
+        report << "hash sha256: " << rate(hashInput.size(), bestSeconds([&] { utilities::calculateSHA256(hashInput); })) << "\n";
+        report << "hash sha256-tree: " << rate(text.size(), bestSeconds([&] { utilities::calculateChecksum(text, "sha256-tree", 0); })) << " on all threads\n";
+
+        // Small files: open, read and hash, as bundle does for every tracked file
+        std::vector<std::filesystem::path> smallFiles;
+        for (size_t i = 0; i < SMALL_FILE_COUNT; ++i) {
+            std::filesystem::path subdirectory = scratch.path / "small" / std::to_string(i % 16);
+            if (i < 16) {
+                std::filesystem::create_directories(subdirectory);
+            }
+            smallFiles.push_back(subdirectory / ("file" + std::to_string(i) + ".txt"));
+            writeFile(smallFiles.back(), std::string_view(text.data() + i * 64, SMALL_FILE_SIZE));
+        }
+        std::vector<double> readSeconds;
+        for (int jobs : counts) {
+            readSeconds.push_back(bestSeconds([&] {
+                utilities::parallelFor(smallFiles.size(), jobs, [&](size_t i) {
+                    thread_local std::string buffer(SMALL_FILE_SIZE * 2, '\0');
+                    size_t length = readFile(smallFiles[i], buffer);
+                    utilities::calculateSHA256(std::string_view(buffer.data(), length));
+                });
+            }));
+            report << "small files, -j " << jobs << ": " << std::fixed << std::setprecision(1)
+                   << readSeconds.back() * 1e6 / smallFiles.size() << " us per file\n";
+        }
+        settings.bundleJobs = pickThreads(counts, readSeconds);
+
+        // Write bandwidth: create and fill files, as unbundle does
+        const std::string_view writeContent(text.data(), WRITE_FILE_SIZE);
+        std::vector<double> writeSeconds;
+        for (int jobs : counts) {
+            const std::filesystem::path target = scratch.path / ("write" + std::to_string(jobs));
+            std::filesystem::create_directories(target);
+            writeSeconds.push_back(bestSeconds([&] {
+                utilities::parallelFor(WRITE_FILE_COUNT, jobs, [&](size_t i) { writeFile(target / ("out" + std::to_string(i)), writeContent); });
+            }));
+            report << "write, -j " << jobs << ": " << rate(static_cast<double>(WRITE_FILE_COUNT) * WRITE_FILE_SIZE, writeSeconds.back()) << "\n";
+            std::error_code ec;
+            std::filesystem::remove_all(target, ec);
+        }
+        settings.unbundleJobs = pickThreads(counts, writeSeconds);
+
+        // Sequential reads of one large file per buffer size
+        const std::filesystem::path largeFile = scratch.path / "large.txt";
+        {
+            std::string large;
+            large.reserve(LARGE_FILE_SIZE);
+            while (large.size() < LARGE_FILE_SIZE) {
+                large.append(text, 0, std::min(text.size(), LARGE_FILE_SIZE - large.size()));
+            }
+            writeFile(largeFile, large);
+        }
+        double fastestRead = std::numeric_limits<double>::max();
+        for (size_t bufferSize : { size_t(64) << 10, size_t(256) << 10, size_t(1) << 20, size_t(4) << 20 }) {
+            std::string buffer(bufferSize, '\0');
+            double seconds = bestSeconds([&] { readFile(largeFile, buffer); });
+            report << "read, " << (bufferSize >> 10) << " KiB buffer: " << rate(LARGE_FILE_SIZE, seconds) << "\n";
+            if (seconds < fastestRead * 0.95) { // Smaller buffers win ties
+                fastestRead = seconds;
+                settings.readBufferSize = bufferSize;
+            }
+        }
+
+        // mmap against read(2): bring the file into memory and scan it, as unbundle does
+        double mapSeconds = bestSeconds([&] {
+            MappedFile mapped(largeFile, MappedFile::Access::Map);
+            scanner::findSeparatorLines(mapped.view(), SEPARATOR, false);
+        });
+        double readAllSeconds = bestSeconds([&] {
+            MappedFile loaded(largeFile, MappedFile::Access::Read);
+            scanner::findSeparatorLines(loaded.view(), SEPARATOR, false);
+        });
+        report << "load and scan, mmap: " << rate(LARGE_FILE_SIZE, mapSeconds) << "\n";
+        report << "load and scan, read: " << rate(LARGE_FILE_SIZE, readAllSeconds) << "\n";
+        settings.io = readAllSeconds < mapSeconds * 0.95 ? "read" : "mmap";
+        return settings;
+    }
+
+} // namespace tuning
+} // namespace codebundler
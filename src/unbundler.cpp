@@ -1,14 +1,164 @@
 #include "unbundler.hpp"
+#include "boundedqueue.hpp"
 #include "bundleparser.hpp"
+#include "changes.hpp"
+#include "compressedbundle.hpp"
+#include "constants.hpp"
+#include "dedupindex.hpp"
 #include "exceptions.hpp"
+#include "journal.hpp"
+#include "mappedfile.hpp"
+#include "ndjson.hpp"
+#include "scanner.hpp"
+#include "shards.hpp"
 #include "utilities.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
 #include <filesystem> // Requires C++17
 #include <fstream>
 #include <iostream> // For std::cout, std::cerr
+#include <iterator>
+#include <memory>
+#include <mutex>
 #include <sstream>
+#include <streambuf>
+#include <sys/sendfile.h>
+#include <thread>
+#include <tuple>
+#include <unistd.h>
 
 namespace codebundler {
 
+namespace {
+
+    constexpr size_t PIPELINE_QUEUE_DEPTH = 8; // Chunks or files buffered between two stages
+
+    // Presents the chunks arriving through a queue as a stream, for the parse stage
+    class QueueStreamBuf : public std::streambuf {
+    public:
+        explicit QueueStreamBuf(BoundedQueue<std::string>& queue)
+            : m_queue(queue)
+        {
+        }
+
+    protected:
+        int_type underflow() override
+        {
+            while (gptr() == egptr()) {
+                std::optional<std::string> chunk = m_queue.pop();
+                if (!chunk) {
+                    return traits_type::eof();
+                }
+                m_chunk = std::move(*chunk);
+                setg(&m_chunk[0], &m_chunk[0], &m_chunk[0] + m_chunk.size());
+            }
+            return traits_type::to_int_type(*gptr());
+        }
+
+    private:
+        BoundedQueue<std::string>& m_queue;
+        std::string m_chunk;
+    };
+
+    // Keeps the first failure of any pipeline stage
+    class FirstError {
+    public:
+        void record(std::exception_ptr error)
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (!m_error) {
+                m_error = error;
+            }
+        }
+        void rethrow()
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (m_error) {
+                std::rethrow_exception(m_error);
+            }
+        }
+
+    private:
+        std::mutex m_mutex;
+        std::exception_ptr m_error;
+    };
+
+    // Binary bundles come from other machines; keep their entries below the output directory
+    void checkEntryPath(const std::string& path)
+    {
+        std::filesystem::path entryPath(path);
+        bool unsafe = path.empty() || entryPath.is_absolute();
+        for (const auto& part : entryPath) {
+            unsafe = unsafe || part == "..";
+        }
+        if (unsafe) {
+            throw BundleFormatException("Unsafe path in bundle: " + path);
+        }
+    }
+
+    // Copies a range of one file into another inside the kernel. Returns -1 (with errno set)
+    // if neither copy_file_range nor sendfile can handle this pair of files.
+    ssize_t copyInKernel(int inFd, uint64_t offset, int outFd, size_t length)
+    {
+        loff_t inOffset = static_cast<loff_t>(offset);
+        ssize_t copied = ::copy_file_range(inFd, &inOffset, outFd, nullptr, length, 0);
+        if (copied < 0 && (errno == EXDEV || errno == ENOSYS || errno == EINVAL || errno == EOPNOTSUPP)) {
+            off_t sendOffset = static_cast<off_t>(offset);
+            copied = ::sendfile(outFd, inFd, &sendOffset, length);
+        }
+        return copied;
+    }
+
+    // Writes under a temporary name and renames it into place, so an existing file (perhaps
+    // hard-linked to another one by --dedup hardlink) is replaced rather than written through
+    void writeBlob(int inFd, uint64_t offset, std::string_view content, const std::filesystem::path& target, uint32_t mode)
+    {
+        std::filesystem::path tempPath = target;
+        tempPath += ".tmp." + std::to_string(::getpid());
+        mode_t permissions = (mode & 0777) != 0 ? static_cast<mode_t>(mode & 0777) : 0644;
+        int outFd = ::open(tempPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, permissions);
+        if (outFd < 0) {
+            throw FileIOException("Failed to open file for writing: " + std::string(std::strerror(errno)), target.string());
+        }
+
+        bool inKernel = inFd >= 0;
+        size_t written = 0;
+        while (written < content.size()) {
+            ssize_t result = inKernel
+                ? copyInKernel(inFd, offset + written, outFd, content.size() - written)
+                : ::write(outFd, content.data() + written, content.size() - written);
+            if (result < 0 && errno == EINTR) {
+                continue;
+            }
+            if (result <= 0 && inKernel) {
+                inKernel = false; // Finish from the mapping
+                continue;
+            }
+            if (result < 0) {
+                int error = errno;
+                ::close(outFd);
+                ::unlink(tempPath.c_str());
+                throw FileIOException("Failed to write file: " + std::string(std::strerror(error)), target.string());
+            }
+            written += static_cast<size_t>(result);
+        }
+
+        if (::close(outFd) != 0) {
+            int error = errno;
+            ::unlink(tempPath.c_str());
+            throw FileIOException("Failed to close file: " + std::string(std::strerror(error)), target.string());
+        }
+        if (::rename(tempPath.c_str(), target.c_str()) != 0) {
+            int error = errno;
+            ::unlink(tempPath.c_str());
+            throw FileIOException("Failed to replace file: " + std::string(std::strerror(error)), target.string());
+        }
+    }
+
+} // anonymous namespace
+
 //--------------------------------------------------------------------------
 // Constructor
 //--------------------------------------------------------------------------
@@ -28,7 +178,18 @@ void Unbundler::unbundleFromStream(std::istream& inputStream, const std::filesys
 {
     m_options.verbose > 0 && std::cerr << "Starting unbundle process..." << std::endl;
 
-    processBundle(inputStream, outputDirectory);
+    // Compressed and binary bundles both start with a non-ASCII byte, NDJSON ones with '{'
+    if (compressed::startsCompressedBundle(inputStream) || ndjson::startsNdjsonBundle(inputStream)) {
+        std::string container((std::istreambuf_iterator<char>(inputStream)), std::istreambuf_iterator<char>());
+        unbundleFromBuffer(container, outputDirectory);
+    } else {
+        checkInputFormat("v1");
+        if (m_options.jobs == 1) {
+            processBundle(inputStream, outputDirectory);
+        } else {
+            processBundlePipelined(inputStream, outputDirectory);
+        }
+    }
     m_options.verbose > 0 && std::cerr << "Unbundle process finished." << std::endl;
 }
 
@@ -37,6 +198,42 @@ void Unbundler::unbundleFromStream(std::istream& inputStream, const std::filesys
  */
 void Unbundler::unbundleFromFile(const std::string& inputFilePath, const std::filesystem::path& outputDirectory)
 {
+    // Regular files are mapped and split at separators found by the scanning kernel
+    std::unique_ptr<MappedFile> mapped;
+    try {
+        mapped = std::make_unique<MappedFile>(inputFilePath, m_options.io == "read" ? MappedFile::Access::Read : MappedFile::Access::Map);
+    } catch (const FileIOException&) {
+        // Pipes, devices and unreadable files go through the stream path (which reports errors)
+    }
+    if (mapped && shards::isManifest(mapped->view())) {
+        unbundleShards(inputFilePath, shards::readManifest(mapped->view()), outputDirectory);
+        return;
+    }
+    if (mapped && mapped->size() > 0) {
+        m_options.verbose > 0 && std::cerr << "Reading bundle from: " << inputFilePath << std::endl;
+        if (m_options.journal && !m_options.trialRun) {
+            m_journal = std::make_shared<Journal>(Journal::defaultLocation(outputDirectory, inputFilePath), mapped->view(), m_options.resume);
+            if (m_journal->finished()) {
+                m_options.verbose > 0 && std::cerr << "Already extracted according to the journal." << std::endl;
+                m_journal.reset();
+                return;
+            }
+            m_options.verbose > 0 && !m_journal->committed().empty()
+                && std::cerr << "Resuming after " << m_journal->committed().size() << " journaled entries." << std::endl;
+        }
+        m_options.verbose > 0 && std::cerr << "Starting unbundle process..." << std::endl;
+        unbundleFromBuffer(mapped->view(), outputDirectory, mapped->fd());
+        if (m_journal) {
+            m_keepJournal ? m_journal->finish() : m_journal->remove();
+            m_journal.reset();
+        }
+        m_options.verbose > 0 && std::cerr << "Unbundle process finished." << std::endl;
+        return;
+    }
+    if (m_options.journal) {
+        throw CodeBundlerException("A journal can only be kept for a bundle file, not a stream: " + inputFilePath);
+    }
+
     std::ifstream inputFileStream(inputFilePath, std::ios::binary);
     if (!inputFileStream) {
         throw FileIOException("Failed to open input bundle file for reading", inputFilePath);
@@ -45,20 +242,607 @@ void Unbundler::unbundleFromFile(const std::string& inputFilePath, const std::fi
     unbundleFromStream(inputFileStream, outputDirectory);
 }
 
+/**
+ * @brief Extracts all shards listed in a manifest, several at a time.
+ */
+void Unbundler::unbundleShards(const std::string& manifestPath, const shards::Manifest& manifest, const std::filesystem::path& outputDirectory)
+{
+    const std::filesystem::path manifestDirectory = std::filesystem::path(manifestPath).parent_path();
+    m_options.verbose > 0 && std::cerr << "Extracting " << manifest.shards.size() << " shards listed in " << manifestPath << "." << std::endl;
+
+    // Shards hold disjoint files, so each gets its own single-threaded unbundler
+    Options shardOptions = m_options;
+    shardOptions.jobs = 1;
+    std::mutex foundMutex;
+    utilities::parallelFor(manifest.shards.size(), m_options.jobs, [&](size_t i) {
+        Unbundler shard(shardOptions);
+        shard.m_keepJournal = true;
+        shard.m_requireOnlyFiles = false;
+        shard.unbundleFromFile((manifestDirectory / manifest.shards[i].path).string(), outputDirectory);
+        std::lock_guard<std::mutex> lock(foundMutex);
+        m_foundOnlyFiles.insert(shard.m_foundOnlyFiles.begin(), shard.m_foundOnlyFiles.end());
+    });
+    requireOnlyFiles({});
+    if (m_options.journal) {
+        // Only now can no shard need to resume
+        for (const auto& shard : manifest.shards) {
+            std::error_code ec;
+            std::filesystem::remove(Journal::defaultLocation(outputDirectory, shard.path), ec);
+        }
+    }
+}
+
+/**
+ * @brief Reads every entry of a bundle of any format (text, compressed or binary) into memory.
+ */
+binary::BundleContents Unbundler::readContents(const std::string& inputFilePath)
+{
+    std::string data = utilities::readFileBytes(inputFilePath);
+    binary::BundleContents contents;
+
+    // Binary and NDJSON bundles both come with an entry table
+    auto readEntries = [this, &contents](const auto& reader) {
+        contents.separator = reader.separator();
+        contents.description = reader.description();
+        requireOnlyFiles(selectedEntries(reader.entries()));
+        for (const auto& entry : reader.entries()) {
+            if (!m_options.onlyFiles.empty()
+                && std::find(m_options.onlyFiles.begin(), m_options.onlyFiles.end(), entry.path) == m_options.onlyFiles.end()) {
+                continue;
+            }
+            std::string content(reader.content(entry));
+            if (m_options.verify) {
+                std::string calculated = utilities::calculateChecksum(content, utilities::checksumType(entry.checksum), m_options.jobs);
+                if (calculated != entry.checksum) {
+                    throw ChecksumMismatchException(entry.path, entry.checksum, calculated);
+                }
+            }
+            contents.entries.push_back(binary::FileEntry { entry.path, std::move(content), entry.mode });
+        }
+    };
+    if (binary::isBinaryBundle(data)) {
+        readEntries(binary::Reader(data));
+        return contents;
+    }
+    if (ndjson::isNdjsonBundle(data)) {
+        readEntries(ndjson::Reader(data, m_options.jobs));
+        return contents;
+    }
+
+    std::string text = compressed::isCompressedBundle(data) ? compressed::readBundle(data, m_options.onlyFiles, m_options.jobs) : std::move(data);
+    std::istringstream header(text);
+    std::string line;
+    std::getline(header, line);
+    contents.separator = utilities::trim(line);
+    if (std::getline(header, line) && utilities::startsWith(line, DESCRIPTION_PREFIX)) {
+        contents.description = line.substr(DESCRIPTION_PREFIX.size());
+    }
+
+    processBuffer(text, ".", [&contents](const std::string& filename, std::string content, const std::string& /*checksum*/) {
+        contents.entries.push_back(binary::FileEntry { filename, std::move(content) });
+    });
+    return contents;
+}
+
+/**
+ * @brief Lists the paths stored in a bundle file.
+ */
+std::vector<std::string> Unbundler::listEntries(const std::string& inputFilePath)
+{
+    std::vector<std::string> paths;
+    MappedFile mapped(inputFilePath);
+    if (shards::isManifest(mapped.view())) {
+        const std::filesystem::path manifestDirectory = std::filesystem::path(inputFilePath).parent_path();
+        for (const auto& shard : shards::readManifest(mapped.view()).shards) {
+            for (auto& path : listEntries((manifestDirectory / shard.path).string())) {
+                paths.push_back(std::move(path));
+            }
+        }
+        return paths;
+    }
+    if (binary::isBinaryBundle(mapped.view()) || ndjson::isNdjsonBundle(mapped.view())) {
+        // Only the entry tables are read; content stays undecoded
+        auto entries = binary::isBinaryBundle(mapped.view()) ? binary::Reader(mapped.view()).entries() : ndjson::Reader(mapped.view(), m_options.jobs).entries();
+        for (const auto& entry : entries) {
+            paths.push_back(entry.path);
+        }
+        return paths;
+    }
+
+    Options options = m_options;
+    options.verify = false; // Listing does not need to hash content
+    Unbundler lister(options);
+    for (auto& entry : lister.readContents(inputFilePath).entries) {
+        paths.push_back(std::move(entry.path));
+    }
+    return paths;
+}
+
+/**
+ * @brief Reads the paths and checksums of a bundle's entries without verifying content.
+ */
+changes::BundleIndex Unbundler::readIndex(const std::string& inputFilePath)
+{
+    MappedFile mapped(inputFilePath);
+    changes::BundleIndex index;
+    if (shards::isManifest(mapped.view())) {
+        const std::filesystem::path manifestDirectory = std::filesystem::path(inputFilePath).parent_path();
+        for (const auto& shard : shards::readManifest(mapped.view()).shards) {
+            changes::BundleIndex shardIndex = readIndex((manifestDirectory / shard.path).string());
+            index.normalized = shardIndex.normalized;
+            std::move(shardIndex.entries.begin(), shardIndex.entries.end(), std::back_inserter(index.entries));
+        }
+        return index;
+    }
+    if (compressed::isCompressedBundle(mapped.view())) {
+        return changes::indexBuffer(compressed::readBundle(mapped.view(), {}, m_options.jobs));
+    }
+    return changes::indexBuffer(mapped.view());
+}
+
+/**
+ * @brief Passes the entries of a bundle file to a sink instead of writing them to files.
+ */
+std::string Unbundler::exportFromFile(const std::string& inputFilePath, const FileSink& sink)
+{
+    std::unique_ptr<MappedFile> mapped;
+    try {
+        mapped = std::make_unique<MappedFile>(inputFilePath);
+    } catch (const FileIOException&) {
+        // Not mappable; read it like a stream
+    }
+    if (mapped && mapped->size() > 0) {
+        return exportFromBuffer(mapped->view(), sink);
+    }
+
+    std::ifstream inputFileStream(inputFilePath, std::ios::binary);
+    if (!inputFileStream) {
+        throw FileIOException("Failed to open input bundle file for reading", inputFilePath);
+    }
+    return exportFromStream(inputFileStream, sink);
+}
+
+/**
+ * @brief Passes the entries of a bundle read from a stream to a sink.
+ */
+std::string Unbundler::exportFromStream(std::istream& inputStream, const FileSink& sink)
+{
+    if (compressed::startsCompressedBundle(inputStream) || ndjson::startsNdjsonBundle(inputStream)) {
+        std::string container((std::istreambuf_iterator<char>(inputStream)), std::istreambuf_iterator<char>());
+        return exportFromBuffer(container, sink);
+    }
+
+    checkInputFormat("v1");
+    std::string description;
+    processBundle(inputStream, ".", [&sink](const std::string& filename, std::string content, const std::string& /*checksum*/) {
+        checkEntryPath(filename);
+        sink(filename, content, 0644);
+    }, &description);
+    return description;
+}
+
+//--------------------------------------------------------------------------
+// Private Methods
+//--------------------------------------------------------------------------
+
+/**
+ * @brief Unbundles a bundle held entirely in memory, plain, compressed or binary.
+ */
+void Unbundler::unbundleFromBuffer(std::string_view data, const std::filesystem::path& outputDirectory, int fd)
+{
+    checkInputFormat(binary::isBinaryBundle(data) ? "v2" : ndjson::isNdjsonBundle(data) ? "ndjson" : "v1");
+    if (binary::isBinaryBundle(data)) {
+        m_options.verbose > 0 && std::cerr << "Detected binary bundle." << std::endl;
+        extractEntries(binary::Reader(data), fd, outputDirectory);
+    } else if (ndjson::isNdjsonBundle(data)) {
+        m_options.verbose > 0 && std::cerr << "Detected NDJSON bundle." << std::endl;
+        extractEntries(ndjson::Reader(data, m_options.jobs), -1, outputDirectory);
+    } else if (compressed::isCompressedBundle(data)) {
+        m_options.verbose > 0 && std::cerr << "Detected compressed bundle." << std::endl;
+        std::string text = compressed::readBundle(data, m_options.onlyFiles, m_options.jobs);
+        processBuffer(text, outputDirectory);
+    } else {
+        processBuffer(data, outputDirectory);
+    }
+}
+
+/**
+ * @brief Checks a bundle against the required input format, if one was given.
+ */
+void Unbundler::checkInputFormat(const std::string& detected) const
+{
+    if (!m_options.inputFormat.empty() && m_options.inputFormat != detected) {
+        throw BundleFormatException("Expected a bundle of format " + m_options.inputFormat + ", but the input has format " + detected + ".");
+    }
+}
+
+/**
+ * @brief Records the entries selected with --only that a bundle holds, and requires all of them.
+ */
+void Unbundler::requireOnlyFiles(const std::set<std::string>& found)
+{
+    m_foundOnlyFiles.insert(found.begin(), found.end());
+    if (!m_requireOnlyFiles) {
+        return;
+    }
+    std::string missing;
+    for (const auto& path : m_options.onlyFiles) {
+        if (!m_foundOnlyFiles.count(path)) {
+            missing += (missing.empty() ? "" : ", ") + path;
+        }
+    }
+    if (!missing.empty()) {
+        throw BundleFormatException("No entry for --only " + missing + " in the bundle.");
+    }
+}
+
+/**
+ * @brief Returns the entries of an entry table that were selected with --only.
+ */
+std::set<std::string> Unbundler::selectedEntries(const std::vector<binary::Entry>& entries) const
+{
+    std::set<std::string> selected;
+    for (const auto& entry : entries) {
+        if (std::find(m_options.onlyFiles.begin(), m_options.onlyFiles.end(), entry.path) != m_options.onlyFiles.end()) {
+            selected.insert(entry.path);
+        }
+    }
+    return selected;
+}
+
+/**
+ * @brief Extracts the entries of a binary or NDJSON bundle, verifying and writing them in parallel.
+ */
+template <typename EntryReader>
+void Unbundler::extractEntries(const EntryReader& reader, int fd, const std::filesystem::path& outputDirectory)
+{
+    // Entries are extracted out of order, so a resumed run skips every journaled ordinal
+    std::vector<bool> journaled(reader.entries().size(), false);
+    if (m_journal) {
+        for (const auto& record : m_journal->committed()) {
+            if (record.ordinal >= journaled.size() || reader.entries()[record.ordinal].offset != record.offset) {
+                throw BundleFormatException("The journal does not match the bundle at entry " + std::to_string(record.ordinal) + ".");
+            }
+            journaled[record.ordinal] = true;
+        }
+    }
+    requireOnlyFiles(selectedEntries(reader.entries()));
+    std::vector<const binary::Entry*> selected;
+    for (const auto& entry : reader.entries()) {
+        if ((m_options.onlyFiles.empty()
+                || std::find(m_options.onlyFiles.begin(), m_options.onlyFiles.end(), entry.path) != m_options.onlyFiles.end())
+            && !journaled[&entry - reader.entries().data()]) {
+            checkEntryPath(entry.path);
+            selected.push_back(&entry);
+        }
+    }
+    m_options.verbose > 0 && std::cerr << "Extracting " << selected.size() << " of " << reader.entries().size() << " entries"
+                                       << (fd >= 0 ? " (in-kernel copy)." : ".") << std::endl;
+
+    DedupIndex dedup(m_options.dedup, m_options.verbose);
+    utilities::parallelFor(selected.size(), m_options.jobs, [&](size_t i) {
+        const binary::Entry& entry = *selected[i];
+        auto content = reader.content(entry); // A view into a binary bundle, decoded text for NDJSON
+        if (m_options.verify) {
+            std::string calculated = utilities::calculateChecksum(content, utilities::checksumType(entry.checksum), m_options.jobs);
+            if (calculated != entry.checksum) {
+                throw ChecksumMismatchException(entry.path, entry.checksum, calculated);
+            }
+        }
+        if (m_options.trialRun) {
+            return;
+        }
+        std::filesystem::path target = outputDirectory / entry.path;
+        m_options.verbose > 1 && std::cerr << "  Writing " << target << std::endl;
+        if (target.has_parent_path()) {
+            std::filesystem::create_directories(target.parent_path());
+        }
+        // Unverified blobs might not match their recorded checksum, so only verified ones are shared
+        std::string checksum = m_options.verify ? entry.checksum : std::string();
+        if (!dedup.materialize(checksum, target, entry.mode)) {
+            writeBlob(fd, entry.offset, content, target, entry.mode);
+            dedup.remember(checksum, target, entry.mode);
+        }
+        if (m_journal) {
+            m_journal->commit({ static_cast<std::uint64_t>(selected[i] - reader.entries().data()), entry.offset, entry.checksum, entry.path });
+        }
+    });
+    dedup.enabled() && m_options.verbose > 0 && std::cerr << "Linked " << dedup.linkedCount() << " duplicate files." << std::endl;
+}
+
+/**
+ * @brief Passes the entries of a bundle held in memory to a sink.
+ */
+std::string Unbundler::exportFromBuffer(std::string_view data, const FileSink& sink)
+{
+    checkInputFormat(binary::isBinaryBundle(data) ? "v2" : ndjson::isNdjsonBundle(data) ? "ndjson" : "v1");
+    auto exportEntries = [this, &sink](const auto& reader) {
+        requireOnlyFiles(selectedEntries(reader.entries()));
+        for (const auto& entry : reader.entries()) {
+            if (!m_options.onlyFiles.empty()
+                && std::find(m_options.onlyFiles.begin(), m_options.onlyFiles.end(), entry.path) == m_options.onlyFiles.end()) {
+                continue;
+            }
+            checkEntryPath(entry.path);
+            auto content = reader.content(entry);
+            if (m_options.verify) {
+                std::string calculated = utilities::calculateChecksum(content, utilities::checksumType(entry.checksum), m_options.jobs);
+                if (calculated != entry.checksum) {
+                    throw ChecksumMismatchException(entry.path, entry.checksum, calculated);
+                }
+            }
+            sink(entry.path, content, entry.mode);
+        }
+        return reader.description();
+    };
+    if (binary::isBinaryBundle(data)) {
+        return exportEntries(binary::Reader(data));
+    }
+    if (ndjson::isNdjsonBundle(data)) {
+        return exportEntries(ndjson::Reader(data, m_options.jobs));
+    }
+
+    std::string decompressed;
+    if (compressed::isCompressedBundle(data)) {
+        decompressed = compressed::readBundle(data, m_options.onlyFiles, m_options.jobs);
+        data = decompressed;
+    }
+
+    // --only selections are applied by the parser
+    std::string description;
+    processBuffer(data, ".", [&sink](const std::string& filename, std::string content, const std::string& /*checksum*/) {
+        checkEntryPath(filename);
+        sink(filename, content, 0644);
+    }, &description);
+    return description;
+}
+
+/**
+ * @brief Parses an in-memory bundle, splitting entries at separator lines found by the scanner.
+ */
+void Unbundler::processBuffer(std::string_view data, const std::filesystem::path& outputDirectory, const EntryHandler& entryHandler, std::string* description)
+{
+    // Returns the line starting at pos (without its newline) and the position after it
+    auto lineAt = [&data](size_t pos) {
+        size_t end = data.find('\n', pos);
+        size_t next = end == std::string_view::npos ? data.size() : end + 1;
+        end = end == std::string_view::npos ? data.size() : end;
+        return std::make_pair(std::string(data.substr(pos, end - pos)), next);
+    };
+
+    auto [firstLine, pos] = lineAt(0);
+    std::string separator = utilities::trim(firstLine);
+    if (separator.empty()) {
+        // Without a usable separator there is nothing to scan for; parse line by line
+        std::istringstream stream { std::string(data) };
+        processBundle(stream, outputDirectory, entryHandler, description);
+        return;
+    }
+
+    std::vector<size_t> separators = scanner::findSeparatorLines(data, separator, false);
+    m_options.verbose > 0 && std::cerr << "Found " << separators.size() << " separator lines (" << scanner::kernelName(scanner::Kernel::Auto) << " scan)." << std::endl;
+    auto nextSeparator = [&separators, &data](size_t from) {
+        auto it = std::lower_bound(separators.begin(), separators.end(), from);
+        return it == separators.end() ? data.size() : *it;
+    };
+
+    BundleParser parser(m_options, utilities::calculateSHA256, outputDirectory);
+    parser.setEntryHandler(entryHandler);
+    bool done = parser.parse(std::make_optional(firstLine));
+
+    // Journaled entries are numbered in bundle order and recorded with the offset their content ends at
+    std::uint64_t nextOrdinal = 0;
+    std::uint64_t entryOrdinal = 0;
+    size_t entryEnd = 0;
+    if (m_journal && !entryHandler) {
+        if (!m_journal->committed().empty()) {
+            // Text entries are parsed in order, so the last record is where the previous run stopped
+            const Journal::Record& last = m_journal->committed().back();
+            if (last.offset > data.size() || (last.offset < data.size() && !std::binary_search(separators.begin(), separators.end(), last.offset))) {
+                throw BundleFormatException("The journal does not match the bundle: no separator at offset " + std::to_string(last.offset) + ".");
+            }
+            // The header comment declares the entry headers, so the parser reads it before skipping ahead
+            if (separators.size() > 1 && data.substr(pos, FILENAME_PREFIX.size()) != FILENAME_PREFIX) {
+                while (pos <= separators[1] && !done) {
+                    std::string line;
+                    std::tie(line, pos) = lineAt(pos);
+                    done = parser.parse(std::make_optional(line));
+                }
+            }
+            // The parser expects the entry after the journaled one's separator
+            pos = last.offset == data.size() ? data.size() : lineAt(last.offset).second;
+            nextOrdinal = last.ordinal + 1;
+            m_options.verbose > 0 && std::cerr << "Resuming at byte " << pos << " (entry " << nextOrdinal << ")." << std::endl;
+            if (pos == data.size()) {
+                return;
+            }
+        }
+        parser.setSavedHandler([this, &entryOrdinal, &entryEnd](const std::string& filename, const std::string& checksum) {
+            m_journal->commit({ entryOrdinal, entryEnd, checksum, filename });
+        });
+    }
+
+    while (pos < data.size() && !done) {
+        size_t segmentEnd = nextSeparator(pos);
+
+        if (data.substr(pos, FILENAME_PREFIX.size()) == FILENAME_PREFIX) {
+            // Entry: feed the header lines, then the content as one block
+            entryOrdinal = nextOrdinal++;
+            std::string line;
+            std::tie(line, pos) = lineAt(pos);
+            done = parser.parse(std::make_optional(line));
+            for (const std::string* prefix : { &CHECKSUM_PREFIX, &TOKENS_PREFIX, &LENGTH_PREFIX }) {
+                if ((prefix == &LENGTH_PREFIX && !parser.lengthHeaders()) || (prefix == &TOKENS_PREFIX && !parser.tokenHeaders())) {
+                    continue; // Undeclared, so such a line is the first line of the content
+                }
+                if (pos < segmentEnd && data.substr(pos, prefix->size()) == *prefix) {
+                    std::tie(line, pos) = lineAt(pos);
+                    done = parser.parse(std::make_optional(line));
+                }
+            }
+            if (auto length = parser.pendingBlockLength()) {
+                // Length-prefixed content may itself contain separator lines
+                size_t available = std::min(*length, data.size() - pos);
+                segmentEnd = nextSeparator(pos + available);
+                entryEnd = segmentEnd;
+                done = parser.parse(std::make_optional(std::string(data.substr(pos, available))));
+                pos += available;
+            }
+            entryEnd = segmentEnd;
+            if (pos < segmentEnd) {
+                std::string content(data.substr(pos, segmentEnd - pos));
+                if (content.back() != '\n') {
+                    content += '\n'; // Unterminated last line at end of bundle
+                }
+                done = parser.parseBlock(content);
+                pos = segmentEnd;
+            }
+        } else {
+            // Comments and anything unexpected go through the parser line by line
+            while (pos < segmentEnd && !done) {
+                std::string line;
+                std::tie(line, pos) = lineAt(pos);
+                done = parser.parse(std::make_optional(line));
+            }
+        }
+
+        if (pos < data.size() && !done) {
+            std::string line;
+            std::tie(line, pos) = lineAt(pos); // The separator line
+            done = parser.parse(std::make_optional(line));
+        }
+    }
+
+    if (!done) {
+        done = parser.parse(std::nullopt);
+    }
+    if (description) {
+        *description = parser.description();
+    }
+    if (!done) {
+        throw BundleFormatException("Parsing failed; the bundle ends in the middle of an entry.");
+    }
+    m_options.verbose > 0 && std::cerr << "Parsing completed successfully!" << std::endl;
+    requireOnlyFiles(parser.selectedFiles());
+}
+
+/**
+ * @brief Unbundles a text bundle from a stream with reading, parsing/hashing and writing on separate threads.
+ */
+void Unbundler::processBundlePipelined(std::istream& inputStream, const std::filesystem::path& outputDirectory)
+{
+    BoundedQueue<std::string> chunks(PIPELINE_QUEUE_DEPTH);
+    struct VerifiedFile {
+        std::filesystem::path path;
+        std::string content;
+        std::string checksum;
+    };
+    BoundedQueue<VerifiedFile> files(PIPELINE_QUEUE_DEPTH);
+    DedupIndex dedup(m_options.dedup, m_options.verbose);
+    FirstError error;
+
+    // Stage 1: large reads from the input
+    std::thread reader([&]() {
+        try {
+            std::streambuf* source = inputStream.rdbuf();
+            while (true) {
+                std::string chunk(m_options.readBufferSize, '\0');
+                std::streamsize got = source->sgetn(&chunk[0], static_cast<std::streamsize>(chunk.size()));
+                if (got <= 0) {
+                    break;
+                }
+                chunk.resize(static_cast<size_t>(got));
+                if (!chunks.push(std::move(chunk))) {
+                    break; // The parse stage gave up
+                }
+            }
+        } catch (...) {
+            error.record(std::current_exception());
+        }
+        chunks.close();
+    });
+
+    // Stage 3: entries are written to a temporary file and renamed into place,
+    // and only after the parse stage verified their checksum
+    std::thread writer([&]() {
+        try {
+            while (auto file = files.pop()) {
+                m_options.verbose > 1 && std::cerr << "  Writing " << file->path << std::endl;
+                if (file->path.has_parent_path()) {
+                    std::filesystem::create_directories(file->path.parent_path());
+                }
+                if (!dedup.materialize(file->checksum, file->path)) {
+                    utilities::replaceFileAtomically(file->path, file->content);
+                    dedup.remember(file->checksum, file->path);
+                }
+            }
+        } catch (...) {
+            error.record(std::current_exception());
+            files.close();
+        }
+    });
+
+    // Stage 2 (this thread): split into entries and verify checksums
+    try {
+        QueueStreamBuf buffer(chunks);
+        std::istream chunkStream(&buffer);
+        processBundle(chunkStream, outputDirectory, [&](const std::string& filename, std::string content, const std::string& checksum) {
+            if (m_options.trialRun) {
+                return;
+            }
+            if (!files.push({ outputDirectory / filename, std::move(content), checksum })) {
+                throw FileIOException("Writer stopped, not extracting", filename);
+            }
+        });
+    } catch (...) {
+        error.record(std::current_exception());
+    }
+
+    chunks.close();
+    files.close();
+    reader.join();
+    writer.join();
+    error.rethrow();
+    dedup.enabled() && m_options.verbose > 0 && std::cerr << "Linked " << dedup.linkedCount() << " duplicate files." << std::endl;
+}
+
+/**
+ * @brief Reads up to length bytes; growing in steps so a corrupt length cannot exhaust memory.
+ */
+std::string Unbundler::readBlock(std::istream& inputStream, size_t length)
+{
+    const size_t step = 1 << 20;
+    std::string block;
+    block.reserve(std::min(length, step));
+    while (block.size() < length && inputStream) {
+        size_t offset = block.size();
+        block.resize(offset + std::min(length - offset, step));
+        inputStream.read(&block[offset], static_cast<std::streamsize>(block.size() - offset));
+        block.resize(offset + static_cast<size_t>(inputStream.gcount()));
+    }
+    return block;
+}
+
 /**
  * @brief Internal parsing and extraction/verification logic. Separator is detected from the stream.
  */
-bool Unbundler::processBundle(std::istream& inputStream, const std::filesystem::path& outputDirectory)
+void Unbundler::processBundle(std::istream& inputStream, const std::filesystem::path& outputDirectory, const EntryHandler& entryHandler, std::string* description)
 {
     int verbose = 5;
     BundleParser::Hasher hasher = utilities::calculateSHA256;
     BundleParser parser(m_options, hasher, outputDirectory);
+    parser.setEntryHandler(entryHandler);
     std::string line;
     bool done = false;
 
     while (std::getline(inputStream, line)) {
         m_options.verbose > 3 && std::cerr << line << std::endl;
         done = parser.parse(std::make_optional(line));
+
+        // After a "Length:" header, read the whole content in one piece
+        if (auto length = parser.pendingBlockLength()) {
+            done = parser.parse(std::make_optional(readBlock(inputStream, *length)));
+        }
     }
 
     if (done) {
@@ -70,15 +854,15 @@ bool Unbundler::processBundle(std::istream& inputStream, const std::filesystem::
         // signal EOF
         done = parser.parse(std::nullopt);
     }
+    if (description) {
+        *description = parser.description();
+    }
 
     if (!done) {
-        std::cerr << "Error: Parsing failed!" << std::endl;
-        return 1;
-    } else {
-        m_options.verbose > 0 && std::cerr << "Parsing completed successfully!" << std::endl;
+        throw BundleFormatException("Parsing failed; the bundle ends in the middle of an entry.");
     }
-
-    return true; // If we reached here without throwing, verification passed or wasn't applicable
+    m_options.verbose > 0 && std::cerr << "Parsing completed successfully!" << std::endl;
+    requireOnlyFiles(parser.selectedFiles());
 }
 
 } // namespace codebundler
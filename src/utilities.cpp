@@ -1,13 +1,21 @@
 #include "utilities.hpp"
+#include "constants.hpp"
 #include "exceptions.hpp"
+#include "scanner.hpp"
+#include <algorithm>
 #include <array> // For buffer in executeCommand
+#include <atomic>
 #include <cstdio> // For popen, pclose
 #include <fstream>
 #include <iostream> // For cerr
 #include <memory> // For unique_ptr with custom deleter
+#include <mutex>
+#include <set>
 #include <picosha2.h> // Include PicoSHA2 header
 #include <sstream>
 #include <system_error> // For filesystem errors
+#include <thread>
+#include <unistd.h> // For getpid
 
 namespace codebundler {
 namespace utilities {
@@ -55,6 +63,22 @@ namespace utilities {
         std::vector<std::string> lines = readFileLines(filepath);
         return linesToString(lines);
     }
+
+    /**
+     * @brief Reads a file byte for byte, without any line normalization.
+     */
+    std::string readFileBytes(const std::filesystem::path& filepath)
+    {
+        std::ifstream fileStream(filepath, std::ios::binary);
+        if (!fileStream) {
+            throw FileIOException("Failed to open file for reading", filepath.string());
+        }
+        std::string content((std::istreambuf_iterator<char>(fileStream)), std::istreambuf_iterator<char>());
+        if (fileStream.bad()) {
+            throw FileIOException("Failed during reading from file", filepath.string());
+        }
+        return content;
+    }
     /**
      * @brief Checks if a file contains a specific delimiter.
      * @param lines The lines of the file as a vector of strings.
@@ -71,6 +95,17 @@ namespace utilities {
         return false; // Delimiter not found
     }
 
+    /**
+     * @brief Checks if newline-terminated content contains a line starting with a delimiter.
+     * @param content The content to scan (as produced by linesToString).
+     * @param delimiter The delimiter to check for.
+     * @return true if some line of the content starts with the delimiter, false otherwise.
+     */
+    bool contentContainsDelimiter(const std::string& content, const std::string& delimiter)
+    {
+        return scanner::containsSeparatorLine(content, delimiter);
+    }
+
     /**
      * @brief Converts a vector of strings to a single string, joining them with newlines.
      * @param lines The vector of strings to convert.
@@ -118,6 +153,32 @@ namespace utilities {
         // ofstream destructor handles closing
     }
 
+    /**
+     * @brief Replaces a file's content atomically, so readers see either the old or the new file.
+     * Writes to a temporary file in the same directory and renames it over the target.
+     * @param filepath The path to the file to replace.
+     * @param content The string content to write.
+     * @throws FileIOException If the temporary file cannot be written or renamed.
+     */
+    void replaceFileAtomically(const std::filesystem::path& filepath, const std::string& content)
+    {
+        std::filesystem::path tempPath = filepath;
+        tempPath += ".tmp." + std::to_string(::getpid());
+        std::error_code ec;
+        try {
+            writeFileContent(tempPath, content);
+        } catch (...) {
+            std::filesystem::remove(tempPath, ec);
+            throw;
+        }
+
+        std::filesystem::rename(tempPath, filepath, ec);
+        if (ec) {
+            std::filesystem::remove(tempPath, ec);
+            throw FileIOException("Failed to replace file", filepath.string());
+        }
+    }
+
     /**
      * @brief Executes a shell command and captures its standard output.
      * Uses popen/pclose for process management.
@@ -178,7 +239,23 @@ namespace utilities {
      */
     std::vector<std::string> getGitTrackedFiles()
     {
-        const std::string command = "git ls-files";
+        return getGitTrackedFiles(".");
+    }
+
+    /**
+     * @brief Retrieves the files tracked by the Git repository at a given directory.
+     * @param repository The directory to run `git ls-files` in.
+     * @param recurseSubmodules True to list the files of checked out submodules too, instead of the submodules themselves.
+     * @return A vector of tracked file paths relative to the given directory.
+     * @throws GitCommandException If the `git ls-files` command fails or returns a non-zero exit code.
+     * @throws std::runtime_error If the Git command cannot be executed.
+     */
+    std::vector<std::string> getGitTrackedFiles(const std::filesystem::path& repository, bool recurseSubmodules)
+    {
+        std::string command = repository == "." ? "git ls-files" : "git -C " + shellQuote(repository.string()) + " ls-files";
+        if (recurseSubmodules) {
+            command += " --recurse-submodules";
+        }
         auto [exit_code, output] = executeCommand(command);
 
         if (exit_code != 0) {
@@ -198,14 +275,130 @@ namespace utilities {
         return files;
     }
 
+    /**
+     * @brief Reads a list of repository directories, one per line ('#' starts a comment line).
+     * @param listFile The file; directories in it are relative to the file's own directory.
+     * @return The normalized directories, in file order ("." for the list file's directory itself).
+     * @throws FileIOException If the file cannot be read.
+     * @throws CodeBundlerException If a directory is absolute, leaves the list file's directory or is repeated.
+     */
+    std::vector<std::string> readRepositoryList(const std::filesystem::path& listFile)
+    {
+        std::ifstream input(listFile);
+        if (!input) {
+            throw FileIOException("Failed to open repository list", listFile.string());
+        }
+        std::vector<std::string> repositories;
+        std::set<std::string> seen;
+        std::string line;
+        while (std::getline(input, line)) {
+            line = trim(line);
+            if (line.empty() || line[0] == '#') {
+                continue;
+            }
+            std::filesystem::path directory = std::filesystem::path(line).lexically_normal();
+            std::string normalized = directory.generic_string();
+            while (normalized.size() > 1 && normalized.back() == '/') {
+                normalized.pop_back();
+            }
+            if (directory.is_absolute() || normalized == ".." || normalized.rfind("../", 0) == 0) {
+                // Entry paths are the directories as listed, so they must stay below the list file
+                throw CodeBundlerException("Repository '" + line + "' in " + listFile.string() + " must be a directory below the list file's directory.");
+            }
+            if (!seen.insert(normalized).second) {
+                throw CodeBundlerException("Repository '" + line + "' is listed twice in " + listFile.string() + ".");
+            }
+            repositories.push_back(normalized);
+        }
+        return repositories;
+    }
+
+    /**
+     * @brief Quotes a string for safe use as a single POSIX shell word.
+     * Wraps the word in single quotes and escapes embedded single quotes.
+     * @param word The string to quote.
+     * @return The quoted string.
+     */
+    std::string shellQuote(const std::string& word)
+    {
+        std::string quoted = "'";
+        for (char c : word) {
+            if (c == '\'') {
+                quoted += "'\\''";
+            } else {
+                quoted += c;
+            }
+        }
+        quoted += "'";
+        return quoted;
+    }
+
     /**
      * @brief Calculates the SHA-256 hash of a string.
      * @param content The string content to hash.
      * @return The SHA-256 hash represented as a hexadecimal string.
      */
-    std::string calculateSHA256(const std::string& content)
+    std::string calculateSHA256(std::string_view content)
+    {
+        return picosha2::hash256_hex_string(content.begin(), content.end());
+    }
+
+    /**
+     * @brief Calculates a SHA-256 tree hash, hashing the leaves in parallel.
+     */
+    std::string calculateTreeSHA256(std::string_view content, int jobs)
+    {
+        using Digest = std::array<unsigned char, picosha2::k_digest_size>;
+        auto hashNode = [](unsigned char domain, std::string_view first, std::string_view second) {
+            picosha2::hash256_one_by_one hasher;
+            hasher.process(&domain, &domain + 1);
+            hasher.process(first.begin(), first.end());
+            hasher.process(second.begin(), second.end());
+            hasher.finish();
+            Digest digest;
+            hasher.get_hash_bytes(digest.begin(), digest.end());
+            return digest;
+        };
+        auto view = [](const Digest& digest) {
+            return std::string_view(reinterpret_cast<const char*>(digest.data()), digest.size());
+        };
+
+        size_t leafCount = content.empty() ? 1 : (content.size() + TREE_CHUNK_SIZE - 1) / TREE_CHUNK_SIZE;
+        std::vector<Digest> level(leafCount);
+        parallelFor(leafCount, jobs, [&](size_t i) {
+            level[i] = hashNode(0x00, content.substr(std::min(content.size(), i * TREE_CHUNK_SIZE), TREE_CHUNK_SIZE), {});
+        });
+
+        while (level.size() > 1) {
+            std::vector<Digest> parents((level.size() + 1) / 2);
+            for (size_t i = 0; i < parents.size(); ++i) {
+                parents[i] = 2 * i + 1 < level.size() ? hashNode(0x01, view(level[2 * i]), view(level[2 * i + 1])) : level[2 * i];
+            }
+            level = std::move(parents);
+        }
+        return picosha2::bytes_to_hex_string(level[0].begin(), level[0].end());
+    }
+
+    /**
+     * @brief Returns the type of a checksum as written on a "Checksum:" line.
+     */
+    std::string checksumType(const std::string& checksum)
     {
-        return picosha2::hash256_hex_string(content);
+        return startsWith(checksum, TREE_CHECKSUM_TAG) ? "sha256-tree" : "sha256";
+    }
+
+    /**
+     * @brief Calculates a checksum in the form written on a "Checksum:" line.
+     */
+    std::string calculateChecksum(std::string_view content, const std::string& type, int jobs)
+    {
+        if (type == "sha256") {
+            return calculateSHA256(content);
+        }
+        if (type == "sha256-tree") {
+            return TREE_CHECKSUM_TAG + calculateTreeSHA256(content, jobs);
+        }
+        throw CodeBundlerException("Unknown checksum type: " + type);
     }
 
     /**
@@ -235,5 +428,93 @@ namespace utilities {
         return str.rfind(prefix, 0) == 0;
     }
 
+    /**
+     * @brief Checks whether a header comment line declares an optional entry header.
+     * Header names are the prefixes without ": ", separated by spaces.
+     */
+    bool declaresEntryHeader(std::string_view line, const std::string& prefix)
+    {
+        if (line.substr(0, ENTRY_HEADERS_PREFIX.size()) != ENTRY_HEADERS_PREFIX) {
+            return false;
+        }
+        const std::string_view name = std::string_view(prefix).substr(0, prefix.find(':'));
+        std::istringstream names { std::string(line.substr(ENTRY_HEADERS_PREFIX.size())) };
+        std::string declared;
+        while (names >> declared) {
+            if (declared == name) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /**
+     * @brief Resolves a requested worker count, mapping 0 to the number of hardware threads.
+     * @param jobs The requested number of workers.
+     * @return The number of workers to use (at least 1).
+     */
+    unsigned resolveJobs(int jobs)
+    {
+        if (jobs > 0) {
+            return static_cast<unsigned>(jobs);
+        }
+        unsigned hardware = std::thread::hardware_concurrency();
+        return hardware > 0 ? hardware : 1;
+    }
+
+    namespace {
+        // Set while a thread works for a parallelFor pool; nested calls then run inline
+        thread_local bool t_onPoolWorker = false;
+    }
+
+    /**
+     * @brief Runs a task for every index in [0, count) on a pool of worker threads.
+     * @param count The number of indices.
+     * @param jobs The number of workers (0 - one per hardware thread).
+     * @param task The task to run for each index.
+     */
+    void parallelFor(size_t count, int jobs, const std::function<void(size_t)>& task)
+    {
+        size_t workers = std::min<size_t>(resolveJobs(jobs), count);
+        if (workers <= 1 || t_onPoolWorker) {
+            for (size_t i = 0; i < count; ++i) {
+                task(i);
+            }
+            return;
+        }
+
+        std::atomic<size_t> next { 0 };
+        std::exception_ptr firstError;
+        std::mutex errorMutex;
+        auto worker = [&]() {
+            t_onPoolWorker = true;
+            size_t i;
+            while ((i = next.fetch_add(1)) < count) {
+                try {
+                    task(i);
+                } catch (...) {
+                    std::lock_guard<std::mutex> lock(errorMutex);
+                    if (!firstError) {
+                        firstError = std::current_exception();
+                    }
+                    next = count; // Stop handing out work
+                }
+            }
+            t_onPoolWorker = false;
+        };
+
+        std::vector<std::thread> threads;
+        for (size_t t = 1; t < workers; ++t) {
+            threads.emplace_back(worker);
+        }
+        worker(); // The calling thread works too
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        if (firstError) {
+            std::rethrow_exception(firstError);
+        }
+    }
+
 } // namespace utilities
 } // namespace codebundler
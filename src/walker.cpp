@@ -0,0 +1,227 @@
+#include "walker.hpp"
+#include "exceptions.hpp"
+#include "pathmatcher.hpp"
+#include "utilities.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <dirent.h>
+#include <exception>
+#include <fcntl.h>
+#include <memory>
+#include <mutex>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <thread>
+#include <unistd.h>
+
+namespace codebundler {
+namespace walker {
+
+    namespace {
+
+        constexpr size_t DIRENT_BUFFER_SIZE = 1 << 16;
+        const char* const IGNORE_FILES[] = { ".gitignore", ".ignore" };
+
+        // Layout of the records returned by getdents64 (not exported by glibc headers)
+        struct LinuxDirent64 {
+            ino64_t d_ino;
+            off64_t d_off;
+            unsigned short d_reclen;
+            unsigned char d_type;
+            char d_name[];
+        };
+
+        // The ignore rules of one directory, chained to those of its parents
+        struct Scope {
+            std::shared_ptr<const Scope> parent;
+            std::string base; // Directory of the ignore files, relative to the root, with a trailing '/'
+            IgnoreRules rules;
+        };
+
+        struct Directory {
+            std::string path; // Relative to the root, empty or with a trailing '/'
+            std::shared_ptr<const Scope> scope;
+        };
+
+        bool isIgnored(const Scope* scope, const std::string& path, bool isDirectory)
+        {
+            for (; scope; scope = scope->parent.get()) {
+                IgnoreRules::Match match = scope->rules.match(std::string_view(path).substr(scope->base.size()), isDirectory);
+                if (match != IgnoreRules::Match::None) {
+                    return match == IgnoreRules::Match::Ignored;
+                }
+            }
+            return false;
+        }
+
+        std::string readSmallFile(int directoryFd, const char* name)
+        {
+            int fd = ::openat(directoryFd, name, O_RDONLY | O_CLOEXEC);
+            if (fd < 0) {
+                return {};
+            }
+            std::string content;
+            char buffer[8192];
+            ssize_t got;
+            while ((got = ::read(fd, buffer, sizeof(buffer))) > 0 || (got < 0 && errno == EINTR)) {
+                content.append(buffer, static_cast<size_t>(std::max<ssize_t>(got, 0)));
+            }
+            ::close(fd);
+            return content;
+        }
+
+        class Walk {
+        public:
+            explicit Walk(std::filesystem::path root)
+                : m_root(std::move(root))
+            {
+            }
+
+            std::vector<std::string> run(int jobs)
+            {
+                m_pending.push_back(Directory { "", nullptr });
+                m_active = 1;
+                std::vector<std::thread> workers;
+                for (unsigned i = 0; i < utilities::resolveJobs(jobs); ++i) {
+                    workers.emplace_back([this] { work(); });
+                }
+                for (auto& worker : workers) {
+                    worker.join();
+                }
+                if (m_error) {
+                    std::rethrow_exception(m_error);
+                }
+                std::sort(m_files.begin(), m_files.end());
+                return std::move(m_files);
+            }
+
+        private:
+            std::filesystem::path m_root;
+            std::mutex m_mutex;
+            std::condition_variable m_changed;
+            std::deque<Directory> m_pending;
+            size_t m_active = 0; // Directories queued or being read
+            std::vector<std::string> m_files;
+            std::exception_ptr m_error;
+
+            void work()
+            {
+                std::vector<std::string> files;
+                std::vector<Directory> found;
+                while (true) {
+                    Directory directory;
+                    {
+                        std::unique_lock<std::mutex> lock(m_mutex);
+                        m_changed.wait(lock, [this] { return !m_pending.empty() || m_active == 0; });
+                        if (m_pending.empty()) {
+                            break;
+                        }
+                        directory = std::move(m_pending.front());
+                        m_pending.pop_front();
+                    }
+
+                    found.clear();
+                    try {
+                        readDirectory(directory, files, found);
+                    } catch (...) {
+                        std::lock_guard<std::mutex> lock(m_mutex);
+                        if (!m_error) {
+                            m_error = std::current_exception();
+                        }
+                        found.clear();
+                    }
+
+                    std::lock_guard<std::mutex> lock(m_mutex);
+                    for (auto& subdirectory : found) {
+                        m_pending.push_back(std::move(subdirectory));
+                    }
+                    m_active += found.size();
+                    --m_active;
+                    m_changed.notify_all();
+                }
+
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_files.insert(m_files.end(), std::make_move_iterator(files.begin()), std::make_move_iterator(files.end()));
+            }
+
+            void readDirectory(const Directory& directory, std::vector<std::string>& files, std::vector<Directory>& found)
+            {
+                const std::filesystem::path fullPath = directory.path.empty() ? m_root : m_root / directory.path;
+                int fd = ::open(fullPath.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+                if (fd < 0) {
+                    if (directory.path.empty()) {
+                        throw FileIOException("Failed to open directory: " + std::string(std::strerror(errno)), m_root.string());
+                    }
+                    return; // Unreadable subdirectories are skipped, as git does
+                }
+
+                std::shared_ptr<const Scope> scope = directory.scope;
+                IgnoreRules rules;
+                for (const char* name : IGNORE_FILES) {
+                    rules.addRules(readSmallFile(fd, name));
+                }
+                if (!rules.empty()) {
+                    scope = std::make_shared<const Scope>(Scope { scope, directory.path, std::move(rules) });
+                }
+
+                std::vector<char> buffer(DIRENT_BUFFER_SIZE);
+                while (true) {
+                    long got = ::syscall(SYS_getdents64, fd, buffer.data(), buffer.size());
+                    if (got < 0 && errno == EINTR) {
+                        continue;
+                    }
+                    if (got <= 0) {
+                        break;
+                    }
+                    for (long offset = 0; offset < got;) {
+                        const auto* entry = reinterpret_cast<const LinuxDirent64*>(buffer.data() + offset);
+                        offset += entry->d_reclen;
+                        const char* name = entry->d_name;
+                        if (std::strcmp(name, ".") == 0 || std::strcmp(name, "..") == 0 || std::strcmp(name, ".git") == 0) {
+                            continue;
+                        }
+
+                        unsigned char type = entry->d_type;
+                        if (type == DT_UNKNOWN || type == DT_LNK) {
+                            // Symbolic links count as what they point to, but directories are not followed
+                            struct stat st;
+                            bool isLink = type == DT_LNK;
+                            if (::fstatat(fd, name, &st, isLink ? 0 : AT_SYMLINK_NOFOLLOW) != 0) {
+                                continue;
+                            }
+                            type = S_ISREG(st.st_mode) ? DT_REG : (S_ISDIR(st.st_mode) && !isLink ? DT_DIR : DT_UNKNOWN);
+                        }
+                        if (type != DT_REG && type != DT_DIR) {
+                            continue;
+                        }
+
+                        std::string path = directory.path + name;
+                        if (isIgnored(scope.get(), path, type == DT_DIR)) {
+                            continue;
+                        }
+                        if (type == DT_DIR) {
+                            found.push_back(Directory { path + "/", scope });
+                        } else {
+                            files.push_back(std::move(path));
+                        }
+                    }
+                }
+                ::close(fd);
+            }
+        };
+
+    } // anonymous namespace
+
+    /**
+     * @brief Lists the files below a directory the way `git ls-files` lists a repository.
+     */
+    std::vector<std::string> listFiles(const std::filesystem::path& root, int jobs)
+    {
+        return Walk(root).run(jobs);
+    }
+
+} // namespace walker
+} // namespace codebundler
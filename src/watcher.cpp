@@ -0,0 +1,277 @@
+#include "watcher.hpp"
+#include "exceptions.hpp"
+#include "filefilter.hpp"
+#include "utilities.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <cstdint>
+#include <cstring>
+#include <filesystem> // Requires C++17
+#include <iostream> // For std::cerr
+#include <poll.h>
+#include <sstream>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+namespace codebundler {
+
+namespace {
+
+    volatile std::sig_atomic_t g_stopRequested = 0;
+
+    void requestStop(int /*signal*/)
+    {
+        g_stopRequested = 1;
+    }
+
+    constexpr uint32_t FILE_EVENTS = IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_CREATE | IN_DELETE;
+
+} // anonymous namespace
+
+//--------------------------------------------------------------------------
+// Constructor
+//--------------------------------------------------------------------------
+BundleWatcher::BundleWatcher(const Options& options, std::string outputFilePath, std::string description, int debounceMs)
+    : m_options(options)
+    , m_bundler(options)
+    , m_outputFilePath(std::move(outputFilePath))
+    , m_description(std::move(description))
+    , m_debounceMs(debounceMs)
+{
+    m_stopFd = ::eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (m_stopFd < 0) {
+        throw FileIOException("Failed to create an eventfd", std::strerror(errno));
+    }
+}
+
+BundleWatcher::~BundleWatcher()
+{
+    ::close(m_stopFd);
+}
+
+//--------------------------------------------------------------------------
+// Public Methods
+//--------------------------------------------------------------------------
+
+/**
+ * @brief Writes the bundle and keeps rewriting it on changes until SIGINT or SIGTERM.
+ */
+void BundleWatcher::run()
+{
+    auto [exit_code, output] = utilities::executeCommand("git -C " + utilities::shellQuote(m_options.rootDirectory) + " rev-parse --absolute-git-dir");
+    if (exit_code == 0) {
+        m_gitDirectory = utilities::trim(output);
+    }
+
+    m_inotifyFd = ::inotify_init1(IN_CLOEXEC);
+    if (m_inotifyFd < 0) {
+        throw FileIOException("Failed to initialize inotify", std::strerror(errno));
+    }
+    refreshFileList();
+    watchDirectories();
+    writeBundle(); // Only once watched, so edits made after the bundle appears are seen
+
+    // No SA_RESTART, so poll() returns with EINTR when asked to stop
+    g_stopRequested = 0;
+    struct sigaction action {};
+    action.sa_handler = requestStop;
+    sigemptyset(&action.sa_mask);
+    ::sigaction(SIGINT, &action, nullptr);
+    ::sigaction(SIGTERM, &action, nullptr);
+
+    const std::filesystem::path outputPath = std::filesystem::absolute(m_outputFilePath).lexically_normal();
+    m_options.verbose > 0 && std::cerr << "Watching " << m_files.size() << " files. Press Ctrl-C to stop." << std::endl;
+
+    while (!g_stopRequested) {
+        std::set<std::string> changedFiles;
+        bool indexChanged = false;
+        bool overflowed = false;
+        if (!collectChanges(changedFiles, indexChanged, overflowed, -1)) {
+            continue;
+        }
+        // Debounce: keep collecting until nothing happened for a full interval
+        while (!g_stopRequested && collectChanges(changedFiles, indexChanged, overflowed, m_debounceMs)) {
+        }
+        if (g_stopRequested) {
+            break;
+        }
+
+        if (overflowed) {
+            // Events were lost, so any file (or the index) may have changed; re-read everything as at startup
+            m_options.verbose > 0 && std::cerr << "inotify queue overflowed, re-reading all files." << std::endl;
+            m_chunks.clear();
+            changedFiles.clear();
+            indexChanged = true;
+        } else if (indexChanged) {
+            m_options.verbose > 0 && std::cerr << "Git index changed, refreshing file list." << std::endl;
+        }
+        if (indexChanged) {
+            refreshFileList();
+            watchDirectories();
+        }
+
+        size_t rendered = overflowed ? m_files.size() : 0;
+        for (const auto& filePath : changedFiles) {
+            if (!std::binary_search(m_files.begin(), m_files.end(), filePath)) {
+                continue; // Untracked file, or the bundle itself
+            }
+            if (std::filesystem::absolute(std::filesystem::path(m_options.rootDirectory) / filePath).lexically_normal() == outputPath) {
+                continue;
+            }
+            renderEntry(filePath);
+            rendered++;
+        }
+
+        if (rendered > 0 || indexChanged) {
+            m_options.verbose > 0 && std::cerr << "Rewriting bundle (" << rendered << " changed entries)." << std::endl;
+            writeBundle();
+        }
+    }
+
+    ::close(m_inotifyFd);
+    m_inotifyFd = -1;
+    m_watchedDirectories.clear();
+    m_options.verbose > 0 && std::cerr << "Stopped watching." << std::endl;
+}
+
+/**
+ * @brief Makes run() return; may be called from another thread.
+ */
+void BundleWatcher::stop()
+{
+    std::uint64_t one = 1;
+    [[maybe_unused]] ssize_t written = ::write(m_stopFd, &one, sizeof(one));
+}
+
+//--------------------------------------------------------------------------
+// Private Methods
+//--------------------------------------------------------------------------
+
+void BundleWatcher::refreshFileList()
+{
+    m_files = utilities::getGitTrackedFiles(m_options.rootDirectory);
+    if (!m_options.includePatterns.empty() || !m_options.excludePatterns.empty() || m_options.maxFileSize > 0 || m_options.skipBinary) {
+        // Size and binary checks see the files as they are now; later edits do not drop them
+        m_files = FileFilter(m_options).apply(m_files, m_options.rootDirectory);
+    }
+    std::sort(m_files.begin(), m_files.end());
+
+    std::map<std::string, std::string> chunks;
+    for (const auto& filePath : m_files) {
+        auto it = m_chunks.find(filePath);
+        if (it != m_chunks.end()) {
+            chunks.emplace(filePath, std::move(it->second));
+        }
+    }
+    m_chunks = std::move(chunks);
+
+    for (const auto& filePath : m_files) {
+        if (m_chunks.find(filePath) == m_chunks.end()) {
+            renderEntry(filePath);
+        }
+    }
+}
+
+void BundleWatcher::renderEntry(const std::string& filePath)
+{
+    std::ostringstream entry;
+    // A line starting with the separator is not caught: it is fatal, as it is for bundle
+    try {
+        m_bundler.writeFileEntry(entry, filePath);
+        m_chunks[filePath] = entry.str();
+    } catch (const FileIOException& e) {
+        // Deleted files still in the index are left out; unreadable ones keep their last good entry until they settle
+        std::error_code ec;
+        if (!std::filesystem::exists(std::filesystem::path(m_options.rootDirectory) / filePath, ec)) {
+            m_options.verbose > 0 && std::cerr << "Leaving out deleted file '" << filePath << "'." << std::endl;
+            m_chunks.erase(filePath);
+        } else {
+            std::cerr << "Warning: keeping the previous entry of '" << filePath << "': " << e.what() << std::endl;
+        }
+    }
+}
+
+void BundleWatcher::writeBundle()
+{
+    std::ostringstream bundle;
+    m_bundler.writeHeader(bundle, m_description);
+    for (const auto& filePath : m_files) {
+        auto it = m_chunks.find(filePath);
+        if (it != m_chunks.end()) {
+            bundle << it->second;
+        }
+    }
+    utilities::replaceFileAtomically(m_outputFilePath, bundle.str());
+}
+
+void BundleWatcher::watchDirectories()
+{
+    std::set<std::string> directories { "" };
+    for (const auto& filePath : m_files) {
+        directories.insert(std::filesystem::path(filePath).parent_path().generic_string());
+    }
+
+    for (const auto& directory : directories) {
+        std::filesystem::path watchPath = std::filesystem::path(m_options.rootDirectory) / directory;
+        int wd = ::inotify_add_watch(m_inotifyFd, watchPath.c_str(), FILE_EVENTS);
+        if (wd < 0) {
+            m_options.verbose > 1 && std::cerr << "Warning: cannot watch " << watchPath << ": " << std::strerror(errno) << std::endl;
+            continue;
+        }
+        m_watchedDirectories[wd] = directory;
+    }
+
+    if (!m_gitDirectory.empty()) {
+        // Git replaces the index by renaming index.lock over it
+        int wd = ::inotify_add_watch(m_inotifyFd, m_gitDirectory.c_str(), IN_MOVED_TO | IN_CLOSE_WRITE);
+        if (wd >= 0) {
+            m_watchedDirectories[wd] = m_gitDirectory;
+        }
+    }
+}
+
+bool BundleWatcher::collectChanges(std::set<std::string>& changedFiles, bool& indexChanged, bool& overflowed, int timeoutMs)
+{
+    pollfd pfds[2] = { { m_inotifyFd, POLLIN, 0 }, { m_stopFd, POLLIN, 0 } };
+    int ready = ::poll(pfds, 2, timeoutMs);
+    if (ready <= 0) {
+        return false; // Timeout, or interrupted by a signal
+    }
+    if (pfds[1].revents & POLLIN) {
+        g_stopRequested = 1;
+        return false;
+    }
+
+    alignas(inotify_event) char buffer[16384];
+    ssize_t length = ::read(m_inotifyFd, buffer, sizeof(buffer));
+    if (length <= 0) {
+        return false;
+    }
+
+    for (char* cursor = buffer; cursor < buffer + length;) {
+        const auto* event = reinterpret_cast<const inotify_event*>(cursor);
+        cursor += sizeof(inotify_event) + event->len;
+
+        if (event->mask & IN_Q_OVERFLOW) {
+            overflowed = true; // Carries no watch descriptor or name
+            continue;
+        }
+        auto it = m_watchedDirectories.find(event->wd);
+        if (it == m_watchedDirectories.end() || event->len == 0) {
+            continue;
+        }
+        std::string name = event->name;
+        if (it->second == m_gitDirectory) {
+            if (name == "index") {
+                indexChanged = true;
+            }
+            continue;
+        }
+        changedFiles.insert((std::filesystem::path(it->second) / name).generic_string());
+    }
+    return true;
+}
+
+} // namespace codebundler
@@ -1,13 +1,30 @@
 #include "bundler.hpp"
+#include "changes.hpp"
 #include "constants.hpp"
 #include "exceptions.hpp"
+#include "filecache.hpp"
+#include "filefilter.hpp"
 #include "options.hpp"
+#include "pathmatcher.hpp"
+#include "separatorset.hpp"
+#include "server.hpp"
+#include "shards.hpp"
+#include "tokenbudget.hpp"
+#include "tuning.hpp"
+#include "unbundler.hpp"
 #include "utilities.hpp" // For helpers if needed
+#include "walker.hpp"
+#include "watcher.hpp"
+#include <chrono>
 #include <cstdlib> // For system()
 #include <filesystem> // Requires C++17
 #include <fstream>
 #include <gtest/gtest.h>
+#include <mutex>
+#include <set>
 #include <sstream>
+#include <thread>
+#include <unistd.h> // For pipe()
 
 // Helper function to create dummy files and initialize a git repo
 // WARNING: This modifies the filesystem and runs git commands. Use with caution.
@@ -144,6 +161,476 @@ TEST_F(BundlerGitTest, BundleWithCustomSeparatorAndDescription)
     EXPECT_EQ(bundleContent.find(default_options.separator), std::string::npos);
 }
 
+TEST_F(BundlerGitTest, AutoSeparatorAvoidsCollidingFiles)
+{
+    using namespace codebundler;
+    std::vector<std::string> candidates = SeparatorSet::defaultCandidates();
+    ASSERT_EQ(candidates.size(), SeparatorSet::MAX_CANDIDATES);
+    EXPECT_EQ(candidates[0], Options().separator);
+    EXPECT_EQ(candidates[1], "========= BOUNDARY 1 ==========");
+
+    // Whole lines and line prefixes collide; text in the middle of a line does not
+    const std::string content = candidates[0] + "\nx\n" + candidates[1] + " trailing\n  " + candidates[2] + "\n" + candidates[3];
+    std::ofstream(test_repo_path / "tricky.txt") << content;
+    ASSERT_EQ(std::system("git add tricky.txt"), 0);
+
+    Options options;
+    options.separator = AUTO_SEPARATOR;
+    std::stringstream output;
+    Bundler(options).bundleToStream(output);
+    EXPECT_EQ(output.str().substr(0, output.str().find('\n')), candidates[2]);
+
+    const std::filesystem::path extracted = test_repo_path / "extracted";
+    Unbundler(Options {}).unbundleFromStream(output, extracted);
+    EXPECT_EQ(utilities::readFileBytes(extracted / "tricky.txt"), content + "\n");
+}
+
+TEST_F(BundlerGitTest, SeparatorPrefixLineIsRejected)
+{
+    using namespace codebundler;
+    Options options;
+    // The unbundler would split at this line, so both the stream and the sink writers must refuse it
+    std::ofstream(test_repo_path / "file1.txt") << "before\n" << options.separator << " extra\nafter\n";
+
+    std::stringstream output;
+    EXPECT_THROW(Bundler(options).bundleToStream(output), CodeBundlerException);
+    EXPECT_THROW(Bundler(options).bundleToFile((test_repo_path.parent_path() / "codebundler_prefix_bundle.txt").string()), CodeBundlerException);
+    std::filesystem::remove(test_repo_path.parent_path() / "codebundler_prefix_bundle.txt");
+}
+
+TEST_F(BundlerGitTest, CachedBundleSeesModifiedFiles)
+{
+    using namespace codebundler;
+    Options options;
+    FileCache cache;
+    Bundler bundler(options, &cache);
+
+    std::stringstream first;
+    ASSERT_NO_THROW(bundler.bundleToStream(first));
+    EXPECT_NE(first.str().find("Content of file 1."), std::string::npos);
+
+    // Change size so the stat stamp differs even on coarse-timestamp filesystems
+    std::ofstream(test_repo_path / "file1.txt") << "Changed content of file 1.\n";
+
+    std::stringstream second;
+    ASSERT_NO_THROW(bundler.bundleToStream(second));
+    EXPECT_NE(second.str().find("Changed content of file 1."), std::string::npos);
+    EXPECT_NE(second.str().find(utilities::calculateSHA256("Changed content of file 1.\n")), std::string::npos);
+}
+
+TEST_F(BundlerGitTest, DescriptorOutputMatchesStreamOutput)
+{
+    using namespace codebundler;
+    std::string large;
+    for (int line = 0; large.size() < 300000; ++line) {
+        large += "Line " + std::to_string(line) + " of a file large enough for one gathered write.\n";
+    }
+    std::ofstream(test_repo_path / "large.txt") << large;
+    std::ofstream(test_repo_path / "unterminated.txt") << large << "no final newline";
+    ASSERT_EQ(std::system("git add large.txt unterminated.txt"), 0);
+
+    Options options;
+    options.lengthHeaders = true;
+    Bundler bundler(options);
+    std::stringstream expected;
+    ASSERT_NO_THROW(bundler.bundleToStream(expected, "Same bytes"));
+
+    // Into a pipe, with a reader thread draining it meanwhile
+    int fds[2];
+    ASSERT_EQ(::pipe(fds), 0);
+    std::string piped;
+    std::thread reader([&] {
+        char buffer[65536];
+        for (ssize_t got; (got = ::read(fds[0], buffer, sizeof(buffer))) > 0;) {
+            piped.append(buffer, static_cast<size_t>(got));
+        }
+    });
+    EXPECT_NO_THROW(bundler.bundleToFd(fds[1], "Same bytes"));
+    ::close(fds[1]);
+    reader.join();
+    ::close(fds[0]);
+    EXPECT_EQ(piped, expected.str());
+
+    const std::filesystem::path file = std::filesystem::temp_directory_path() / "codebundler_descriptor_test.txt";
+    ASSERT_NO_THROW(bundler.bundleToFile(file.string(), "Same bytes"));
+    EXPECT_EQ(utilities::readFileBytes(file), expected.str());
+    std::filesystem::remove(file);
+}
+
+TEST_F(BundlerGitTest, WatcherRewritesBundleAfterEdit)
+{
+    using namespace codebundler;
+    Options options;
+    std::filesystem::path bundle_path = test_repo_path.parent_path() / "codebundler_watched_bundle.txt";
+    std::filesystem::remove(bundle_path);
+    BundleWatcher watcher(options, bundle_path.string(), "", 20);
+    std::thread running([&watcher] { watcher.run(); });
+
+    // Waits up to five seconds for the bundle to hold the given text
+    auto bundleContains = [&bundle_path](const std::string& text) {
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+        while (std::chrono::steady_clock::now() < deadline) {
+            std::error_code ec;
+            if (std::filesystem::exists(bundle_path, ec) && utilities::readFileContent(bundle_path).find(text) != std::string::npos) {
+                return true;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        return false;
+    };
+
+    EXPECT_TRUE(bundleContains("Content of file 1."));
+    std::ofstream(test_repo_path / "file1.txt") << "Edited while watched.\n";
+    EXPECT_TRUE(bundleContains("Edited while watched."));
+
+    watcher.stop();
+    running.join();
+    std::filesystem::remove(bundle_path);
+}
+
+TEST_F(BundlerGitTest, WatcherRejectsSeparatorLine)
+{
+    using namespace codebundler;
+    Options options;
+    std::ofstream(test_repo_path / "file1.txt") << options.separator << "\n";
+    std::filesystem::path bundle_path = test_repo_path.parent_path() / "codebundler_watched_separator.txt";
+    std::filesystem::remove(bundle_path);
+
+    // The file must not be silently left out of the bundle
+    BundleWatcher watcher(options, bundle_path.string(), "", 20);
+    EXPECT_THROW(watcher.run(), CodeBundlerException);
+    EXPECT_FALSE(std::filesystem::exists(bundle_path));
+}
+
+TEST_F(BundlerGitTest, RemoteBundleMatchesLocalBundle)
+{
+    using namespace codebundler;
+    Options options;
+    const std::string socket_path = (test_repo_path.parent_path() / "codebundler_test_server.sock").string();
+    Server server(options, socket_path);
+    std::thread serving([&server] { server.run(); });
+
+    RemoteRequest request;
+    request.command = "bundle";
+    request.directory = std::filesystem::canonical(test_repo_path).string();
+    request.description = "Remote test";
+    std::stringstream remote;
+    // The server binds its socket shortly after starting
+    for (int attempt = 0; attempt < 500; ++attempt) {
+        try {
+            sendRemoteRequest(socket_path, request, remote);
+            break;
+        } catch (const FileIOException&) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+    }
+
+    std::stringstream local;
+    Bundler(options).bundleToStream(local, "Remote test");
+    EXPECT_FALSE(remote.str().empty());
+    EXPECT_EQ(remote.str(), local.str());
+
+    // Errors arrive as the ERR trailer
+    request.command = "unknown";
+    std::stringstream rejected;
+    EXPECT_THROW(sendRemoteRequest(socket_path, request, rejected), CodeBundlerException);
+
+    server.stop();
+    serving.join();
+    EXPECT_FALSE(std::filesystem::exists(socket_path));
+}
+
+TEST_F(BundlerGitTest, RevisionBundleMatchesCommittedTree)
+{
+    using namespace codebundler;
+    Options options;
+    Bundler bundler(options);
+    std::stringstream fromWorkingTree;
+    ASSERT_NO_THROW(bundler.bundleToStream(fromWorkingTree));
+
+    // Neither working tree changes nor a deleted file affect a revision bundle
+    std::ofstream(test_repo_path / "file1.txt") << "Uncommitted change.\n";
+    std::filesystem::remove(test_repo_path / "subdir" / "file2.bin");
+
+    std::stringstream fromRevision;
+    ASSERT_NO_THROW(bundler.bundleRevisionToStream(fromRevision, "HEAD"));
+    EXPECT_EQ(fromRevision.str(), fromWorkingTree.str());
+
+    std::stringstream unknown;
+    EXPECT_THROW(bundler.bundleRevisionToStream(unknown, "no-such-revision"), GitCommandException);
+}
+
+TEST(BundlerTest, GlobPatternsFollowGitignoreSyntax)
+{
+    using codebundler::GlobPattern;
+    EXPECT_TRUE(GlobPattern("*.o").matches("main.o"));
+    EXPECT_FALSE(GlobPattern("*.o").matches("src/main.o"));
+    EXPECT_TRUE(GlobPattern("src/**/*.h").matches("src/a/b/x.h"));
+    EXPECT_TRUE(GlobPattern("src/**/*.h").matches("src/x.h"));
+    EXPECT_FALSE(GlobPattern("src/**/*.h").matches("srcx.h"));
+    EXPECT_TRUE(GlobPattern("**/build").matches("build"));
+    EXPECT_TRUE(GlobPattern("**/build").matches("a/b/build"));
+    EXPECT_TRUE(GlobPattern("lib/**").matches("lib/a/b"));
+    EXPECT_TRUE(GlobPattern("file[0-9].[!c]").matches("file7.h"));
+    EXPECT_FALSE(GlobPattern("file[0-9].[!c]").matches("file7.c"));
+    EXPECT_TRUE(GlobPattern("\\*literal?").matches("*literalX"));
+    EXPECT_FALSE(GlobPattern("a?c").matches("a/c"));
+}
+
+TEST(BundlerTest, WalkerHonoursIgnoreFiles)
+{
+    namespace fs = std::filesystem;
+    const fs::path root = fs::temp_directory_path() / "codebundler_walker_test";
+    std::error_code ec;
+    fs::remove_all(root, ec);
+    for (const char* dir : { "src/gen", "build/obj", "docs", ".git" }) {
+        fs::create_directories(root / dir);
+    }
+    for (const char* file : { "src/main.cpp", "src/main.o", "src/keep.o", "src/gen/out.cpp", "build/obj/a.o", "docs/notes.txt", "docs/draft.txt", ".git/HEAD", "README" }) {
+        std::ofstream(root / file) << "x\n";
+    }
+    std::ofstream(root / ".gitignore") << "# objects\n*.o\n!keep.o\nbuild/\n/src/gen\n";
+    std::ofstream(root / "docs" / ".ignore") << "draft.*\n";
+
+    std::vector<std::string> expected = { ".gitignore", "README", "docs/.ignore", "docs/notes.txt", "src/keep.o", "src/main.cpp" };
+    EXPECT_EQ(codebundler::walker::listFiles(root, 4), expected);
+    EXPECT_EQ(codebundler::walker::listFiles(root, 1), expected);
+    fs::remove_all(root, ec);
+}
+
+TEST(BundlerTest, FileFilterSkipsBeforeReading)
+{
+    namespace fs = std::filesystem;
+    const fs::path root = fs::temp_directory_path() / "codebundler_filter_test";
+    std::error_code ec;
+    fs::remove_all(root, ec);
+    fs::create_directories(root / "src" / "vendor");
+    fs::create_directories(root / "docs");
+    std::ofstream(root / "src" / "main.cpp") << "int main() {}\n";
+    std::ofstream(root / "src" / "big.cpp") << std::string(5000, 'x');
+    std::ofstream(root / "src" / "vendor" / "lib.cpp") << "x\n";
+    std::ofstream(root / "src" / "blob.cpp", std::ios::binary) << std::string("ELF\0\1\2", 6);
+    std::ofstream(root / "docs" / "guide.md") << "# Guide\n";
+    std::vector<std::string> files = { "docs/guide.md", "src/big.cpp", "src/blob.cpp", "src/main.cpp", "src/vendor/lib.cpp" };
+
+    codebundler::Options options;
+    options.includePatterns = { "*.cpp" };
+    options.excludePatterns = { "vendor/" };
+    options.maxFileSize = 4096;
+    options.skipBinary = true;
+    codebundler::FileFilter filter(options);
+    EXPECT_EQ(filter.apply(files, root), std::vector<std::string> { "src/main.cpp" });
+    EXPECT_EQ(filter.stats().listed, 5u);
+    EXPECT_EQ(filter.stats().skippedByPattern, 2u);
+    EXPECT_EQ(filter.stats().skippedBySize, 1u);
+    EXPECT_EQ(filter.stats().skippedAsBinary, 1u);
+    EXPECT_EQ(filter.stats().keptBytes, 14u);
+    EXPECT_TRUE(filter.selectsPath("a/b/c.cpp"));
+    EXPECT_FALSE(filter.selectsPath("a/vendor/c.cpp"));
+    fs::remove_all(root, ec);
+}
+
+TEST(BundlerTest, ShardsBalanceBySizeAndExtractTogether)
+{
+    using codebundler::shards::balance;
+    // 10 bytes in 4-byte shards: three shards, largest files first to the smallest shard
+    std::vector<std::vector<size_t>> expected = { { 0 }, { 1 }, { 2, 3, 4 } };
+    EXPECT_EQ(balance({ 4, 3, 1, 1, 1 }, 4), expected);
+    EXPECT_EQ(balance({ 100 }, 4).size(), 1u);
+    EXPECT_EQ(codebundler::shards::shardPath("out-%03d.txt", 7), "out-007.txt");
+    EXPECT_EQ(codebundler::shards::manifestPath("out-%03d.txt"), "out-manifest.txt");
+    EXPECT_FALSE(codebundler::shards::isValidPattern("out.txt"));
+
+    namespace fs = std::filesystem;
+    const fs::path root = fs::temp_directory_path() / "codebundler_shard_test";
+    std::error_code ec;
+    fs::remove_all(root, ec);
+    fs::create_directories(root / "src");
+    fs::create_directories(root / "shards");
+    for (int i = 0; i < 6; ++i) {
+        std::ofstream(root / "src" / ("file" + std::to_string(i) + ".txt")) << std::string(100 * (i + 1), 'a' + i) << "\n";
+    }
+
+    codebundler::Options options;
+    options.walk = true;
+    options.rootDirectory = (root / "src").string();
+    codebundler::Bundler bundler(options);
+    std::string manifestPath = bundler.bundleToShards((root / "shards" / "part-%d.txt").string(), 800, "sharded");
+    EXPECT_EQ(manifestPath, (root / "shards" / "part-manifest.txt").string());
+
+    std::ifstream manifestStream(manifestPath);
+    std::stringstream manifestText;
+    manifestText << manifestStream.rdbuf();
+    codebundler::shards::Manifest manifest = codebundler::shards::readManifest(manifestText.str());
+    EXPECT_EQ(manifest.description, "sharded");
+    ASSERT_EQ(manifest.shards.size(), 3u);
+    EXPECT_EQ(manifest.shards[0].path, "part-0.txt");
+    for (const auto& shard : manifest.shards) {
+        EXPECT_EQ(shard.bytes, 702u); // 601+101, 501+201, 401+301
+    }
+
+    codebundler::Unbundler unbundler(codebundler::Options {});
+    EXPECT_EQ(unbundler.listEntries(manifestPath).size(), 6u);
+    unbundler.unbundleFromFile(manifestPath, root / "out");
+    for (int i = 0; i < 6; ++i) {
+        std::string name = "file" + std::to_string(i) + ".txt";
+        EXPECT_EQ(codebundler::utilities::readFileBytes(root / "out" / name), codebundler::utilities::readFileBytes(root / "src" / name));
+    }
+    fs::remove_all(root, ec);
+}
+
+TEST(BundlerTest, TokenBudgetKeepsHighestPriorityFiles)
+{
+    using namespace codebundler;
+    EXPECT_EQ(tokens::estimate("hello world"), 2u);
+    EXPECT_EQ(tokens::estimate("        return 1234567;\n"), 7u); // Indent, "return", digits in threes, ";", newline
+    std::string mixed;
+    for (int i = 0; i < 2000; ++i) {
+        mixed += static_cast<char>(i * 7919 % 128);
+    }
+    EXPECT_GE(tokens::estimate(mixed), tokens::lowerBound(mixed.size()));
+    EXPECT_GE(tokens::estimate(std::string(1000, ' ')), tokens::lowerBound(1000));
+
+    tokens::PriorityRules rules("src/=10,*.md=1,tests/=-1");
+    EXPECT_EQ(rules.priority("src/a/b.cpp"), 10);
+    EXPECT_EQ(rules.priority("docs/x.md"), 1);
+    EXPECT_EQ(rules.priority("tests/t.cpp"), -1);
+    EXPECT_EQ(rules.priority("other.txt"), 0);
+    EXPECT_THROW(tokens::PriorityRules("src/"), ArgumentParserException);
+    // Highest priority first; the large second file is passed over for the smaller ones after it
+    EXPECT_EQ(tokens::choose({ 0, 5, 5, -1 }, { 10, 80, 15, 1 }, 30), (std::vector<size_t> { 0, 2 }));
+
+    namespace fs = std::filesystem;
+    const fs::path root = fs::temp_directory_path() / "codebundler_token_test";
+    std::error_code ec;
+    fs::remove_all(root, ec);
+    fs::create_directories(root / "src");
+    fs::create_directories(root / "tests");
+    std::ofstream(root / "src" / "main.cpp") << "int main() { return 0; }\n";
+    std::ofstream(root / "README.md") << "# Project\n";
+    std::ofstream(root / "tests" / "test.cpp") << "// test\n";
+    std::ofstream(root / "huge.txt") << std::string(100000, 'x');
+
+    Options options;
+    options.walk = true;
+    options.rootDirectory = root.string();
+    options.tokenBudget = 200;
+    options.priorityRules = "src/=10,tests/=-1";
+    std::ostringstream bundle;
+    Bundler(options).bundleToStream(bundle);
+    changes::BundleIndex index = changes::indexBuffer(bundle.str());
+    ASSERT_EQ(index.entries.size(), 2u);
+    EXPECT_EQ(index.entries[0].path, "README.md");
+    EXPECT_EQ(index.entries[1].path, "src/main.cpp");
+    EXPECT_EQ(index.entries[1].tokens, tokens::estimate("int main() { return 0; }\n"));
+
+    // The "Tokens:" header is skipped when unbundling
+    std::istringstream input(bundle.str());
+    Unbundler(Options {}).unbundleFromStream(input, root / "out");
+    EXPECT_EQ(utilities::readFileBytes(root / "out" / "src" / "main.cpp"), "int main() { return 0; }\n");
+    fs::remove_all(root, ec);
+}
+
+TEST(BundlerTest, TunedSettingsRoundTripAndYieldToOptions)
+{
+    using namespace codebundler;
+    namespace fs = std::filesystem;
+    const fs::path config = fs::temp_directory_path() / "codebundler_tune_test" / "config";
+    fs::remove_all(config.parent_path());
+
+    EXPECT_EQ(tuning::load(config).bundleJobs, 0); // No file yet
+    tuning::Settings measured;
+    measured.bundleJobs = 3;
+    measured.unbundleJobs = 5;
+    measured.readBufferSize = 256 << 10;
+    measured.io = "read";
+    tuning::save(config, measured, "test");
+
+    utilities::writeFileContent(config, utilities::readFileBytes(config) + "future-key = 1 # skipped\n");
+    tuning::Settings loaded = tuning::load(config);
+    EXPECT_EQ(loaded.bundleJobs, 3);
+    EXPECT_EQ(loaded.unbundleJobs, 5);
+    EXPECT_EQ(loaded.readBufferSize, 256u << 10);
+    EXPECT_EQ(loaded.io, "read");
+
+    Options unbundle;
+    tuning::apply(loaded, "unbundle", false, unbundle);
+    EXPECT_EQ(unbundle.jobs, 5);
+    EXPECT_EQ(unbundle.io, "read");
+    Options bundle;
+    bundle.jobs = 7;
+    tuning::apply(loaded, "bundle", true, bundle); // --jobs was given
+    EXPECT_EQ(bundle.jobs, 7);
+    EXPECT_EQ(bundle.io, "mmap");
+
+    utilities::writeFileContent(config, "bundle-jobs = many\n");
+    EXPECT_THROW(tuning::load(config), CodeBundlerException);
+    fs::remove_all(config.parent_path());
+}
+
+TEST(BundlerTest, RepositoriesAndSubmodulesBundleTogether)
+{
+    namespace fs = std::filesystem;
+    using namespace codebundler;
+    const fs::path root = fs::temp_directory_path() / "codebundler_repos_test";
+    cleanup_test_git_repo(root);
+    setup_test_git_repo(root / "core");
+    setup_test_git_repo(root / "libs" / "ui");
+    const std::string addSubmodule = "cd \"" + (root / "core").string() + "\" && git -c protocol.file.allow=always submodule add -q \""
+        + (root / "libs" / "ui").string() + "\" ext/ui && git commit -q -m submodule";
+    ASSERT_EQ(std::system(addSubmodule.c_str()), 0);
+
+    std::ofstream(root / "repos.txt") << "# Bundled together\ncore/\n\nlibs/ui\n";
+    std::vector<std::string> expectedList = { "core", "libs/ui" };
+    EXPECT_EQ(utilities::readRepositoryList(root / "repos.txt"), expectedList);
+
+    Options options;
+    options.rootDirectory = root.string();
+    options.repositories = expectedList;
+    options.recurseSubmodules = true;
+    std::stringstream first;
+    ASSERT_NO_THROW(Bundler(options).bundleToStream(first));
+    for (const char* path : { "core/file1.txt", "core/ext/ui/file1.txt", "core/ext/ui/subdir/file2.bin", "libs/ui/file1.txt", "libs/ui/subdir/file2.bin" }) {
+        EXPECT_NE(first.str().find(FILENAME_PREFIX + path + "\n"), std::string::npos) << path;
+    }
+    EXPECT_LT(first.str().find(FILENAME_PREFIX + "core/file1.txt"), first.str().find(FILENAME_PREFIX + "libs/ui/file1.txt"));
+    std::stringstream second;
+    Bundler(options).bundleToStream(second);
+    EXPECT_EQ(first.str(), second.str());
+
+    std::ofstream(root / "repos.txt") << "core\n../elsewhere\n";
+    EXPECT_THROW(utilities::readRepositoryList(root / "repos.txt"), CodeBundlerException);
+    cleanup_test_git_repo(root);
+}
+
+TEST(BundlerTest, NestedParallelForRunsOnTheOuterWorker)
+{
+    using namespace codebundler;
+    // E.g. tree hashes of files hashed in parallel: at most jobs threads, not jobs squared
+    std::mutex mutex;
+    std::set<std::thread::id> threads;
+    bool nestedOnOwnThread = true;
+    utilities::parallelFor(4, 4, [&](size_t) {
+        const std::thread::id outer = std::this_thread::get_id();
+        utilities::parallelFor(64, 4, [&](size_t) {
+            std::lock_guard<std::mutex> lock(mutex);
+            threads.insert(std::this_thread::get_id());
+            nestedOnOwnThread = nestedOnOwnThread && std::this_thread::get_id() == outer;
+        });
+    });
+    EXPECT_TRUE(nestedOnOwnThread);
+    EXPECT_LE(threads.size(), 4u);
+
+    // Outside a pool the same call still fans out
+    std::set<std::thread::id> alone;
+    utilities::parallelFor(64, 4, [&](size_t) {
+        std::lock_guard<std::mutex> lock(mutex);
+        alone.insert(std::this_thread::get_id());
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    });
+    EXPECT_GT(alone.size(), 1u);
+}
+
 TEST(BundlerTest, ConstructorEmptySeparator)
 {
     using namespace codebundler;
@@ -0,0 +1,87 @@
+#include "scanner.hpp"
+#include <algorithm>
+#include <gtest/gtest.h>
+#include <random>
+#include <string>
+
+using codebundler::scanner::Kernel;
+namespace scanner = codebundler::scanner;
+
+namespace {
+
+// Builds a buffer mostly made of newlines and separator fragments so matches
+// and near-misses land on every offset within a vector.
+std::string randomBuffer(std::mt19937& rng, const std::string& separator, size_t size)
+{
+    const std::string alphabet = "\n\n-=ab" + separator.substr(0, 1) + separator.substr(separator.size() - 1);
+    std::uniform_int_distribution<size_t> pick(0, alphabet.size() + 2);
+    std::string buffer;
+    while (buffer.size() < size) {
+        size_t choice = pick(rng);
+        if (choice == alphabet.size()) {
+            buffer += separator;
+        } else if (choice == alphabet.size() + 1) {
+            buffer += "\n" + separator + "\n";
+        } else if (choice == alphabet.size() + 2) {
+            buffer += separator.substr(0, separator.size() - 1) + "\n";
+        } else {
+            buffer += alphabet[choice];
+        }
+    }
+    return buffer;
+}
+
+} // anonymous namespace
+
+TEST(ScannerTest, KernelsAgreeWithScalar)
+{
+    std::mt19937 rng(12345);
+    const std::vector<std::string> separators = { "-", "--", "=====", "----------", std::string(70, '-'), "-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=" };
+
+    for (Kernel kernel : { Kernel::SSE42, Kernel::AVX2, Kernel::AVX512, Kernel::NEON }) {
+        if (!scanner::isKernelSupported(kernel)) {
+            continue;
+        }
+        SCOPED_TRACE(scanner::kernelName(kernel));
+        for (int round = 0; round < 300; ++round) {
+            const std::string& separator = separators[round % separators.size()];
+            std::string buffer = randomBuffer(rng, separator, static_cast<size_t>(round * 7 % 600));
+            // Vary the start so unaligned heads and short tails are covered
+            std::string_view view(buffer);
+            view.remove_prefix(std::min<size_t>(view.size(), round % 5));
+
+            EXPECT_EQ(scanner::findLineStarts(view, Kernel::Scalar), scanner::findLineStarts(view, kernel));
+            EXPECT_EQ(scanner::findSeparatorLines(view, separator, true, Kernel::Scalar), scanner::findSeparatorLines(view, separator, true, kernel));
+            EXPECT_EQ(scanner::findSeparatorLines(view, separator, false, Kernel::Scalar), scanner::findSeparatorLines(view, separator, false, kernel));
+            EXPECT_EQ(scanner::containsSeparatorLine(view, separator, Kernel::Scalar), scanner::containsSeparatorLine(view, separator, kernel));
+
+            // Plant a NUL byte at a varying offset in every other round
+            std::string withNul(view);
+            if (round % 2 == 1 && !withNul.empty()) {
+                withNul[(round * 13) % withNul.size()] = '\0';
+            }
+            EXPECT_EQ(scanner::containsNulByte(withNul, Kernel::Scalar), scanner::containsNulByte(withNul, kernel));
+            EXPECT_EQ(scanner::containsNulByte(withNul, kernel), withNul.find('\0') != std::string::npos);
+
+            // Without newlines the random buffers are plain JSON-safe text; plant a quote or a UTF-8 lead byte now and then
+            std::string json(view);
+            std::replace(json.begin(), json.end(), '\n', ' ');
+            if (round % 3 != 0 && !json.empty()) {
+                json[(round * 17) % json.size()] = round % 3 == 1 ? '"' : '\xc3';
+            }
+            for (size_t from : { size_t(0), json.size() / 3 }) {
+                EXPECT_EQ(scanner::findJsonSpecial(json, from, Kernel::Scalar), scanner::findJsonSpecial(json, from, kernel));
+            }
+        }
+    }
+}
+
+TEST(ScannerTest, ScalarFindsSeparatorLines)
+{
+    const std::string buffer = "----\nabc\n----x\n-----\n----";
+    EXPECT_EQ(scanner::findLineStarts(buffer, Kernel::Scalar), (std::vector<size_t> { 0, 5, 9, 15, 21 }));
+    EXPECT_EQ(scanner::findSeparatorLines(buffer, "----", true, Kernel::Scalar), (std::vector<size_t> { 0, 21 }));
+    EXPECT_EQ(scanner::findSeparatorLines(buffer, "----", false, Kernel::Scalar), (std::vector<size_t> { 0, 9, 15, 21 }));
+    EXPECT_FALSE(scanner::containsSeparatorLine("a----\n---\n", "----", Kernel::Scalar));
+    EXPECT_TRUE(scanner::containsSeparatorLine("a\n---- extra\n", "----", Kernel::Scalar));
+}
@@ -1,8 +1,19 @@
+#include "binarybundle.hpp"
+#include "changes.hpp"
+#include "chunkstore.hpp"
+#include "compressedbundle.hpp"
 #include "constants.hpp"
 #include "exceptions.hpp"
+#include "fastimport.hpp"
+#include "grep.hpp"
+#include "hashcache.hpp"
+#include "journal.hpp"
+#include "ndjson.hpp"
 #include "options.hpp"
+#include "tarwriter.hpp"
 #include "unbundler.hpp"
 #include "utilities.hpp" // For reading created files, calculating checksums
+#include <algorithm>
 #include <filesystem> // Requires C++17
 #include <fstream>
 #include <gtest/gtest.h>
@@ -234,7 +245,656 @@ TEST_F(UnbundlerTest, BundleEndsAbruptlyAfterFilename)
     ASSERT_FALSE(std::filesystem::exists(file_path));
 }
 
+TEST_F(UnbundlerTest, UnbundleOnlySelectedFiles)
+{
+    using namespace codebundler;
+    Options options;
+    options.onlyFiles = { "data/fileB.txt" };
+    Unbundler unbundler(options);
+    std::stringstream input_stream(create_valid_bundle());
+
+    ASSERT_NO_THROW(unbundler.unbundleFromStream(input_stream, test_output_dir));
+
+    EXPECT_FALSE(std::filesystem::exists(test_output_dir / "fileA.txt"));
+    EXPECT_EQ(utilities::readFileContent(test_output_dir / "data/fileB.txt"), "File 2\nMore lines.\n");
+}
+
+TEST_F(UnbundlerTest, UnbundleOnlyMissingFileIsError)
+{
+    using namespace codebundler;
+    Options options;
+    options.onlyFiles = { "data/fileB.txt", "missing.txt" };
+    Unbundler unbundler(options);
+    std::stringstream input_stream(create_valid_bundle());
+
+    EXPECT_THROW(unbundler.unbundleFromStream(input_stream, test_output_dir), BundleFormatException);
+}
+
+TEST_F(UnbundlerTest, UnbundleLengthPrefixedEntries)
+{
+    using namespace codebundler;
+    Options options;
+    Unbundler unbundler(options);
+
+    // Content that would confuse line matching is read as one block
+    std::string sep = "---SEP---";
+    std::string content1 = "Filename: not/a/file.txt\nChecksum: nope\n";
+    std::string content2 = "plain\n";
+    std::stringstream ss;
+    ss << sep << "\n";
+    ss << ENTRY_HEADERS_PREFIX << "Length\n";
+    ss << sep << "\n";
+    ss << FILENAME_PREFIX << "tricky.txt\n";
+    ss << CHECKSUM_PREFIX << utilities::calculateSHA256(content1) << "\n";
+    ss << LENGTH_PREFIX << content1.size() << "\n";
+    ss << content1 << sep << "\n";
+    ss << FILENAME_PREFIX << "plain.txt\n";
+    ss << CHECKSUM_PREFIX << utilities::calculateSHA256(content2) << "\n";
+    ss << LENGTH_PREFIX << content2.size() << "\n";
+    ss << content2 << sep << "\n";
+
+    ASSERT_NO_THROW(unbundler.unbundleFromStream(ss, test_output_dir));
+    EXPECT_EQ(utilities::readFileContent(test_output_dir / "tricky.txt"), content1);
+    EXPECT_EQ(utilities::readFileContent(test_output_dir / "plain.txt"), content2);
+    EXPECT_FALSE(std::filesystem::exists(test_output_dir / "not/a/file.txt"));
+}
+
+TEST_F(UnbundlerTest, LengthHeaderMismatchIsFormatError)
+{
+    using namespace codebundler;
+    Options options;
+    Unbundler unbundler(options);
+    std::string sep = "---SEP---";
+    std::string content = "two\nlines\n";
+    std::stringstream ss;
+    ss << sep << "\n";
+    ss << ENTRY_HEADERS_PREFIX << "Length\n";
+    ss << sep << "\n";
+    ss << FILENAME_PREFIX << "short.txt\n";
+    ss << CHECKSUM_PREFIX << utilities::calculateSHA256(content) << "\n";
+    ss << LENGTH_PREFIX << content.size() - 3 << "\n"; // Separator won't follow the block
+    ss << content << sep << "\n";
+
+    EXPECT_THROW(unbundler.unbundleFromStream(ss, test_output_dir), BundleFormatException);
+    EXPECT_FALSE(std::filesystem::exists(test_output_dir / "short.txt"));
+}
+
+TEST_F(UnbundlerTest, UndeclaredLengthLineIsContent)
+{
+    using namespace codebundler;
+    // Bundles without the "Entry headers:" declaration parse as before Length headers existed
+    std::string sep = "---SEP---";
+    std::string content = "Length: 5\nnot a header\n";
+    std::string bundle = sep + "\n" + FILENAME_PREFIX + "looks.txt\n" + CHECKSUM_PREFIX + utilities::calculateSHA256(content) + "\n" + content + sep + "\n";
+
+    Unbundler unbundler { Options() };
+    std::stringstream ss(bundle);
+    ASSERT_NO_THROW(unbundler.unbundleFromStream(ss, test_output_dir / "stream"));
+    EXPECT_EQ(utilities::readFileBytes(test_output_dir / "stream/looks.txt"), content);
+
+    std::filesystem::path bundlePath = test_output_dir / "bundle.txt";
+    std::ofstream(bundlePath, std::ios::binary) << bundle;
+    ASSERT_NO_THROW(unbundler.unbundleFromFile(bundlePath.string(), test_output_dir / "file"));
+    EXPECT_EQ(utilities::readFileBytes(test_output_dir / "file/looks.txt"), content);
+    EXPECT_EQ(unbundler.readIndex(bundlePath.string()).entries.at(0).length, content.size());
+}
+
+TEST_F(UnbundlerTest, UndeclaredTokensLineIsContent)
+{
+    using namespace codebundler;
+    std::string sep = "---SEP---";
+    std::string content = "Tokens: 123\nLength: 4\n";
+    std::string bundle = sep + "\n" + FILENAME_PREFIX + "notes.txt\n" + CHECKSUM_PREFIX + utilities::calculateSHA256(content) + "\n" + content + sep + "\n";
+
+    Unbundler unbundler { Options() };
+    std::stringstream ss(bundle);
+    ASSERT_NO_THROW(unbundler.unbundleFromStream(ss, test_output_dir / "stream"));
+    EXPECT_EQ(utilities::readFileBytes(test_output_dir / "stream/notes.txt"), content);
+
+    std::filesystem::path bundlePath = test_output_dir / "bundle.txt";
+    std::ofstream(bundlePath, std::ios::binary) << bundle;
+    ASSERT_NO_THROW(unbundler.unbundleFromFile(bundlePath.string(), test_output_dir / "file"));
+    EXPECT_EQ(utilities::readFileBytes(test_output_dir / "file/notes.txt"), content);
+    EXPECT_EQ(unbundler.readIndex(bundlePath.string()).entries.at(0).tokens, 0u);
+}
+
+TEST_F(UnbundlerTest, CompressedBundleRoundTrip)
+{
+    using namespace codebundler;
+    std::string codec = compressed::isCodecAvailable("zstd") ? "zstd" : "lz4";
+    if (!compressed::isCodecAvailable(codec)) {
+        GTEST_SKIP() << "No compression codec in this build.";
+    }
+
+    // Split the text bundle into preamble and entries the way the bundler renders them
+    std::string sep = "========== BOUNDARY ==========";
+    std::string text = create_valid_bundle(sep);
+    size_t firstEntry = text.find(codebundler::FILENAME_PREFIX);
+    size_t secondEntry = text.find(codebundler::FILENAME_PREFIX, firstEntry + 1);
+    std::vector<compressed::EntryChunk> entries = {
+        { "fileA.txt", text.substr(firstEntry, secondEntry - firstEntry) },
+        { "data/fileB.txt", text.substr(secondEntry) },
+    };
+    std::stringstream container;
+    compressed::writeBundle(container, text.substr(0, firstEntry), entries, codec, 2);
+
+    EXPECT_EQ(compressed::readBundle(container.str(), {}, 2), text);
+
+    Options options;
+    options.onlyFiles = { "fileA.txt" };
+    Unbundler unbundler(options);
+    ASSERT_NO_THROW(unbundler.unbundleFromStream(container, test_output_dir));
+    EXPECT_EQ(utilities::readFileContent(test_output_dir / "fileA.txt"), "File 1 content.\n");
+    EXPECT_FALSE(std::filesystem::exists(test_output_dir / "data/fileB.txt"));
+
+    // Leaves only the preamble to parse, which must still report the missing entry
+    options.onlyFiles = { "missing.txt" };
+    std::stringstream unmatched(container.str());
+    EXPECT_THROW(Unbundler(options).unbundleFromStream(unmatched, test_output_dir), BundleFormatException);
+}
+
+TEST_F(UnbundlerTest, CompressedBundleRejectsCorruptSizes)
+{
+    using namespace codebundler;
+    std::string codec = compressed::isCodecAvailable("zstd") ? "zstd" : "lz4";
+    if (!compressed::isCodecAvailable(codec)) {
+        GTEST_SKIP() << "No compression codec in this build.";
+    }
+
+    std::string sep = "========== BOUNDARY ==========";
+    std::string text = create_valid_bundle(sep);
+    size_t firstEntry = text.find(codebundler::FILENAME_PREFIX);
+    std::stringstream out;
+    compressed::writeBundle(out, text.substr(0, firstEntry), { { "all.txt", text.substr(firstEntry) } }, codec, 1);
+    const std::string container = out.str();
+
+    // Overwrites little-endian bytes of the frame table, which starts after the codec id
+    auto corrupt = [&container](size_t offset, int bytes) {
+        std::string copy = container;
+        for (int i = 0; i < bytes; ++i) {
+            copy[offset + static_cast<size_t>(i)] = '\xff';
+        }
+        return copy;
+    };
+    size_t tableOffset = 0;
+    for (int i = 0; i < 8; ++i) {
+        tableOffset |= static_cast<size_t>(static_cast<unsigned char>(container[container.size() - 24 + static_cast<size_t>(i)])) << (8 * i);
+    }
+    const size_t frameCount = tableOffset + 4;
+    const size_t preambleRawSize = frameCount + 4 + 16;
+    const size_t locationCount = frameCount + 4 + 2 * 24;
+
+    EXPECT_THROW(compressed::readBundle(corrupt(frameCount, 4), {}, 1), BundleFormatException);
+    EXPECT_THROW(compressed::readBundle(corrupt(locationCount, 4), {}, 1), BundleFormatException);
+    EXPECT_THROW(compressed::readBundle(corrupt(preambleRawSize, 8), {}, 1), BundleFormatException);
+    EXPECT_EQ(compressed::readBundle(container, {}, 1), text);
+}
+
+TEST_F(UnbundlerTest, PipelinedUnbundleStopsBeforeBadFile)
+{
+    using namespace codebundler;
+    std::string sep = "========== BOUNDARY ==========";
+    std::stringstream ss;
+    ss << sep << "\n";
+    ss << FILENAME_PREFIX << "good.txt\n";
+    ss << CHECKSUM_PREFIX << utilities::calculateSHA256("Good data.\n") << "\n";
+    ss << "Good data.\n";
+    ss << sep << "\n";
+    ss << FILENAME_PREFIX << "bad.txt\n";
+    ss << CHECKSUM_PREFIX << utilities::calculateSHA256("Other data.\n") << "\n";
+    ss << "Tampered data.\n";
+    ss << sep << "\n";
+
+    Options options;
+    options.jobs = 4; // Pipelined even on single-core machines
+    Unbundler unbundler(options);
+    EXPECT_THROW(unbundler.unbundleFromStream(ss, test_output_dir), ChecksumMismatchException);
+
+    EXPECT_EQ(utilities::readFileContent(test_output_dir / "good.txt"), "Good data.\n");
+    EXPECT_FALSE(std::filesystem::exists(test_output_dir / "bad.txt"));
+    for (const auto& entry : std::filesystem::directory_iterator(test_output_dir)) {
+        EXPECT_EQ(entry.path().filename(), "good.txt"); // No temporary files left behind
+    }
+}
+
+TEST_F(UnbundlerTest, TreeChecksumEntriesVerify)
+{
+    using namespace codebundler;
+    // Spans several leaves, with a short last one
+    std::string content;
+    while (content.size() < 2 * TREE_CHUNK_SIZE + 1000) {
+        content += "line " + std::to_string(content.size()) + "\n";
+    }
+    std::string checksum = utilities::calculateChecksum(content, "sha256-tree", 4);
+    ASSERT_EQ(utilities::checksumType(checksum), "sha256-tree");
+    EXPECT_EQ(checksum, utilities::calculateChecksum(content, "sha256-tree", 1));
+    EXPECT_NE(checksum.substr(TREE_CHECKSUM_TAG.size()), utilities::calculateSHA256(content));
+
+    auto makeBundle = [&](const std::string& body) {
+        std::string sep = "========== BOUNDARY ==========";
+        return sep + "\n" + FILENAME_PREFIX + "big.txt\n" + CHECKSUM_PREFIX + checksum + "\n" + body + sep + "\n";
+    };
+    Unbundler unbundler { Options() };
+    std::stringstream good(makeBundle(content));
+    ASSERT_NO_THROW(unbundler.unbundleFromStream(good, test_output_dir));
+    EXPECT_EQ(utilities::readFileContent(test_output_dir / "big.txt"), content);
+
+    std::string tampered = content;
+    tampered[TREE_CHUNK_SIZE + 5] = 'X';
+    std::stringstream bad(makeBundle(tampered));
+    EXPECT_THROW(unbundler.unbundleFromStream(bad, test_output_dir), ChecksumMismatchException);
+}
+
+TEST_F(UnbundlerTest, DuplicateContentIsHardLinked)
+{
+    using namespace codebundler;
+    std::string sep = "========== BOUNDARY ==========";
+    std::string content = "Shared fixture.\n";
+    std::stringstream ss;
+    ss << sep << "\n";
+    for (const char* name : { "a.txt", "sub/b.txt", "c.txt" }) {
+        ss << FILENAME_PREFIX << name << "\n";
+        ss << CHECKSUM_PREFIX << utilities::calculateSHA256(name[0] == 'c' ? "Unique.\n" : content) << "\n";
+        ss << (name[0] == 'c' ? "Unique.\n" : content);
+        ss << sep << "\n";
+    }
+
+    Options options;
+    options.dedup = "hardlink";
+    Unbundler unbundler(options);
+    ASSERT_NO_THROW(unbundler.unbundleFromStream(ss, test_output_dir));
+    EXPECT_EQ(utilities::readFileContent(test_output_dir / "sub/b.txt"), content);
+    EXPECT_EQ(std::filesystem::hard_link_count(test_output_dir / "a.txt"), 2u);
+    EXPECT_EQ(std::filesystem::hard_link_count(test_output_dir / "c.txt"), 1u);
+}
+
+TEST_F(UnbundlerTest, BinaryReextractionReplacesHardLinks)
+{
+    using namespace codebundler;
+    auto extract = [this](const std::vector<binary::FileEntry>& entries) {
+        std::filesystem::path bundlePath = test_output_dir / "bundle.cbb";
+        {
+            std::ofstream out(bundlePath, std::ios::binary);
+            binary::writeBundle(out, "---", "", entries);
+        }
+        Options options;
+        options.dedup = "hardlink";
+        Unbundler(options).unbundleFromFile(bundlePath.string(), test_output_dir / "out");
+    };
+    ASSERT_NO_THROW(extract({ { "a.txt", "same\n", 0644 }, { "b.txt", "same\n", 0644 }, { "run.sh", "same\n", 0755 } }));
+    EXPECT_EQ(std::filesystem::hard_link_count(test_output_dir / "out/a.txt"), 2u);
+    // Hard links share permission bits, so the executable copy is written separately
+    EXPECT_EQ(std::filesystem::hard_link_count(test_output_dir / "out/run.sh"), 1u);
+
+    // Rewriting a.txt must not write through the link into b.txt
+    ASSERT_NO_THROW(extract({ { "a.txt", "diff\n", 0644 }, { "b.txt", "same\n", 0644 } }));
+    EXPECT_EQ(utilities::readFileBytes(test_output_dir / "out/a.txt"), "diff\n");
+    EXPECT_EQ(utilities::readFileBytes(test_output_dir / "out/b.txt"), "same\n");
+}
+
+TEST_F(UnbundlerTest, TextReextractionReplacesHardLinks)
+{
+    using namespace codebundler;
+    auto bundle = [](const std::vector<std::pair<std::string, std::string>>& files) {
+        std::string text = "---SEP---\n";
+        for (const auto& [name, content] : files) {
+            text += FILENAME_PREFIX + name + "\n" + CHECKSUM_PREFIX + utilities::calculateSHA256(content) + "\n" + content + "---SEP---\n";
+        }
+        return text;
+    };
+    Options linking;
+    linking.dedup = "hardlink";
+    std::stringstream first(bundle({ { "a.txt", "same\n" }, { "b.txt", "same\n" } }));
+    ASSERT_NO_THROW(Unbundler(linking).unbundleFromStream(first, test_output_dir));
+    EXPECT_EQ(std::filesystem::hard_link_count(test_output_dir / "a.txt"), 2u);
+
+    // A plain copy-mode run over the linked tree must not write a.txt through the link into b.txt
+    Options copying;
+    copying.jobs = 1;
+    copying.onlyFiles = { "a.txt" };
+    std::stringstream second(bundle({ { "a.txt", "diff\n" }, { "b.txt", "same\n" } }));
+    ASSERT_NO_THROW(Unbundler(copying).unbundleFromStream(second, test_output_dir));
+    EXPECT_EQ(utilities::readFileBytes(test_output_dir / "a.txt"), "diff\n");
+    EXPECT_EQ(utilities::readFileBytes(test_output_dir / "b.txt"), "same\n");
+}
+
+TEST_F(UnbundlerTest, BinaryBundleRoundTrip)
+{
+    using namespace codebundler;
+    const std::string binaryContent("\x00\x01\xff\nno trailing newline", 24);
+    std::vector<binary::FileEntry> entries = {
+        { "fileA.txt", "File 1 content.\n", 0644 },
+        { "data/blob.bin", binaryContent, 0755 },
+    };
+    std::filesystem::path bundlePath = test_output_dir / "bundle.cbb";
+    {
+        std::ofstream out(bundlePath, std::ios::binary);
+        binary::writeBundle(out, "---", "A description", entries);
+    }
+    EXPECT_EQ(std::filesystem::file_size(bundlePath) % binary::BLOB_ALIGNMENT, 0u);
+
+    Unbundler unbundler { Options() };
+    EXPECT_EQ(unbundler.listEntries(bundlePath.string()), (std::vector<std::string> { "fileA.txt", "data/blob.bin" }));
+
+    std::filesystem::path outDir = test_output_dir / "out";
+    ASSERT_NO_THROW(unbundler.unbundleFromFile(bundlePath.string(), outDir));
+    EXPECT_EQ(utilities::readFileBytes(outDir / "data/blob.bin"), binaryContent);
+    EXPECT_EQ(utilities::readFileBytes(outDir / "fileA.txt"), "File 1 content.\n");
+
+    binary::BundleContents contents = unbundler.readContents(bundlePath.string());
+    EXPECT_EQ(contents.separator, "---");
+    EXPECT_EQ(contents.description, "A description");
+    ASSERT_EQ(contents.entries.size(), 2u);
+    EXPECT_EQ(contents.entries[1].content, binaryContent);
+    EXPECT_EQ(contents.entries[1].mode, 0755u);
+}
+
+TEST_F(UnbundlerTest, FastImportStreamFromBinaryBundle)
+{
+    using namespace codebundler;
+    std::vector<binary::FileEntry> entries = {
+        { "run.sh", "#!/bin/sh\n", 0755 },
+        { "say \"hi\".txt", "hi", 0644 },
+    };
+    std::filesystem::path bundlePath = test_output_dir / "bundle.cbb";
+    {
+        std::ofstream out(bundlePath, std::ios::binary);
+        binary::writeBundle(out, "---", "Import me", entries);
+    }
+
+    std::ostringstream stream;
+    FastImportWriter writer(stream, "imported", "0123abcd");
+    Unbundler unbundler { Options() };
+    std::string description = unbundler.exportFromFile(bundlePath.string(), [&writer](const std::string& path, std::string_view content, uint32_t mode) {
+        writer.addFile(path, content, mode);
+    });
+    writer.commit("A U Thor <author@example.com> 0 +0000", description);
+
+    EXPECT_EQ(stream.str(),
+        "blob\nmark :1\ndata 10\n#!/bin/sh\n\n"
+        "blob\nmark :2\ndata 2\nhi\n"
+        "commit refs/heads/imported\n"
+        "committer A U Thor <author@example.com> 0 +0000\n"
+        "data 9\nImport me\n"
+        "from 0123abcd\n"
+        "deleteall\n"
+        "M 100755 :1 run.sh\n"
+        "M 100644 :2 \"say \\\"hi\\\".txt\"\n\n");
+}
+
+TEST_F(UnbundlerTest, TarStreamFromTextBundle)
+{
+    using namespace codebundler;
+    std::ostringstream tar;
+    TarWriter writer(tar, 0);
+    Unbundler unbundler { Options() };
+    std::stringstream input_stream(create_valid_bundle());
+    std::string description = unbundler.exportFromStream(input_stream, [&writer](const std::string& path, std::string_view content, uint32_t mode) {
+        writer.addFile(path, content, mode);
+    });
+    writer.addFile(std::string(120, 'x') + "/" + std::string(120, 'y'), "long\n"); // Needs a pax path record
+    writer.finish();
+    EXPECT_EQ(description, "A test bundle");
+    EXPECT_FALSE(std::filesystem::exists(test_output_dir / "fileA.txt"));
+
+    const std::string archive = tar.str();
+    ASSERT_EQ(archive.size(), 10u * 512); // Two blocks per file, two for the pax header, two end blocks
+    EXPECT_EQ(std::string(archive.c_str()), "fileA.txt");
+    EXPECT_EQ(archive.substr(124, 12), std::string("00000000020\0", 12)); // 16 bytes, octal
+    EXPECT_EQ(archive.substr(257, 8), std::string("ustar\0" "00", 8));
+    EXPECT_EQ(archive.substr(512, 16), "File 1 content.\n");
+    EXPECT_EQ(std::string(archive.c_str() + 1024), "data/fileB.txt");
+
+    // Header checksum: sum of all bytes with the checksum field counted as spaces
+    unsigned sum = 0;
+    for (size_t i = 0; i < 512; ++i) {
+        sum += (i >= 148 && i < 156) ? ' ' : static_cast<unsigned char>(archive[i]);
+    }
+    EXPECT_EQ(std::stoul(archive.substr(148, 6), nullptr, 8), sum);
+
+    EXPECT_EQ(archive[2048 + 156], 'x');
+    EXPECT_NE(archive.find("path=" + std::string(120, 'x') + "/"), std::string::npos);
+}
+
+TEST_F(UnbundlerTest, IndexDiffStatusAndFingerprint)
+{
+    using namespace codebundler;
+    const std::filesystem::path bundlePath = test_output_dir / "a.txt";
+    utilities::writeFileContent(bundlePath, create_valid_bundle());
+    Unbundler unbundler { Options() };
+    changes::BundleIndex index = unbundler.readIndex(bundlePath.string());
+    ASSERT_EQ(index.entries.size(), 2u); // The description block is not an entry
+    EXPECT_EQ(index.entries[1].path, "data/fileB.txt");
+    EXPECT_EQ(index.entries[1].checksum, utilities::calculateSHA256("File 2\nMore lines.\n"));
+
+    // Same files as a binary bundle, in the other order: equal fingerprints, no differences
+    const std::filesystem::path binaryPath = test_output_dir / "b.cbb";
+    {
+        std::ofstream output(binaryPath, std::ios::binary);
+        binary::writeBundle(output, "===", "", { { "data/fileB.txt", "File 2\nMore lines.\n" }, { "fileA.txt", "File 1 content.\n" } });
+    }
+    changes::BundleIndex binaryIndex = unbundler.readIndex(binaryPath.string());
+    EXPECT_FALSE(binaryIndex.normalized);
+    EXPECT_EQ(changes::fingerprint(index), changes::fingerprint(binaryIndex));
+
+    binaryIndex.entries[0].checksum = utilities::calculateSHA256("changed\n");
+    binaryIndex.entries.push_back({ "new.txt", utilities::calculateSHA256("") });
+    index.entries.push_back({ "old.txt", utilities::calculateSHA256("") });
+    std::vector<changes::Difference> differences = changes::compare(index, binaryIndex);
+    ASSERT_EQ(differences.size(), 3u);
+    EXPECT_EQ(differences[0].change, changes::Change::Modified);
+    EXPECT_EQ(differences[0].path, "data/fileB.txt");
+    EXPECT_EQ(differences[1].change, changes::Change::Added);
+    EXPECT_EQ(differences[2].change, changes::Change::Deleted);
+    EXPECT_NE(changes::fingerprint(index), changes::fingerprint(binaryIndex));
+
+    // Status: unchanged files are hashed once, then answered from the cache
+    const std::filesystem::path tree = test_output_dir / "tree";
+    utilities::writeFileContent(tree / "fileA.txt", "File 1 content.\n");
+    utilities::writeFileContent(tree / "data" / "fileB.txt", "File 2\nchanged\n");
+    utilities::writeFileContent(tree / "extra.txt", "x\n");
+    for (const char* file : { "fileA.txt", "data/fileB.txt" }) {
+        std::filesystem::last_write_time(tree / file, std::filesystem::file_time_type::clock::now() - std::chrono::hours(1));
+    }
+    index.entries.pop_back();
+    const std::vector<std::string> files = { "data/fileB.txt", "extra.txt", "fileA.txt" };
+    HashCache cache(test_output_dir / "hashes");
+    differences = changes::status(index, tree, files, cache, 2);
+    ASSERT_EQ(differences.size(), 2u);
+    EXPECT_EQ(differences[0].path, "data/fileB.txt");
+    EXPECT_EQ(differences[1].change, changes::Change::Added);
+    EXPECT_EQ(cache.misses(), 2u);
+    cache.save();
+
+    HashCache reloaded(test_output_dir / "hashes");
+    EXPECT_EQ(changes::status(index, tree, files, reloaded, 2).size(), 2u);
+    EXPECT_EQ(reloaded.misses(), 0u);
+}
+
 // Add more tests:
 // - Bundles with binary content (ensure no corruption) -> Covered by bundler test data, verify here too if needed
 // - Error handling for unwritable output directory/files (might need more setup)
 // - Bundle containing only header
+
+TEST_F(UnbundlerTest, ChunkStoreDeduplicatesSimilarBundles)
+{
+    using namespace codebundler;
+    // Pseudo-random content, so chunk boundaries come from the data rather than the size limits
+    std::string large;
+    std::uint64_t state = 42;
+    while (large.size() < 200000) {
+        state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+        large += static_cast<char>('a' + (state >> 59));
+    }
+    std::vector<size_t> lengths = store::chunkLengths(large);
+    size_t total = 0;
+    for (size_t i = 0; i < lengths.size(); ++i) {
+        EXPECT_LE(lengths[i], store::MAX_CHUNK_SIZE);
+        EXPECT_TRUE(lengths[i] >= store::MIN_CHUNK_SIZE || i + 1 == lengths.size());
+        total += lengths[i];
+    }
+    EXPECT_EQ(total, large.size());
+    EXPECT_GT(lengths.size(), 4u);
+
+    auto makeBundle = [&](const std::string& name, const std::string& content) {
+        const std::filesystem::path path = test_output_dir / name;
+        std::ofstream output(path, std::ios::binary);
+        binary::writeBundle(output, "===", "", { { "big.txt", content }, { "small.txt", "tiny\n" } });
+        return path.string();
+    };
+    std::string edited = large;
+    edited.insert(100000, "an edit in the middle\n");
+    const std::string first = makeBundle("one.cbb", large);
+    const std::string second = makeBundle("two.cbb", edited);
+
+    store::ChunkStore chunkStore(test_output_dir / "store", 2);
+    store::AddResult added = chunkStore.add("one", first);
+    EXPECT_EQ(added.newChunks, added.chunks);
+    store::AddResult again = chunkStore.add("two", second);
+    EXPECT_LE(again.newChunks, 3u); // Only the chunks around the edit are new
+    EXPECT_EQ(chunkStore.list(), (std::vector<std::string> { "one", "two" }));
+
+    std::ostringstream rebuilt;
+    chunkStore.get("two", rebuilt);
+    EXPECT_EQ(rebuilt.str(), utilities::readFileBytes(second));
+    EXPECT_EQ(chunkStore.getEntry("two", "big.txt"), edited);
+    EXPECT_EQ(chunkStore.getEntry("one", "small.txt"), "tiny\n");
+    EXPECT_THROW(chunkStore.getEntry("one", "missing.txt"), FileIOException);
+
+    chunkStore.remove("two");
+    EXPECT_GE(chunkStore.gc(), 1u);
+    EXPECT_EQ(chunkStore.gc(), 0u);
+    std::ostringstream original;
+    chunkStore.get("one", original);
+    EXPECT_EQ(original.str(), utilities::readFileBytes(first));
+}
+
+TEST_F(UnbundlerTest, ResumeSkipsJournaledEntries)
+{
+    using namespace codebundler;
+    const std::string text = create_valid_bundle();
+    const std::filesystem::path textPath = test_output_dir / "bundle.txt";
+    utilities::writeFileContent(textPath, text);
+    const std::filesystem::path binaryPath = test_output_dir / "bundle.cbb";
+    {
+        std::ofstream output(binaryPath, std::ios::binary);
+        binary::writeBundle(output, "===", "", { { "fileA.txt", "File 1 content.\n" }, { "data/fileB.txt", "File 2\nMore lines.\n" } });
+    }
+    const std::string binaryData = utilities::readFileBytes(binaryPath);
+
+    // An interrupted run: the first entry was journaled, but its file is gone (so skipping it is visible)
+    const std::filesystem::path out = test_output_dir / "out";
+    changes::BundleIndex textIndex = changes::indexBuffer(text);
+    changes::BundleIndex binaryIndex = changes::indexBuffer(binaryData);
+    {
+        Journal textJournal(Journal::defaultLocation(out, textPath.string()), text, false);
+        textJournal.commit({ 0, textIndex.entries[0].offset + textIndex.entries[0].length, textIndex.entries[0].checksum, "fileA.txt" });
+        Journal binaryJournal(Journal::defaultLocation(out / "bin", binaryPath.string()), binaryData, false);
+        binaryJournal.commit({ 0, binaryIndex.entries[0].offset, binaryIndex.entries[0].checksum, "fileA.txt" });
+    }
+
+    Options options;
+    options.journal = true;
+    options.resume = true;
+    Unbundler unbundler(options);
+    unbundler.unbundleFromFile(textPath.string(), out);
+    unbundler.unbundleFromFile(binaryPath.string(), out / "bin");
+    for (const auto& directory : { out, out / "bin" }) {
+        EXPECT_FALSE(std::filesystem::exists(directory / "fileA.txt"));
+        EXPECT_EQ(utilities::readFileBytes(directory / "data/fileB.txt"), "File 2\nMore lines.\n");
+    }
+    // Finished runs leave no journal behind
+    EXPECT_FALSE(std::filesystem::exists(Journal::defaultLocation(out, textPath.string())));
+
+    // A journal written for another bundle is refused
+    {
+        Journal journal(Journal::defaultLocation(out, textPath.string()), "another bundle", false);
+        journal.commit({ 0, 0, "-", "x" });
+    }
+    EXPECT_THROW(unbundler.unbundleFromFile(textPath.string(), out), BundleFormatException);
+}
+
+TEST_F(UnbundlerTest, GrepReportsEntryRelativeLines)
+{
+    using namespace codebundler;
+    EXPECT_EQ(grep::requiredLiteral("foo.*barbaz", grep::Syntax::Basic), "barbaz");
+    EXPECT_EQ(grep::requiredLiteral("colou?r", grep::Syntax::Extended), "colo");
+    EXPECT_EQ(grep::requiredLiteral("(abcdef)?x", grep::Syntax::Extended), "x");
+    EXPECT_EQ(grep::requiredLiteral("a{2}bc", grep::Syntax::Extended), "bc");
+    EXPECT_EQ(grep::requiredLiteral("cat|dog", grep::Syntax::Extended), "");
+    EXPECT_EQ(grep::requiredLiteral("std::vector\\.size", grep::Syntax::Basic), "std::vector.size");
+
+    const std::string text = create_valid_bundle();
+    std::vector<grep::Match> matches = grep::searchBuffer(text, grep::Matcher("lines", grep::Syntax::Fixed), 2);
+    ASSERT_EQ(matches.size(), 1u);
+    EXPECT_EQ(matches[0].path, "data/fileB.txt");
+    EXPECT_EQ(matches[0].line, 2u);
+    EXPECT_EQ(matches[0].text, "More lines.");
+    EXPECT_EQ(grep::searchBuffer(text, grep::Matcher("^file [0-9]", grep::Syntax::Basic, true), 2).size(), 2u);
+    EXPECT_TRUE(grep::searchBuffer(text, grep::Matcher("BOUNDARY", grep::Syntax::Fixed), 2).empty()); // Separators are not content
+
+    // An entry larger than one search unit is split, and its line numbers still count from the entry start
+    std::string large;
+    for (int i = 1; i <= 200000; ++i) {
+        large += (i % 50000 == 0 ? "needle " : "hay ") + std::to_string(i) + "\n";
+    }
+    std::ostringstream bundle;
+    binary::writeBundle(bundle, "===", "", { { "small.txt", "needle 0\n" }, { "large.txt", large } });
+    matches = grep::searchBuffer(bundle.str(), grep::Matcher("needle [0-9]+", grep::Syntax::Extended), 4);
+    ASSERT_EQ(matches.size(), 5u);
+    EXPECT_EQ(matches[0].path, "small.txt");
+    for (size_t i = 1; i < matches.size(); ++i) {
+        EXPECT_EQ(matches[i].path, "large.txt");
+        EXPECT_EQ(matches[i].line, i * 50000);
+        EXPECT_EQ(matches[i].text, "needle " + std::to_string(i * 50000));
+    }
+}
+
+TEST_F(UnbundlerTest, NdjsonBundleRoundTrip)
+{
+    using namespace codebundler;
+    const std::string binaryContent("\x00\x01\xff\nno trailing newline", 24);
+    const std::string text = "Tab\there, \"quoted\" \\ and caf\xc3\xa9 \xf0\x9f\x93\xa6\nbell \x07\n";
+    std::vector<binary::FileEntry> entries = {
+        { "src/a.txt", text, 0644 },
+        { "data/blob.bin", binaryContent, 0755 },
+        { "empty", "", 0600 },
+    };
+    std::filesystem::path bundlePath = test_output_dir / "bundle.ndjson";
+    {
+        std::ofstream out(bundlePath, std::ios::binary);
+        ndjson::writeBundle(out, "---", "A \"description\"", entries);
+    }
+    // One header line and one line per entry; only the non-UTF-8 entry is base64 encoded
+    const std::string written = utilities::readFileBytes(bundlePath);
+    EXPECT_EQ(std::count(written.begin(), written.end(), '\n'), 4);
+    const size_t blobLine = written.find("{\"path\":\"data/blob.bin\"");
+    ASSERT_NE(blobLine, std::string::npos);
+    EXPECT_EQ(written.find("\"encoding\""), written.find("\"encoding\":\"base64\"", blobLine));
+    EXPECT_NE(written.find("caf\xc3\xa9"), std::string::npos);
+    EXPECT_NE(written.find("bell \\u0007\\n"), std::string::npos);
+    EXPECT_EQ(ndjson::decodeString("\\ud83d\\udce6 \\u00e9\\/"), "\xf0\x9f\x93\xa6 \xc3\xa9/");
+
+    Unbundler unbundler { Options() };
+    EXPECT_EQ(unbundler.listEntries(bundlePath.string()), (std::vector<std::string> { "src/a.txt", "data/blob.bin", "empty" }));
+    std::filesystem::path outDir = test_output_dir / "out";
+    ASSERT_NO_THROW(unbundler.unbundleFromFile(bundlePath.string(), outDir));
+    EXPECT_EQ(utilities::readFileBytes(outDir / "src/a.txt"), text);
+    EXPECT_EQ(utilities::readFileBytes(outDir / "data/blob.bin"), binaryContent);
+    EXPECT_EQ(std::filesystem::file_size(outDir / "empty"), 0u);
+
+    binary::BundleContents contents = unbundler.readContents(bundlePath.string());
+    EXPECT_EQ(contents.separator, "---");
+    EXPECT_EQ(contents.description, "A \"description\"");
+    ASSERT_EQ(contents.entries.size(), 3u);
+    EXPECT_EQ(contents.entries[1].mode, 0755u);
+
+    // A tampered entry fails verification, and a required input format is enforced
+    std::string tampered = written;
+    tampered.replace(tampered.find("Tab"), 3, "Tub");
+    std::istringstream stream(tampered);
+    EXPECT_THROW(unbundler.unbundleFromStream(stream, test_output_dir / "tampered"), ChecksumMismatchException);
+    Options binaryOnly;
+    binaryOnly.inputFormat = "v2";
+    EXPECT_THROW(Unbundler(binaryOnly).unbundleFromFile(bundlePath.string(), test_output_dir / "other"), BundleFormatException);
+}